@@ -0,0 +1,317 @@
+/*
+ * Copyright (c) 2004-2006 Jussi Kivilinna
+ *
+ *    This file is part of "Metamod All-Mod-Support"-patch for Metamod.
+ *
+ *    Metamod is free software; you can redistribute it and/or modify it
+ *    under the terms of the GNU General Public License as published by the
+ *    Free Software Foundation; either version 2 of the License, or (at
+ *    your option) any later version.
+ *
+ *    Metamod is distributed in the hope that it will be useful, but
+ *    WITHOUT ANY WARRANTY; without even the implied warranty of
+ *    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ *    General Public License for more details.
+ *
+ *    You should have received a copy of the GNU General Public License
+ *    along with Metamod; if not, write to the Free Software Foundation,
+ *    Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+ *
+ *    In addition, as a special exception, the author gives permission to
+ *    link the code of this program with the Half-Life Game Engine ("HL
+ *    Engine") and Modified Game Libraries ("MODs") developed by Valve,
+ *    L.L.C ("Valve").  You must obey the GNU General Public License in all
+ *    respects for all of the code used other than the HL Engine and MODs
+ *    from Valve.  If you modify this file, you may extend this exception
+ *    to your version of the file, but you are not obligated to do so.  If
+ *    you do not wish to do so, delete this exception statement from your
+ *    version.
+ *
+ */
+
+#include <stddef.h>			// offsetof
+#include <string.h>			// memset
+#include <atomic>			// std::atomic
+#include <chrono>			// std::chrono::milliseconds
+#include <thread>			// std::thread, std::this_thread
+
+#include <extdll.h>			// always
+
+#include "api_async.h"		// me
+#include "api_hook.h"		// api_first_func, api_num_funcs, PLUGIN_MASK_TEST
+#include "metamod.h"		// Plugins
+#include "mlist.h"			// MPluginList
+#include "mplugin.h"		// MPlugin
+#include "log_meta.h"		// META_DEBUG, etc
+
+#define API_ASYNC_RING_MASK		(API_ASYNC_RING_SIZE - 1)
+
+// How long the worker sleeps when there's nothing to call.
+#define API_ASYNC_WORKER_SLEEP_MS	2
+
+// Functions that can have observers: ones whose arguments can be copied,
+// and whose calls observers might want to follow without holding up the
+// frame.
+static const struct {
+	enum_api_t api;
+	unsigned int func_offset;
+} async_funcs[] = {
+	{ e_api_dllapi, offsetof(DLL_FUNCTIONS, pfnClientConnect) },
+	{ e_api_dllapi, offsetof(DLL_FUNCTIONS, pfnClientDisconnect) },
+	{ e_api_dllapi, offsetof(DLL_FUNCTIONS, pfnClientKill) },
+	{ e_api_dllapi, offsetof(DLL_FUNCTIONS, pfnClientPutInServer) },
+	{ e_api_dllapi, offsetof(DLL_FUNCTIONS, pfnClientUserInfoChanged) },
+	{ e_api_dllapi, offsetof(DLL_FUNCTIONS, pfnServerActivate) },
+	{ e_api_dllapi, offsetof(DLL_FUNCTIONS, pfnServerDeactivate) },
+	{ e_api_engine, offsetof(enginefuncs_t, pfnMessageBegin) },
+	{ e_api_engine, offsetof(enginefuncs_t, pfnMessageEnd) },
+	{ e_api_engine, offsetof(enginefuncs_t, pfnWriteByte) },
+	{ e_api_engine, offsetof(enginefuncs_t, pfnWriteChar) },
+	{ e_api_engine, offsetof(enginefuncs_t, pfnWriteShort) },
+	{ e_api_engine, offsetof(enginefuncs_t, pfnWriteLong) },
+	{ e_api_engine, offsetof(enginefuncs_t, pfnWriteAngle) },
+	{ e_api_engine, offsetof(enginefuncs_t, pfnWriteCoord) },
+	{ e_api_engine, offsetof(enginefuncs_t, pfnWriteString) },
+	{ e_api_engine, offsetof(enginefuncs_t, pfnWriteEntity) },
+};
+
+// Observers as registered, running or not.
+typedef struct async_hook_s {
+	int plugin_index;		// 0 for a free entry
+	unsigned int fn;
+	void *pfn;
+} async_hook_t;
+
+// Observers of a function, by running plugins.
+typedef struct async_calls_s {
+	int plugin_index[API_ASYNC_MAX_CALLS];
+	void *pfn[API_ASYNC_MAX_CALLS];
+} async_calls_t;
+
+typedef struct async_rec_s {
+	unsigned int fn;
+	int ncalls;
+	async_calls_t calls;		// copied when queued; lists change
+	API_ASYNC_INVOKE_FN invoke;
+	char data[API_ASYNC_DATA_SIZE];
+} async_rec_t;
+
+unsigned char api_async_hooked[NUM_API_FUNCS];
+
+static async_hook_t async_hooks[API_ASYNC_MAX_HOOKS];
+static async_calls_t async_calls[NUM_API_FUNCS];
+
+// Records are filled in at head by the main thread and called at tail by
+// the worker.
+static async_rec_t async_ring[API_ASYNC_RING_SIZE];
+static std::atomic<unsigned int> async_head(0);
+static std::atomic<unsigned int> async_tail(0);
+
+static std::atomic<unsigned int> async_queued(0);
+static std::atomic<unsigned int> async_dropped(0);
+
+static std::thread *worker_thread = NULL;
+static std::atomic<bool> worker_stop(false);
+
+mBOOL DLLINTERNAL api_async_supported(enum_api_t api, unsigned int func_offset) {
+	unsigned int i;
+
+	for(i=0; i < sizeof(async_funcs) / sizeof(async_funcs[0]); i++) {
+		if(async_funcs[i].api == api && async_funcs[i].func_offset == func_offset)
+			return(mTRUE);
+	}
+	return(mFALSE);
+}
+
+mBOOL DLLINTERNAL api_async_set(int plugin_index, enum_api_t api, unsigned int func_offset, void *pfn) {
+	async_hook_t *free_hook;
+	unsigned int fn;
+	int i;
+
+	if(plugin_index < 1 || plugin_index > MAX_PLUGINS)
+		RETURN_ERRNO(mFALSE, ME_ARGUMENT);
+	if(!api_async_supported(api, func_offset))
+		RETURN_ERRNO(mFALSE, ME_ARGUMENT);
+	fn = api_first_func[api] + func_offset / sizeof(void*);
+
+	free_hook = NULL;
+	for(i=0; i < API_ASYNC_MAX_HOOKS; i++) {
+		if(!async_hooks[i].plugin_index) {
+			if(!free_hook)
+				free_hook = &async_hooks[i];
+			continue;
+		}
+		if(async_hooks[i].plugin_index == plugin_index && async_hooks[i].fn == fn) {
+			if(!pfn)
+				async_hooks[i].plugin_index = 0;
+			else
+				async_hooks[i].pfn = pfn;
+			rebuild_api_hook_lists();
+			return(mTRUE);
+		}
+	}
+	if(!pfn)
+		return(mTRUE);
+	if(!free_hook) {
+		META_WARNING("Too many async observers (max %d)", API_ASYNC_MAX_HOOKS);
+		RETURN_ERRNO(mFALSE, ME_MAXREACHED);
+	}
+	free_hook->plugin_index = plugin_index;
+	free_hook->fn = fn;
+	free_hook->pfn = pfn;
+	rebuild_api_hook_lists();
+	return(mTRUE);
+}
+
+mBOOL DLLINTERNAL api_async_plugin_hooks(int plugin_index, enum_api_t api, unsigned int func_offset) {
+	unsigned int fn = api_first_func[api] + func_offset / sizeof(void*);
+	int i;
+
+	for(i=0; i < API_ASYNC_MAX_HOOKS; i++) {
+		if(async_hooks[i].plugin_index == plugin_index && async_hooks[i].fn == fn)
+			return(mTRUE);
+	}
+	return(mFALSE);
+}
+
+void DLLINTERNAL api_async_update(void) {
+	MPlugin *iplug;
+	unsigned int fn;
+	int i, p, n;
+
+	memset(api_async_hooked, 0, sizeof(api_async_hooked));
+	if(!Plugins)
+		return;
+	// in plugin order, like the hook lists
+	for(p=0; p < Plugins->endlist; p++) {
+		iplug = &Plugins->plist[p];
+		if(iplug->status != PL_RUNNING)
+			continue;
+		for(i=0; i < API_ASYNC_MAX_HOOKS; i++) {
+			if(async_hooks[i].plugin_index != iplug->index)
+				continue;
+			fn = async_hooks[i].fn;
+			n = api_async_hooked[fn];
+			if(n >= API_ASYNC_MAX_CALLS) {
+				META_WARNING("Too many async observers of a function (max %d); ignoring plugin '%s'", 
+						API_ASYNC_MAX_CALLS, iplug->desc);
+				continue;
+			}
+			async_calls[fn].plugin_index[n] = iplug->index;
+			async_calls[fn].pfn[n] = async_hooks[i].pfn;
+			api_async_hooked[fn] = n + 1;
+		}
+	}
+}
+
+void DLLINTERNAL api_async_remove_plugin(int plugin_index) {
+	int i;
+
+	for(i=0; i < API_ASYNC_MAX_HOOKS; i++) {
+		if(async_hooks[i].plugin_index == plugin_index)
+			async_hooks[i].plugin_index = 0;
+	}
+	api_async_update();
+	// calls already queued still point into the plugin
+	api_async_drain();
+}
+
+// Call observers for records up to head.  Worker thread only.
+static unsigned int DLLINTERNAL call_async_records(void) {
+	unsigned int tail, head, count;
+	async_rec_t *rec;
+	int i;
+
+	count = 0;
+	tail = async_tail.load(std::memory_order_relaxed);
+	head = async_head.load(std::memory_order_acquire);
+	while(tail != head) {
+		rec = &async_ring[tail & API_ASYNC_RING_MASK];
+		for(i=0; i < rec->ncalls; i++)
+			rec->invoke(rec->calls.pfn[i], rec->data);
+		async_tail.store(++tail, std::memory_order_release);
+		count++;
+	}
+	return(count);
+}
+
+static void DLLINTERNAL async_worker_main(void) {
+	while(!worker_stop.load(std::memory_order_acquire)) {
+		if(!call_async_records())
+			std::this_thread::sleep_for(std::chrono::milliseconds(API_ASYNC_WORKER_SLEEP_MS));
+	}
+	// whatever was queued before the stop
+	call_async_records();
+}
+
+mBOOL DLLINTERNAL api_async_begin(unsigned int fn, const unsigned int *plugin_mask, API_ASYNC_INVOKE_FN invoke, api_async_writer *writer) {
+	const async_calls_t *calls = &async_calls[fn];
+	unsigned int head;
+	async_rec_t *rec;
+	int i, n;
+
+	head = async_head.load(std::memory_order_relaxed);
+	if(unlikely(head - async_tail.load(std::memory_order_acquire) >= API_ASYNC_RING_SIZE)) {
+		async_dropped.fetch_add(1, std::memory_order_relaxed);
+		return(mFALSE);
+	}
+
+	rec = &async_ring[head & API_ASYNC_RING_MASK];
+	n = 0;
+	for(i=0; i < api_async_hooked[fn]; i++) {
+		if(plugin_mask && !PLUGIN_MASK_TEST(plugin_mask, calls->plugin_index[i]))
+			continue;
+		rec->calls.plugin_index[n] = calls->plugin_index[i];
+		rec->calls.pfn[n] = calls->pfn[i];
+		n++;
+	}
+	if(!n)
+		return(mFALSE);
+
+	if(unlikely(!worker_thread)) {
+		worker_stop.store(false);
+		worker_thread = new std::thread(async_worker_main);
+		META_DEBUG(2, ("Started async observer thread"));
+	}
+
+	rec->fn = fn;
+	rec->ncalls = n;
+	rec->invoke = invoke;
+	writer->cur = rec->data;
+	writer->end = rec->data + sizeof(rec->data);
+	return(mTRUE);
+}
+
+void DLLINTERNAL api_async_commit(api_async_writer *writer) {
+	if(unlikely(writer->cur > writer->end)) {
+		async_dropped.fetch_add(1, std::memory_order_relaxed);
+		return;
+	}
+	async_head.fetch_add(1, std::memory_order_release);
+	async_queued.fetch_add(1, std::memory_order_relaxed);
+}
+
+void DLLINTERNAL api_async_drain(void) {
+	if(!worker_thread)
+		return;
+	while(async_tail.load(std::memory_order_acquire) != async_head.load(std::memory_order_relaxed))
+		std::this_thread::sleep_for(std::chrono::milliseconds(1));
+}
+
+void DLLINTERNAL api_async_stop(void) {
+	if(!worker_thread)
+		return;
+	worker_stop.store(true, std::memory_order_release);
+	worker_thread->join();
+	delete worker_thread;
+	worker_thread = NULL;
+	META_DEBUG(2, ("Stopped async observer thread"));
+}
+
+unsigned int DLLINTERNAL api_async_queued(void) {
+	return(async_queued.load(std::memory_order_relaxed));
+}
+
+unsigned int DLLINTERNAL api_async_dropped(void) {
+	return(async_dropped.load(std::memory_order_relaxed));
+}
@@ -0,0 +1,251 @@
+/*
+ * Copyright (c) 2004-2006 Jussi Kivilinna
+ *
+ *    This file is part of "Metamod All-Mod-Support"-patch for Metamod.
+ *
+ *    Metamod is free software; you can redistribute it and/or modify it
+ *    under the terms of the GNU General Public License as published by the
+ *    Free Software Foundation; either version 2 of the License, or (at
+ *    your option) any later version.
+ *
+ *    Metamod is distributed in the hope that it will be useful, but
+ *    WITHOUT ANY WARRANTY; without even the implied warranty of
+ *    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ *    General Public License for more details.
+ *
+ *    You should have received a copy of the GNU General Public License
+ *    along with Metamod; if not, write to the Free Software Foundation,
+ *    Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+ *
+ *    In addition, as a special exception, the author gives permission to
+ *    link the code of this program with the Half-Life Game Engine ("HL
+ *    Engine") and Modified Game Libraries ("MODs") developed by Valve,
+ *    L.L.C ("Valve").  You must obey the GNU General Public License in all
+ *    respects for all of the code used other than the HL Engine and MODs
+ *    from Valve.  If you modify this file, you may extend this exception
+ *    to your version of the file, but you are not obligated to do so.  If
+ *    you do not wish to do so, delete this exception statement from your
+ *    version.
+ *
+ */
+
+#ifndef API_ASYNC_H
+#define API_ASYNC_H
+
+#include <stddef.h>			// size_t
+#include <string.h>			// memcpy, strlen
+#include <tuple>			// std::tuple
+#include <type_traits>		// std::is_arithmetic, etc
+#include <utility>			// std::index_sequence
+
+#include <extdll.h>			// edict_t
+
+#include "sdk_util.h"		// ENTINDEX
+#include "types_meta.h"		// mBOOL
+#include "api_info.h"		// NUM_API_FUNCS, enum_api_t
+#include "osdep.h"			// DLLINTERNAL, unlikely
+
+// Async observers: plugin routines registered with SET_ASYNC_POST_HOOK,
+// called after an api function, like post hooks, but later and on
+// metamod's worker thread, so their work stays out of the frame.
+//
+// After the post hooks, the wrapper copies the call's arguments into a
+// record in a ring: numbers as they are, strings (with a length) and
+// vectors (3 floats).  An edict_t pointer is turned into its entity index
+// (-1 for NULL) on the game thread, and observers get that int in its
+// place; by the time the worker runs, the edict may have been freed and
+// reused.  The worker calls the observers with the arguments unpacked
+// from the record, in the order the calls were made.  When the ring is
+// full, calls are dropped and counted, not waited for.
+//
+// Only the functions in api_async.cpp's list are wrapped this way; they
+// have arguments that can be copied.  Observers are called after the
+// plugin's post hooks for the call, with no meta globals; the engine and
+// gamedll may be anywhere in a later frame by then.
+
+// Must be a power of 2.
+#define API_ASYNC_RING_SIZE		256
+// Bytes of arguments in a record; longer strings are cut.
+#define API_ASYNC_DATA_SIZE		512
+// Observers registered, all plugins together.
+#define API_ASYNC_MAX_HOOKS		64
+// Observers of one function.
+#define API_ASYNC_MAX_CALLS		8
+
+// Unpacks a record's arguments and calls pfn with them.
+typedef void (*API_ASYNC_INVOKE_FN)(void *pfn, const char *data);
+
+// Number of running plugins observing each function.
+extern unsigned char api_async_hooked[NUM_API_FUNCS] DLLHIDDEN;
+
+// Whether function (api, func_offset) can have observers.
+mBOOL DLLINTERNAL api_async_supported(enum_api_t api, unsigned int func_offset);
+
+// Register pfn as plugin's observer of a function; NULL removes it.
+mBOOL DLLINTERNAL api_async_set(int plugin_index, enum_api_t api, unsigned int func_offset, void *pfn);
+// Whether plugin observes a function.
+mBOOL DLLINTERNAL api_async_plugin_hooks(int plugin_index, enum_api_t api, unsigned int func_offset);
+// Forget all of plugin's observers.
+void DLLINTERNAL api_async_remove_plugin(int plugin_index);
+// Redo api_async_hooked from running plugins' observers.
+void DLLINTERNAL api_async_update(void);
+
+// Wait until the worker has made all queued calls.
+void DLLINTERNAL api_async_drain(void);
+// Make queued calls, and stop the worker.
+void DLLINTERNAL api_async_stop(void);
+
+unsigned int DLLINTERNAL api_async_queued(void);
+unsigned int DLLINTERNAL api_async_dropped(void);
+
+// Writes arguments into a record being queued.
+class api_async_writer {
+	public:
+		char *cur;
+		char *end;
+
+		void DLLINTERNAL put_bytes(const void *src, size_t len) {
+			if(unlikely(len > (size_t)(end - cur))) {
+				cur = end + 1;		// overflowed; record is dropped
+				return;
+			}
+			memcpy(cur, src, len);
+			cur += len;
+		}
+		template<typename T>
+		void DLLINTERNAL put(T value) {
+			static_assert(std::is_arithmetic<T>::value || std::is_enum<T>::value,
+					"no async copy for this argument type");
+			put_bytes(&value, sizeof(value));
+		}
+		void DLLINTERNAL put(edict_t *ed) {
+			put(ed ? ENTINDEX(ed) : -1);
+		}
+		void DLLINTERNAL put(const float *vec) {
+			unsigned char present = vec ? 1 : 0;
+			put_bytes(&present, 1);
+			if(vec)
+				put_bytes(vec, 3 * sizeof(float));
+		}
+		void DLLINTERNAL put(const char *str) {
+			unsigned short len;
+			if(!str) {
+				len = 0xffff;
+				put_bytes(&len, sizeof(len));
+				return;
+			}
+			size_t n = strlen(str);
+			// cut to what fits, leaving the length and trailing null
+			if(cur + sizeof(len) + n + 1 > end)
+				n = (end - cur) > (ptrdiff_t)(sizeof(len) + 1) ? (end - cur) - sizeof(len) - 1 : 0;
+			len = (unsigned short)n;
+			put_bytes(&len, sizeof(len));
+			put_bytes(str, n);
+			put_bytes("", 1);
+		}
+		void DLLINTERNAL put(char *str) {
+			put((const char *)str);
+		}
+};
+
+// Reads them back, on the worker.
+class api_async_reader {
+	public:
+		const char *cur;
+		float vecs[4][3];		// vectors, copied out aligned
+		int nvecs;
+
+		api_async_reader(const char *data) : cur(data), nvecs(0) {}
+
+		template<typename T>
+		T DLLINTERNAL get(void) {
+			return(getter((T *)NULL));
+		}
+
+	private:
+		template<typename T>
+		T DLLINTERNAL getter(T *) {
+			T value;
+			memcpy(&value, cur, sizeof(value));
+			cur += sizeof(value);
+			return(value);
+		}
+		const float * DLLINTERNAL getter(const float **) {
+			float *vec;
+			if(!*cur++)
+				return(NULL);
+			vec = vecs[nvecs++ & 3];
+			memcpy(vec, cur, 3 * sizeof(float));
+			cur += 3 * sizeof(float);
+			return(vec);
+		}
+		char * DLLINTERNAL getter(char **) {
+			unsigned short len;
+			char *str;
+			memcpy(&len, cur, sizeof(len));
+			cur += sizeof(len);
+			if(len == 0xffff)
+				return(NULL);
+			str = (char *)cur;
+			cur += len + 1;
+			return(str);
+		}
+		const char * DLLINTERNAL getter(const char **) {
+			return(getter((char **)NULL));
+		}
+};
+
+// Claim a record for a call of function fn, for running observers that
+// plugin_mask (NULL for all) allows; NULL if there are none or the ring is
+// full.
+mBOOL DLLINTERNAL api_async_begin(unsigned int fn, const unsigned int *plugin_mask, API_ASYNC_INVOKE_FN invoke, api_async_writer *writer);
+// Hand the record to the worker, unless its arguments didn't fit.
+void DLLINTERNAL api_async_commit(api_async_writer *writer);
+
+// Argument type observers get for an argument of type T.
+template<typename T> struct api_async_arg { typedef T type; };
+template<> struct api_async_arg<edict_t *> { typedef int type; };
+
+template<typename fn_t> struct api_async_call;
+
+template<typename ret_t, typename... args_t>
+struct api_async_call<ret_t (*)(args_t...)> {
+	typedef ret_t (*fn_t)(typename api_async_arg<args_t>::type...);
+
+	template<size_t... I>
+	static void DLLINTERNAL call(void *pfn, std::tuple<typename api_async_arg<args_t>::type...> &args, std::index_sequence<I...>) {
+		(*(fn_t)pfn)(std::get<I>(args)...);
+	}
+
+	static void DLLINTERNAL invoke(void *pfn, const char *data) {
+		api_async_reader reader(data);
+		// braced init reads the arguments in order
+		std::tuple<typename api_async_arg<args_t>::type...> args{ reader.get<typename api_async_arg<args_t>::type>()... };
+		call(pfn, args, std::index_sequence_for<args_t...>());
+	}
+
+	// Queues a call when called with the function's arguments.
+	struct queuer {
+		unsigned int fn;
+		const unsigned int *plugin_mask;
+
+		void DLLINTERNAL operator()(args_t... args) const {
+			api_async_writer writer;
+			if(!api_async_begin(fn, plugin_mask, invoke, &writer))
+				return;
+			int order[] = { 0, (writer.put(args), 0)... };
+			(void)order;
+			api_async_commit(&writer);
+		}
+	};
+};
+
+// Queue a call of an api function for its async observers, if it has any.
+// Needs api_hook.h, for api_first_func.
+#define API_ASYNC_POST(api, table_t, pfnName, FN_TYPE, plugin_mask, pfn_args) \
+	if(unlikely(api_async_hooked[api_first_func[api] + offsetof(table_t, pfnName) / sizeof(void*)])) { \
+		api_async_call<FN_TYPE>::queuer async_queuer = { api_first_func[api] + (unsigned int)(offsetof(table_t, pfnName) / sizeof(void*)), plugin_mask }; \
+		async_queuer pfn_args; \
+	}
+
+#endif /* API_ASYNC_H */
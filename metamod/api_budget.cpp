@@ -0,0 +1,202 @@
+/*
+ * Copyright (c) 2004-2006 Jussi Kivilinna
+ *
+ *    This file is part of "Metamod All-Mod-Support"-patch for Metamod.
+ *
+ *    Metamod is free software; you can redistribute it and/or modify it
+ *    under the terms of the GNU General Public License as published by the
+ *    Free Software Foundation; either version 2 of the License, or (at
+ *    your option) any later version.
+ *
+ *    Metamod is distributed in the hope that it will be useful, but
+ *    WITHOUT ANY WARRANTY; without even the implied warranty of
+ *    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ *    General Public License for more details.
+ *
+ *    You should have received a copy of the GNU General Public License
+ *    along with Metamod; if not, write to the Free Software Foundation,
+ *    Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+ *
+ *    In addition, as a special exception, the author gives permission to
+ *    link the code of this program with the Half-Life Game Engine ("HL
+ *    Engine") and Modified Game Libraries ("MODs") developed by Valve,
+ *    L.L.C ("Valve").  You must obey the GNU General Public License in all
+ *    respects for all of the code used other than the HL Engine and MODs
+ *    from Valve.  If you modify this file, you may extend this exception
+ *    to your version of the file, but you are not obligated to do so.  If
+ *    you do not wish to do so, delete this exception statement from your
+ *    version.
+ *
+ */
+
+#include <stdlib.h>			// strtol, qsort
+#include <string.h>			// memset, strlen
+
+#include <extdll.h>
+
+#include "api_budget.h"		// me
+#include "api_prof.h"		// api_prof_frame_tsc, api_prof_tsc_per_usec
+#include "metamod.h"		// Plugins, Config
+#include "log_meta.h"		// META_WARNING, etc
+#include "osdep.h"			// strncasecmp, unlikely
+
+typedef struct api_budget_s {
+	int budget_usec;			// 0 for no budget
+	int over_streak;			// frames over budget in a row
+	unsigned long long frames;		// frames since plugin was loaded
+	unsigned long long frames_over;
+	unsigned long long total_tsc;
+	unsigned long long worst_tsc;
+} api_budget_t;
+
+static api_budget_t budgets[MAX_PLUGINS + 1];
+static unsigned long long budget_frames;
+
+// Find budget for plugin in config "budget_plugins", which is a list of
+// "name=usec" entries, where name is a prefix of the plugin's file, or its
+// logtag.
+static int DLLINTERNAL find_plugin_budget(MPlugin *plug) {
+	const char *cp, *eq;
+	char *endptr;
+	size_t len;
+	int usec;
+
+	cp = Config->budget_plugins;
+	while(cp && *cp) {
+		cp += strspn(cp, " \t,");
+		eq = strchr(cp, '=');
+		if(!eq)
+			break;
+		len = eq - cp;
+		usec = strtol(eq + 1, &endptr, 10);
+		if(len && (!strncasecmp(plug->file, cp, len)
+				|| (plug->info && plug->info->logtag
+					&& strlen(plug->info->logtag) == len
+					&& !strncasecmp(plug->info->logtag, cp, len))))
+			return(usec);
+		cp = endptr;
+	}
+	return(Config->budget_usec);
+}
+
+void DLLINTERNAL api_budget_reset_plugin(MPlugin *plug) {
+	memset(&budgets[plug->index], 0, sizeof(api_budget_t));
+	budgets[plug->index].budget_usec = find_plugin_budget(plug);
+	if(budgets[plug->index].budget_usec)
+		META_DEBUG(3, ("Frame budget for plugin '%s': %d usec", plug->desc, budgets[plug->index].budget_usec));
+}
+
+void DLLINTERNAL api_budget_reset(void) {
+	int i, usec;
+
+	for(i=0; i <= MAX_PLUGINS; i++) {
+		usec = budgets[i].budget_usec;
+		memset(&budgets[i], 0, sizeof(api_budget_t));
+		budgets[i].budget_usec = usec;
+	}
+	budget_frames = 0;
+}
+
+void DLLINTERNAL api_budget_end_frame(void) {
+	api_budget_t *budget;
+	MPlugin *plug;
+	double tsc_per_usec, frame_usec;
+	unsigned long long frame_tsc;
+	int i;
+
+	// gamedll/engine time isn't budgeted
+	api_prof_frame_tsc[API_PROF_SLOT_REAL] = 0;
+
+	tsc_per_usec = api_prof_tsc_per_usec();
+	if(unlikely(!tsc_per_usec) || unlikely(!Plugins)) {
+		memset(api_prof_frame_tsc, 0, sizeof(api_prof_frame_tsc));
+		return;
+	}
+	budget_frames++;
+
+	for(i=0; i < Plugins->endlist; i++) {
+		budget = &budgets[i + 1];
+		frame_tsc = api_prof_frame_tsc[i + 1];
+		api_prof_frame_tsc[i + 1] = 0;
+
+		budget->frames++;
+		budget->total_tsc += frame_tsc;
+		if(frame_tsc > budget->worst_tsc)
+			budget->worst_tsc = frame_tsc;
+
+		if(!budget->budget_usec || frame_tsc <= budget->budget_usec * tsc_per_usec) {
+			budget->over_streak = 0;
+			continue;
+		}
+		budget->frames_over++;
+		// act once per streak; a limit below 1 acts on the first frame over
+		if(++budget->over_streak != (Config->budget_frames > 1 ? Config->budget_frames : 1))
+			continue;
+
+		plug = &Plugins->plist[i];
+		if(plug->status != PL_RUNNING)
+			continue;
+		frame_usec = frame_tsc / tsc_per_usec;
+		if(Config->budget_autopause) {
+			META_WARNING("Plugin '%s' over frame budget for %d frames (%.0f usec > %d usec); pausing", 
+					plug->desc, budget->over_streak, frame_usec, budget->budget_usec);
+			if(plug->pause())
+				plug->budget_paused=mTRUE;
+		}
+		else {
+			META_WARNING("Plugin '%s' over frame budget for %d frames (%.0f usec > %d usec)", 
+					plug->desc, budget->over_streak, frame_usec, budget->budget_usec);
+		}
+	}
+}
+
+static int budget_cmp(const void *a, const void *b) {
+	const api_budget_t *ba = &budgets[*(const int *)a];
+	const api_budget_t *bb = &budgets[*(const int *)b];
+
+	if(ba->total_tsc > bb->total_tsc)
+		return(-1);
+	if(ba->total_tsc < bb->total_tsc)
+		return(1);
+	return(0);
+}
+
+void DLLINTERNAL api_budget_show(void) {
+	int order[MAX_PLUGINS];
+	api_budget_t *budget;
+	MPlugin *plug;
+	double tsc_per_usec;
+	int i, n;
+
+	tsc_per_usec = api_prof_tsc_per_usec();
+	if(!tsc_per_usec || !budget_frames) {
+		META_CONS("No frames recorded yet.");
+		return;
+	}
+
+	n = 0;
+	for(i=0; i < Plugins->endlist; i++) {
+		if(Plugins->plist[i].status < PL_VALID || !budgets[i + 1].frames)
+			continue;
+		order[n++] = i + 1;
+	}
+	qsort(order, n, sizeof(int), budget_cmp);
+
+	META_CONS("Hook time per frame over %.0f frames:", (double)budget_frames);
+	META_CONS("%*s %-20s %8s %10s %10s %10s %10s", WIDTH_MAX_PLUGINS, "", 
+			"description", "stat", "budget us", "avg us", "worst us", "over");
+	for(i=0; i < n; i++) {
+		plug = &Plugins->plist[order[i] - 1];
+		budget = &budgets[order[i]];
+		if(budget->budget_usec)
+			META_CONS("%*d %-20.20s %8s %10d %10.1f %10.1f %10.0f", WIDTH_MAX_PLUGINS, plug->index,
+					plug->desc, plug->str_status(ST_SHOW), budget->budget_usec,
+					budget->total_tsc / tsc_per_usec / budget->frames,
+					budget->worst_tsc / tsc_per_usec, (double)budget->frames_over);
+		else
+			META_CONS("%*d %-20.20s %8s %10s %10.1f %10.1f %10s", WIDTH_MAX_PLUGINS, plug->index,
+					plug->desc, plug->str_status(ST_SHOW), "-",
+					budget->total_tsc / tsc_per_usec / budget->frames,
+					budget->worst_tsc / tsc_per_usec, "-");
+	}
+}
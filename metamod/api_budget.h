@@ -0,0 +1,58 @@
+/*
+ * Copyright (c) 2004-2006 Jussi Kivilinna
+ *
+ *    This file is part of "Metamod All-Mod-Support"-patch for Metamod.
+ *
+ *    Metamod is free software; you can redistribute it and/or modify it
+ *    under the terms of the GNU General Public License as published by the
+ *    Free Software Foundation; either version 2 of the License, or (at
+ *    your option) any later version.
+ *
+ *    Metamod is distributed in the hope that it will be useful, but
+ *    WITHOUT ANY WARRANTY; without even the implied warranty of
+ *    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ *    General Public License for more details.
+ *
+ *    You should have received a copy of the GNU General Public License
+ *    along with Metamod; if not, write to the Free Software Foundation,
+ *    Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+ *
+ *    In addition, as a special exception, the author gives permission to
+ *    link the code of this program with the Half-Life Game Engine ("HL
+ *    Engine") and Modified Game Libraries ("MODs") developed by Valve,
+ *    L.L.C ("Valve").  You must obey the GNU General Public License in all
+ *    respects for all of the code used other than the HL Engine and MODs
+ *    from Valve.  If you modify this file, you may extend this exception
+ *    to your version of the file, but you are not obligated to do so.  If
+ *    you do not wish to do so, delete this exception statement from your
+ *    version.
+ *
+ */
+
+#ifndef API_BUDGET_H
+#define API_BUDGET_H
+
+#include "comp_dep.h"
+#include "mplugin.h"		// MPlugin
+
+// Per-frame hook time budgets for plugins.
+//
+// Time each plugin spends in its hooks is summed per frame by api_prof
+// (see api_prof_frame_tsc), and checked at every StartFrame against the
+// plugin's budget from config.ini: "budget_usec" for all plugins, or a
+// "budget_plugins" entry for this one.  A plugin that goes over budget
+// for "budget_frames" frames in a row is reported, and paused if
+// "budget_autopause" is set.
+
+// set budget for newly loaded plugin, and clear its counters
+void DLLINTERNAL api_budget_reset_plugin(MPlugin *plug);
+
+// check and clear time spent in the frame that just ended
+void DLLINTERNAL api_budget_end_frame(void);
+
+void DLLINTERNAL api_budget_reset(void);
+
+// print plugins with most time spent to console
+void DLLINTERNAL api_budget_show(void);
+
+#endif /* API_BUDGET_H */
@@ -32,665 +32,333 @@
 #include <stddef.h>			// offsetof
 #include <extdll.h>
 
-#include "ret_type.h"
 #include "types_meta.h"
 #include "api_info.h"
 #include "api_hook.h"
 #include "mplugin.h"
 #include "metamod.h"
 #include "osdep.h"			//unlikely
+#include "ent_filter.h"		// ent_filter_update
+#include "mlist.h"			// MAX_PLUGINS
+#include "api_async.h"		// api_async_update, etc
+#include "reg_support.h"	// meta_client_command_hook
+
+const unsigned int api_num_funcs[3] = {
+	NUM_ENGINE_FUNCS,
+	NUM_DLLAPI_FUNCS,
+	NUM_NEWAPI_FUNCS
+};
 
-// getting pointer with table index is faster than with if-else
-static const void ** api_tables[3] = {
-	(const void**)&Engine.funcs,
-	(const void**)&GameDLL.funcs.dllapi_table,
-	(const void**)&GameDLL.funcs.newapi_table
+const unsigned int api_first_func[3] = {
+	0,
+	NUM_ENGINE_FUNCS,
+	NUM_ENGINE_FUNCS + NUM_DLLAPI_FUNCS
 };
 
-static const void ** api_info_tables[3] = {
-	(const void**)&engine_info,
-	(const void**)&dllapi_info,
-	(const void**)&newapi_info
+unsigned char api_func_hooked[3][MAX_API_TABLE_FUNCS];
+
+static api_hook_lists_t empty_hook_lists;
+api_hook_lists_t *api_hook_lists = &empty_hook_lists;
+api_hook_lists_t *retired_api_hook_lists = NULL;
+
+unsigned int api_hook_call_count = 0;
+
+// Plugins' hook priority and HOOK_* flags, by plugin index and function.
+static int hook_priority[MAX_PLUGINS + 1][NUM_API_FUNCS];
+static unsigned char hook_flags[MAX_PLUGINS + 1][NUM_API_FUNCS];
+// Pre/post hooks plugins have turned off, by plugin index and function.
+static unsigned char hook_disabled[MAX_PLUGINS + 1][2][NUM_API_FUNCS];
+
+unsigned int msg_hook_plugins[256][PLUGIN_MASK_WORDS];
+unsigned char msg_hooks_wanted[256];
+const unsigned int *cur_msg_plugins = msg_hook_plugins[0];
+int cur_msg_hooked = 0;
+
+// Engine message functions, for which plugins can pick msg ids.
+static const unsigned int msg_func_offsets[] = {
+	offsetof(enginefuncs_t, pfnMessageBegin),
+	offsetof(enginefuncs_t, pfnMessageEnd),
+	offsetof(enginefuncs_t, pfnWriteByte),
+	offsetof(enginefuncs_t, pfnWriteChar),
+	offsetof(enginefuncs_t, pfnWriteShort),
+	offsetof(enginefuncs_t, pfnWriteLong),
+	offsetof(enginefuncs_t, pfnWriteAngle),
+	offsetof(enginefuncs_t, pfnWriteCoord),
+	offsetof(enginefuncs_t, pfnWriteString),
+	offsetof(enginefuncs_t, pfnWriteEntity),
 };
 
-// Safety check for metamod-bot-plugin bugfix.
-//  engine_api->pfnRunPlayerMove calls dllapi-functions before it returns.
-//  This causes problems with bots running as metamod plugins, because
-//  metamod assumed that PublicMetaGlobals is free to be used.
-//  With call_count we can fix this by backuping up PublicMetaGlobals if 
-//  it's already being used.
-static unsigned int call_count = 0;
-
-// get function pointer from api table by function pointer offset
-inline void * DLLINTERNAL get_api_function(const void * api_table, unsigned int func_offset) {
-	return(*(void**)((unsigned long)api_table + func_offset));
+void DLLINTERNAL free_retired_api_hook_lists(void) {
+	while(retired_api_hook_lists) {
+		api_hook_lists_t *next = retired_api_hook_lists->next_retired;
+		free(retired_api_hook_lists);
+		retired_api_hook_lists = next;
+	}
 }
 
-// get data pointer from api_info table by function offset
-inline const api_info_t * DLLINTERNAL get_api_info(enum_api_t api, unsigned int api_info_offset) {
-	return((const api_info_t *)((unsigned long)api_info_tables[api] + api_info_offset));
+void * DLLINTERNAL get_plugin_hook(MPlugin *plug, int post, enum_api_t api, unsigned int func_offset) {
+	const void *api_table;
+
+	api_table = post ? plug->get_api_post_table(api) : plug->get_api_table(api);
+	if(!api_table)
+		return(NULL);
+	if(unlikely(hook_disabled[plug->index][post][api_first_func[api] + func_offset / sizeof(void*)]))
+		return(NULL);
+	return(get_api_function(api_table, func_offset));
 }
 
-// simplified 'void' version of main hook function
-void DLLINTERNAL main_hook_function_void(unsigned int api_info_offset, enum_api_t api, unsigned int func_offset, const void * packed_args) {
-	const api_info_t *api_info;
-	int i;
-	META_RES mres, status, prev_mres;
-	MPlugin *iplug;
-	void *pfn_routine;
-	int loglevel;
-	const void *api_table;
-	meta_globals_t backup_meta_globals[1];
-	
-	//passing offset from api wrapper function makes code faster/smaller
-	api_info = get_api_info(api, api_info_offset);
-	
-	//Fix bug with metamod-bot-plugins.
-	if(unlikely(call_count++>0)) {
-		//Backup PublicMetaGlobals.
-		backup_meta_globals[0] = PublicMetaGlobals;
-	}
-	
-	//Setup
-	loglevel=api_info->loglevel;
-	mres=MRES_UNSET;
-	status=MRES_UNSET;
-	prev_mres=MRES_UNSET;
-	pfn_routine=NULL;
-	
-	//Pre plugin functions
-	prev_mres=MRES_UNSET;
-	for(i=0; likely(i < Plugins->endlist); i++) {
-		iplug=&Plugins->plist[i];
-		
-		if(unlikely(iplug->status != PL_RUNNING))
-			continue;
-		
-		api_table = iplug->get_api_table(api);
-		if(likely(!api_table)) {
-			//plugin doesn't provide this api table
-			continue;
-		}
-		
-		pfn_routine=get_api_function(api_table, func_offset);
-		if(likely(!pfn_routine)) {
-			//plugin doesn't provide this function
-			continue;
-		}
-		
-		// initialize PublicMetaGlobals
-		PublicMetaGlobals.mres = MRES_UNSET;
-		PublicMetaGlobals.prev_mres = prev_mres;
-		PublicMetaGlobals.status = status;
-		
-		// call plugin
-		META_DEBUG(loglevel, ("Calling %s:%s()", iplug->file, api_info->name));
-		api_info->api_caller(pfn_routine, packed_args);
-		API_UNPAUSE_TSC_TRACKING();
-		
-		// plugin's result code
-		mres=PublicMetaGlobals.mres;
-		if(unlikely(mres > status))
-			status = mres;
-		
-		// save this for successive plugins to see
-		prev_mres = mres;
-		
-		if(unlikely(mres==MRES_UNSET))
-			META_WARNING("Plugin didn't set meta_result: %s:%s()", iplug->file, api_info->name);
-	}
-	
-	call_count--;
-	
-	//Api call
-	if(likely(status!=MRES_SUPERCEDE)) {
-		//get api table
-		api_table = *api_tables[api];
-		
-		if(likely(api_table)) {
-			pfn_routine = get_api_function(api_table, func_offset);
-			if(likely(pfn_routine)) {
-				META_DEBUG(loglevel, ("Calling %s:%s()", (api==e_api_engine)?"engine":GameDLL.file, api_info->name));
-				api_info->api_caller(pfn_routine, packed_args);
-				API_UNPAUSE_TSC_TRACKING();
-			} else {
-				// don't complain for NULL routines in NEW_DLL_FUNCTIONS
-				if(unlikely(api != e_api_newapi))
-					META_WARNING("Couldn't find api call: %s:%s", (api==e_api_engine)?"engine":GameDLL.file, api_info->name);
-				status=MRES_UNSET;
-			}
-		} else {
-			// don't complain for NULL NEW_DLL_FUNCTIONS-table
-			if(unlikely(api != e_api_newapi))
-				META_DEBUG(loglevel, ("No api table defined for api call: %s:%s", (api==e_api_engine)?"engine":GameDLL.file, api_info->name));
-			status=MRES_UNSET;
-		}
-	} else
-		META_DEBUG(loglevel, ("Skipped (supercede) %s:%s()", (api==e_api_engine)?"engine":GameDLL.file, api_info->name));
-	
-	call_count++;
-	
-	//Post plugin functions
-	prev_mres=MRES_UNSET;
-	for(i=0; likely(i < Plugins->endlist); i++) {
-		iplug=&Plugins->plist[i];
-		
-		if(unlikely(iplug->status != PL_RUNNING))
-			continue;
-		
-		api_table = iplug->get_api_post_table(api);
-		if(likely(!api_table)) {
-			//plugin doesn't provide this api table
-			continue;
-		}
-		
-		pfn_routine=get_api_function(api_table, func_offset);
-		if(likely(!pfn_routine)) {
-			//plugin doesn't provide this function
-			continue;
-		}
-		
-		// initialize PublicMetaGlobals
-		PublicMetaGlobals.mres = MRES_UNSET;
-		PublicMetaGlobals.prev_mres = prev_mres;
-		PublicMetaGlobals.status = status;
-		
-		// call plugin
-		META_DEBUG(loglevel, ("Calling %s:%s_Post()", iplug->file, api_info->name));
-		api_info->api_caller(pfn_routine, packed_args);
-		API_UNPAUSE_TSC_TRACKING();
-		
-		// plugin's result code
-		mres=PublicMetaGlobals.mres;
-		if(unlikely(mres > status))
-			status = mres;
-		
-		// save this for successive plugins to see
-		prev_mres = mres;
-		
-		if(unlikely(mres==MRES_UNSET))
-			META_WARNING("Plugin didn't set meta_result: %s:%s_Post()", iplug->file, api_info->name);
-		else if(unlikely(mres==MRES_SUPERCEDE))
-			META_WARNING("MRES_SUPERCEDE not valid in Post functions: %s:%s_Post()", iplug->file, api_info->name);
-	}
+// Metamod's own hook of a function in place of plugin: a ClientCommand
+// pre hook for its REG_CLIENT_COMMAND commands, if it has any.
+static void * DLLINTERNAL get_meta_hook(MPlugin *plug, int post, unsigned int fn) {
+	if(post || fn != api_first_func[e_api_dllapi] + offsetof(DLL_FUNCTIONS, pfnClientCommand) / sizeof(void*))
+		return(NULL);
+	return(meta_client_command_hook(plug->index));
+}
 
-	if(unlikely(--call_count>0)) {
-		//Restore backup
-		PublicMetaGlobals = backup_meta_globals[0];
-	}
+// check that hook from old lists still belongs to a running plugin
+mBOOL DLLINTERNAL is_api_hook_valid(const api_hook_t *hook, int post, enum_api_t api, unsigned int func_offset) {
+	if(hook->plugin->status != PL_RUNNING)
+		return(mFALSE);
+	if(get_plugin_hook(hook->plugin, post, api, func_offset) == hook->pfn)
+		return(mTRUE);
+	if(get_meta_hook(hook->plugin, post, api_first_func[api] + func_offset / sizeof(void*)) == hook->pfn)
+		return(mTRUE);
+	return(mFALSE);
 }
 
-// full return typed version of main hook function
-void * DLLINTERNAL main_hook_function(const class_ret_t ret_init, unsigned int api_info_offset, enum_api_t api, unsigned int func_offset, const void * packed_args) {
-	const api_info_t *api_info;
+// Limit plugin's message function hooks to given msg ids.
+mBOOL DLLINTERNAL set_msg_hook_filter(int plugin_index, const int *msgids, int count) {
+	unsigned int bit = 1u << (plugin_index & 31);
+	int word = plugin_index >> 5;
 	int i;
-	META_RES mres, status, prev_mres;
-	MPlugin *iplug;
-	void *pfn_routine;
-	int loglevel;
-	const void *api_table;
-	meta_globals_t backup_meta_globals[1];
-	
-	//passing offset from api wrapper function makes code faster/smaller
-	api_info = get_api_info(api, api_info_offset);
-	
-	//Fix bug with metamod-bot-plugins.
-	if(unlikely(call_count++>0)) {
-		//Backup PublicMetaGlobals.
-		backup_meta_globals[0] = PublicMetaGlobals;
-	}
-	
-	//Return class setup
-	class_ret_t dllret=ret_init;
-	class_ret_t override_ret=ret_init;
-	class_ret_t pub_override_ret=ret_init;
-	class_ret_t orig_ret=ret_init;
-	class_ret_t pub_orig_ret=ret_init;
-	
-	//Setup
-	loglevel=api_info->loglevel;
-	mres=MRES_UNSET;
-	status=MRES_UNSET;
-	prev_mres=MRES_UNSET;
-	pfn_routine=NULL;
-	
-	//Pre plugin functions
-	prev_mres=MRES_UNSET;
-	for(i=0; likely(i < Plugins->endlist); i++) {
-		iplug=&Plugins->plist[i];
-		
-		if(unlikely(iplug->status != PL_RUNNING))
-			continue;
-		
-		api_table = iplug->get_api_table(api);
-		if(likely(!api_table)) {
-			//plugin doesn't provide this api table
-			continue;
-		}
-		
-		pfn_routine=get_api_function(api_table, func_offset);
-		if(likely(!pfn_routine)) {
-			//plugin doesn't provide this function
-			continue;
-		}
-		
-		// initialize PublicMetaGlobals
-		PublicMetaGlobals.mres = MRES_UNSET;
-		PublicMetaGlobals.prev_mres = prev_mres;
-		PublicMetaGlobals.status = status;
-		pub_orig_ret = orig_ret;
-		PublicMetaGlobals.orig_ret = pub_orig_ret.getptr();
-		if(unlikely(status==MRES_SUPERCEDE)) {
-			pub_override_ret = override_ret;
-			PublicMetaGlobals.override_ret = pub_override_ret.getptr();
-		}
-		
-		// call plugin
-		META_DEBUG(loglevel, ("Calling %s:%s()", iplug->file, api_info->name));
-		dllret = class_ret_t(api_info->api_caller(pfn_routine, packed_args));
-		API_UNPAUSE_TSC_TRACKING();
-		
-		// plugin's result code
-		mres=PublicMetaGlobals.mres;
-		if(unlikely(mres > status))
-			status = mres;
-		
-		// save this for successive plugins to see
-		prev_mres = mres;
-		
-		if(unlikely(mres==MRES_SUPERCEDE)) {
-			pub_override_ret = dllret;
-			override_ret = dllret;
-		} 
-		else if(unlikely(mres==MRES_UNSET)) {
-			META_WARNING("Plugin didn't set meta_result: %s:%s()", iplug->file, api_info->name);
-		}
-	}
-	
-	call_count--;
-	
-	//Api call
-	if(likely(status!=MRES_SUPERCEDE)) {
-		//get api table
-		api_table = *api_tables[api];
-		
-		if(likely(api_table)) {
-			pfn_routine = get_api_function(api_table, func_offset);
-			if(likely(pfn_routine)) {
-				META_DEBUG(loglevel, ("Calling %s:%s()", (api==e_api_engine)?"engine":GameDLL.file, api_info->name));
-				dllret = class_ret_t(api_info->api_caller(pfn_routine, packed_args));
-				API_UNPAUSE_TSC_TRACKING();
-				orig_ret = dllret;
-			} else {
-				// don't complain for NULL routines in NEW_DLL_FUNCTIONS
-				if(unlikely(api != e_api_newapi))
-					META_WARNING("Couldn't find api call: %s:%s", (api==e_api_engine)?"engine":GameDLL.file, api_info->name);
-				status=MRES_UNSET;
-			}
-		} else {
-			// don't complain for NULL NEW_DLL_FUNCTIONS-table
-			if(unlikely(api != e_api_newapi))
-				META_DEBUG(loglevel, ("No api table defined for api call: %s:%s", (api==e_api_engine)?"engine":GameDLL.file, api_info->name));
-			status=MRES_UNSET;
-		}
-	} else {
-		META_DEBUG(loglevel, ("Skipped (supercede) %s:%s()", (api==e_api_engine)?"engine":GameDLL.file, api_info->name));
-		orig_ret = override_ret;
-		pub_orig_ret = override_ret;
-		PublicMetaGlobals.orig_ret = pub_orig_ret.getptr();
-	}
-	
-	call_count++;
-	
-	//Pre plugin functions
-	prev_mres=MRES_UNSET;
-	for(i=0; likely(i < Plugins->endlist); i++) {
-		iplug=&Plugins->plist[i];
-		
-		if(unlikely(iplug->status != PL_RUNNING))
-			continue;
-		
-		api_table = iplug->get_api_post_table(api);
-		if(likely(!api_table)) {
-			//plugin doesn't provide this api table
-			continue;
-		}
-		
-		pfn_routine=get_api_function(api_table, func_offset);
-		if(likely(!pfn_routine)) {
-			//plugin doesn't provide this function
-			continue;
-		}
-		
-		// initialize PublicMetaGlobals
-		PublicMetaGlobals.mres = MRES_UNSET;
-		PublicMetaGlobals.prev_mres = prev_mres;
-		PublicMetaGlobals.status = status;
-		pub_orig_ret = orig_ret;
-		PublicMetaGlobals.orig_ret = pub_orig_ret.getptr();
-		if(unlikely(status==MRES_OVERRIDE)) {
-			pub_override_ret = override_ret;
-			PublicMetaGlobals.override_ret = pub_override_ret.getptr();
-		}
-		
-		// call plugin
-		META_DEBUG(loglevel, ("Calling %s:%s_Post()", iplug->file, api_info->name));
-		dllret = class_ret_t(api_info->api_caller(pfn_routine, packed_args));
-		API_UNPAUSE_TSC_TRACKING();
-		
-		// plugin's result code
-		mres=PublicMetaGlobals.mres;
-		if(unlikely(mres > status))
-			status = mres;
-		
-		// save this for successive plugins to see
-		prev_mres = mres;
-		
-		if(unlikely(mres==MRES_OVERRIDE)) {
-			pub_override_ret = dllret;
-			override_ret = dllret;
-		}
-		else if(unlikely(mres==MRES_UNSET)) {
-			META_WARNING("Plugin didn't set meta_result: %s:%s_Post()", iplug->file, api_info->name);
-		}
-		else if(unlikely(mres==MRES_SUPERCEDE)) {
-			META_WARNING("MRES_SUPERCEDE not valid in Post functions: %s:%s_Post()", iplug->file, api_info->name);
+
+	if(msgids) {
+		for(i=0; i < count; i++) {
+			if(msgids[i] < 0 || msgids[i] > 255)
+				RETURN_ERRNO(mFALSE, ME_ARGUMENT);
 		}
 	}
-	
-	if(unlikely(--call_count>0)) {
-		//Restore backup
-		PublicMetaGlobals = backup_meta_globals[0];
+
+	for(i=0; i < 256; i++) {
+		if(msgids)
+			msg_hook_plugins[i][word] &= ~bit;
+		else
+			msg_hook_plugins[i][word] |= bit;
 	}
-	
-	//return value is passed through ret_init!
-	if(likely(status!=MRES_OVERRIDE)) {
-		return(*(void**)orig_ret.getptr());
-	} else {
-		META_DEBUG(loglevel, ("Returning (override) %s()", api_info->name));
-		return(*(void**)override_ret.getptr());
+	if(msgids) {
+		for(i=0; i < count; i++)
+			msg_hook_plugins[msgids[i]][word] |= bit;
 	}
+
+	update_msg_hooks_wanted();
+	return(mTRUE);
 }
 
-//
-// Macros for creating api caller functions
-//
-#define BEGIN_API_CALLER_FUNC(ret_type, args_type_code) \
-	void * DLLINTERNAL _COMBINE4(api_caller_, ret_type, _args_, args_type_code)(const void * func, const void * packed_args) { \
-		_COMBINE2(pack_args_type_, args_type_code) * p ATTRIBUTE(unused)= (_COMBINE2(pack_args_type_, args_type_code) *)packed_args;
-#define END_API_CALLER_FUNC(ret_t, args_t, args) \
-		API_PAUSE_TSC_TRACKING(); \
-		return(*(void **)class_ret_t((*(( ret_t (*) args_t )func)) args).getptr()); \
+// Range of function indexes for a HOOK_TABLE_* table and func_offset in
+// it, or -1 for all of its functions.
+static mBOOL DLLINTERNAL hook_func_range(int table, int func_offset, unsigned int *first, unsigned int *last) {
+	if(table==HOOK_TABLE_ALL) {
+		if(func_offset != -1)
+			RETURN_ERRNO(mFALSE, ME_ARGUMENT);
+		*first=0;
+		*last=NUM_API_FUNCS;
 	}
-#define END_API_CALLER_FUNC_void(args_t, args) \
-		API_PAUSE_TSC_TRACKING(); \
-		return((*(( void* (*) args_t )func)) args); \
+	else if(table >= HOOK_TABLE_ENGINE && table <= HOOK_TABLE_NEWAPI) {
+		*first=api_first_func[table];
+		*last=*first + api_num_funcs[table];
+		if(func_offset != -1) {
+			if(func_offset < 0 || func_offset % sizeof(void*) != 0
+					|| func_offset / sizeof(void*) >= api_num_funcs[table])
+				RETURN_ERRNO(mFALSE, ME_ARGUMENT);
+			*first+=func_offset / sizeof(void*);
+			*last=*first + 1;
+		}
 	}
+	else
+		RETURN_ERRNO(mFALSE, ME_ARGUMENT);
+	return(mTRUE);
+}
 
-//
-// API function callers.
-//
-
-//-
-BEGIN_API_CALLER_FUNC(void, ipV)
-END_API_CALLER_FUNC_void( (int, const void*, ...), (p->i1, p->p1, p->str) )
-
-//-
-BEGIN_API_CALLER_FUNC(void, 2pV)
-END_API_CALLER_FUNC_void( (const void*, const void*, ...), (p->p1, p->p2, p->str) )
-
-//Disable unreferenced local variable warning temporarily. - Solokiller
-#pragma warning( push )
-#pragma warning( disable: 4189 )
-//-
-BEGIN_API_CALLER_FUNC(void, void)
-END_API_CALLER_FUNC_void( (void), () )
-
-BEGIN_API_CALLER_FUNC(ptr, void)
-END_API_CALLER_FUNC(void*, (void), () )
-
-BEGIN_API_CALLER_FUNC(int, void)
-END_API_CALLER_FUNC(int, (void), () )
-
-BEGIN_API_CALLER_FUNC(float, void)
-END_API_CALLER_FUNC(float, (void), () )
-#pragma warning( pop )
-
-//-
-BEGIN_API_CALLER_FUNC(float, 2f)
-END_API_CALLER_FUNC( float, (float, float), (p->f1, p->f2) )
-
-//-
-BEGIN_API_CALLER_FUNC(void, 2i)
-END_API_CALLER_FUNC_void( (int, int), (p->i1, p->i2) );
-
-BEGIN_API_CALLER_FUNC(int, 2i)
-END_API_CALLER_FUNC(int, (int, int), (p->i1, p->i2) );
-
-//-
-BEGIN_API_CALLER_FUNC(void, 2i2p)
-END_API_CALLER_FUNC_void( (int, int, const void*, const void*), (p->i1, p->i2, p->p1, p->p2) );
-
-//-
-BEGIN_API_CALLER_FUNC(void, 2i2pi2p)
-END_API_CALLER_FUNC_void( (int, int, const void*, const void*, int, const void*, const void*), (p->i1, p->i2, p->p1, p->p2, p->i3, p->p3, p->p4) );
-
-//-
-BEGIN_API_CALLER_FUNC(void, 2p)
-END_API_CALLER_FUNC_void( (const void*, const void*), (p->p1, p->p2) );
-
-BEGIN_API_CALLER_FUNC(ptr, 2p)
-END_API_CALLER_FUNC(void*, (const void*, const void*), (p->p1, p->p2) );
-
-BEGIN_API_CALLER_FUNC(int, 2p)
-END_API_CALLER_FUNC(int, (const void*, const void*), (p->p1, p->p2) );
-
-//-
-BEGIN_API_CALLER_FUNC(void, 2p2f)
-END_API_CALLER_FUNC_void( (const void*, const void*, float, float), (p->p1, p->p2, p->f1, p->f2) );
-
-//-
-BEGIN_API_CALLER_FUNC(void, 2p2i2p)
-END_API_CALLER_FUNC_void( (const void*, const void*, int, int, const void*, const void*), (p->p1, p->p2, p->i1, p->i2, p->p3, p->p4) );
-
-//-
-BEGIN_API_CALLER_FUNC(void, 2p3fus2uc)
-END_API_CALLER_FUNC_void( (const void*, const void*, float, float, float, unsigned short, unsigned char, unsigned char), 
-	(p->p1, p->p2, p->f1, p->f2, p->f3, static_cast<unsigned short>( p->us1 ), static_cast<unsigned char>( p->uc1 ), static_cast<unsigned char>( p->uc2 )) );
-
-//-
-BEGIN_API_CALLER_FUNC(ptr, 2pf)
-END_API_CALLER_FUNC(void*, (const void*, const void*, float), (p->p1, p->p2, p->f1) );
-
-//-
-BEGIN_API_CALLER_FUNC(void, 2pfi)
-END_API_CALLER_FUNC_void( (const void*, const void*, float, int), (p->p1, p->p2, p->f1, p->i1) );
-
-//-
-BEGIN_API_CALLER_FUNC(void, 2pi)
-END_API_CALLER_FUNC_void( (const void*, const void*, int), (p->p1, p->p2, p->i1) );
-
-BEGIN_API_CALLER_FUNC(int, 2pi)
-END_API_CALLER_FUNC(int, (const void*, const void*, int), (p->p1, p->p2, p->i1) );
-
-//-
-BEGIN_API_CALLER_FUNC(void, 2pui)
-END_API_CALLER_FUNC_void( (const void*, const void*, unsigned int), (p->p1, p->p2, p->ui1) );
-
-//-
-BEGIN_API_CALLER_FUNC(void, 2pi2p)
-END_API_CALLER_FUNC_void( (const void*, const void*, int, const void*, const void*), (p->p1, p->p2, p->i1, p->p3, p->p4) );
-
-//-
-BEGIN_API_CALLER_FUNC(void, 2pif2p)
-END_API_CALLER_FUNC_void( (const void*, const void*, int, float, const void*, const void*), (p->p1, p->p2, p->i1, p->f1, p->p3, p->p4) );
-
-//-
-BEGIN_API_CALLER_FUNC(int, 3i)
-END_API_CALLER_FUNC(int, (int, int, int), (p->i1, p->i2, p->i3) );
-
-//-
-BEGIN_API_CALLER_FUNC(void, 3p)
-END_API_CALLER_FUNC_void( (const void*, const void*, const void*), (p->p1, p->p2, p->p3) );
-
-BEGIN_API_CALLER_FUNC(ptr, 3p)
-END_API_CALLER_FUNC(void*, (const void*, const void*, const void*), (p->p1, p->p2, p->p3) );
-
-BEGIN_API_CALLER_FUNC(int, 3p)
-END_API_CALLER_FUNC(int, (const void*, const void*, const void*), (p->p1, p->p2, p->p3) );
-
-//-
-BEGIN_API_CALLER_FUNC(void, 3p2f2i)
-END_API_CALLER_FUNC_void( (const void*, const void*, const void*, float, float, int, int), (p->p1, p->p2, p->p3, p->f1, p->f2, p->i1, p->i2) );
-
-//-
-BEGIN_API_CALLER_FUNC(int, 3pi2p)
-END_API_CALLER_FUNC(int, (const void*, const void*, const void*, int, const void*, const void*), (p->p1, p->p2, p->p3, p->i1, p->p4, p->p5) );
-
-//-
-BEGIN_API_CALLER_FUNC(void, 4p)
-END_API_CALLER_FUNC_void( (const void*, const void*, const void*, const void*), (p->p1, p->p2, p->p3, p->p4) );
-
-BEGIN_API_CALLER_FUNC(int, 4p)
-END_API_CALLER_FUNC(int, (const void*, const void*, const void*, const void*), (p->p1, p->p2, p->p3, p->p4) );
-
-//-
-BEGIN_API_CALLER_FUNC(void, 4pi)
-END_API_CALLER_FUNC_void( (const void*, const void*, const void*, const void*, int), (p->p1, p->p2, p->p3, p->p4, p->i1) );
-
-BEGIN_API_CALLER_FUNC(int, 4pi)
-END_API_CALLER_FUNC(int, (const void*, const void*, const void*, const void*, int), (p->p1, p->p2, p->p3, p->p4, p->i1) );
-
-//-
-BEGIN_API_CALLER_FUNC(void, f)
-END_API_CALLER_FUNC_void( (float), (p->f1) );
-
-//-
-BEGIN_API_CALLER_FUNC(void, i)
-END_API_CALLER_FUNC_void( (int), (p->i1) );
-
-BEGIN_API_CALLER_FUNC(int, i)
-END_API_CALLER_FUNC(int, (int), (p->i1) );
-
-BEGIN_API_CALLER_FUNC(ptr, i)
-END_API_CALLER_FUNC(void*, (int), (p->i1) );
-
-BEGIN_API_CALLER_FUNC(uint, ui)
-END_API_CALLER_FUNC(unsigned int, (unsigned int), (p->ui1) );
-
-BEGIN_API_CALLER_FUNC(ptr, ui)
-END_API_CALLER_FUNC(void*, (unsigned int), (p->ui1) );
-
-//-
-BEGIN_API_CALLER_FUNC(ulong, ul)
-END_API_CALLER_FUNC(unsigned long, (unsigned long), (p->ul1) );
-
-//-
-BEGIN_API_CALLER_FUNC(void, i2p)
-END_API_CALLER_FUNC_void( (int, const void*, const void*), (p->i1, p->p1, p->p2) );
-
-BEGIN_API_CALLER_FUNC(int, i2p)
-END_API_CALLER_FUNC(int, (int, const void*, const void*), (p->i1, p->p1, p->p2) );
-
-//-
-BEGIN_API_CALLER_FUNC(void, i3p)
-END_API_CALLER_FUNC_void( (int, const void*, const void*, const void*), (p->i1, p->p1, p->p2, p->p3) );
-
-//-
-BEGIN_API_CALLER_FUNC(void, ip)
-END_API_CALLER_FUNC_void( (int, const void*), (p->i1, p->p1) );
-
-BEGIN_API_CALLER_FUNC(ushort, ip)
-END_API_CALLER_FUNC( unsigned short, (int, const void*), (p->i1, p->p1) );
-
-BEGIN_API_CALLER_FUNC(int, ip)
-END_API_CALLER_FUNC( int, (int, const void*), (p->i1, p->p1) );
-
-//-
-BEGIN_API_CALLER_FUNC(void, ipusf2p2f4i)
-END_API_CALLER_FUNC_void( (int, const void*, unsigned short, float, const void*, const void*, float, float, int, int, int, int), 
-	(p->i1, p->p1, static_cast<unsigned short>( p->us1 ), p->f1, p->p2, p->p3, p->f2, p->f3, p->i2, p->i3, p->i4, p->i5) );
-
-//-
-BEGIN_API_CALLER_FUNC(void, p)
-END_API_CALLER_FUNC_void( (const void*), (p->p1) );
-
-BEGIN_API_CALLER_FUNC(ptr, p)
-END_API_CALLER_FUNC(void*, (const void*), (p->p1) );
-
-BEGIN_API_CALLER_FUNC(char, p)
-END_API_CALLER_FUNC(char, (const void*), (p->p1) );
-
-BEGIN_API_CALLER_FUNC(int, p)
-END_API_CALLER_FUNC(int, (const void*), (p->p1) );
-
-BEGIN_API_CALLER_FUNC(uint, p)
-END_API_CALLER_FUNC(unsigned int, (const void*), (p->p1) );
+// Set priority and flags of plugin's hooks for a function, or all of them.
+mBOOL DLLINTERNAL set_hook_priority(int plugin_index, int table, int func_offset, int priority, int flags) {
+	unsigned int first, last;
+	unsigned int fn;
 
-BEGIN_API_CALLER_FUNC(float, p)
-END_API_CALLER_FUNC(float, (const void*), (p->p1) );
+	if(plugin_index < 1 || plugin_index > MAX_PLUGINS)
+		RETURN_ERRNO(mFALSE, ME_ARGUMENT);
+	if(!hook_func_range(table, func_offset, &first, &last))
+		return(mFALSE);
 
-//-
-BEGIN_API_CALLER_FUNC(void, p2f)
-END_API_CALLER_FUNC_void( (const void*, float, float), (p->p1, p->f1, p->f2) );
+	for(fn=first; fn < last; fn++) {
+		hook_priority[plugin_index][fn]=priority;
+		hook_flags[plugin_index][fn]=(unsigned char)flags;
+	}
+	rebuild_api_hook_lists();
+	return(mTRUE);
+}
 
-//-
-BEGIN_API_CALLER_FUNC(int, p2fi)
-END_API_CALLER_FUNC(int, (const void*, float, float, int), (p->p1, p->f1, p->f2, p->i1) );
+// Turn plugin's pre or post hooks of a function, or all of them, off or
+// on.  Disabled hooks are left out of the hook lists altogether, so
+// functions nobody else hooks go straight to the engine/gamedll again.
+mBOOL DLLINTERNAL set_hook_enabled(int plugin_index, int table, int func_offset, int post, int enabled) {
+	unsigned int first, last;
+	unsigned int fn;
+
+	if(plugin_index < 1 || plugin_index > MAX_PLUGINS || (post != 0 && post != 1))
+		RETURN_ERRNO(mFALSE, ME_ARGUMENT);
+	if(!hook_func_range(table, func_offset, &first, &last))
+		return(mFALSE);
+
+	for(fn=first; fn < last; fn++)
+		hook_disabled[plugin_index][post][fn]=enabled ? 0 : 1;
+	rebuild_api_hook_lists();
+	return(mTRUE);
+}
 
-//-
-BEGIN_API_CALLER_FUNC(void, p2i)
-END_API_CALLER_FUNC_void( (const void*, int, int), (p->p1, p->i1, p->i2) );
+// Back to default priority, no flags and all hooks enabled, for a new
+// plugin in the slot.
+void DLLINTERNAL reset_hook_priority(int plugin_index) {
+	memset(hook_priority[plugin_index], 0, sizeof(hook_priority[plugin_index]));
+	memset(hook_flags[plugin_index], 0, sizeof(hook_flags[plugin_index]));
+	memset(hook_disabled[plugin_index], 0, sizeof(hook_disabled[plugin_index]));
+}
 
-//-
-BEGIN_API_CALLER_FUNC(void, p3i)
-END_API_CALLER_FUNC_void( (const void*, int, int, int), (p->p1, p->i1, p->i2, p->i3) );
+// Find msg ids some running plugin hooking message functions wants, so
+// other messages can skip the hook functions altogether.
+void DLLINTERNAL update_msg_hooks_wanted(void) {
+	unsigned int hooking[PLUGIN_MASK_WORDS];
+	MPlugin *iplug;
+	unsigned int j;
+	int i, post, w;
 
-//-
-BEGIN_API_CALLER_FUNC(void, p4i)
-END_API_CALLER_FUNC_void( (const void*, int, int, int, int), (p->p1, p->i1, p->i2, p->i3, p->i4) );
+	memset(hooking, 0, sizeof(hooking));
+	for(i=0; Plugins && i < Plugins->endlist; i++) {
+		iplug=&Plugins->plist[i];
+		if(iplug->status != PL_RUNNING)
+			continue;
+		for(post=0; post < 2; post++) {
+			for(j=0; j < sizeof(msg_func_offsets) / sizeof(msg_func_offsets[0]); j++) {
+				if(get_plugin_hook(iplug, post, e_api_engine, msg_func_offsets[j]))
+					PLUGIN_MASK_SET(hooking, iplug->index);
+			}
+		}
+		for(j=0; j < sizeof(msg_func_offsets) / sizeof(msg_func_offsets[0]); j++) {
+			if(api_async_plugin_hooks(iplug->index, e_api_engine, msg_func_offsets[j]))
+				PLUGIN_MASK_SET(hooking, iplug->index);
+		}
+	}
 
-//-
-BEGIN_API_CALLER_FUNC(void, puc)
-END_API_CALLER_FUNC_void( (const void*, unsigned char), (p->p1, static_cast<unsigned char>( p->uc1 )) );
+	for(i=0; i < 256; i++) {
+		msg_hooks_wanted[i] = 0;
+		for(w=0; w < PLUGIN_MASK_WORDS; w++) {
+			if(msg_hook_plugins[i][w] & hooking[w])
+				msg_hooks_wanted[i] = 1;
+		}
+	}
+}
 
-//-
-BEGIN_API_CALLER_FUNC(void, pf)
-END_API_CALLER_FUNC_void( (const void*, float), (p->p1, p->f1) );
+// Rebuild hook lists from plugins currently running.  Lists are replaced
+// as a whole, so that a hook function that triggers a plugin (un)load or
+// pause keeps walking valid memory; it notices the change and rechecks
+// plugin status for the remaining entries.
+void DLLINTERNAL rebuild_api_hook_lists(void) {
+	api_hook_lists_t *lists;
+	MPlugin *iplug;
+	void *pfn;
+	unsigned int total, n, fn, afn, first, k;
+	int i, j, post, api, prio;
 
-//-
-BEGIN_API_CALLER_FUNC(void, pfp)
-END_API_CALLER_FUNC_void( (const void*, float, const void*), (p->p1, p->f1, p->p2) );
+	if(!Plugins)
+		return;
 
-//-
-BEGIN_API_CALLER_FUNC(void, pi)
-END_API_CALLER_FUNC_void( (const void*, int), (p->p1, p->i1) );
+	total = 0;
+	for(i=0; i < Plugins->endlist; i++) {
+		iplug=&Plugins->plist[i];
+		if(iplug->status != PL_RUNNING)
+			continue;
+		for(post=0; post < 2; post++) {
+			for(api=0; api < 3; api++) {
+				for(fn=0; fn < api_num_funcs[api]; fn++) {
+					if(get_plugin_hook(iplug, post, (enum_api_t)api, fn * sizeof(void*)))
+						total++;
+					if(get_meta_hook(iplug, post, api_first_func[api] + fn))
+						total++;
+				}
+			}
+		}
+	}
 
-BEGIN_API_CALLER_FUNC(ptr, pi)
-END_API_CALLER_FUNC(void*, (const void*, int), (p->p1, p->i1) );
+	lists = (api_hook_lists_t *)calloc(1, sizeof(api_hook_lists_t) + total * sizeof(api_hook_t));
+	if(!lists) {
+		// Plugins won't be called, but at least we won't call into
+		// plugins that might have been unloaded.
+		META_ERROR("Failed malloc() for api hook lists; plugin hooks disabled");
+		lists = &empty_hook_lists;
+	}
+	else {
+		n = 0;
+		for(post=0; post < 2; post++) {
+			for(api=0; api < 3; api++) {
+				for(fn=0; fn < api_num_funcs[api]; fn++) {
+					afn = api_first_func[api] + fn;
+					lists->first[post][afn] = n;
+					first = n;
+					for(i=0; i < Plugins->endlist; i++) {
+						iplug=&Plugins->plist[i];
+						if(iplug->status != PL_RUNNING)
+							continue;
+						// metamod's hook for the plugin first, then its own
+						for(j=0; j < 2; j++) {
+							if(j == 0)
+								pfn = get_meta_hook(iplug, post, afn);
+							else
+								pfn = get_plugin_hook(iplug, post, (enum_api_t)api, fn * sizeof(void*));
+							if(!pfn)
+								continue;
+							// higher priority first; inserting keeps plugin
+							// order among equal ones
+							prio = hook_priority[iplug->index][afn];
+							for(k=n; k > first && hook_priority[lists->hooks[k-1].plugin->index][afn] < prio; k--)
+								lists->hooks[k] = lists->hooks[k-1];
+							lists->hooks[k].pfn = pfn;
+							lists->hooks[k].plugin = iplug;
+							lists->hooks[k].flags = hook_flags[iplug->index][afn];
+							n++;
+						}
+					}
+				}
+			}
+			lists->first[post][NUM_API_FUNCS] = n;
+		}
+	}
 
-BEGIN_API_CALLER_FUNC(int, pi)
-END_API_CALLER_FUNC(int, (const void*, int), (p->p1, p->i1) );
+	// async observers need the wrappers too
+	api_async_update();
 
-//-
-BEGIN_API_CALLER_FUNC(void, pi2p)
-END_API_CALLER_FUNC_void( (const void*, int, const void*, const void*), (p->p1, p->i1, p->p2, p->p3) );
+	memset(api_func_hooked, 0, sizeof(api_func_hooked));
+	for(api=0; api < 3; api++) {
+		for(fn=0; fn < api_num_funcs[api]; fn++) {
+			i = api_first_func[api] + fn;
+			if(lists->first[0][i] != lists->first[0][i + 1] || lists->first[1][i] != lists->first[1][i + 1]
+					|| api_async_hooked[i])
+				api_func_hooked[api][fn] = 1;
+		}
+	}
 
-//-
-BEGIN_API_CALLER_FUNC(int, pi2p2ip)
-END_API_CALLER_FUNC(int, (const void*, int, const void*, const void*, int, int, const void*), (p->p1, p->i1, p->p2, p->p3, p->i2, p->i3, p->p4) );
+	if(api_hook_lists != &empty_hook_lists) {
+		api_hook_lists->next_retired = retired_api_hook_lists;
+		retired_api_hook_lists = api_hook_lists;
+	}
+	api_hook_lists = lists;
 
-//-
-BEGIN_API_CALLER_FUNC(void, pip)
-END_API_CALLER_FUNC_void( (const void*, int, const void*), (p->p1, p->i1, p->p2) );
+	if(api_hook_call_count == 0)
+		free_retired_api_hook_lists();
 
-BEGIN_API_CALLER_FUNC(ptr, pip)
-END_API_CALLER_FUNC(void*, (const void*, int, const void*), (p->p1, p->i1, p->p2) );
+	// point engine's dllapi/newapi slots at the gamedll where possible
+	update_dllapi_passthrough();
 
-//-
-BEGIN_API_CALLER_FUNC(void, pip2f2i)
-END_API_CALLER_FUNC_void( (const void*, int, const void*, float, float, int, int), (p->p1, p->i1, p->p2, p->f1, p->f2, p->i2, p->i3) );
+	update_msg_hooks_wanted();
+	ent_filter_update();
 
-//-
-BEGIN_API_CALLER_FUNC(void, pip2f4i2p)
-END_API_CALLER_FUNC_void( (const void*, int, const void*, float, float, int, int, int, int, const void*, const void*), (p->p1, p->i1, p->p2, p->f1, p->f2, p->i2, p->i3, p->i4, p->i5, p->p3, p->p4) );
+	META_DEBUG(7, ("Rebuilt api hook lists; %d hooks", total));
+}
@@ -31,367 +31,511 @@
 #ifndef API_HOOK_H
 #define API_HOOK_H
 
+#include <extdll.h>
+
 #include "ret_type.h"
 #include "api_info.h"
 #include "meta_api.h"
-#include "osdep.h"		//OPEN_ARGS
-
-// Compine 4 parts for single name
-#define _COMBINE4(w,x,y,z) w##x##y##z
-#define _COMBINE2(x,y) x##y
-
-// simplified 'void' version of main hook function
-void DLLINTERNAL main_hook_function_void(unsigned int api_info_offset, enum_api_t api, unsigned int func_offset, const void * packed_args);
-
-// full return typed version of main hook function
-void * DLLINTERNAL main_hook_function(const class_ret_t ret_init, unsigned int api_info_offset, enum_api_t api, unsigned int func_offset, const void * packed_args);
+#include "metamod.h"		// PublicMetaGlobals, GameDLL, Engine, etc
+#include "mplugin.h"		// MPlugin
+#include "log_meta.h"		// META_DEBUG, etc
+#include "osdep.h"		// likely, unlikely
+#include "api_prof.h"		// api_prof_enter, GET_TSC
+#include "api_trace.h"		// api_trace_call
+#include "api_stats.h"		// api_stats_count
+
+// Where each api starts in the hook lists.
+extern const unsigned int api_num_funcs[3] DLLHIDDEN;
+extern const unsigned int api_first_func[3] DLLHIDDEN;
+
+// Largest api table, in function pointers.
+#define MAX_API_TABLE_FUNCS (sizeof(enginefuncs_t) / sizeof(void*))
+
+// Nonzero for api functions that some running plugin hooks, pre or post.
+// Updated by rebuild_api_hook_lists().
+extern unsigned char api_func_hooked[3][MAX_API_TABLE_FUNCS] DLLHIDDEN;
+
+#define API_FUNC_HOOKED(api, func_offset) \
+	(api_func_hooked[api][(func_offset) / sizeof(void*)] != 0)
+
+// Sets of plugins, as bitsets by plugin index.
+#define PLUGIN_MASK_WORDS ((MAX_PLUGINS + 1 + 31) / 32)
+#define PLUGIN_MASK_TEST(mask, plugin_index) \
+	(((mask)[(plugin_index) >> 5] >> ((plugin_index) & 31)) & 1)
+#define PLUGIN_MASK_SET(mask, plugin_index) \
+	((mask)[(plugin_index) >> 5] |= 1u << ((plugin_index) & 31))
+
+// Plugins whose MessageBegin/Write*/MessageEnd hooks are called for each
+// msg id.  All bits are set for a plugin, unless it limited its hooks to
+// some msg ids with SET_MSG_HOOK_FILTER.
+extern unsigned int msg_hook_plugins[256][PLUGIN_MASK_WORDS] DLLHIDDEN;
+
+// Nonzero for msg ids that some running plugin hooking message functions
+// wants.  Updated by update_msg_hooks_wanted().
+extern unsigned char msg_hooks_wanted[256] DLLHIDDEN;
+
+// Set at MessageBegin, for the message being written.
+extern const unsigned int *cur_msg_plugins DLLHIDDEN;
+extern int cur_msg_hooked DLLHIDDEN;
+
+inline void DLLINTERNAL set_cur_msg(int msg_type) {
+	cur_msg_plugins = msg_hook_plugins[msg_type & 0xff];
+	cur_msg_hooked = msg_hooks_wanted[msg_type & 0xff];
+}
+
+// set msg ids plugin's message function hooks get; all if msgids is NULL
+mBOOL DLLINTERNAL set_msg_hook_filter(int plugin_index, const int *msgids, int count);
+void DLLINTERNAL update_msg_hooks_wanted(void);
+
+// Order of plugin's hooks, and HOOK_* flags, for one function (table and
+// func_offset) or all of them (-1).  Reset when the plugin is loaded.
+mBOOL DLLINTERNAL set_hook_priority(int plugin_index, int table, int func_offset, int priority, int flags);
+// Turn plugin's pre or post hooks of one function, or all of them, off and
+// on again.  Also reset when the plugin is loaded.
+mBOOL DLLINTERNAL set_hook_enabled(int plugin_index, int table, int func_offset, int post, int enabled);
+void DLLINTERNAL reset_hook_priority(int plugin_index);
+
+// Plugin's pre or post hook of a function, unless it has none or has
+// turned it off.
+void * DLLINTERNAL get_plugin_hook(MPlugin *plug, int post, enum_api_t api, unsigned int func_offset);
+
+// Single plugin routine hooked to an api function.
+typedef struct api_hook_s {
+	void *pfn;
+	MPlugin *plugin;
+	int flags;					// HOOK_* flags
+} api_hook_t;
+
+// Compact per-function lists of plugin routines, pre and post, by hook
+// priority and then plugin order.  Hooks for function 'fn' are
+// hooks[first[post][fn]] up to hooks[first[post][fn+1]].  Built from Plugins->plist by
+// rebuild_api_hook_lists() so that the hook functions below only touch
+// the routines that are actually hooked, instead of every MPlugin.
+typedef struct api_hook_lists_s {
+	struct api_hook_lists_s *next_retired;
+	unsigned int first[2][NUM_API_FUNCS + 1];
+	api_hook_t hooks[1];
+} api_hook_lists_t;
+
+// Current hook lists, and lists replaced while a hook function might still
+// be walking them; those are freed once api_hook_call_count drops to zero.
+extern api_hook_lists_t *api_hook_lists DLLHIDDEN;
+extern api_hook_lists_t *retired_api_hook_lists DLLHIDDEN;
+
+// Safety check for metamod-bot-plugin bugfix.
+//  engine_api->pfnRunPlayerMove calls dllapi-functions before it returns.
+//  This causes problems with bots running as metamod plugins, because
+//  metamod assumed that PublicMetaGlobals is free to be used.
+//  With api_hook_call_count we can fix this by backuping up
+//  PublicMetaGlobals if it's already being used.
+extern unsigned int api_hook_call_count DLLHIDDEN;
+
+// rebuild per-function hook lists; call whenever plugin status changes
+void DLLINTERNAL rebuild_api_hook_lists(void);
+
+void DLLINTERNAL free_retired_api_hook_lists(void);
+
+// check that hook from old lists still belongs to a running plugin
+mBOOL DLLINTERNAL is_api_hook_valid(const api_hook_t *hook, int post, enum_api_t api, unsigned int func_offset);
+
+// get function pointer from api table by function pointer offset
+inline void * DLLINTERNAL get_api_function(const void * api_table, unsigned int func_offset) {
+	return(*(void**)((unsigned long)api_table + func_offset));
+}
+
+// get engine's or gamedll's own table for api
+inline const void * DLLINTERNAL get_real_api_table(enum_api_t api) {
+	switch(api) {
+		case e_api_engine:
+			return(Engine.funcs);
+		case e_api_dllapi:
+			return(GameDLL.funcs.dllapi_table);
+		default:
+			return(GameDLL.funcs.newapi_table);
+	}
+}
+
+// get first and last hook for function
+inline const api_hook_t * DLLINTERNAL get_api_hooks(const api_hook_lists_t *lists, int post, enum_api_t api, unsigned int func_offset, const api_hook_t **end) {
+	unsigned int fn = api_first_func[api] + func_offset / sizeof(void*);
+	*end = &lists->hooks[lists->first[post][fn + 1]];
+	return(&lists->hooks[lists->first[post][fn]]);
+}
+
+inline const char * DLLINTERNAL get_real_api_owner(enum_api_t api) {
+	return((api==e_api_engine)?"engine":GameDLL.file);
+}
 
 //
-// API function args structures/classes
+// Hook functions.
 //
-#define API_PACK_ARGS(type, args) \
-	_COMBINE2(pack_args_type_, type) packed_args args;
-
-#define PACK_ARGS_CLASS_HEADER(type, constructor_args) \
-	class _COMBINE2(pack_args_type_, type) : public class_metamod_new { \
-		public: inline _COMBINE2(pack_args_type_, type) constructor_args
-
-#define PACK_ARGS_END };
-
-#define VOID_ARG 0
-
-PACK_ARGS_CLASS_HEADER(void, (int)) {};
-PACK_ARGS_END
-
-PACK_ARGS_CLASS_HEADER(i, (int _i1)): i1(_i1) {}; 
-	int i1;
-PACK_ARGS_END
-
-PACK_ARGS_CLASS_HEADER(2i, (int _i1, int _i2)): i1(_i1), i2(_i2) {}; 
-	int i1,i2;
-PACK_ARGS_END
-
-PACK_ARGS_CLASS_HEADER(3i, (int _i1, int _i2, int _i3)): i1(_i1), i2(_i2), i3(_i3) {};
-	int i1,i2,i3;
-PACK_ARGS_END
-
-PACK_ARGS_CLASS_HEADER(ui, (unsigned int _ui1)): ui1(_ui1) {}; 
-	unsigned int ui1;
-PACK_ARGS_END
-
-PACK_ARGS_CLASS_HEADER(ul, (unsigned long _ul1)): ul1(_ul1) {}; 
-	unsigned long ul1;
-PACK_ARGS_END
-
-PACK_ARGS_CLASS_HEADER(f, (float _f1)): f1(_f1) {}; 
-	float f1;
-PACK_ARGS_END
-
-PACK_ARGS_CLASS_HEADER(2f, (float _f1, float _f2)): f1(_f1), f2(_f2) {}; 
-	float f1,f2;
-PACK_ARGS_END
-
-PACK_ARGS_CLASS_HEADER(p, (const void *_p1)): p1(_p1) {}; 
-	const void *p1;
-PACK_ARGS_END
-
-PACK_ARGS_CLASS_HEADER(2p, (const void *_p1, const void *_p2)): p1(_p1), p2(_p2) {}; 
-	const void *p1,*p2;
-PACK_ARGS_END
-
-PACK_ARGS_CLASS_HEADER(3p, (const void *_p1, const void *_p2, const void *_p3)): p1(_p1), p2(_p2), p3(_p3) {}; 
-	const void *p1,*p2,*p3;
-PACK_ARGS_END
-
-PACK_ARGS_CLASS_HEADER(4p, (const void *_p1, const void *_p2, const void *_p3, const void *_p4)): p1(_p1), p2(_p2), p3(_p3), p4(_p4) {}; 
-	const void *p1,*p2,*p3,*p4;
-PACK_ARGS_END
-
-PACK_ARGS_CLASS_HEADER(2pV, (const void *_p1, const void *_p2, const void *_str)): p1(_p1), p2(_p2), str(_str) {}; 
-	const void *p1,*p2,*str;
-PACK_ARGS_END
-
-PACK_ARGS_CLASS_HEADER(ipV, (int _i1, const void *_p1, const void *_str)): i1(_i1), p1(_p1), str(_str) {}; 
-	int i1;
-	const void *p1,*str;
-PACK_ARGS_END
-
-PACK_ARGS_CLASS_HEADER(2i2p, (int _i1, int _i2, const void *_p1, const void *_p2)): i1(_i1), i2(_i2), p1(_p1), p2(_p2) {}; 
-	int i1,i2;
-	const void *p1,*p2;
-PACK_ARGS_END
-
-PACK_ARGS_CLASS_HEADER(2p2f, (const void *_p1, const void *_p2, float _f1, float _f2)): p1(_p1), p2(_p2), f1(_f1), f2(_f2) {}; 
-	const void *p1,*p2;
-	float f1,f2;
-PACK_ARGS_END
-
-PACK_ARGS_CLASS_HEADER(2p2i2p, (const void *_p1, const void *_p2, int _i1, int _i2, const void *_p3, const void *_p4)): p1(_p1), p2(_p2), i1(_i1), i2(_i2), p3(_p3), p4(_p4) {}; 
-	const void *p1,*p2;
-	int i1,i2;
-	const void *p3,*p4;
-PACK_ARGS_END
-
-PACK_ARGS_CLASS_HEADER(2p3fus2uc, (const void *_p1, const void *_p2, float _f1, float _f2, float _f3, unsigned short _us1, unsigned char _uc1, unsigned char _uc2)): p1(_p1), p2(_p2), f1(_f1), f2(_f2), f3(_f3), us1(_us1), uc1(_uc1), uc2(_uc2) {}; 
-	const void *p1,*p2;
-	float f1,f2,f3;
-	unsigned int us1;
-	unsigned int uc1,uc2;
-PACK_ARGS_END
-
-PACK_ARGS_CLASS_HEADER(2pf, (const void *_p1, const void *_p2, float _f1)): p1(_p1), p2(_p2), f1(_f1) {}; 
-	const void *p1,*p2;
-	float f1;
-PACK_ARGS_END
-
-PACK_ARGS_CLASS_HEADER(2pfi, (const void *_p1, const void *_p2, float _f1, int _i1)): p1(_p1), p2(_p2), f1(_f1), i1(_i1) {}; 
-	const void *p1,*p2;
-	float f1;
-	int i1;
-PACK_ARGS_END
-
-PACK_ARGS_CLASS_HEADER(2pi, (const void *_p1, const void *_p2, int _i1)): p1(_p1), p2(_p2), i1(_i1) {}; 
-	const void *p1,*p2;
-	int i1;
-PACK_ARGS_END
-
-PACK_ARGS_CLASS_HEADER(2pi2p, (const void *_p1, const void *_p2, int _i1, const void *_p3, const void *_p4)): p1(_p1), p2(_p2), i1(_i1), p3(_p3), p4(_p4) {}; 
-	const void *p1,*p2;
-	int i1;
-	const void *p3,*p4;
-PACK_ARGS_END
-
-PACK_ARGS_CLASS_HEADER(2pif2p, (const void *_p1, const void *_p2, int _i1, float _f1, const void *_p3, const void *_p4)): p1(_p1), p2(_p2), i1(_i1), f1(_f1), p3(_p3), p4(_p4) {}; 
-	const void *p1,*p2;
-	int i1;
-	float f1;
-	const void *p3,*p4;
-PACK_ARGS_END
-
-PACK_ARGS_CLASS_HEADER(3p2f2i, (const void *_p1, const void *_p2, const void *_p3, float _f1, float _f2, int _i1, int _i2)): p1(_p1), p2(_p2), p3(_p3), f1(_f1), f2(_f2), i1(_i1), i2(_i2) {}; 
-	const void *p1,*p2,*p3;	
-	float f1,f2;
-	int i1,i2;
-PACK_ARGS_END
-
-PACK_ARGS_CLASS_HEADER(3pi2p, (const void *_p1, const void *_p2, const void *_p3, int _i1, const void *_p4, const void *_p5)): p1(_p1), p2(_p2), p3(_p3), i1(_i1), p4(_p4), p5(_p5) {}; 
-	const void *p1,*p2,*p3;	
-	int i1;
-	const void *p4,*p5;
-PACK_ARGS_END
-
-PACK_ARGS_CLASS_HEADER(i3p, (int _i1, const void *_p1, const void *_p2, const void *_p3)): i1(_i1), p1(_p1), p2(_p2), p3(_p3) {}; 
-	int i1;
-	const void *p1,*p2,*p3;
-PACK_ARGS_END
-
-PACK_ARGS_CLASS_HEADER(ip, (int _i1, const void *_p1)): i1(_i1), p1(_p1) {}; 
-	int i1;
-	const void *p1;
-PACK_ARGS_END
-
-PACK_ARGS_CLASS_HEADER(ipusf2p2f4i, (int _i1, const void *_p1, unsigned short _us1, float _f1, const void *_p2, const void *_p3, float _f2, float _f3, int _i2, int _i3, int _i4, int _i5)): i1(_i1), p1(_p1), us1(_us1), f1(_f1), p2(_p2), p3(_p3), f2(_f2), f3(_f3), i2(_i2), i3(_i3), i4(_i4), i5(_i5) {}; 
-	int i1;
-	const void *p1;
-	unsigned int us1;
-	float f1;
-	const void *p2,*p3;
-	float f2,f3;
-	int i2,i3,i4,i5;
-PACK_ARGS_END
-
-PACK_ARGS_CLASS_HEADER(3pi, (const void *_p1, const void *_p2, const void *_p3, int _i1)): p1(_p1), p2(_p2), p3(_p3), i1(_i1) {}; 
-	const void *p1,*p2,*p3;
-	int i1;
-PACK_ARGS_END
-
-PACK_ARGS_CLASS_HEADER(4pi, (const void *_p1, const void *_p2, const void *_p3, const void *_p4, int _i1)): p1(_p1), p2(_p2), p3(_p3), p4(_p4), i1(_i1) {}; 
-	const void *p1,*p2,*p3,*p4;
-	int i1;
-PACK_ARGS_END
-
-PACK_ARGS_CLASS_HEADER(pf, (const void *_p1, float _f1)): p1(_p1), f1(_f1) {}; 
-	const void *p1;
-	float f1;
-PACK_ARGS_END
-
-PACK_ARGS_CLASS_HEADER(pfp, (const void *_p1, float _f1, const void *_p2)): p1(_p1), f1(_f1), p2(_p2) {}; 
-	const void *p1;
-	float f1;
-	const void *p2;
-PACK_ARGS_END
-
-PACK_ARGS_CLASS_HEADER(pi, (const void *_p1, int _i1)): p1(_p1), i1(_i1) {}; 
-	const void *p1;
-	int i1;
-PACK_ARGS_END
-
-PACK_ARGS_CLASS_HEADER(pi2p, (const void *_p1, int _i1, const void *_p2, const void *_p3)): p1(_p1), i1(_i1), p2(_p2), p3(_p3) {}; 
-	const void *p1;
-	int i1;
-	const void *p2, *p3;
-PACK_ARGS_END
-
-PACK_ARGS_CLASS_HEADER(pip, (const void *_p1, int _i1, const void *_p2)): p1(_p1), i1(_i1), p2(_p2) {}; 
-	const void *p1;
-	int i1;
-	const void *p2;
-PACK_ARGS_END
-
-PACK_ARGS_CLASS_HEADER(pip2f2i, (const void *_p1, int _i1, const void *_p2, float _f1, float _f2, int _i2, int _i3)): p1(_p1), i1(_i1), p2(_p2), f1(_f1), f2(_f2), i2(_i2), i3(_i3) {}; 
-	const void *p1;
-	int i1;
-	const void *p2;
-	float f1,f2;
-	int i2,i3;
-PACK_ARGS_END
-
-PACK_ARGS_CLASS_HEADER(pip2f4i2p, (const void *_p1, int _i1, const void *_p2, float _f1, float _f2, int _i2, int _i3, int _i4, int _i5, const void *_p3, const void *_p4)): p1(_p1), i1(_i1), p2(_p2), f1(_f1), f2(_f2), i2(_i2), i3(_i3), i4(_i4), i5(_i5), p3(_p3), p4(_p4) {}; 
-	const void *p1;
-	int i1;
-	const void *p2;
-	float f1,f2;
-	int i2,i3,i4,i5;
-	const void *p3,*p4;
-PACK_ARGS_END
-
-PACK_ARGS_CLASS_HEADER(puc, (const void *_p1, unsigned char _uc1)): p1(_p1), uc1(_uc1) {}; 
-	const void *p1;
-	unsigned int uc1;
-PACK_ARGS_END
-
-PACK_ARGS_CLASS_HEADER(2i2pi2p, (int _i1, int _i2, const void *_p1, const void *_p2, int _i3, const void *_p3, const void *_p4)): i1(_i1), i2(_i2), p1(_p1), p2(_p2), i3(_i3), p3(_p3), p4(_p4) {}; 
-	int i1,i2;
-	const void *p1,*p2;
-	int i3;
-	const void *p3,*p4;
-PACK_ARGS_END
-
-PACK_ARGS_CLASS_HEADER(2pui, (const void *_p1, const void *_p2, unsigned int _ui1)): p1(_p1), p2(_p2), ui1(_ui1) {}; 
-	const void *p1,*p2;
-	unsigned int ui1;
-PACK_ARGS_END
-
-PACK_ARGS_CLASS_HEADER(i2p, (int _i1, const void *_p1, const void *_p2)): i1(_i1), p1(_p1), p2(_p2) {}; 
-	int i1;
-	const void *p1,*p2;
-PACK_ARGS_END
-
-PACK_ARGS_CLASS_HEADER(p2f, (const void *_p1, float _f1, float _f2)): p1(_p1), f1(_f1), f2(_f2) {}; 
-	const void *p1;
-	float f1,f2;
-PACK_ARGS_END
-
-PACK_ARGS_CLASS_HEADER(p2fi, (const void *_p1, float _f1, float _f2, int _i1)): p1(_p1), f1(_f1), f2(_f2), i1(_i1) {}; 
-	const void *p1;
-	float f1,f2;
-	int i1;
-PACK_ARGS_END
-
-PACK_ARGS_CLASS_HEADER(p2i, (const void *_p1, int _i1, int _i2)): p1(_p1), i1(_i1), i2(_i2) {}; 
-	const void *p1;
-	int i1,i2;
-PACK_ARGS_END
-
-PACK_ARGS_CLASS_HEADER(p3i, (const void *_p1, int _i1, int _i2, int _i3)): p1(_p1), i1(_i1), i2(_i2), i3(_i3) {}; 
-	const void *p1;
-	int i1,i2,i3;
-PACK_ARGS_END
-
-PACK_ARGS_CLASS_HEADER(p4i, (const void *_p1, int _i1, int _i2, int _i3, int _i4)): p1(_p1), i1(_i1), i2(_i2), i3(_i3), i4(_i4) {}; 
-	const void *p1;
-	int i1,i2,i3,i4;
-PACK_ARGS_END
-
-PACK_ARGS_CLASS_HEADER(pi2p2ip, (const void *_p1, int _i1, const void *_p2, const void *_p3, int _i2, int _i3, const void *_p4)): p1(_p1), i1(_i1), p2(_p2), p3(_p3), i2(_i2), i3(_i3), p4(_p4) {}; 
-	const void *p1;
-	int i1;
-	const void *p2,*p3;
-	int i2,i3;
-	const void *p4;
-PACK_ARGS_END
-
-//
-// API function callers.
+// Wrappers in engine_api.cpp and dllapi.cpp call these with the routine's
+// own function pointer type and a lambda that calls a routine of that type
+// with the wrapper's arguments, so each api function gets its own copy of
+// the plugin loops, with arguments passed straight through in registers
+// and return values kept in their real type.  Return values are only
+// widened into class_ret_t when published to plugins through
+// meta_globals_t orig_ret/override_ret.
 //
-#ifdef __METAMOD_BUILD__
-	#define EXTERN_API_CALLER_FUNCTION(ret_type, args_code) \
-		void * DLLINTERNAL _COMBINE4(api_caller_, ret_type, _args_, args_code)(const void * func, const void * packed_args)
-#else
-	#define EXTERN_API_CALLER_FUNCTION(ret_type, args_code) \
-		static const api_caller_func_t _COMBINE4(api_caller_, ret_type, _args_, args_code) DLLHIDDEN = (api_caller_func_t)0
-#endif
 
-EXTERN_API_CALLER_FUNCTION(void, ipV);
-EXTERN_API_CALLER_FUNCTION(void, 2pV);
-EXTERN_API_CALLER_FUNCTION(void, void);
-EXTERN_API_CALLER_FUNCTION(ptr, void);
-EXTERN_API_CALLER_FUNCTION(int, void);
-EXTERN_API_CALLER_FUNCTION(float, void);
-EXTERN_API_CALLER_FUNCTION(float, 2f);
-EXTERN_API_CALLER_FUNCTION(void, 2i);
-EXTERN_API_CALLER_FUNCTION(int, 2i);
-EXTERN_API_CALLER_FUNCTION(void, 2i2p);
-EXTERN_API_CALLER_FUNCTION(void, 2i2pi2p);
-EXTERN_API_CALLER_FUNCTION(void, 2p);
-EXTERN_API_CALLER_FUNCTION(ptr, 2p);
-EXTERN_API_CALLER_FUNCTION(int, 2p);
-EXTERN_API_CALLER_FUNCTION(void, 2p2f);
-EXTERN_API_CALLER_FUNCTION(void, 2p2i2p);
-EXTERN_API_CALLER_FUNCTION(void, 2p3fus2uc);
-EXTERN_API_CALLER_FUNCTION(ptr, 2pf);
-EXTERN_API_CALLER_FUNCTION(void, 2pfi);
-EXTERN_API_CALLER_FUNCTION(void, 2pi);
-EXTERN_API_CALLER_FUNCTION(int, 2pi);
-EXTERN_API_CALLER_FUNCTION(void, 2pui);
-EXTERN_API_CALLER_FUNCTION(void, 2pi2p);
-EXTERN_API_CALLER_FUNCTION(void, 2pif2p);
-EXTERN_API_CALLER_FUNCTION(int, 3i);
-EXTERN_API_CALLER_FUNCTION(void, 3p);
-EXTERN_API_CALLER_FUNCTION(ptr, 3p);
-EXTERN_API_CALLER_FUNCTION(int, 3p);
-EXTERN_API_CALLER_FUNCTION(void, 3p2f2i);
-EXTERN_API_CALLER_FUNCTION(int, 3pi2p);
-EXTERN_API_CALLER_FUNCTION(void, 4p);
-EXTERN_API_CALLER_FUNCTION(int, 4p);
-EXTERN_API_CALLER_FUNCTION(void, 4pi);
-EXTERN_API_CALLER_FUNCTION(int, 4pi);
-EXTERN_API_CALLER_FUNCTION(void, f);
-EXTERN_API_CALLER_FUNCTION(void, i);
-EXTERN_API_CALLER_FUNCTION(ptr, i);
-EXTERN_API_CALLER_FUNCTION(int, i);
-EXTERN_API_CALLER_FUNCTION(ptr, ui);
-EXTERN_API_CALLER_FUNCTION(uint, ui);
-EXTERN_API_CALLER_FUNCTION(ulong, ul);
-EXTERN_API_CALLER_FUNCTION(void, i2p);
-EXTERN_API_CALLER_FUNCTION(int, i2p);
-EXTERN_API_CALLER_FUNCTION(void, i3p);
-EXTERN_API_CALLER_FUNCTION(void, ip);
-EXTERN_API_CALLER_FUNCTION(ushort, ip);
-EXTERN_API_CALLER_FUNCTION(int, ip);
-EXTERN_API_CALLER_FUNCTION(void, ipusf2p2f4i);
-EXTERN_API_CALLER_FUNCTION(void, p);
-EXTERN_API_CALLER_FUNCTION(ptr, p);
-EXTERN_API_CALLER_FUNCTION(char, p);
-EXTERN_API_CALLER_FUNCTION(int, p);
-EXTERN_API_CALLER_FUNCTION(uint, p);
-EXTERN_API_CALLER_FUNCTION(float, p);
-EXTERN_API_CALLER_FUNCTION(void, p2f);
-EXTERN_API_CALLER_FUNCTION(int, p2fi);
-EXTERN_API_CALLER_FUNCTION(void, p2i);
-EXTERN_API_CALLER_FUNCTION(void, p3i);
-EXTERN_API_CALLER_FUNCTION(void, p4i);
-EXTERN_API_CALLER_FUNCTION(void, puc);
-EXTERN_API_CALLER_FUNCTION(void, pf);
-EXTERN_API_CALLER_FUNCTION(void, pfp);
-EXTERN_API_CALLER_FUNCTION(void, pi);
-EXTERN_API_CALLER_FUNCTION(ptr, pi);
-EXTERN_API_CALLER_FUNCTION(int, pi);
-EXTERN_API_CALLER_FUNCTION(void, pi2p);
-EXTERN_API_CALLER_FUNCTION(int, pi2p2ip);
-EXTERN_API_CALLER_FUNCTION(void, pip);
-EXTERN_API_CALLER_FUNCTION(ptr, pip);
-EXTERN_API_CALLER_FUNCTION(void, pip2f2i);
-EXTERN_API_CALLER_FUNCTION(void, pip2f4i2p);
+// simplified 'void' version of main hook function
+// filtered is set for wrappers that pass plugin_mask, the plugins wanting
+// this call (message functions for the current msg id, entity dispatch
+// for the entity); other plugins are skipped.
+template<typename fn_t, bool filtered = false, typename call_t>
+inline void DLLINTERNAL main_hook_function_void(const api_info_t *api_info, enum_api_t api, unsigned int func_offset, call_t call_routine, const unsigned int *plugin_mask = NULL) {
+	const api_hook_lists_t *lists;
+	const api_hook_t *hook, *hook_end;
+	META_RES mres, status, prev_mres;
+	MPlugin *iplug;
+	fn_t pfn_routine;
+	int loglevel;
+	const void *api_table;
+	unsigned int fn;
+	unsigned long long start_tsc, end_tsc;
+	meta_globals_t backup_meta_globals[1];
+	
+	//Fix bug with metamod-bot-plugins.
+	if(unlikely(api_hook_call_count++>0)) {
+		//Backup PublicMetaGlobals.
+		backup_meta_globals[0] = PublicMetaGlobals;
+	}
+	
+	//Setup
+	loglevel=api_info->loglevel;
+	fn=api_first_func[api] + func_offset / sizeof(void*);
+	mres=MRES_UNSET;
+	status=MRES_UNSET;
+	
+	//Pre plugin functions
+	prev_mres=MRES_UNSET;
+	lists=api_hook_lists;
+	for(hook=get_api_hooks(lists, 0, api, func_offset, &hook_end); likely(hook < hook_end); hook++) {
+		iplug=hook->plugin;
+		pfn_routine=(fn_t)hook->pfn;
+		
+		// lists were rebuilt by a plugin we called; entry may be stale
+		if(unlikely(lists != api_hook_lists) && !is_api_hook_valid(hook, 0, api, func_offset))
+			continue;
+		
+		// plugin doesn't want this call
+		if(filtered && !PLUGIN_MASK_TEST(plugin_mask, iplug->index))
+			continue;
+		
+		// initialize PublicMetaGlobals
+		PublicMetaGlobals.mres = MRES_UNSET;
+		PublicMetaGlobals.prev_mres = prev_mres;
+		PublicMetaGlobals.status = status;
+		
+		// call plugin
+		META_DEBUG(loglevel, ("Calling %s:%s()", iplug->file, api_info->name));
+		api_prof_enter(iplug->index);
+		start_tsc = GET_TSC();
+		call_routine(pfn_routine);
+		end_tsc = GET_TSC();
+		api_prof_leave(iplug->index, P_PRE, fn, end_tsc - start_tsc);
+		
+		// plugin's result code
+		mres=PublicMetaGlobals.mres;
+		api_trace_call(start_tsc, end_tsc, fn, iplug->index, P_PRE, mres);
+		if(unlikely(mres > status))
+			status = mres;
+		
+		// save this for successive plugins to see
+		prev_mres = mres;
+		
+		if(unlikely(mres==MRES_UNSET))
+			api_stats_count(iplug->index, fn, API_STAT_UNSET);
+		
+		// plugin says nobody else needs to see this call
+		if(unlikely(mres==MRES_SUPERCEDE) && (hook->flags & HOOK_STOP_ON_SUPERCEDE)) {
+			META_DEBUG(loglevel, ("Skipping further pre hooks of %s(); superceded by %s", api_info->name, iplug->file));
+			break;
+		}
+	}
+	
+	api_hook_call_count--;
+	
+	//Api call
+	if(likely(status!=MRES_SUPERCEDE)) {
+		//get api table
+		api_table = get_real_api_table(api);
+		
+		if(likely(api_table)) {
+			pfn_routine = (fn_t)get_api_function(api_table, func_offset);
+			if(likely(pfn_routine)) {
+				META_DEBUG(loglevel, ("Calling %s:%s()", get_real_api_owner(api), api_info->name));
+				api_prof_enter(API_PROF_SLOT_REAL);
+				start_tsc = GET_TSC();
+				call_routine(pfn_routine);
+				end_tsc = GET_TSC();
+				api_prof_leave(API_PROF_SLOT_REAL, P_PRE, fn, end_tsc - start_tsc);
+				api_trace_call(start_tsc, end_tsc, fn, API_PROF_SLOT_REAL, P_PRE, MRES_UNSET);
+			} else {
+				// don't complain for NULL routines in NEW_DLL_FUNCTIONS
+				if(unlikely(api != e_api_newapi))
+					api_stats_count(API_PROF_SLOT_REAL, fn, API_STAT_NO_CALL);
+				status=MRES_UNSET;
+			}
+		} else {
+			// don't complain for NULL NEW_DLL_FUNCTIONS-table
+			if(unlikely(api != e_api_newapi))
+				META_DEBUG(loglevel, ("No api table defined for api call: %s:%s", get_real_api_owner(api), api_info->name));
+			status=MRES_UNSET;
+		}
+	} else
+		META_DEBUG(loglevel, ("Skipped (supercede) %s:%s()", get_real_api_owner(api), api_info->name));
+	
+	api_hook_call_count++;
+	
+	//Post plugin functions
+	prev_mres=MRES_UNSET;
+	lists=api_hook_lists;
+	for(hook=get_api_hooks(lists, 1, api, func_offset, &hook_end); likely(hook < hook_end); hook++) {
+		iplug=hook->plugin;
+		pfn_routine=(fn_t)hook->pfn;
+		
+		// lists were rebuilt by a plugin we called; entry may be stale
+		if(unlikely(lists != api_hook_lists) && !is_api_hook_valid(hook, 1, api, func_offset))
+			continue;
+		
+		// plugin doesn't want this call
+		if(filtered && !PLUGIN_MASK_TEST(plugin_mask, iplug->index))
+			continue;
+		
+		// initialize PublicMetaGlobals
+		PublicMetaGlobals.mres = MRES_UNSET;
+		PublicMetaGlobals.prev_mres = prev_mres;
+		PublicMetaGlobals.status = status;
+		
+		// call plugin
+		META_DEBUG(loglevel, ("Calling %s:%s_Post()", iplug->file, api_info->name));
+		api_prof_enter(iplug->index);
+		start_tsc = GET_TSC();
+		call_routine(pfn_routine);
+		end_tsc = GET_TSC();
+		api_prof_leave(iplug->index, P_POST, fn, end_tsc - start_tsc);
+		
+		// plugin's result code
+		mres=PublicMetaGlobals.mres;
+		api_trace_call(start_tsc, end_tsc, fn, iplug->index, P_POST, mres);
+		if(unlikely(mres > status))
+			status = mres;
+		
+		// save this for successive plugins to see
+		prev_mres = mres;
+		
+		if(unlikely(mres==MRES_UNSET))
+			api_stats_count(iplug->index, fn, API_STAT_UNSET_POST);
+		else if(unlikely(mres==MRES_SUPERCEDE))
+			api_stats_count(iplug->index, fn, API_STAT_SUPERCEDE_POST);
+	}
+
+	if(unlikely(--api_hook_call_count>0)) {
+		//Restore backup
+		PublicMetaGlobals = backup_meta_globals[0];
+	}
+	else if(unlikely(retired_api_hook_lists != NULL)) {
+		free_retired_api_hook_lists();
+	}
+}
+
+// full return typed version of main hook function
+template<typename ret_t, typename fn_t, typename call_t>
+inline ret_t DLLINTERNAL main_hook_function(const ret_t ret_init, const api_info_t *api_info, enum_api_t api, unsigned int func_offset, call_t call_routine) {
+	const api_hook_lists_t *lists;
+	const api_hook_t *hook, *hook_end;
+	META_RES mres, status, prev_mres;
+	MPlugin *iplug;
+	fn_t pfn_routine;
+	int loglevel;
+	const void *api_table;
+	unsigned int fn;
+	unsigned long long start_tsc, end_tsc;
+	meta_globals_t backup_meta_globals[1];
+	
+	//Fix bug with metamod-bot-plugins.
+	if(unlikely(api_hook_call_count++>0)) {
+		//Backup PublicMetaGlobals.
+		backup_meta_globals[0] = PublicMetaGlobals;
+	}
+	
+	//Return value setup
+	ret_t dllret=ret_init;
+	ret_t override_ret=ret_init;
+	ret_t orig_ret=ret_init;
+	class_ret_t pub_override_ret=class_ret_t(ret_init);
+	class_ret_t pub_orig_ret=class_ret_t(ret_init);
+	
+	//Setup
+	loglevel=api_info->loglevel;
+	fn=api_first_func[api] + func_offset / sizeof(void*);
+	mres=MRES_UNSET;
+	status=MRES_UNSET;
+	
+	//Pre plugin functions
+	prev_mres=MRES_UNSET;
+	lists=api_hook_lists;
+	for(hook=get_api_hooks(lists, 0, api, func_offset, &hook_end); likely(hook < hook_end); hook++) {
+		iplug=hook->plugin;
+		pfn_routine=(fn_t)hook->pfn;
+		
+		// lists were rebuilt by a plugin we called; entry may be stale
+		if(unlikely(lists != api_hook_lists) && !is_api_hook_valid(hook, 0, api, func_offset))
+			continue;
+		
+		// initialize PublicMetaGlobals
+		PublicMetaGlobals.mres = MRES_UNSET;
+		PublicMetaGlobals.prev_mres = prev_mres;
+		PublicMetaGlobals.status = status;
+		pub_orig_ret = class_ret_t(orig_ret);
+		PublicMetaGlobals.orig_ret = pub_orig_ret.getptr();
+		if(unlikely(status==MRES_SUPERCEDE)) {
+			pub_override_ret = class_ret_t(override_ret);
+			PublicMetaGlobals.override_ret = pub_override_ret.getptr();
+		}
+		
+		// call plugin
+		META_DEBUG(loglevel, ("Calling %s:%s()", iplug->file, api_info->name));
+		api_prof_enter(iplug->index);
+		start_tsc = GET_TSC();
+		dllret = call_routine(pfn_routine);
+		end_tsc = GET_TSC();
+		api_prof_leave(iplug->index, P_PRE, fn, end_tsc - start_tsc);
+		
+		// plugin's result code
+		mres=PublicMetaGlobals.mres;
+		api_trace_call(start_tsc, end_tsc, fn, iplug->index, P_PRE, mres);
+		if(unlikely(mres > status))
+			status = mres;
+		
+		// save this for successive plugins to see
+		prev_mres = mres;
+		
+		if(unlikely(mres==MRES_SUPERCEDE)) {
+			pub_override_ret = class_ret_t(dllret);
+			override_ret = dllret;
+		} 
+		else if(unlikely(mres==MRES_UNSET)) {
+			api_stats_count(iplug->index, fn, API_STAT_UNSET);
+		}
+		
+		// plugin says nobody else needs to see this call
+		if(unlikely(mres==MRES_SUPERCEDE) && (hook->flags & HOOK_STOP_ON_SUPERCEDE)) {
+			META_DEBUG(loglevel, ("Skipping further pre hooks of %s(); superceded by %s", api_info->name, iplug->file));
+			break;
+		}
+	}
+	
+	api_hook_call_count--;
+	
+	//Api call
+	if(likely(status!=MRES_SUPERCEDE)) {
+		//get api table
+		api_table = get_real_api_table(api);
+		
+		if(likely(api_table)) {
+			pfn_routine = (fn_t)get_api_function(api_table, func_offset);
+			if(likely(pfn_routine)) {
+				META_DEBUG(loglevel, ("Calling %s:%s()", get_real_api_owner(api), api_info->name));
+				api_prof_enter(API_PROF_SLOT_REAL);
+				start_tsc = GET_TSC();
+				dllret = call_routine(pfn_routine);
+				end_tsc = GET_TSC();
+				api_prof_leave(API_PROF_SLOT_REAL, P_PRE, fn, end_tsc - start_tsc);
+				api_trace_call(start_tsc, end_tsc, fn, API_PROF_SLOT_REAL, P_PRE, MRES_UNSET);
+				orig_ret = dllret;
+			} else {
+				// don't complain for NULL routines in NEW_DLL_FUNCTIONS
+				if(unlikely(api != e_api_newapi))
+					api_stats_count(API_PROF_SLOT_REAL, fn, API_STAT_NO_CALL);
+				status=MRES_UNSET;
+			}
+		} else {
+			// don't complain for NULL NEW_DLL_FUNCTIONS-table
+			if(unlikely(api != e_api_newapi))
+				META_DEBUG(loglevel, ("No api table defined for api call: %s:%s", get_real_api_owner(api), api_info->name));
+			status=MRES_UNSET;
+		}
+	} else {
+		META_DEBUG(loglevel, ("Skipped (supercede) %s:%s()", get_real_api_owner(api), api_info->name));
+		orig_ret = override_ret;
+		pub_orig_ret = class_ret_t(override_ret);
+		PublicMetaGlobals.orig_ret = pub_orig_ret.getptr();
+	}
+	
+	api_hook_call_count++;
+	
+	//Post plugin functions
+	prev_mres=MRES_UNSET;
+	lists=api_hook_lists;
+	for(hook=get_api_hooks(lists, 1, api, func_offset, &hook_end); likely(hook < hook_end); hook++) {
+		iplug=hook->plugin;
+		pfn_routine=(fn_t)hook->pfn;
+		
+		// lists were rebuilt by a plugin we called; entry may be stale
+		if(unlikely(lists != api_hook_lists) && !is_api_hook_valid(hook, 1, api, func_offset))
+			continue;
+		
+		// initialize PublicMetaGlobals
+		PublicMetaGlobals.mres = MRES_UNSET;
+		PublicMetaGlobals.prev_mres = prev_mres;
+		PublicMetaGlobals.status = status;
+		pub_orig_ret = class_ret_t(orig_ret);
+		PublicMetaGlobals.orig_ret = pub_orig_ret.getptr();
+		if(unlikely(status==MRES_OVERRIDE)) {
+			pub_override_ret = class_ret_t(override_ret);
+			PublicMetaGlobals.override_ret = pub_override_ret.getptr();
+		}
+		
+		// call plugin
+		META_DEBUG(loglevel, ("Calling %s:%s_Post()", iplug->file, api_info->name));
+		api_prof_enter(iplug->index);
+		start_tsc = GET_TSC();
+		dllret = call_routine(pfn_routine);
+		end_tsc = GET_TSC();
+		api_prof_leave(iplug->index, P_POST, fn, end_tsc - start_tsc);
+		
+		// plugin's result code
+		mres=PublicMetaGlobals.mres;
+		api_trace_call(start_tsc, end_tsc, fn, iplug->index, P_POST, mres);
+		if(unlikely(mres > status))
+			status = mres;
+		
+		// save this for successive plugins to see
+		prev_mres = mres;
+		
+		if(unlikely(mres==MRES_OVERRIDE)) {
+			pub_override_ret = class_ret_t(dllret);
+			override_ret = dllret;
+		}
+		else if(unlikely(mres==MRES_UNSET)) {
+			api_stats_count(iplug->index, fn, API_STAT_UNSET_POST);
+		}
+		else if(unlikely(mres==MRES_SUPERCEDE)) {
+			api_stats_count(iplug->index, fn, API_STAT_SUPERCEDE_POST);
+		}
+	}
+	
+	if(unlikely(--api_hook_call_count>0)) {
+		//Restore backup
+		PublicMetaGlobals = backup_meta_globals[0];
+	}
+	else if(unlikely(retired_api_hook_lists != NULL)) {
+		free_retired_api_hook_lists();
+	}
+	
+	if(likely(status!=MRES_OVERRIDE)) {
+		return(orig_ret);
+	} else {
+		META_DEBUG(loglevel, ("Returning (override) %s()", api_info->name));
+		return(override_ret);
+	}
+}
+
+// Build the lambda handed to main_hook_function(_void), calling a routine
+// of type FN_TYPE with the wrapper's arguments.
+#define API_CALL_ROUTINE(FN_TYPE, pfn_args) \
+	[&](FN_TYPE pfn_routine) { return((*pfn_routine) pfn_args); }
 
 #endif /*API_HOOK_H*/
@@ -53,14 +53,9 @@ typedef enum enum_api_t {
 	e_api_newapi = 2,
 } enum_api_t;
 
-// API caller function prototype
-typedef void * (DLLINTERNAL_NOVIS * api_caller_func_t)(const void * func, const void * packed_args);
-
-
 typedef struct api_info_s {
 	mBOOL trace;			// if true, log info about this function
 	int loglevel;			// level at which to log info about this function
-	api_caller_func_t api_caller;	// argument format/type for single-main-hook-function optimization
 	const char *name;		// string representation of function name
 } api_info_t;
 
@@ -309,4 +304,10 @@ extern const dllapi_info_t dllapi_info DLLHIDDEN;
 extern const newapi_info_t newapi_info DLLHIDDEN;
 extern const engine_info_t engine_info DLLHIDDEN;
 
+// Number of hookable functions in each api.
+#define NUM_ENGINE_FUNCS (sizeof(engine_info_t) / sizeof(api_info_t) - 1)
+#define NUM_DLLAPI_FUNCS (sizeof(dllapi_info_t) / sizeof(api_info_t) - 1)
+#define NUM_NEWAPI_FUNCS (sizeof(newapi_info_t) / sizeof(api_info_t) - 1)
+#define NUM_API_FUNCS (NUM_ENGINE_FUNCS + NUM_DLLAPI_FUNCS + NUM_NEWAPI_FUNCS)
+
 #endif /* API_INFO_H */
@@ -0,0 +1,264 @@
+/*
+ * Copyright (c) 2004-2006 Jussi Kivilinna
+ *
+ *    This file is part of "Metamod All-Mod-Support"-patch for Metamod.
+ *
+ *    Metamod is free software; you can redistribute it and/or modify it
+ *    under the terms of the GNU General Public License as published by the
+ *    Free Software Foundation; either version 2 of the License, or (at
+ *    your option) any later version.
+ *
+ *    Metamod is distributed in the hope that it will be useful, but
+ *    WITHOUT ANY WARRANTY; without even the implied warranty of
+ *    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ *    General Public License for more details.
+ *
+ *    You should have received a copy of the GNU General Public License
+ *    along with Metamod; if not, write to the Free Software Foundation,
+ *    Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+ *
+ *    In addition, as a special exception, the author gives permission to
+ *    link the code of this program with the Half-Life Game Engine ("HL
+ *    Engine") and Modified Game Libraries ("MODs") developed by Valve,
+ *    L.L.C ("Valve").  You must obey the GNU General Public License in all
+ *    respects for all of the code used other than the HL Engine and MODs
+ *    from Valve.  If you modify this file, you may extend this exception
+ *    to your version of the file, but you are not obligated to do so.  If
+ *    you do not wish to do so, delete this exception statement from your
+ *    version.
+ *
+ */
+
+#include <stdlib.h>			// calloc, qsort
+#include <string.h>			// memset
+#ifndef _WIN32
+#include <sys/time.h>		// gettimeofday
+#endif
+
+#include <extdll.h>
+
+#include "api_prof.h"		// me
+#include "api_hook.h"		// api_first_func
+#include "metamod.h"		// Plugins
+#include "log_meta.h"		// META_CONS, etc
+
+api_prof_hist_t *api_prof_hists[MAX_PLUGINS + 1][2][NUM_API_FUNCS];
+unsigned int api_prof_depth[MAX_PLUGINS + 1];
+unsigned long long api_prof_frame_tsc[MAX_PLUGINS + 1];
+
+// TSC and wall clock at startup, to convert ticks to time.
+static unsigned long long calib_tsc;
+static double calib_time;
+static double tsc_per_usec;
+
+static double DLLINTERNAL get_wall_time(void) {
+#ifdef _WIN32
+	LARGE_INTEGER freq, count;
+	QueryPerformanceFrequency(&freq);
+	QueryPerformanceCounter(&count);
+	return((double)count.QuadPart / (double)freq.QuadPart);
+#else
+	struct timeval tv;
+	gettimeofday(&tv, NULL);
+	return(tv.tv_sec + tv.tv_usec / 1000000.0);
+#endif
+}
+
+void DLLINTERNAL api_prof_init(void) {
+	calib_tsc = GET_TSC();
+	calib_time = get_wall_time();
+}
+
+// Ticks are measured against the wall clock once, after a second has
+// passed since startup, which is plenty to get the rate right.
+double DLLINTERNAL api_prof_tsc_per_usec(void) {
+	double elapsed;
+
+	if(likely(tsc_per_usec))
+		return(tsc_per_usec);
+	elapsed = get_wall_time() - calib_time;
+	if(elapsed < 1.0)
+		return(0);
+	tsc_per_usec = (double)(GET_TSC() - calib_tsc) / (elapsed * 1000000.0);
+	return(tsc_per_usec);
+}
+
+api_prof_hist_t * DLLINTERNAL api_prof_new_hist(int slot, int post, unsigned int fn) {
+	static mBOOL warned = mFALSE;
+	api_prof_hist_t *hist;
+
+	hist = (api_prof_hist_t *)calloc(1, sizeof(api_prof_hist_t));
+	if(!hist) {
+		if(!warned)
+			META_ERROR("Failed calloc() for api profiling histogram");
+		warned = mTRUE;
+		return(NULL);
+	}
+	api_prof_hists[slot][post][fn] = hist;
+	return(hist);
+}
+
+void DLLINTERNAL api_prof_reset_plugin(int slot) {
+	int post;
+	unsigned int fn;
+
+	for(post=0; post < 2; post++) {
+		for(fn=0; fn < NUM_API_FUNCS; fn++) {
+			if(api_prof_hists[slot][post][fn])
+				memset(api_prof_hists[slot][post][fn], 0, sizeof(api_prof_hist_t));
+		}
+	}
+}
+
+void DLLINTERNAL api_prof_reset(void) {
+	int slot;
+
+	for(slot=0; slot <= MAX_PLUGINS; slot++)
+		api_prof_reset_plugin(slot);
+}
+
+const api_info_t * DLLINTERNAL api_prof_func_info(unsigned int fn, enum_api_t *api) {
+	if(fn < api_first_func[e_api_dllapi]) {
+		*api = e_api_engine;
+		return(&((const api_info_t *)&engine_info)[fn]);
+	}
+	if(fn < api_first_func[e_api_newapi]) {
+		*api = e_api_dllapi;
+		return(&((const api_info_t *)&dllapi_info)[fn - api_first_func[e_api_dllapi]]);
+	}
+	*api = e_api_newapi;
+	return(&((const api_info_t *)&newapi_info)[fn - api_first_func[e_api_newapi]]);
+}
+
+int DLLINTERNAL api_prof_find_func(const char *name) {
+	const api_info_t *info;
+	enum_api_t api;
+	unsigned int fn;
+
+	// allow engine names with their "pfn" prefix, as in enginefuncs_t
+	if(!strncasecmp(name, "pfn", 3))
+		name += 3;
+	for(fn=0; fn < NUM_API_FUNCS; fn++) {
+		info = api_prof_func_info(fn, &api);
+		if(!strcasecmp(name, info->name))
+			return(fn);
+	}
+	return(-1);
+}
+
+// Approximate value at percentile 'pct' (0-100), in ticks; the middle of
+// the bucket it falls in.
+static double DLLINTERNAL hist_percentile(const api_prof_hist_t *hist, double pct) {
+	unsigned long long want, seen;
+	unsigned int i, msb;
+	double lo, width;
+
+	want = (unsigned long long)(hist->count * pct / 100.0);
+	if(want < 1)
+		want = 1;
+	seen = 0;
+	for(i=0; i < API_PROF_BUCKETS; i++) {
+		seen += hist->buckets[i];
+		if(seen >= want)
+			break;
+	}
+	if(i < 4)
+		return(i);
+	msb = (i >> 2) + 1;
+	lo = (double)((4 + (i & 3)) * (1ULL << (msb - 2)));
+	width = (double)(1ULL << (msb - 2));
+	if(lo + width / 2 > hist->max_tsc)
+		return(hist->max_tsc);
+	return(lo + width / 2);
+}
+
+typedef struct prof_row_s {
+	int slot;
+	int post;
+	unsigned int fn;
+	const api_prof_hist_t *hist;
+} prof_row_t;
+
+static int prof_row_cmp(const void *a, const void *b) {
+	const prof_row_t *ra = (const prof_row_t *)a;
+	const prof_row_t *rb = (const prof_row_t *)b;
+
+	if(ra->hist->total_tsc > rb->hist->total_tsc)
+		return(-1);
+	if(ra->hist->total_tsc < rb->hist->total_tsc)
+		return(1);
+	return(0);
+}
+
+// Most expensive entries first.  Without filters, only the top entries
+// are shown, since a busy server has hundreds of them.
+#define PROF_SHOW_TOP 25
+
+void DLLINTERNAL api_prof_show(int plugin_slot, int fn_filter) {
+	prof_row_t *rows;
+	const api_info_t *info;
+	const char *owner;
+	enum_api_t api;
+	double tsc_per_usec;
+	int slot, post, nrows, i, limit;
+	unsigned int fn;
+
+	tsc_per_usec = api_prof_tsc_per_usec();
+	if(!tsc_per_usec) {
+		META_CONS("Profiling clock not calibrated yet; try again in a second.");
+		return;
+	}
+
+	rows = (prof_row_t *)malloc((MAX_PLUGINS + 1) * 2 * NUM_API_FUNCS * sizeof(prof_row_t));
+	if(!rows) {
+		META_CONS("Failed malloc() for profile listing");
+		return;
+	}
+	nrows = 0;
+	for(slot=0; slot <= MAX_PLUGINS; slot++) {
+		if(plugin_slot >= 0 && slot != plugin_slot)
+			continue;
+		for(post=0; post < 2; post++) {
+			for(fn=0; fn < NUM_API_FUNCS; fn++) {
+				if(fn_filter >= 0 && fn != (unsigned int)fn_filter)
+					continue;
+				if(!api_prof_hists[slot][post][fn] || !api_prof_hists[slot][post][fn]->count)
+					continue;
+				rows[nrows].slot = slot;
+				rows[nrows].post = post;
+				rows[nrows].fn = fn;
+				rows[nrows].hist = api_prof_hists[slot][post][fn];
+				nrows++;
+			}
+		}
+	}
+	qsort(rows, nrows, sizeof(prof_row_t), prof_row_cmp);
+
+	limit = (plugin_slot < 0 && fn_filter < 0 && nrows > PROF_SHOW_TOP) ? PROF_SHOW_TOP : nrows;
+
+	META_CONS("%-*s %-20s %-24s %4s %10s %9s %9s %9s %10s", WIDTH_MAX_PLUGINS, "", 
+			"plugin", "function", "", "calls", "p50 us", "p99 us", "max us", "total ms");
+	for(i=0; i < limit; i++) {
+		info = api_prof_func_info(rows[i].fn, &api);
+		if(rows[i].slot == API_PROF_SLOT_REAL)
+			owner = (api == e_api_engine) ? "engine" : GameDLL.name;
+		else if(Plugins->plist[rows[i].slot - 1].status >= PL_VALID)
+			owner = Plugins->plist[rows[i].slot - 1].desc;
+		else
+			owner = "(unloaded)";
+		META_CONS("%*d %-20.20s %-24.24s %4s %10.0f %9.2f %9.2f %9.2f %10.2f", 
+				WIDTH_MAX_PLUGINS, rows[i].slot, owner, info->name,
+				rows[i].slot == API_PROF_SLOT_REAL ? "call" : (rows[i].post ? "post" : "pre"),
+				(double)rows[i].hist->count,
+				hist_percentile(rows[i].hist, 50) / tsc_per_usec,
+				hist_percentile(rows[i].hist, 99) / tsc_per_usec,
+				rows[i].hist->max_tsc / tsc_per_usec,
+				rows[i].hist->total_tsc / tsc_per_usec / 1000.0);
+	}
+	if(limit < nrows)
+		META_CONS("(%d more; use \"meta prof <plugin> [<function>]\" to narrow)", nrows - limit);
+	else if(!nrows)
+		META_CONS("No calls recorded.");
+
+	free(rows);
+}
@@ -0,0 +1,148 @@
+/*
+ * Copyright (c) 2004-2006 Jussi Kivilinna
+ *
+ *    This file is part of "Metamod All-Mod-Support"-patch for Metamod.
+ *
+ *    Metamod is free software; you can redistribute it and/or modify it
+ *    under the terms of the GNU General Public License as published by the
+ *    Free Software Foundation; either version 2 of the License, or (at
+ *    your option) any later version.
+ *
+ *    Metamod is distributed in the hope that it will be useful, but
+ *    WITHOUT ANY WARRANTY; without even the implied warranty of
+ *    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ *    General Public License for more details.
+ *
+ *    You should have received a copy of the GNU General Public License
+ *    along with Metamod; if not, write to the Free Software Foundation,
+ *    Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+ *
+ *    In addition, as a special exception, the author gives permission to
+ *    link the code of this program with the Half-Life Game Engine ("HL
+ *    Engine") and Modified Game Libraries ("MODs") developed by Valve,
+ *    L.L.C ("Valve").  You must obey the GNU General Public License in all
+ *    respects for all of the code used other than the HL Engine and MODs
+ *    from Valve.  If you modify this file, you may extend this exception
+ *    to your version of the file, but you are not obligated to do so.  If
+ *    you do not wish to do so, delete this exception statement from your
+ *    version.
+ *
+ */
+
+#ifndef API_PROF_H
+#define API_PROF_H
+
+#include "comp_dep.h"
+#include "api_info.h"		// NUM_API_FUNCS
+#include "mlist.h"			// MAX_PLUGINS
+#include "osdep.h"			// unlikely
+
+// Per-call latency histograms for api hooks.
+//
+// Every call made by main_hook_function(_void) is timed, and recorded in
+// the histogram for (plugin, function, pre/post).  Calls to the real
+// engine/gamedll routine are recorded in slot API_PROF_SLOT_REAL, and
+// plugins in the slot of their 1-based plugin index.  Timings are
+// inclusive; time spent in engine calls a plugin makes from its hook is
+// counted for that hook as well.
+//
+// Each slot also sums the time of its outermost calls into
+// api_prof_frame_tsc, for api_budget_end_frame() to check and clear once
+// per frame.
+//
+// Buckets are log-linear, four per power of two, so reported percentiles
+// are within 25% of the real value.  Histograms are allocated the first
+// time a function is called through a plugin.
+
+#define API_PROF_SLOT_REAL	0
+#define API_PROF_BUCKETS	256
+
+typedef struct api_prof_hist_s {
+	unsigned long long count;
+	unsigned long long total_tsc;
+	unsigned long long max_tsc;
+	unsigned long long buckets[API_PROF_BUCKETS];
+} api_prof_hist_t;
+
+extern api_prof_hist_t *api_prof_hists[MAX_PLUGINS + 1][2][NUM_API_FUNCS] DLLHIDDEN;
+extern unsigned int api_prof_depth[MAX_PLUGINS + 1] DLLHIDDEN;
+extern unsigned long long api_prof_frame_tsc[MAX_PLUGINS + 1] DLLHIDDEN;
+
+inline unsigned long long DLLINTERNAL GET_TSC(void) {
+	union { struct { unsigned int eax, edx;	} split; unsigned long long full; } tsc;
+#ifdef __GNUC__
+	__asm__ __volatile__("rdtsc":"=a"(tsc.split.eax), "=d"(tsc.split.edx));	
+#else
+	__asm
+	{
+		rdtsc
+		mov tsc.split.eax, eax
+		mov tsc.split.edx, edx
+	}
+#endif
+	return(tsc.full);
+}
+
+// histogram bucket for a call taking 'tsc' ticks
+inline unsigned int DLLINTERNAL api_prof_bucket(unsigned long long tsc) {
+	unsigned int msb;
+
+	if(tsc < 4)
+		return((unsigned int)tsc);
+#ifdef __GNUC__
+	msb = 63 - __builtin_clzll(tsc);
+#else
+	for(msb = 2; tsc >> (msb + 1); msb++)
+		;
+#endif
+	return(((msb - 1) << 2) | (unsigned int)((tsc >> (msb - 2)) & 3));
+}
+
+api_prof_hist_t * DLLINTERNAL api_prof_new_hist(int slot, int post, unsigned int fn);
+
+// start of a call into hook/routine in slot
+inline void DLLINTERNAL api_prof_enter(int slot) {
+	api_prof_depth[slot]++;
+}
+
+// end of a call into hook/routine in slot, for function 'fn' (index in
+// hook lists, see api_first_func), which took 'tsc' ticks
+inline void DLLINTERNAL api_prof_leave(int slot, int post, unsigned int fn, unsigned long long tsc) {
+	api_prof_hist_t *hist;
+
+	// nested calls are already included in the outer call's time
+	if(--api_prof_depth[slot] == 0)
+		api_prof_frame_tsc[slot] += tsc;
+
+	hist = api_prof_hists[slot][post][fn];
+	if(unlikely(!hist)) {
+		hist = api_prof_new_hist(slot, post, fn);
+		if(!hist)
+			return;
+	}
+	hist->count++;
+	hist->total_tsc += tsc;
+	if(unlikely(tsc > hist->max_tsc))
+		hist->max_tsc = tsc;
+	hist->buckets[api_prof_bucket(tsc)]++;
+}
+
+void DLLINTERNAL api_prof_init(void);
+
+// TSC ticks per microsecond, or 0 if not calibrated yet
+double DLLINTERNAL api_prof_tsc_per_usec(void);
+
+void DLLINTERNAL api_prof_reset(void);
+void DLLINTERNAL api_prof_reset_plugin(int slot);
+
+// print histogram summaries to console; plugin_slot -1 for all slots,
+// fn -1 for all functions
+void DLLINTERNAL api_prof_show(int plugin_slot, int fn);
+
+// api and api_info entry for function index
+const api_info_t * DLLINTERNAL api_prof_func_info(unsigned int fn, enum_api_t *api);
+
+// find function index by name, or -1
+int DLLINTERNAL api_prof_find_func(const char *name);
+
+#endif /* API_PROF_H */
@@ -0,0 +1,177 @@
+/*
+ * Copyright (c) 2004-2006 Jussi Kivilinna
+ *
+ *    This file is part of "Metamod All-Mod-Support"-patch for Metamod.
+ *
+ *    Metamod is free software; you can redistribute it and/or modify it
+ *    under the terms of the GNU General Public License as published by the
+ *    Free Software Foundation; either version 2 of the License, or (at
+ *    your option) any later version.
+ *
+ *    Metamod is distributed in the hope that it will be useful, but
+ *    WITHOUT ANY WARRANTY; without even the implied warranty of
+ *    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ *    General Public License for more details.
+ *
+ *    You should have received a copy of the GNU General Public License
+ *    along with Metamod; if not, write to the Free Software Foundation,
+ *    Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+ *
+ *    In addition, as a special exception, the author gives permission to
+ *    link the code of this program with the Half-Life Game Engine ("HL
+ *    Engine") and Modified Game Libraries ("MODs") developed by Valve,
+ *    L.L.C ("Valve").  You must obey the GNU General Public License in all
+ *    respects for all of the code used other than the HL Engine and MODs
+ *    from Valve.  If you modify this file, you may extend this exception
+ *    to your version of the file, but you are not obligated to do so.  If
+ *    you do not wish to do so, delete this exception statement from your
+ *    version.
+ *
+ */
+
+#include <time.h>			// time
+#include <atomic>			// std::atomic
+
+#include <extdll.h>
+
+#include "api_stats.h"		// me
+#include "api_prof.h"		// API_PROF_SLOT_REAL, api_prof_func_info
+#include "api_hook.h"		// get_real_api_owner
+#include "metamod.h"		// Plugins
+#include "log_meta.h"		// META_WARNING, etc
+#include "log_async.h"		// log_async_dropped
+#include "api_async.h"		// api_async_queued, etc
+
+// Hooks could in principle run on other threads, so counts are atomic.
+// What has been summarized is only touched from the main thread.
+static std::atomic<unsigned int> stat_counts[MAX_PLUGINS + 1][NUM_API_FUNCS][API_STAT_MAX];
+static unsigned int stat_reported[MAX_PLUGINS + 1][NUM_API_FUNCS][API_STAT_MAX];
+static std::atomic<bool> stats_pending(false);
+static time_t last_summary = 0;
+
+static const char *const stat_desc[API_STAT_MAX] = {
+	"unset meta_result",
+	"unset meta_result",
+	"MRES_SUPERCEDE in post",
+	"missing api call",
+};
+
+// Name of what's in the slot, for messages.
+static const char * DLLINTERNAL slot_name(int slot, enum_api_t api) {
+	if(slot == API_PROF_SLOT_REAL)
+		return(get_real_api_owner(api));
+	if(Plugins && slot <= Plugins->endlist && Plugins->plist[slot - 1].status >= PL_VALID)
+		return(Plugins->plist[slot - 1].file);
+	return("(unloaded plugin)");
+}
+
+void DLLINTERNAL api_stats_count(int slot, unsigned int fn, api_stat_t stat) {
+	const api_info_t *info;
+	enum_api_t api;
+
+	if(stat_counts[slot][fn][stat].fetch_add(1, std::memory_order_relaxed) != 0) {
+		stats_pending.store(true, std::memory_order_relaxed);
+		return;
+	}
+
+	// first one; say what's going on right away
+	info = api_prof_func_info(fn, &api);
+	switch(stat) {
+		case API_STAT_UNSET:
+			META_WARNING("Plugin didn't set meta_result: %s:%s() (further ones are counted; see 'meta stats')", 
+					slot_name(slot, api), info->name);
+			break;
+		case API_STAT_UNSET_POST:
+			META_WARNING("Plugin didn't set meta_result: %s:%s_Post() (further ones are counted; see 'meta stats')", 
+					slot_name(slot, api), info->name);
+			break;
+		case API_STAT_SUPERCEDE_POST:
+			META_WARNING("MRES_SUPERCEDE not valid in Post functions: %s:%s_Post() (further ones are counted; see 'meta stats')", 
+					slot_name(slot, api), info->name);
+			break;
+		default:
+			META_WARNING("Couldn't find api call: %s:%s (further ones are counted; see 'meta stats')", 
+					slot_name(slot, api), info->name);
+			break;
+	}
+	stat_reported[slot][fn][stat] = 1;
+}
+
+void DLLINTERNAL api_stats_frame(void) {
+	const api_info_t *info;
+	enum_api_t api;
+	unsigned int fn, count, delta;
+	time_t now;
+	int slot, stat;
+
+	if(likely(!stats_pending.load(std::memory_order_relaxed)))
+		return;
+	now = time(NULL);
+	if(now - last_summary < API_STATS_SUMMARY_SECS)
+		return;
+	stats_pending.store(false, std::memory_order_relaxed);
+
+	for(slot=0; slot <= MAX_PLUGINS; slot++) {
+		for(fn=0; fn < NUM_API_FUNCS; fn++) {
+			for(stat=0; stat < API_STAT_MAX; stat++) {
+				count = stat_counts[slot][fn][stat].load(std::memory_order_relaxed);
+				delta = count - stat_reported[slot][fn][stat];
+				if(!count || (int)delta <= 0)
+					continue;
+				stat_reported[slot][fn][stat] = count;
+				info = api_prof_func_info(fn, &api);
+				META_WARNING("%s %s: %u %s in %s%s over last %d s", 
+						slot == API_PROF_SLOT_REAL ? "Game" : "Plugin", 
+						slot_name(slot, api), delta, stat_desc[stat], info->name, 
+						stat == API_STAT_UNSET || stat == API_STAT_NO_CALL ? "" : "_Post", 
+						last_summary ? (int)(now - last_summary) : API_STATS_SUMMARY_SECS);
+			}
+		}
+	}
+	last_summary = now;
+}
+
+void DLLINTERNAL api_stats_reset_plugin(int slot) {
+	unsigned int fn;
+	int stat;
+
+	for(fn=0; fn < NUM_API_FUNCS; fn++) {
+		for(stat=0; stat < API_STAT_MAX; stat++) {
+			stat_counts[slot][fn][stat].store(0, std::memory_order_relaxed);
+			stat_reported[slot][fn][stat] = 0;
+		}
+	}
+}
+
+void DLLINTERNAL api_stats_show(void) {
+	const api_info_t *info;
+	enum_api_t api;
+	unsigned int fn, count;
+	int slot, stat, n;
+
+	n = 0;
+	for(slot=0; slot <= MAX_PLUGINS; slot++) {
+		for(fn=0; fn < NUM_API_FUNCS; fn++) {
+			for(stat=0; stat < API_STAT_MAX; stat++) {
+				count = stat_counts[slot][fn][stat].exchange(0, std::memory_order_relaxed);
+				stat_reported[slot][fn][stat] = 0;
+				if(!count)
+					continue;
+				if(!n++)
+					META_CONS("%*s %-20s %-28s %-24s %10s", WIDTH_MAX_PLUGINS, "", 
+							"file", "function", "condition", "count");
+				info = api_prof_func_info(fn, &api);
+				META_CONS("%*d %-20.20s %-22.22s%-6s %-24s %10u", WIDTH_MAX_PLUGINS, slot, 
+						slot_name(slot, api), info->name, 
+						stat == API_STAT_UNSET || stat == API_STAT_NO_CALL ? "" : "_Post", 
+						stat_desc[stat], count);
+			}
+		}
+	}
+	if(!n)
+		META_CONS("No hook problems counted.");
+	META_CONS("Log messages dropped since start: %u", log_async_dropped());
+	META_CONS("Async observer calls since start: %u queued, %u dropped", 
+			api_async_queued(), api_async_dropped());
+	META_CONS("Reset hook problem counters.");
+}
@@ -0,0 +1,69 @@
+/*
+ * Copyright (c) 2004-2006 Jussi Kivilinna
+ *
+ *    This file is part of "Metamod All-Mod-Support"-patch for Metamod.
+ *
+ *    Metamod is free software; you can redistribute it and/or modify it
+ *    under the terms of the GNU General Public License as published by the
+ *    Free Software Foundation; either version 2 of the License, or (at
+ *    your option) any later version.
+ *
+ *    Metamod is distributed in the hope that it will be useful, but
+ *    WITHOUT ANY WARRANTY; without even the implied warranty of
+ *    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ *    General Public License for more details.
+ *
+ *    You should have received a copy of the GNU General Public License
+ *    along with Metamod; if not, write to the Free Software Foundation,
+ *    Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+ *
+ *    In addition, as a special exception, the author gives permission to
+ *    link the code of this program with the Half-Life Game Engine ("HL
+ *    Engine") and Modified Game Libraries ("MODs") developed by Valve,
+ *    L.L.C ("Valve").  You must obey the GNU General Public License in all
+ *    respects for all of the code used other than the HL Engine and MODs
+ *    from Valve.  If you modify this file, you may extend this exception
+ *    to your version of the file, but you are not obligated to do so.  If
+ *    you do not wish to do so, delete this exception statement from your
+ *    version.
+ *
+ */
+
+#ifndef API_STATS_H
+#define API_STATS_H
+
+#include "api_info.h"		// NUM_API_FUNCS
+#include "mlist.h"			// MAX_PLUGINS
+#include "osdep.h"			// DLLINTERNAL
+
+// Counters for misbehaviour seen in the hook loops, per (plugin, function,
+// condition), instead of a warning every time.  The first occurrence
+// since the counters were reset is still logged as it happens; after that
+// a summary of new occurrences is logged at most every
+// API_STATS_SUMMARY_SECS, and "meta stats" shows and resets the totals.
+//
+// Slots are as in api_prof: plugins by 1-based index, and
+// API_PROF_SLOT_REAL for the engine/gamedll.
+
+#define API_STATS_SUMMARY_SECS	60
+
+typedef enum {
+	API_STAT_UNSET = 0,			// plugin didn't set meta_result
+	API_STAT_UNSET_POST,		// same, in a post function
+	API_STAT_SUPERCEDE_POST,	// MRES_SUPERCEDE from a post function
+	API_STAT_NO_CALL,			// engine/gamedll has no routine to call
+	API_STAT_MAX
+} api_stat_t;
+
+// count an occurrence of 'stat' for function index 'fn'
+void DLLINTERNAL api_stats_count(int slot, unsigned int fn, api_stat_t stat);
+
+// log summary if one is due; called every frame
+void DLLINTERNAL api_stats_frame(void);
+
+void DLLINTERNAL api_stats_reset_plugin(int slot);
+
+// print counters to console, and reset them
+void DLLINTERNAL api_stats_show(void);
+
+#endif /* API_STATS_H */
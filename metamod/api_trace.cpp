@@ -0,0 +1,212 @@
+/*
+ * Copyright (c) 2004-2006 Jussi Kivilinna
+ *
+ *    This file is part of "Metamod All-Mod-Support"-patch for Metamod.
+ *
+ *    Metamod is free software; you can redistribute it and/or modify it
+ *    under the terms of the GNU General Public License as published by the
+ *    Free Software Foundation; either version 2 of the License, or (at
+ *    your option) any later version.
+ *
+ *    Metamod is distributed in the hope that it will be useful, but
+ *    WITHOUT ANY WARRANTY; without even the implied warranty of
+ *    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ *    General Public License for more details.
+ *
+ *    You should have received a copy of the GNU General Public License
+ *    along with Metamod; if not, write to the Free Software Foundation,
+ *    Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+ *
+ *    In addition, as a special exception, the author gives permission to
+ *    link the code of this program with the Half-Life Game Engine ("HL
+ *    Engine") and Modified Game Libraries ("MODs") developed by Valve,
+ *    L.L.C ("Valve").  You must obey the GNU General Public License in all
+ *    respects for all of the code used other than the HL Engine and MODs
+ *    from Valve.  If you modify this file, you may extend this exception
+ *    to your version of the file, but you are not obligated to do so.  If
+ *    you do not wish to do so, delete this exception statement from your
+ *    version.
+ *
+ */
+
+#include <stdio.h>			// fopen, etc
+#include <stdlib.h>			// calloc
+#include <string.h>			// memcpy, strlen
+#include <atomic>			// std::atomic
+
+#include <extdll.h>
+
+#include "api_trace.h"		// me
+#include "api_prof.h"		// GET_TSC, api_prof_func_info, etc
+#include "metamod.h"		// Plugins, GameDLL
+#include "log_meta.h"		// META_CONS, etc
+#include "osdep.h"			// is_absolute_path, etc
+#include "support_meta.h"	// STRNCPY
+
+typedef struct api_trace_ring_s {
+	struct api_trace_ring_s *next;
+	unsigned int thread;
+	// records written since trace start; only the owning thread writes
+	volatile unsigned int head;
+	api_trace_rec_t recs[API_TRACE_RING_SIZE];
+} api_trace_ring_t;
+
+volatile mBOOL api_trace_active = mFALSE;
+
+// Rings of all threads that have recorded; rings are kept until exit, and
+// added with a compare-and-swap so threads never wait on each other.
+static std::atomic<api_trace_ring_t *> trace_rings(NULL);
+static std::atomic<unsigned int> num_trace_rings(0);
+static thread_local api_trace_ring_t *thread_ring = NULL;
+
+static unsigned long long trace_start_tsc;
+
+static api_trace_ring_t * DLLINTERNAL new_ring(void) {
+	static mBOOL warned = mFALSE;
+	api_trace_ring_t *ring, *head;
+
+	ring = (api_trace_ring_t *)calloc(1, sizeof(api_trace_ring_t));
+	if(!ring) {
+		if(!warned)
+			META_ERROR("Failed calloc() for trace ring buffer");
+		warned = mTRUE;
+		return(NULL);
+	}
+	ring->thread = num_trace_rings++;
+	head = trace_rings.load();
+	do {
+		ring->next = head;
+	} while(!trace_rings.compare_exchange_weak(head, ring));
+	return(ring);
+}
+
+void DLLINTERNAL api_trace_record(unsigned long long start_tsc, unsigned long long end_tsc, unsigned int fn, int slot, int post, META_RES mres) {
+	api_trace_ring_t *ring;
+	api_trace_rec_t *rec;
+	unsigned long long duration;
+
+	ring = thread_ring;
+	if(unlikely(!ring)) {
+		ring = thread_ring = new_ring();
+		if(!ring)
+			return;
+	}
+	rec = &ring->recs[ring->head & (API_TRACE_RING_SIZE - 1)];
+	duration = end_tsc - start_tsc;
+	rec->tsc = start_tsc;
+	rec->duration = duration > 0xffffffffULL ? 0xffffffffU : (uint32_t)duration;
+	rec->func = (uint16_t)fn;
+	rec->slot = (uint8_t)slot;
+	rec->post = (uint8_t)post;
+	rec->mres = (uint8_t)mres;
+	rec->thread = (uint16_t)ring->thread;
+	ring->head++;
+}
+
+void DLLINTERNAL api_trace_start(void) {
+	api_trace_ring_t *ring;
+
+	api_trace_active = mFALSE;
+	for(ring = trace_rings.load(); ring; ring = ring->next)
+		ring->head = 0;
+	trace_start_tsc = GET_TSC();
+	api_trace_active = mTRUE;
+}
+
+void DLLINTERNAL api_trace_stop(void) {
+	api_trace_active = mFALSE;
+}
+
+// Records a ring holds, oldest first from 'first'.
+static unsigned int DLLINTERNAL ring_count(const api_trace_ring_t *ring, unsigned int *first) {
+	unsigned int head = ring->head;
+
+	if(head > API_TRACE_RING_SIZE) {
+		*first = head - API_TRACE_RING_SIZE;
+		return(API_TRACE_RING_SIZE);
+	}
+	*first = 0;
+	return(head);
+}
+
+int DLLINTERNAL api_trace_dump(const char *filename) {
+	char path[PATH_MAX];
+	api_trace_header_t header;
+	api_trace_ring_t *ring;
+	const api_info_t *info;
+	const char *name;
+	enum_api_t api;
+	unsigned int fn, first, count, i;
+	mBOOL was_active;
+	FILE *fp;
+	int slot;
+
+	if(is_absolute_path(filename))
+		STRNCPY(path, filename, sizeof(path));
+	else
+		safevoid_snprintf(path, sizeof(path), "%s/%s", GameDLL.gamedir, filename);
+	fp = fopen(path, "wb");
+	if(!fp) {
+		META_WARNING("Couldn't open trace dump '%s': %s", path, strerror(errno));
+		return(-1);
+	}
+
+	// don't let our own thread overwrite what we're writing
+	was_active = api_trace_active;
+	api_trace_active = mFALSE;
+
+	memset(&header, 0, sizeof(header));
+	memcpy(header.magic, API_TRACE_MAGIC, sizeof(header.magic));
+	header.version = API_TRACE_VERSION;
+	header.tsc_per_usec = api_prof_tsc_per_usec();
+	header.num_funcs = NUM_API_FUNCS;
+	header.num_slots = MAX_PLUGINS + 1;
+	for(ring = trace_rings.load(); ring; ring = ring->next)
+		header.num_recs += ring_count(ring, &first);
+	fwrite(&header, sizeof(header), 1, fp);
+
+	for(fn=0; fn < NUM_API_FUNCS; fn++) {
+		info = api_prof_func_info(fn, &api);
+		fprintf(fp, "%s.%s%c", api == e_api_engine ? "engine" : (api == e_api_dllapi ? "dllapi" : "newapi"), info->name, '\0');
+	}
+	for(slot=0; slot <= MAX_PLUGINS; slot++) {
+		if(slot == API_PROF_SLOT_REAL)
+			name = GameDLL.name[0] ? GameDLL.name : "gamedll";
+		else if(Plugins && slot <= Plugins->endlist && Plugins->plist[slot - 1].status >= PL_VALID)
+			name = Plugins->plist[slot - 1].desc;
+		else
+			name = "";
+		fprintf(fp, "%s%c", name, '\0');
+	}
+
+	for(ring = trace_rings.load(); ring; ring = ring->next) {
+		count = ring_count(ring, &first);
+		for(i=0; i < count; i++)
+			fwrite(&ring->recs[(first + i) & (API_TRACE_RING_SIZE - 1)], sizeof(api_trace_rec_t), 1, fp);
+	}
+
+	api_trace_active = was_active;
+	if(fclose(fp) != 0) {
+		META_WARNING("Couldn't write trace dump '%s': %s", path, strerror(errno));
+		return(-1);
+	}
+	return(header.num_recs);
+}
+
+void DLLINTERNAL api_trace_show(void) {
+	api_trace_ring_t *ring;
+	unsigned int first, total, kept;
+	double tpu;
+
+	total = 0;
+	kept = 0;
+	for(ring = trace_rings.load(); ring; ring = ring->next) {
+		total += ring->head;
+		kept += ring_count(ring, &first);
+	}
+	META_CONS("Hook call trace %s; %u calls recorded, last %u kept, in %u thread(s)",
+			api_trace_active ? "running" : "stopped", total, kept, num_trace_rings.load());
+	tpu = api_prof_tsc_per_usec();
+	if(api_trace_active && tpu)
+		META_CONS("Running for %.1f s", (GET_TSC() - trace_start_tsc) / tpu / 1000000.0);
+}
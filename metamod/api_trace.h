@@ -0,0 +1,67 @@
+/*
+ * Copyright (c) 2004-2006 Jussi Kivilinna
+ *
+ *    This file is part of "Metamod All-Mod-Support"-patch for Metamod.
+ *
+ *    Metamod is free software; you can redistribute it and/or modify it
+ *    under the terms of the GNU General Public License as published by the
+ *    Free Software Foundation; either version 2 of the License, or (at
+ *    your option) any later version.
+ *
+ *    Metamod is distributed in the hope that it will be useful, but
+ *    WITHOUT ANY WARRANTY; without even the implied warranty of
+ *    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ *    General Public License for more details.
+ *
+ *    You should have received a copy of the GNU General Public License
+ *    along with Metamod; if not, write to the Free Software Foundation,
+ *    Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+ *
+ *    In addition, as a special exception, the author gives permission to
+ *    link the code of this program with the Half-Life Game Engine ("HL
+ *    Engine") and Modified Game Libraries ("MODs") developed by Valve,
+ *    L.L.C ("Valve").  You must obey the GNU General Public License in all
+ *    respects for all of the code used other than the HL Engine and MODs
+ *    from Valve.  If you modify this file, you may extend this exception
+ *    to your version of the file, but you are not obligated to do so.  If
+ *    you do not wish to do so, delete this exception statement from your
+ *    version.
+ *
+ */
+
+#ifndef API_TRACE_H
+#define API_TRACE_H
+
+#include "comp_dep.h"
+#include "types_meta.h"		// mBOOL
+#include "meta_api.h"		// META_RES
+#include "osdep.h"			// unlikely
+#include "api_trace_format.h"	// api_trace_rec_t
+
+// Hook call trace, for "meta trace".
+//
+// While tracing, every call main_hook_function(_void) makes into a plugin
+// hook or the real routine is recorded into a ring buffer of the calling
+// thread, keeping the last API_TRACE_RING_SIZE calls of each thread.  Only
+// the owning thread writes its ring, so recording takes no locks.  Dumps
+// are converted offline by the meta_trace_conv tool (see tools/).
+
+#define API_TRACE_RING_SIZE	65536	// power of two
+
+extern volatile mBOOL api_trace_active DLLHIDDEN;
+
+void DLLINTERNAL api_trace_record(unsigned long long start_tsc, unsigned long long end_tsc, unsigned int fn, int slot, int post, META_RES mres);
+
+inline void DLLINTERNAL api_trace_call(unsigned long long start_tsc, unsigned long long end_tsc, unsigned int fn, int slot, int post, META_RES mres) {
+	if(unlikely(api_trace_active))
+		api_trace_record(start_tsc, end_tsc, fn, slot, post, mres);
+}
+
+void DLLINTERNAL api_trace_start(void);
+void DLLINTERNAL api_trace_stop(void);
+// write recorded calls to file in gamedir; returns number of records, or
+// -1 on error
+int DLLINTERNAL api_trace_dump(const char *filename);
+void DLLINTERNAL api_trace_show(void);
+
+#endif /* API_TRACE_H */
@@ -0,0 +1,78 @@
+/*
+ * Copyright (c) 2004-2006 Jussi Kivilinna
+ *
+ *    This file is part of "Metamod All-Mod-Support"-patch for Metamod.
+ *
+ *    Metamod is free software; you can redistribute it and/or modify it
+ *    under the terms of the GNU General Public License as published by the
+ *    Free Software Foundation; either version 2 of the License, or (at
+ *    your option) any later version.
+ *
+ *    Metamod is distributed in the hope that it will be useful, but
+ *    WITHOUT ANY WARRANTY; without even the implied warranty of
+ *    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ *    General Public License for more details.
+ *
+ *    You should have received a copy of the GNU General Public License
+ *    along with Metamod; if not, write to the Free Software Foundation,
+ *    Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+ *
+ *    In addition, as a special exception, the author gives permission to
+ *    link the code of this program with the Half-Life Game Engine ("HL
+ *    Engine") and Modified Game Libraries ("MODs") developed by Valve,
+ *    L.L.C ("Valve").  You must obey the GNU General Public License in all
+ *    respects for all of the code used other than the HL Engine and MODs
+ *    from Valve.  If you modify this file, you may extend this exception
+ *    to your version of the file, but you are not obligated to do so.  If
+ *    you do not wish to do so, delete this exception statement from your
+ *    version.
+ *
+ */
+
+#ifndef API_TRACE_FORMAT_H
+#define API_TRACE_FORMAT_H
+
+#include <stdint.h>
+
+// Layout of "meta trace dump" files; shared with the standalone
+// meta_trace_conv tool, so this must not depend on anything else here.
+//
+// A dump is, in host (x86, little endian) byte order:
+//
+//	api_trace_header_t
+//	num_funcs NUL-terminated function names, as "engine.WriteByte",
+//		"dllapi.Touch", "newapi.ShouldCollide"
+//	num_slots NUL-terminated plugin names; slot 0 is the gamedll
+//	num_recs api_trace_rec_t
+//
+// Records of each thread are oldest first, but threads follow each other;
+// sort by tsc to interleave them.
+
+#define API_TRACE_MAGIC		"MMTR"
+#define API_TRACE_VERSION	1
+
+typedef struct api_trace_header_s {
+	char magic[4];
+	uint32_t version;
+	double tsc_per_usec;		// 0 if not calibrated
+	uint32_t num_funcs;
+	uint32_t num_slots;
+	uint32_t num_recs;
+	uint32_t reserved;
+} api_trace_header_t;
+
+// One call from main_hook_function(_void) into a plugin hook or the real
+// engine/gamedll routine.
+typedef struct api_trace_rec_s {
+	uint64_t tsc;				// start of call
+	uint32_t duration;			// ticks, saturated
+	uint16_t func;				// index into function names
+	uint8_t slot;				// plugin index; 0 for the real routine
+	uint8_t post;				// 1 for _Post hooks
+	uint8_t mres;				// META_RES the hook returned
+	uint8_t reserved;
+	uint16_t thread;			// per-dump thread number
+	uint32_t reserved2;
+} api_trace_rec_t;
+
+#endif /* API_TRACE_FORMAT_H */
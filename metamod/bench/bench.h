@@ -0,0 +1,59 @@
+/*
+ * Copyright (c) 2004-2006 Jussi Kivilinna
+ *
+ *    This file is part of "Metamod All-Mod-Support"-patch for Metamod.
+ *
+ *    Metamod is free software; you can redistribute it and/or modify it
+ *    under the terms of the GNU General Public License as published by the
+ *    Free Software Foundation; either version 2 of the License, or (at
+ *    your option) any later version.
+ *
+ *    Metamod is distributed in the hope that it will be useful, but
+ *    WITHOUT ANY WARRANTY; without even the implied warranty of
+ *    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ *    General Public License for more details.
+ *
+ *    You should have received a copy of the GNU General Public License
+ *    along with Metamod; if not, write to the Free Software Foundation,
+ *    Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+ *
+ *    In addition, as a special exception, the author gives permission to
+ *    link the code of this program with the Half-Life Game Engine ("HL
+ *    Engine") and Modified Game Libraries ("MODs") developed by Valve,
+ *    L.L.C ("Valve").  You must obey the GNU General Public License in all
+ *    respects for all of the code used other than the HL Engine and MODs
+ *    from Valve.  If you modify this file, you may extend this exception
+ *    to your version of the file, but you are not obligated to do so.  If
+ *    you do not wish to do so, delete this exception statement from your
+ *    version.
+ *
+ */
+
+#ifndef BENCH_H
+#define BENCH_H
+
+// Shared between the parts of the metamod dispatch benchmark: the stub
+// engine and driver (bench_engine.cpp), the fake game DLL
+// (bench_game.cpp) and the synthetic plugin (bench_plugin.cpp), which is
+// copied once for each plugin slot.
+
+#define BENCH_EXPORT	extern "C" __attribute__((visibility("default")))
+
+// Hooks each synthetic plugin installs: comma-separated function names,
+// with "_Post" for post hooks, or "all" / "all_Post" for every hook the
+// plugin has (see bench_plugin.cpp).
+#define BENCH_HOOKS_ENV		"MM_BENCH_HOOKS"
+
+// Exported by the fake game DLL; sends 'count' user messages through the
+// engine functions it got, ie through metamod.
+#define BENCH_SEND_MSGS_FN	"bench_game_send_msgs"
+typedef void (*BENCH_SEND_MSGS_FN_T)(int count);
+
+// Calls each message makes: MessageBegin, 8 writes, MessageEnd.
+#define BENCH_CALLS_PER_MSG	10
+
+// Driver entry point, exported by the stub engine library so globals the
+// engine passes to metamod live in a shared object, as with hlds.
+BENCH_EXPORT int bench_main(int argc, char **argv);
+
+#endif /* BENCH_H */
@@ -0,0 +1,776 @@
+/*
+ * Copyright (c) 2004-2006 Jussi Kivilinna
+ *
+ *    This file is part of "Metamod All-Mod-Support"-patch for Metamod.
+ *
+ *    Metamod is free software; you can redistribute it and/or modify it
+ *    under the terms of the GNU General Public License as published by the
+ *    Free Software Foundation; either version 2 of the License, or (at
+ *    your option) any later version.
+ *
+ *    Metamod is distributed in the hope that it will be useful, but
+ *    WITHOUT ANY WARRANTY; without even the implied warranty of
+ *    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ *    General Public License for more details.
+ *
+ *    You should have received a copy of the GNU General Public License
+ *    along with Metamod; if not, write to the Free Software Foundation,
+ *    Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+ *
+ *    In addition, as a special exception, the author gives permission to
+ *    link the code of this program with the Half-Life Game Engine ("HL
+ *    Engine") and Modified Game Libraries ("MODs") developed by Valve,
+ *    L.L.C ("Valve").  You must obey the GNU General Public License in all
+ *    respects for all of the code used other than the HL Engine and MODs
+ *    from Valve.  If you modify this file, you may extend this exception
+ *    to your version of the file, but you are not obligated to do so.  If
+ *    you do not wish to do so, delete this exception statement from your
+ *    version.
+ *
+ */
+
+// Stub engine and driver for the metamod dispatch benchmark.
+//
+// Sets up a throwaway game directory with a config.ini pointing at the
+// fake game DLL and a plugins.ini listing one copy of the synthetic plugin
+// per slot, then loads metamod the way hlds does: GiveFnptrsToDll,
+// GetEntityAPI2, GetNewDLLFunctions, GameInit, worldspawn, ServerActivate.
+//
+// Each run then replays frames of StartFrame, PlayerPreThink and
+// PlayerPostThink for every client, AddToFullPack calls, and user messages
+// sent by the game DLL, with a given number of plugins running (the rest
+// are paused with "meta pause"), and reports ns per call and calls/sec.
+//
+// usage: mm_bench [options]
+//	-M <file>	metamod library
+//	-G <file>	fake game library
+//	-P <file>	synthetic plugin library
+//	-n <num>	plugins to load (default 50)
+//	-s <list>	plugin counts to run, comma-separated (default 0,1,2,5,10,20,30,40,50)
+//	-f <num>	frames per run (default 2000)
+//	-c <num>	clients (default 32)
+//	-a <num>	AddToFullPack calls per frame (default 1024)
+//	-m <num>	user messages per frame (default 32)
+//	-k <hooks>	plugin hooks, as MM_BENCH_HOOKS (default "all")
+//	-w <dir>	work directory (default: new directory in /tmp, removed after)
+//	-v		show engine console output
+
+#include <stddef.h>			// offsetof
+#include <stdio.h>			// printf, etc
+#include <limits.h>			// PATH_MAX
+#include <stdlib.h>			// atoi, mkdtemp
+#include <string.h>			// strcmp, etc
+#include <errno.h>			// errno
+#include <stdarg.h>			// va_list
+#include <unistd.h>			// getopt, unlink
+#include <time.h>			// clock_gettime
+#include <dlfcn.h>			// dlopen
+#include <sys/stat.h>		// mkdir
+
+#include <extdll.h>			// always
+#include <entity_state.h>	// entity_state_t
+
+#include "bench.h"
+
+#ifndef MM_BENCH_METAMOD
+#define MM_BENCH_METAMOD	"metamod.so"
+#endif
+#ifndef MM_BENCH_GAME
+#define MM_BENCH_GAME		"mm_bench_game.so"
+#endif
+#ifndef MM_BENCH_PLUGIN
+#define MM_BENCH_PLUGIN		"mm_bench_plugin.so"
+#endif
+
+#define MAX_BENCH_PLUGINS	50
+#define MAX_BENCH_EDICTS	1024
+#define MAX_BENCH_CVARS		256
+#define MAX_BENCH_CMDS		256
+#define BENCH_STRING_POOL	65536
+#define BENCH_WARMUP_FRAMES	100
+
+typedef void (*GIVE_FNPTRS_FN)(enginefuncs_t *, globalvars_t *);
+typedef int (*GET_ENTITY_API2_FN)(DLL_FUNCTIONS *, int *);
+typedef int (*GET_NEW_DLL_FUNCTIONS_FN)(NEW_DLL_FUNCTIONS *, int *);
+
+typedef struct bench_cvar_s {
+	cvar_t *cvar;
+	char string[128];
+} bench_cvar_t;
+
+typedef struct bench_cmd_s {
+	char name[64];
+	void (*function)(void);
+} bench_cmd_t;
+
+// Engine state.
+static enginefuncs_t engfuncs;
+static globalvars_t globals;
+static edict_t edicts[MAX_BENCH_EDICTS];
+static char string_pool[BENCH_STRING_POOL];
+static int string_pool_used = 1;		// offset 0 is ""
+static bench_cvar_t cvars[MAX_BENCH_CVARS];
+static int num_cvars;
+static bench_cmd_t cmds[MAX_BENCH_CMDS];
+static int num_cmds;
+static int next_msg_id = 64;
+static char gamedir[PATH_MAX];
+static char info_buffer[256];
+static bool verbose;
+
+// Arguments of the command being run.
+static char cmd_line[256];
+static char cmd_words[256];
+static char *cmd_argv[16];
+static int cmd_argc;
+
+// Tables from metamod.
+static DLL_FUNCTIONS dllapi;
+static NEW_DLL_FUNCTIONS newapi;
+
+//
+// Engine functions.
+//
+
+// Anything the benchmark doesn't need does nothing.  Calling through a
+// pointer of another type is fine here, as stubs ignore their arguments
+// and callers clean up the stack.
+static int eng_stub(void) {
+	return(0);
+}
+
+static bench_cvar_t *find_cvar(const char *name) {
+	int i;
+
+	for(i=0; i < num_cvars; i++) {
+		if(!strcmp(cvars[i].cvar->name, name))
+			return(&cvars[i]);
+	}
+	return(NULL);
+}
+
+static void eng_CVarRegister(cvar_t *pCvar) {
+	bench_cvar_t *bc;
+
+	if(find_cvar(pCvar->name) || num_cvars >= MAX_BENCH_CVARS)
+		return;
+	bc = &cvars[num_cvars++];
+	bc->cvar = pCvar;
+	snprintf(bc->string, sizeof(bc->string), "%s", pCvar->string);
+	pCvar->string = bc->string;
+	pCvar->value = (float)atof(bc->string);
+}
+
+static float eng_CVarGetFloat(const char *szVarName) {
+	bench_cvar_t *bc = find_cvar(szVarName);
+	return(bc ? bc->cvar->value : 0.0f);
+}
+
+static const char *eng_CVarGetString(const char *szVarName) {
+	bench_cvar_t *bc = find_cvar(szVarName);
+	return(bc ? bc->string : "");
+}
+
+static void eng_CVarSetString(const char *szVarName, const char *szValue) {
+	bench_cvar_t *bc = find_cvar(szVarName);
+
+	if(!bc)
+		return;
+	snprintf(bc->string, sizeof(bc->string), "%s", szValue);
+	bc->cvar->value = (float)atof(bc->string);
+}
+
+static void eng_CVarSetFloat(const char *szVarName, float flValue) {
+	char buf[32];
+
+	snprintf(buf, sizeof(buf), "%g", flValue);
+	eng_CVarSetString(szVarName, buf);
+}
+
+static cvar_t *eng_CVarGetPointer(const char *szVarName) {
+	bench_cvar_t *bc = find_cvar(szVarName);
+	return(bc ? bc->cvar : NULL);
+}
+
+static void eng_AlertMessage(ALERT_TYPE atype, const char *szFmt, ...) {
+	va_list ap;
+
+	if(!verbose)
+		return;
+	va_start(ap, szFmt);
+	vfprintf(stderr, szFmt, ap);
+	va_end(ap);
+}
+
+static void eng_ServerPrint(const char *szMsg) {
+	if(verbose)
+		fputs(szMsg, stderr);
+}
+
+static void eng_AddServerCommand(const char *cmd_name, void (*function)(void)) {
+	if(num_cmds >= MAX_BENCH_CMDS)
+		return;
+	snprintf(cmds[num_cmds].name, sizeof(cmds[num_cmds].name), "%s", cmd_name);
+	cmds[num_cmds].function = function;
+	num_cmds++;
+}
+
+static const char *eng_Cmd_Args(void) {
+	const char *cp = strchr(cmd_line, ' ');
+	return(cp ? cp + 1 : "");
+}
+
+static const char *eng_Cmd_Argv(int argc) {
+	return(argc < cmd_argc ? cmd_argv[argc] : "");
+}
+
+static int eng_Cmd_Argc(void) {
+	return(cmd_argc);
+}
+
+static void eng_GetGameDir(char *szGetGameDir) {
+	strcpy(szGetGameDir, gamedir);
+}
+
+static int eng_RegUserMsg(const char *pszName, int iSize) {
+	return(next_msg_id++);
+}
+
+static const char *eng_SzFromIndex(int iString) {
+	return(string_pool + iString);
+}
+
+static int eng_AllocString(const char *szValue) {
+	int len = strlen(szValue) + 1;
+	int offset;
+
+	if(string_pool_used + len > BENCH_STRING_POOL)
+		return(0);
+	offset = string_pool_used;
+	memcpy(string_pool + offset, szValue, len);
+	string_pool_used += len;
+	return(offset);
+}
+
+static entvars_t *eng_GetVarsOfEnt(edict_t *pEdict) {
+	return(&pEdict->v);
+}
+
+static edict_t *eng_PEntityOfEntOffset(int iEntOffset) {
+	return((edict_t *)((char *)edicts + iEntOffset));
+}
+
+static int eng_EntOffsetOfPEntity(const edict_t *pEdict) {
+	return((int)((const char *)pEdict - (const char *)edicts));
+}
+
+static int eng_IndexOfEdict(const edict_t *pEdict) {
+	return(pEdict ? (int)(pEdict - edicts) : 0);
+}
+
+static edict_t *eng_PEntityOfEntIndex(int iEntIndex) {
+	if(iEntIndex < 0 || iEntIndex >= MAX_BENCH_EDICTS)
+		return(NULL);
+	return(&edicts[iEntIndex]);
+}
+
+static edict_t *eng_FindEntityByVars(entvars_t *pvars) {
+	return((edict_t *)((char *)pvars - offsetof(edict_t, v)));
+}
+
+static char *eng_GetInfoKeyBuffer(edict_t *e) {
+	return(info_buffer);
+}
+
+static char *eng_InfoKeyValue(char *infobuffer, const char *key) {
+	static char empty[1];
+	return(empty);
+}
+
+static float eng_Time(void) {
+	return(globals.time);
+}
+
+static int eng_IsDedicatedServer(void) {
+	return(1);
+}
+
+static const char *eng_GetPlayerAuthId(edict_t *e) {
+	return("STEAM_ID_LAN");
+}
+
+static void init_engfuncs(void) {
+	unsigned int i;
+
+	for(i=0; i < sizeof(engfuncs) / sizeof(void *); i++)
+		((void **)&engfuncs)[i] = (void *)eng_stub;
+
+	engfuncs.pfnCVarRegister = eng_CVarRegister;
+	engfuncs.pfnCvar_RegisterVariable = eng_CVarRegister;
+	engfuncs.pfnCVarGetFloat = eng_CVarGetFloat;
+	engfuncs.pfnCVarGetString = eng_CVarGetString;
+	engfuncs.pfnCVarSetFloat = eng_CVarSetFloat;
+	engfuncs.pfnCVarSetString = eng_CVarSetString;
+	engfuncs.pfnCVarGetPointer = eng_CVarGetPointer;
+	engfuncs.pfnAlertMessage = eng_AlertMessage;
+	engfuncs.pfnServerPrint = eng_ServerPrint;
+	engfuncs.pfnAddServerCommand = eng_AddServerCommand;
+	engfuncs.pfnCmd_Args = eng_Cmd_Args;
+	engfuncs.pfnCmd_Argv = eng_Cmd_Argv;
+	engfuncs.pfnCmd_Argc = eng_Cmd_Argc;
+	engfuncs.pfnGetGameDir = eng_GetGameDir;
+	engfuncs.pfnRegUserMsg = eng_RegUserMsg;
+	engfuncs.pfnSzFromIndex = eng_SzFromIndex;
+	engfuncs.pfnAllocString = eng_AllocString;
+	engfuncs.pfnGetVarsOfEnt = eng_GetVarsOfEnt;
+	engfuncs.pfnPEntityOfEntOffset = eng_PEntityOfEntOffset;
+	engfuncs.pfnEntOffsetOfPEntity = eng_EntOffsetOfPEntity;
+	engfuncs.pfnIndexOfEdict = eng_IndexOfEdict;
+	engfuncs.pfnPEntityOfEntIndex = eng_PEntityOfEntIndex;
+	engfuncs.pfnFindEntityByVars = eng_FindEntityByVars;
+	engfuncs.pfnGetInfoKeyBuffer = eng_GetInfoKeyBuffer;
+	engfuncs.pfnInfoKeyValue = eng_InfoKeyValue;
+	engfuncs.pfnTime = eng_Time;
+	engfuncs.pfnIsDedicatedServer = eng_IsDedicatedServer;
+	engfuncs.pfnGetPlayerAuthId = eng_GetPlayerAuthId;
+	// metamod checks these are real engine functions
+	engfuncs.pfnQueryClientCvarValue = NULL;
+	engfuncs.pfnQueryClientCvarValue2 = NULL;
+}
+
+static void init_globals(int clients) {
+	int i;
+
+	globals = globalvars_t();
+	globals.maxClients = clients;
+	globals.maxEntities = MAX_BENCH_EDICTS;
+	globals.pStringBase = string_pool;
+	globals.time = 1.0f;
+	globals.frametime = 0.01f;
+
+	for(i=0; i < MAX_BENCH_EDICTS; i++) {
+		edicts[i].v.pContainingEntity = &edicts[i];
+		edicts[i].v.origin[0] = (float)i;
+	}
+	edicts[0].v.classname = eng_AllocString("worldspawn");
+	for(i=1; i <= clients; i++) {
+		edicts[i].v.classname = eng_AllocString("player");
+		edicts[i].v.netname = eng_AllocString("bench");
+		edicts[i].v.flags = FL_CLIENT;
+	}
+	for(i=clients + 1; i < MAX_BENCH_EDICTS; i++)
+		edicts[i].v.classname = eng_AllocString("func_wall");
+}
+
+// Run a server command, as from the console.
+static void run_command(const char *line) {
+	char *cp;
+	int i;
+
+	snprintf(cmd_line, sizeof(cmd_line), "%s", line);
+	snprintf(cmd_words, sizeof(cmd_words), "%s", line);
+	cmd_argc = 0;
+	for(cp = strtok(cmd_words, " "); cp && cmd_argc < 16; cp = strtok(NULL, " "))
+		cmd_argv[cmd_argc++] = cp;
+	if(!cmd_argc)
+		return;
+	for(i=0; i < num_cmds; i++) {
+		if(!strcmp(cmds[i].name, cmd_argv[0])) {
+			(*cmds[i].function)();
+			return;
+		}
+	}
+	fprintf(stderr, "Unknown command: %s\n", cmd_argv[0]);
+}
+
+//
+// Work directory.
+//
+
+static char work_dir[PATH_MAX - 64];
+static bool remove_work_dir;
+static int num_copies;
+
+static bool write_file(const char *path, const char *text) {
+	FILE *fp = fopen(path, "w");
+
+	if(!fp) {
+		fprintf(stderr, "Couldn't write %s: %s\n", path, strerror(errno));
+		return(false);
+	}
+	fputs(text, fp);
+	fclose(fp);
+	return(true);
+}
+
+static bool copy_file(const char *from, const char *to) {
+	char buf[65536];
+	FILE *in, *out;
+	size_t len;
+	bool ok = true;
+
+	if(!(in = fopen(from, "rb"))) {
+		fprintf(stderr, "Couldn't open %s: %s\n", from, strerror(errno));
+		return(false);
+	}
+	if(!(out = fopen(to, "wb"))) {
+		fprintf(stderr, "Couldn't write %s: %s\n", to, strerror(errno));
+		fclose(in);
+		return(false);
+	}
+	while((len = fread(buf, 1, sizeof(buf), in)) > 0) {
+		if(fwrite(buf, 1, len, out) != len) {
+			ok = false;
+			break;
+		}
+	}
+	fclose(in);
+	if(fclose(out) != 0)
+		ok = false;
+	return(ok);
+}
+
+// Set up <work>/benchmod, with metamod's config.ini naming the game DLL and
+// a plugins.ini loading a separate copy of the plugin for each slot (the
+// same file loaded twice would share one handle).
+static bool setup_work_dir(const char *game_path, const char *plugin_path, int plugins) {
+	char path[PATH_MAX + 64], text[PATH_MAX + 64];
+	FILE *fp;
+	int i;
+
+	if(!work_dir[0]) {
+		snprintf(work_dir, sizeof(work_dir), "/tmp/mm_bench.XXXXXX");
+		if(!mkdtemp(work_dir)) {
+			fprintf(stderr, "Couldn't create work directory: %s\n", strerror(errno));
+			return(false);
+		}
+		remove_work_dir = true;
+	}
+
+	snprintf(gamedir, sizeof(gamedir), "%s/benchmod", work_dir);
+	snprintf(path, sizeof(path), "%s/addons", gamedir);
+	mkdir(gamedir, 0755);
+	mkdir(path, 0755);
+	snprintf(path, sizeof(path), "%s/addons/metamod", gamedir);
+	mkdir(path, 0755);
+	snprintf(path, sizeof(path), "%s/addons/bench", gamedir);
+	mkdir(path, 0755);
+
+	snprintf(path, sizeof(path), "%s/addons/metamod/config.ini", gamedir);
+	snprintf(text, sizeof(text), "gamedll %s\nautodetect no\n", game_path);
+	if(!write_file(path, text))
+		return(false);
+
+	snprintf(path, sizeof(path), "%s/addons/metamod/plugins.ini", gamedir);
+	if(!(fp = fopen(path, "w"))) {
+		fprintf(stderr, "Couldn't write %s: %s\n", path, strerror(errno));
+		return(false);
+	}
+	for(i=0; i < plugins; i++) {
+		snprintf(path, sizeof(path), "%s/addons/bench/bench_%02d.so", gamedir, i + 1);
+		if(!copy_file(plugin_path, path)) {
+			fclose(fp);
+			return(false);
+		}
+		num_copies = i + 1;
+		fprintf(fp, "linux addons/bench/bench_%02d.so\n", i + 1);
+	}
+	fclose(fp);
+	return(true);
+}
+
+static void cleanup_work_dir(void) {
+	char path[PATH_MAX + 64];
+	int i;
+
+	if(!remove_work_dir)
+		return;
+	for(i=0; i < num_copies; i++) {
+		snprintf(path, sizeof(path), "%s/addons/bench/bench_%02d.so", gamedir, i + 1);
+		unlink(path);
+	}
+	snprintf(path, sizeof(path), "%s/addons/metamod/config.ini", gamedir);
+	unlink(path);
+	snprintf(path, sizeof(path), "%s/addons/metamod/plugins.ini", gamedir);
+	unlink(path);
+	snprintf(path, sizeof(path), "%s/addons/metamod", gamedir);
+	rmdir(path);
+	snprintf(path, sizeof(path), "%s/addons/bench", gamedir);
+	rmdir(path);
+	snprintf(path, sizeof(path), "%s/addons", gamedir);
+	rmdir(path);
+	rmdir(gamedir);
+	rmdir(work_dir);
+}
+
+//
+// Measurement.
+//
+
+enum {
+	CAT_STARTFRAME = 0,
+	CAT_PRETHINK,
+	CAT_POSTTHINK,
+	CAT_FULLPACK,
+	CAT_MESSAGES,
+	NUM_CATS,
+};
+
+static const char * const cat_names[NUM_CATS] = {
+	"StartFrame",
+	"PreThink",
+	"PostThink",
+	"FullPack",
+	"Messages",
+};
+
+typedef struct bench_opts_s {
+	int frames;
+	int clients;
+	int fullpack;
+	int msgs;
+} bench_opts_t;
+
+static inline long long now_ns(void) {
+	struct timespec ts;
+
+	clock_gettime(CLOCK_MONOTONIC, &ts);
+	return((long long)ts.tv_sec * 1000000000LL + ts.tv_nsec);
+}
+
+// Run frames and fill in total ns and calls for each category.
+static void run_frames(const bench_opts_t *opts, BENCH_SEND_MSGS_FN_T send_msgs,
+		long long ns[NUM_CATS], long long calls[NUM_CATS])
+{
+	entity_state_t state;
+	unsigned char set[128];
+	edict_t *host = &edicts[1];
+	long long t[NUM_CATS + 1];
+	int frame, i, c, e = opts->clients + 1;
+
+	memset(ns, 0, sizeof(long long) * NUM_CATS);
+	memset(calls, 0, sizeof(long long) * NUM_CATS);
+	memset(set, 0xff, sizeof(set));
+
+	for(frame = -BENCH_WARMUP_FRAMES; frame < opts->frames; frame++) {
+		globals.time += globals.frametime;
+
+		t[0] = now_ns();
+		dllapi.pfnStartFrame();
+		t[1] = now_ns();
+		for(c=1; c <= opts->clients; c++)
+			dllapi.pfnPlayerPreThink(&edicts[c]);
+		t[2] = now_ns();
+		for(c=1; c <= opts->clients; c++)
+			dllapi.pfnPlayerPostThink(&edicts[c]);
+		t[3] = now_ns();
+		for(i=0; i < opts->fullpack; i++) {
+			dllapi.pfnAddToFullPack(&state, e, &edicts[e], host, 0, 0, set);
+			if(++e >= MAX_BENCH_EDICTS)
+				e = 1;
+		}
+		t[4] = now_ns();
+		if(send_msgs)
+			send_msgs(opts->msgs);
+		t[5] = now_ns();
+
+		if(frame < 0)
+			continue;
+		for(i=0; i < NUM_CATS; i++)
+			ns[i] += t[i + 1] - t[i];
+		calls[CAT_STARTFRAME] += 1;
+		calls[CAT_PRETHINK] += opts->clients;
+		calls[CAT_POSTTHINK] += opts->clients;
+		calls[CAT_FULLPACK] += opts->fullpack;
+		calls[CAT_MESSAGES] += send_msgs ? opts->msgs * BENCH_CALLS_PER_MSG : 0;
+	}
+}
+
+static void print_header(void) {
+	int i;
+
+	printf("%7s", "plugins");
+	for(i=0; i < NUM_CATS; i++)
+		printf(" %11s", cat_names[i]);
+	printf(" %10s %10s\n", "frame(us)", "Mcalls/s");
+	printf("%7s", "");
+	for(i=0; i < NUM_CATS; i++)
+		printf(" %11s", "(ns/call)");
+	printf("\n");
+}
+
+static void print_row(int plugins, const bench_opts_t *opts,
+		const long long ns[NUM_CATS], const long long calls[NUM_CATS])
+{
+	long long total_ns = 0, total_calls = 0;
+	int i;
+
+	printf("%7d", plugins);
+	for(i=0; i < NUM_CATS; i++) {
+		if(calls[i])
+			printf(" %11.1f", (double)ns[i] / calls[i]);
+		else
+			printf(" %11s", "-");
+		total_ns += ns[i];
+		total_calls += calls[i];
+	}
+	printf(" %10.2f %10.2f\n",
+			opts->frames ? (double)total_ns / opts->frames / 1000.0 : 0.0,
+			total_ns ? (double)total_calls * 1000.0 / total_ns : 0.0);
+	fflush(stdout);
+}
+
+// Run only the first <running> plugins; pause the rest.
+static void set_running_plugins(int running, int loaded) {
+	char cmd[64];
+	int i;
+
+	for(i=1; i <= loaded; i++) {
+		snprintf(cmd, sizeof(cmd), "meta %s %d", i <= running ? "unpause" : "pause", i);
+		run_command(cmd);
+	}
+}
+
+static int parse_counts(const char *list, int *counts, int max) {
+	const char *cp = list;
+	int n = 0;
+
+	while(*cp && n < max) {
+		counts[n++] = atoi(cp);
+		cp = strchr(cp, ',');
+		if(!cp)
+			break;
+		cp++;
+	}
+	return(n);
+}
+
+static void usage(const char *prog) {
+	fprintf(stderr,
+		"usage: %s [options]\n"
+		"  -M <file>   metamod library (default %s)\n"
+		"  -G <file>   fake game library (default %s)\n"
+		"  -P <file>   synthetic plugin library (default %s)\n"
+		"  -n <num>    plugins to load (default %d)\n"
+		"  -s <list>   plugin counts to run (default 0,1,2,5,10,20,30,40,50)\n"
+		"  -f <num>    frames per run (default 2000)\n"
+		"  -c <num>    clients (default 32)\n"
+		"  -a <num>    AddToFullPack calls per frame (default 1024)\n"
+		"  -m <num>    user messages per frame (default 32)\n"
+		"  -k <hooks>  plugin hooks: all, all_Post, or names (default all)\n"
+		"  -w <dir>    work directory (default: temporary)\n"
+		"  -v          show engine console output\n",
+		prog, MM_BENCH_METAMOD, MM_BENCH_GAME, MM_BENCH_PLUGIN, MAX_BENCH_PLUGINS);
+}
+
+BENCH_EXPORT int bench_main(int argc, char **argv) {
+	const char *metamod_path = MM_BENCH_METAMOD;
+	const char *game_path = MM_BENCH_GAME;
+	const char *plugin_path = MM_BENCH_PLUGIN;
+	const char *counts_list = "0,1,2,5,10,20,30,40,50";
+	const char *hooks = "all";
+	char game_full[PATH_MAX], plugin_full[PATH_MAX];
+	int counts[64], num_counts, loaded = MAX_BENCH_PLUGINS;
+	bench_opts_t opts = { 2000, 32, 1024, 32 };
+	long long ns[NUM_CATS], calls[NUM_CATS];
+	GIVE_FNPTRS_FN give_fnptrs;
+	GET_ENTITY_API2_FN get_entity_api2;
+	GET_NEW_DLL_FUNCTIONS_FN get_new_dll_functions;
+	BENCH_SEND_MSGS_FN_T send_msgs;
+	void *metamod, *game;
+	int opt, i, version;
+
+	while((opt = getopt(argc, argv, "M:G:P:n:s:f:c:a:m:k:w:vh")) != -1) {
+		switch(opt) {
+			case 'M': metamod_path = optarg; break;
+			case 'G': game_path = optarg; break;
+			case 'P': plugin_path = optarg; break;
+			case 'n': loaded = atoi(optarg); break;
+			case 's': counts_list = optarg; break;
+			case 'f': opts.frames = atoi(optarg); break;
+			case 'c': opts.clients = atoi(optarg); break;
+			case 'a': opts.fullpack = atoi(optarg); break;
+			case 'm': opts.msgs = atoi(optarg); break;
+			case 'k': hooks = optarg; break;
+			case 'w': snprintf(work_dir, sizeof(work_dir), "%s", optarg); break;
+			case 'v': verbose = true; break;
+			default:
+				usage(argv[0]);
+				return(1);
+		}
+	}
+	if(loaded < 0 || loaded > MAX_BENCH_PLUGINS) {
+		fprintf(stderr, "Plugins to load must be 0-%d\n", MAX_BENCH_PLUGINS);
+		return(1);
+	}
+	if(opts.clients < 1 || opts.clients >= MAX_BENCH_EDICTS / 2) {
+		fprintf(stderr, "Clients must be 1-%d\n", MAX_BENCH_EDICTS / 2 - 1);
+		return(1);
+	}
+	num_counts = parse_counts(counts_list, counts, 64);
+
+	// config.ini and plugins.ini paths are relative to the game dir
+	if(!realpath(game_path, game_full) || !realpath(plugin_path, plugin_full)) {
+		fprintf(stderr, "Couldn't find game or plugin library: %s\n", strerror(errno));
+		return(1);
+	}
+	if(!setup_work_dir(game_full, plugin_full, loaded)) {
+		cleanup_work_dir();
+		return(1);
+	}
+	setenv(BENCH_HOOKS_ENV, hooks, 1);
+
+	init_engfuncs();
+	init_globals(opts.clients);
+
+	metamod = dlopen(metamod_path, RTLD_NOW);
+	if(!metamod) {
+		fprintf(stderr, "Couldn't load metamod: %s\n", dlerror());
+		cleanup_work_dir();
+		return(1);
+	}
+	give_fnptrs = (GIVE_FNPTRS_FN)dlsym(metamod, "GiveFnptrsToDll");
+	get_entity_api2 = (GET_ENTITY_API2_FN)dlsym(metamod, "GetEntityAPI2");
+	get_new_dll_functions = (GET_NEW_DLL_FUNCTIONS_FN)dlsym(metamod, "GetNewDLLFunctions");
+	if(!give_fnptrs || !get_entity_api2) {
+		fprintf(stderr, "Metamod library lacks GiveFnptrsToDll/GetEntityAPI2\n");
+		cleanup_work_dir();
+		return(1);
+	}
+
+	give_fnptrs(&engfuncs, &globals);
+	version = INTERFACE_VERSION;
+	if(!get_entity_api2(&dllapi, &version)) {
+		fprintf(stderr, "Metamod GetEntityAPI2 failed\n");
+		cleanup_work_dir();
+		return(1);
+	}
+	version = NEW_DLL_FUNCTIONS_VERSION;
+	if(get_new_dll_functions)
+		get_new_dll_functions(&newapi, &version);
+
+	dllapi.pfnGameInit();
+	dllapi.pfnSpawn(&edicts[0]);
+	dllapi.pfnServerActivate(edicts, MAX_BENCH_EDICTS, opts.clients);
+
+	// metamod loaded the game DLL; same path gives the same handle
+	game = dlopen(game_full, RTLD_NOW | RTLD_NOLOAD);
+	send_msgs = game ? (BENCH_SEND_MSGS_FN_T)dlsym(game, BENCH_SEND_MSGS_FN) : NULL;
+	if(!send_msgs)
+		fprintf(stderr, "Game library lacks %s; skipping messages\n", BENCH_SEND_MSGS_FN);
+
+	printf("metamod dispatch: %d frames, %d clients, %d fullpack/frame, %d msgs/frame, hooks \"%s\"\n",
+			opts.frames, opts.clients, opts.fullpack, opts.msgs, hooks);
+	print_header();
+	for(i=0; i < num_counts; i++) {
+		if(counts[i] < 0 || counts[i] > loaded)
+			continue;
+		set_running_plugins(counts[i], loaded);
+		run_frames(&opts, send_msgs, ns, calls);
+		print_row(counts[i], &opts, ns, calls);
+	}
+
+	// Plugin copies stay mapped; the files can go anyway.
+	cleanup_work_dir();
+	return(0);
+}
@@ -0,0 +1,139 @@
+/*
+ * Copyright (c) 2004-2006 Jussi Kivilinna
+ *
+ *    This file is part of "Metamod All-Mod-Support"-patch for Metamod.
+ *
+ *    Metamod is free software; you can redistribute it and/or modify it
+ *    under the terms of the GNU General Public License as published by the
+ *    Free Software Foundation; either version 2 of the License, or (at
+ *    your option) any later version.
+ *
+ *    Metamod is distributed in the hope that it will be useful, but
+ *    WITHOUT ANY WARRANTY; without even the implied warranty of
+ *    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ *    General Public License for more details.
+ *
+ *    You should have received a copy of the GNU General Public License
+ *    along with Metamod; if not, write to the Free Software Foundation,
+ *    Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+ *
+ *    In addition, as a special exception, the author gives permission to
+ *    link the code of this program with the Half-Life Game Engine ("HL
+ *    Engine") and Modified Game Libraries ("MODs") developed by Valve,
+ *    L.L.C ("Valve").  You must obey the GNU General Public License in all
+ *    respects for all of the code used other than the HL Engine and MODs
+ *    from Valve.  If you modify this file, you may extend this exception
+ *    to your version of the file, but you are not obligated to do so.  If
+ *    you do not wish to do so, delete this exception statement from your
+ *    version.
+ *
+ */
+
+// Fake game DLL for the metamod dispatch benchmark.
+//
+// Does a token amount of work in each routine the benchmark drives, so
+// the measured time is mostly metamod's.
+
+#include <string.h>			// memset
+
+#include <extdll.h>			// always
+#include <entity_state.h>	// entity_state_s
+
+#include "bench.h"
+
+static enginefuncs_t engfuncs;
+static globalvars_t *gpGlobals;
+static int bench_msg_id;
+static volatile int game_work;
+
+BENCH_EXPORT void GiveFnptrsToDll(enginefuncs_t *pengfuncsFromEngine, globalvars_t *pGlobals) {
+	memcpy(&engfuncs, pengfuncsFromEngine, sizeof(engfuncs));
+	gpGlobals = pGlobals;
+}
+
+static void game_GameInit(void) {
+	bench_msg_id = (*engfuncs.pfnRegUserMsg)("BenchMsg", -1);
+}
+
+static int game_Spawn(edict_t *pent) {
+	game_work++;
+	return(0);
+}
+
+static void game_Think(edict_t *pent) {
+	game_work++;
+}
+
+static void game_Touch(edict_t *pentTouched, edict_t *pentOther) {
+	game_work++;
+}
+
+static void game_ServerActivate(edict_t *pEdictList, int edictCount, int clientMax) {
+	game_work++;
+}
+
+static void game_StartFrame(void) {
+	game_work += (gpGlobals->time > 0);
+}
+
+static void game_PlayerPreThink(edict_t *pEntity) {
+	pEntity->v.button = 0;
+}
+
+static void game_PlayerPostThink(edict_t *pEntity) {
+	pEntity->v.impulse = 0;
+}
+
+static int game_AddToFullPack(struct entity_state_s *state, int e, edict_t *ent, edict_t *host, int hostflags, int player, unsigned char *pSet) {
+	state->number = e;
+	state->origin[0] = ent->v.origin[0];
+	state->origin[1] = ent->v.origin[1];
+	state->origin[2] = ent->v.origin[2];
+	return(e & 1);
+}
+
+BENCH_EXPORT int GetEntityAPI2(DLL_FUNCTIONS *pFunctionTable, int *interfaceVersion) {
+	if(*interfaceVersion != INTERFACE_VERSION) {
+		*interfaceVersion = INTERFACE_VERSION;
+		return(FALSE);
+	}
+	memset(pFunctionTable, 0, sizeof(DLL_FUNCTIONS));
+	pFunctionTable->pfnGameInit = game_GameInit;
+	pFunctionTable->pfnSpawn = game_Spawn;
+	pFunctionTable->pfnThink = game_Think;
+	pFunctionTable->pfnTouch = game_Touch;
+	pFunctionTable->pfnServerActivate = game_ServerActivate;
+	pFunctionTable->pfnStartFrame = game_StartFrame;
+	pFunctionTable->pfnPlayerPreThink = game_PlayerPreThink;
+	pFunctionTable->pfnPlayerPostThink = game_PlayerPostThink;
+	pFunctionTable->pfnAddToFullPack = game_AddToFullPack;
+	return(TRUE);
+}
+
+BENCH_EXPORT int GetNewDLLFunctions(NEW_DLL_FUNCTIONS *pFunctionTable, int *interfaceVersion) {
+	if(*interfaceVersion != NEW_DLL_FUNCTIONS_VERSION) {
+		*interfaceVersion = NEW_DLL_FUNCTIONS_VERSION;
+		return(FALSE);
+	}
+	memset(pFunctionTable, 0, sizeof(NEW_DLL_FUNCTIONS));
+	return(TRUE);
+}
+
+// A typical mix of writes, as for a HUD text or temp entity message.
+BENCH_EXPORT void bench_game_send_msgs(int count) {
+	static const float origin[3] = { 0, 0, 0 };
+	int i;
+
+	for(i=0; i < count; i++) {
+		(*engfuncs.pfnMessageBegin)(MSG_BROADCAST, bench_msg_id, origin, NULL);
+		(*engfuncs.pfnWriteByte)(i & 0xff);
+		(*engfuncs.pfnWriteChar)(1);
+		(*engfuncs.pfnWriteShort)(i);
+		(*engfuncs.pfnWriteLong)(i);
+		(*engfuncs.pfnWriteAngle)(90.0f);
+		(*engfuncs.pfnWriteCoord)(128.0f);
+		(*engfuncs.pfnWriteString)("bench");
+		(*engfuncs.pfnWriteEntity)(1);
+		(*engfuncs.pfnMessageEnd)();
+	}
+}
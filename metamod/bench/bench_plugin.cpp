@@ -0,0 +1,231 @@
+/*
+ * Copyright (c) 2004-2006 Jussi Kivilinna
+ *
+ *    This file is part of "Metamod All-Mod-Support"-patch for Metamod.
+ *
+ *    Metamod is free software; you can redistribute it and/or modify it
+ *    under the terms of the GNU General Public License as published by the
+ *    Free Software Foundation; either version 2 of the License, or (at
+ *    your option) any later version.
+ *
+ *    Metamod is distributed in the hope that it will be useful, but
+ *    WITHOUT ANY WARRANTY; without even the implied warranty of
+ *    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ *    General Public License for more details.
+ *
+ *    You should have received a copy of the GNU General Public License
+ *    along with Metamod; if not, write to the Free Software Foundation,
+ *    Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+ *
+ *    In addition, as a special exception, the author gives permission to
+ *    link the code of this program with the Half-Life Game Engine ("HL
+ *    Engine") and Modified Game Libraries ("MODs") developed by Valve,
+ *    L.L.C ("Valve").  You must obey the GNU General Public License in all
+ *    respects for all of the code used other than the HL Engine and MODs
+ *    from Valve.  If you modify this file, you may extend this exception
+ *    to your version of the file, but you are not obligated to do so.  If
+ *    you do not wish to do so, delete this exception statement from your
+ *    version.
+ *
+ */
+
+// Synthetic plugin for the metamod dispatch benchmark.
+//
+// The benchmark copies this library once for each plugin slot.  Each copy
+// installs the hooks named in MM_BENCH_HOOKS, which just count the call
+// and return MRES_IGNORED, like a typical plugin not interested in this
+// particular call.
+
+#include <stddef.h>			// offsetof
+#include <stdlib.h>			// getenv
+#include <string.h>			// memcpy, strncmp
+
+#include <extdll.h>			// always
+#include <entity_state.h>	// entity_state_s
+
+#include <meta_api.h>		// of course
+
+#include "bench.h"
+
+static META_FUNCTIONS gMetaFunctionTable;
+
+plugin_info_t Plugin_info = {
+	META_INTERFACE_VERSION,	// ifvers
+	"BenchPlugin",		// name
+	"1.0",				// version
+	__DATE__,			// date
+	"metamod",			// author
+	"",					// url
+	"BENCH",			// logtag
+	PT_ANYTIME,			// (when) loadable
+	PT_ANYPAUSE,		// (when) unloadable
+};
+
+enginefuncs_t g_engfuncs;
+globalvars_t *gpGlobals;
+
+meta_globals_t *gpMetaGlobals;		// metamod globals
+gamedll_funcs_t *gpGamedllFuncs;	// gameDLL function tables
+mutil_funcs_t *gpMetaUtilFuncs;		// metamod utility functions
+
+static volatile unsigned int hook_calls;
+
+static void bench_StartFrame(void) {
+	hook_calls++;
+	SET_META_RESULT(MRES_IGNORED);
+}
+static void bench_PlayerThink(edict_t *pEntity) {
+	hook_calls++;
+	SET_META_RESULT(MRES_IGNORED);
+}
+static int bench_AddToFullPack(struct entity_state_s *state, int e, edict_t *ent, edict_t *host, int hostflags, int player, unsigned char *pSet) {
+	hook_calls++;
+	RETURN_META_VALUE(MRES_IGNORED, 0);
+}
+static void bench_Think(edict_t *pent) {
+	hook_calls++;
+	SET_META_RESULT(MRES_IGNORED);
+}
+static void bench_Touch(edict_t *pentTouched, edict_t *pentOther) {
+	hook_calls++;
+	SET_META_RESULT(MRES_IGNORED);
+}
+static void bench_MessageBegin(int msg_dest, int msg_type, const float *pOrigin, edict_t *ed) {
+	hook_calls++;
+	SET_META_RESULT(MRES_IGNORED);
+}
+static void bench_MessageEnd(void) {
+	hook_calls++;
+	SET_META_RESULT(MRES_IGNORED);
+}
+static void bench_WriteInt(int iValue) {
+	hook_calls++;
+	SET_META_RESULT(MRES_IGNORED);
+}
+static void bench_WriteFloat(float flValue) {
+	hook_calls++;
+	SET_META_RESULT(MRES_IGNORED);
+}
+static void bench_WriteString(const char *sz) {
+	hook_calls++;
+	SET_META_RESULT(MRES_IGNORED);
+}
+
+typedef struct bench_hook_s {
+	const char *name;
+	int engine;					// enginefuncs_t rather than DLL_FUNCTIONS
+	unsigned int offset;
+	void *pfn;
+} bench_hook_t;
+
+#define DLL_HOOK(name, hook) { #name, 0, offsetof(DLL_FUNCTIONS, pfn##name), (void *)hook }
+#define ENG_HOOK(name, hook) { #name, 1, offsetof(enginefuncs_t, pfn##name), (void *)hook }
+
+static const bench_hook_t bench_hooks[] = {
+	DLL_HOOK(StartFrame, bench_StartFrame),
+	DLL_HOOK(PlayerPreThink, bench_PlayerThink),
+	DLL_HOOK(PlayerPostThink, bench_PlayerThink),
+	DLL_HOOK(AddToFullPack, bench_AddToFullPack),
+	DLL_HOOK(Think, bench_Think),
+	DLL_HOOK(Touch, bench_Touch),
+	ENG_HOOK(MessageBegin, bench_MessageBegin),
+	ENG_HOOK(MessageEnd, bench_MessageEnd),
+	ENG_HOOK(WriteByte, bench_WriteInt),
+	ENG_HOOK(WriteChar, bench_WriteInt),
+	ENG_HOOK(WriteShort, bench_WriteInt),
+	ENG_HOOK(WriteLong, bench_WriteInt),
+	ENG_HOOK(WriteAngle, bench_WriteFloat),
+	ENG_HOOK(WriteCoord, bench_WriteFloat),
+	ENG_HOOK(WriteString, bench_WriteString),
+	ENG_HOOK(WriteEntity, bench_WriteInt),
+};
+#define NUM_BENCH_HOOKS	(sizeof(bench_hooks) / sizeof(bench_hooks[0]))
+
+// Whether MM_BENCH_HOOKS asks for hook, pre or post.
+static bool hook_wanted(const bench_hook_t *hook, int post) {
+	const char *spec, *cp, *end;
+	size_t len, namelen;
+
+	spec = getenv(BENCH_HOOKS_ENV);
+	if(!spec)
+		spec = "all";
+	namelen = strlen(hook->name);
+	for(cp = spec; *cp; cp = *end ? end + 1 : end) {
+		end = strchr(cp, ',');
+		if(!end)
+			end = cp + strlen(cp);
+		len = end - cp;
+		if(post) {
+			if(len < 5 || strncmp(end - 5, "_Post", 5))
+				continue;
+			len -= 5;
+		}
+		else if(len >= 5 && !strncmp(end - 5, "_Post", 5))
+			continue;
+		if((len == 3 && !strncmp(cp, "all", 3)) || (len == namelen && !strncmp(cp, hook->name, len)))
+			return(true);
+	}
+	return(false);
+}
+
+static void fill_table(void *table, int engine, int post) {
+	unsigned int i;
+
+	for(i=0; i < NUM_BENCH_HOOKS; i++) {
+		if(bench_hooks[i].engine == engine && hook_wanted(&bench_hooks[i], post))
+			*(void **)((char *)table + bench_hooks[i].offset) = bench_hooks[i].pfn;
+	}
+}
+
+static int bench_GetEntityAPI2(DLL_FUNCTIONS *pFunctionTable, int *interfaceVersion) {
+	fill_table(pFunctionTable, 0, 0);
+	return(TRUE);
+}
+static int bench_GetEntityAPI2_Post(DLL_FUNCTIONS *pFunctionTable, int *interfaceVersion) {
+	fill_table(pFunctionTable, 0, 1);
+	return(TRUE);
+}
+static int bench_GetEngineFunctions(enginefuncs_t *pengfuncsFromEngine, int *interfaceVersion) {
+	fill_table(pengfuncsFromEngine, 1, 0);
+	return(TRUE);
+}
+static int bench_GetEngineFunctions_Post(enginefuncs_t *pengfuncsFromEngine, int *interfaceVersion) {
+	fill_table(pengfuncsFromEngine, 1, 1);
+	return(TRUE);
+}
+
+BENCH_EXPORT void GiveFnptrsToDll(enginefuncs_t *pengfuncsFromEngine, globalvars_t *pGlobals) {
+	memcpy(&g_engfuncs, pengfuncsFromEngine, sizeof(enginefuncs_t));
+	gpGlobals = pGlobals;
+}
+
+BENCH_EXPORT int Meta_Query(const char * /*ifvers */, plugin_info_t **pPlugInfo,
+		mutil_funcs_t *pMetaUtilFuncs) 
+{
+	*pPlugInfo=&Plugin_info;
+	gpMetaUtilFuncs=pMetaUtilFuncs;
+	return(TRUE);
+}
+
+BENCH_EXPORT int Meta_Attach(PLUG_LOADTIME /* now */, 
+		META_FUNCTIONS *pFunctionTable, meta_globals_t *pMGlobals, 
+		gamedll_funcs_t *pGamedllFuncs) 
+{
+	if(!pMGlobals || !pFunctionTable)
+		return(FALSE);
+	gpMetaGlobals=pMGlobals;
+	gpGamedllFuncs=pGamedllFuncs;
+	memset(&gMetaFunctionTable, 0, sizeof(gMetaFunctionTable));
+	gMetaFunctionTable.pfnGetEntityAPI2 = bench_GetEntityAPI2;
+	gMetaFunctionTable.pfnGetEntityAPI2_Post = bench_GetEntityAPI2_Post;
+	gMetaFunctionTable.pfnGetEngineFunctions = bench_GetEngineFunctions;
+	gMetaFunctionTable.pfnGetEngineFunctions_Post = bench_GetEngineFunctions_Post;
+	memcpy(pFunctionTable, &gMetaFunctionTable, sizeof(META_FUNCTIONS));
+	return(TRUE);
+}
+
+BENCH_EXPORT int Meta_Detach(PLUG_LOADTIME /* now */, 
+		PL_UNLOAD_REASON /* reason */) 
+{
+	return(TRUE);
+}
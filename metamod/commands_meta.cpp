@@ -43,32 +43,14 @@
 #include "log_meta.h"		// META_CONS, etc
 #include "info_name.h"		// VNAME, etc
 #include "vdate.h"			// COMPILE_TIME, COMPILE_TZONE
+#include "api_prof.h"		// api_prof_show, etc
+#include "api_trace.h"		// api_trace_start, etc
+#include "api_budget.h"	// api_budget_show, etc
+#include "api_stats.h"		// api_stats_show
+#include "plugin_preload.h"	// preload_start
+#include "file_watch.h"		// fwatch_apply
 
 
-#ifdef META_PERFMON
-
-long double total_tsc=0;
-unsigned long long count_tsc=0;
-unsigned long long active_tsc=0;
-unsigned long long min_tsc=0;
-
-void DLLINTERNAL cmd_meta_tsc(void) {
-	if(!count_tsc)
-		return;
-	
-	META_CONS(" ");
-	META_CONS(" count_tsc: %.0f", (double)count_tsc);
-	META_CONS(" mean_tsc: %.1f", (double)(total_tsc / count_tsc));
-	META_CONS(" min_tsc: %.0f", (double)min_tsc);
-}
-
-void DLLINTERNAL cmd_meta_reset_tsc(void) {
-	total_tsc=0;
-	count_tsc=0;
-	min_tsc=0;
-}
-#endif /*META_PERFMON*/
-
 // Register commands and cvars.
 void DLLINTERNAL meta_register_cmdcvar() {
 	CVAR_REGISTER(&meta_debug);
@@ -111,6 +93,8 @@ void DLLHIDDEN svr_meta(void) {
 		cmd_doplug(PC_FORCE_UNLOAD);
 	else if(!strcasecmp(cmd, "reload"))
 		cmd_doplug(PC_RELOAD);
+	else if(!strcasecmp(cmd, "bgreload"))
+		cmd_doplug(PC_BGRELOAD);
 	else if(!strcasecmp(cmd, "retry"))
 		cmd_doplug(PC_RETRY);
 	else if(!strcasecmp(cmd, "clear"))
@@ -122,12 +106,16 @@ void DLLHIDDEN svr_meta(void) {
 	// arguments: filename, description
 	else if(!strcasecmp(cmd, "load"))
 		cmd_meta_load();
-#ifdef META_PERFMON
-	else if(!strcasecmp(cmd, "tsc"))
-		cmd_meta_tsc();
-	else if(!strcasecmp(cmd, "reset_tsc"))
-		cmd_meta_reset_tsc();
-#endif /*META_PERFMON*/
+	// arguments: [plugin] [function], or "reset"
+	else if(!strcasecmp(cmd, "prof"))
+		cmd_meta_prof();
+	else if(!strcasecmp(cmd, "budget"))
+		cmd_meta_budget();
+	else if(!strcasecmp(cmd, "stats"))
+		cmd_meta_stats();
+	// arguments: start, stop, or dump <file>
+	else if(!strcasecmp(cmd, "trace"))
+		cmd_meta_trace();
 	// unrecognized
 	else {
 		META_CONS("Unrecognized meta command: %s", cmd);
@@ -168,9 +156,15 @@ void DLLINTERNAL cmd_meta_usage(void) {
 	META_CONS("   cvars            - list cvars registered by plugins");
 	META_CONS("   refresh          - load/unload any new/deleted/updated plugins");
 	META_CONS("   config           - show config info loaded from config.ini");
+	META_CONS("   prof [<plugin> [<function>]] - show api hook call latencies");
+	META_CONS("   prof reset       - clear api hook call latencies");
+	META_CONS("   budget [reset]   - show plugin hook time per frame, against budgets");
+	META_CONS("   stats            - show and reset counts of hook problems, like unset meta_result");
+	META_CONS("   trace [start|stop|dump <file>] - record api hook calls for offline analysis");
 	META_CONS("   load <name>      - find and load a plugin with the given name");
 	META_CONS("   unload <plugin>  - unload a loaded plugin");
 	META_CONS("   reload <plugin>  - unload a plugin and load it again");
+	META_CONS("   bgreload <plugin> - load a plugin again in the background, and swap it in at next frame");
 	META_CONS("   info <plugin>    - show all information about a plugin");
 	META_CONS("   pause <plugin>   - pause a loaded, running plugin");
 	META_CONS("   unpause <plugin> - unpause a previously paused plugin");
@@ -282,7 +276,8 @@ void DLLINTERNAL cmd_meta_refresh(void) {
 		return;
 	}
 	META_LOG("Refreshing the plugins on demand...");
-	if(Plugins->refresh(PT_ANYTIME) != mTRUE) {
+	// also picks up a changed config.ini, if one was noticed
+	if(fwatch_apply(PT_ANYTIME) != mTRUE) {
 		META_LOG("Refresh failed.");
 	}
 }
@@ -312,6 +307,7 @@ void DLLINTERNAL cmd_meta_cmdlist(void) {
 		return;
 	}
 	RegCmds->show();
+	RegClientCmds->show();
 }
 
 // "meta cvars" console command.
@@ -332,6 +328,118 @@ void DLLINTERNAL cmd_meta_config(void) {
 	Config->show();
 }
 
+// "meta prof" console command.
+void DLLINTERNAL cmd_meta_prof(void) {
+	int argc, slot, fn;
+	const char *arg;
+	char *endptr;
+	MPlugin *findp;
+
+	argc=CMD_ARGC();
+	if(argc > 4) {
+		META_CONS("usage: meta prof [<plugin> [<function>]]");
+		META_CONS("       meta prof reset");
+		META_CONS("   where <plugin> can be either the plugin index #, a non-ambiguous");
+		META_CONS("   prefix string matching name, desc, file, or logtag, \"game\" for");
+		META_CONS("   the gamedll and engine themselves, or \"*\" for all");
+		return;
+	}
+	slot=-1;
+	fn=-1;
+	if(argc >= 3) {
+		arg=CMD_ARGV(2);
+		if(argc == 3 && !strcasecmp(arg, "reset")) {
+			api_prof_reset();
+			META_CONS("Reset api hook profiling data.");
+			return;
+		}
+		if(!strcasecmp(arg, "game"))
+			slot=API_PROF_SLOT_REAL;
+		else if(strcmp(arg, "*")) {
+			// try to match plugin id first
+			slot = strtol(arg, &endptr, 10);
+			if(*arg && !*endptr)
+				findp=Plugins->find(slot);
+			// else try to match some string (prefix)
+			else
+				findp=Plugins->find_match(arg);
+			if(!findp) {
+				if(meta_errno == ME_NOTUNIQ)
+					META_CONS("Couldn't find unique plugin matching '%s'", arg);
+				else
+					META_CONS("Couldn't find plugin matching '%s'", arg);
+				return;
+			}
+			slot=findp->index;
+		}
+	}
+	if(argc == 4) {
+		arg=CMD_ARGV(3);
+		fn=api_prof_find_func(arg);
+		if(fn < 0) {
+			META_CONS("Unknown api function '%s'", arg);
+			return;
+		}
+	}
+	api_prof_show(slot, fn);
+}
+
+// "meta budget" console command.
+void DLLINTERNAL cmd_meta_budget(void) {
+	int argc;
+
+	argc=CMD_ARGC();
+	if(argc == 3 && !strcasecmp(CMD_ARGV(2), "reset")) {
+		api_budget_reset();
+		META_CONS("Reset plugin frame time counters.");
+		return;
+	}
+	if(argc != 2) {
+		META_CONS("usage: meta budget [reset]");
+		return;
+	}
+	api_budget_show();
+}
+
+// "meta stats" console command.
+void DLLINTERNAL cmd_meta_stats(void) {
+	if(CMD_ARGC() != 2) {
+		META_CONS("usage: meta stats");
+		return;
+	}
+	api_stats_show();
+}
+
+// "meta trace" console command.
+void DLLINTERNAL cmd_meta_trace(void) {
+	int argc, n;
+	const char *arg;
+
+	argc=CMD_ARGC();
+	arg = argc >= 3 ? CMD_ARGV(2) : "";
+	if(argc == 2)
+		api_trace_show();
+	else if(argc == 3 && !strcasecmp(arg, "start")) {
+		api_trace_start();
+		META_CONS("Started api hook call trace.");
+	}
+	else if(argc == 3 && !strcasecmp(arg, "stop")) {
+		api_trace_stop();
+		META_CONS("Stopped api hook call trace.");
+	}
+	else if(argc == 4 && !strcasecmp(arg, "dump")) {
+		n = api_trace_dump(CMD_ARGV(3));
+		if(n >= 0)
+			META_CONS("Wrote %d hook calls to '%s'.", n, CMD_ARGV(3));
+	}
+	else {
+		META_CONS("usage: meta trace [start|stop]");
+		META_CONS("       meta trace dump <file>");
+		META_CONS("   where <file> is relative to the game directory; convert it with");
+		META_CONS("   meta_trace_conv to folded stacks or Chrome trace JSON");
+	}
+}
+
 // gamedir/filename
 // gamedir/dlls/filename
 //
@@ -492,6 +600,14 @@ void DLLINTERNAL cmd_doplug(PLUG_CMD pcmd) {
 			else
 				META_CONS("Reload failed for plugin '%s'", findp->desc);
 		}
+		else if(pcmd==PC_BGRELOAD) {
+			if(preload_start(findp))
+				META_CONS("Loading plugin '%s' in the background; will swap it in at next frame", findp->desc);
+			else if(meta_errno == ME_ALREADY)
+				META_CONS("Plugin '%s' is already being loaded in the background", findp->desc);
+			else
+				META_CONS("Can't reload plugin '%s' in the background; not running (status=%s)", findp->desc, findp->str_status());
+		}
 		else if(pcmd==PC_RETRY) {
 			if(findp->retry(PT_ANYTIME, PNL_COMMAND))
 				META_CONS("Retry succeeded for plugin '%s'", findp->desc);
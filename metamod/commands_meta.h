@@ -53,6 +53,7 @@ typedef enum {
 	PC_CLEAR,		// remove a failed plugin from the list
 	PC_FORCE_UNLOAD,	// forcibly unload the plugin
 	PC_REQUIRE,		// require that this plugin is loaded/running
+	PC_BGRELOAD,		// load the plugin again in the background, and swap it in
 } PLUG_CMD;
 
 void DLLINTERNAL meta_register_cmdcvar();
@@ -71,6 +72,10 @@ void DLLINTERNAL cmd_meta_pluginlist(void);
 void DLLINTERNAL cmd_meta_cmdlist(void);
 void DLLINTERNAL cmd_meta_cvarlist(void);
 void DLLINTERNAL cmd_meta_config(void);
+void DLLINTERNAL cmd_meta_prof(void);
+void DLLINTERNAL cmd_meta_budget(void);
+void DLLINTERNAL cmd_meta_stats(void);
+void DLLINTERNAL cmd_meta_trace(void);
 
 void DLLINTERNAL cmd_doplug(PLUG_CMD pcmd);
 
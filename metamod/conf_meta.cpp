@@ -46,7 +46,10 @@
 
 MConfig::MConfig(void)
 	: list(NULL), filename(NULL), debuglevel(0), gamedll(NULL),
-		plugins_file(NULL), exec_cfg(NULL)
+		plugins_file(NULL), exec_cfg(NULL), autodetect(0), clientmeta(0),
+		budget_usec(0), budget_plugins(NULL), budget_frames(0),
+		budget_autopause(0), log_async(0), logfile(NULL), logfile_size(0),
+		watch_files(0), watch_autoapply(0)
 {
 }
 
@@ -196,6 +199,8 @@ mBOOL DLLINTERNAL MConfig::load(const char *fn) {
 			continue;
 		}
 	}
+	if(filename)
+		free(filename);
 	filename=strdup(loadfile);
 	fclose(fp);
 	return(mTRUE);
@@ -90,6 +90,15 @@ class MConfig : public class_metamod_new {
 		char *exec_cfg;		// ie metaexec.cfg, exec.cfg
 		int autodetect;		// autodetection of gamedll (Metamod-All-Support patch)
 		int clientmeta;         // control 'meta' client-command
+		int budget_usec;	// per-plugin hook time budget per frame, 0 for none
+		char *budget_plugins;	// per-plugin budgets, ie "amxx=2000 podbot=500"
+		int budget_frames;	// frames over budget in a row before acting
+		int budget_autopause;	// pause plugins over budget, instead of warning
+		int log_async;		// queue log messages, for the engine at frame start
+		char *logfile;		// metamod's own log file, written by a thread
+		int logfile_size;	// KB at which logfile is rotated, 0 for never
+		int watch_files;	// notice changed ini/plugin files with inotify
+		int watch_autoapply;	// apply noticed changes at next map change
 		// functions
 		void DLLINTERNAL init(option_t *global_options);
 		mBOOL DLLINTERNAL load(const char *filename);
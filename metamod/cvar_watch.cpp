@@ -0,0 +1,159 @@
+/*
+ * Copyright (c) 2004-2006 Jussi Kivilinna
+ *
+ *    This file is part of "Metamod All-Mod-Support"-patch for Metamod.
+ *
+ *    Metamod is free software; you can redistribute it and/or modify it
+ *    under the terms of the GNU General Public License as published by the
+ *    Free Software Foundation; either version 2 of the License, or (at
+ *    your option) any later version.
+ *
+ *    Metamod is distributed in the hope that it will be useful, but
+ *    WITHOUT ANY WARRANTY; without even the implied warranty of
+ *    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ *    General Public License for more details.
+ *
+ *    You should have received a copy of the GNU General Public License
+ *    along with Metamod; if not, write to the Free Software Foundation,
+ *    Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+ *
+ *    In addition, as a special exception, the author gives permission to
+ *    link the code of this program with the Half-Life Game Engine ("HL
+ *    Engine") and Modified Game Libraries ("MODs") developed by Valve,
+ *    L.L.C ("Valve").  You must obey the GNU General Public License in all
+ *    respects for all of the code used other than the HL Engine and MODs
+ *    from Valve.  If you modify this file, you may extend this exception
+ *    to your version of the file, but you are not obligated to do so.  If
+ *    you do not wish to do so, delete this exception statement from your
+ *    version.
+ *
+ */
+
+#include <stdlib.h>			// free
+#include <string.h>			// strcmp, strdup
+
+#include <extdll.h>			// always
+#include "enginecallbacks.h"	// CVAR_GET_POINTER
+
+#include "cvar_watch.h"		// me
+#include "log_meta.h"		// META_DEBUG, etc
+#include "osdep.h"			// likely, unlikely
+
+typedef struct cvar_watch_s {
+	MPlugin *plugin;			// NULL once removed
+	cvar_t *cvar;
+	CVAR_CHANGE_FN pfnChanged;
+	char *last;					// value last seen; malloc'd
+} cvar_watch_t;
+
+// Entries don't move while a change function might be adding or removing
+// them; removed ones are squeezed out at the start of the next frame.
+static cvar_watch_t cvar_watches[MAX_CVAR_WATCHES];
+static int num_cvar_watches = 0;
+static mBOOL cvar_watches_removed = mFALSE;
+
+static void DLLINTERNAL remove_watch(cvar_watch_t *watch) {
+	watch->plugin = NULL;
+	free(watch->last);
+	watch->last = NULL;
+	cvar_watches_removed = mTRUE;
+}
+
+// meta_errno values:
+//  - ME_ARGUMENT	missing cvar name
+//  - ME_NOTFOUND	engine has no such cvar
+//  - ME_MAXREACHED	too many watches
+//  - ME_NOMEM		couldn't copy the value
+cvar_t * DLLINTERNAL cvar_watch_get(MPlugin *plug, const char *name, CVAR_CHANGE_FN pfnChanged) {
+	cvar_watch_t *watch;
+	cvar_t *cvar;
+	int i;
+
+	if(!name || !name[0])
+		RETURN_ERRNO(NULL, ME_ARGUMENT);
+	cvar = CVAR_GET_POINTER(name);
+	if(!cvar)
+		RETURN_ERRNO(NULL, ME_NOTFOUND);
+
+	for(i=0; i < num_cvar_watches; i++) {
+		watch = &cvar_watches[i];
+		if(watch->plugin != plug || watch->cvar != cvar)
+			continue;
+		if(pfnChanged)
+			watch->pfnChanged = pfnChanged;
+		else
+			remove_watch(watch);
+		return(cvar);
+	}
+	if(!pfnChanged)
+		return(cvar);
+
+	if(num_cvar_watches >= MAX_CVAR_WATCHES) {
+		META_WARNING("Too many watched cvars; plugin '%s' won't see changes to '%s'", plug->desc, name);
+		RETURN_ERRNO(NULL, ME_MAXREACHED);
+	}
+	watch = &cvar_watches[num_cvar_watches];
+	watch->last = strdup(cvar->string ? cvar->string : "");
+	if(!watch->last)
+		RETURN_ERRNO(NULL, ME_NOMEM);
+	watch->plugin = plug;
+	watch->cvar = cvar;
+	watch->pfnChanged = pfnChanged;
+	num_cvar_watches++;
+	META_DEBUG(4, ("Plugin '%s' watching cvar '%s'", plug->desc, cvar->name));
+	return(cvar);
+}
+
+void DLLINTERNAL cvar_watch_remove_plugin(MPlugin *plug) {
+	int i;
+
+	for(i=0; i < num_cvar_watches; i++) {
+		if(cvar_watches[i].plugin == plug)
+			remove_watch(&cvar_watches[i]);
+	}
+}
+
+void DLLINTERNAL cvar_watch_frame(void) {
+	cvar_watch_t *watch;
+	const char *value;
+	char *old;
+	int i, n;
+
+	if(likely(!num_cvar_watches))
+		return;
+
+	if(cvar_watches_removed) {
+		n = 0;
+		for(i=0; i < num_cvar_watches; i++) {
+			if(cvar_watches[i].plugin)
+				cvar_watches[n++] = cvar_watches[i];
+		}
+		num_cvar_watches = n;
+		cvar_watches_removed = mFALSE;
+	}
+
+	// count fixed now; watches added by change functions start next frame
+	n = num_cvar_watches;
+	for(i=0; i < n; i++) {
+		watch = &cvar_watches[i];
+		// removed by a change function earlier in this loop
+		if(!watch->plugin || !watch->last)
+			continue;
+		value = watch->cvar->string ? watch->cvar->string : "";
+		if(likely(!strcmp(value, watch->last)))
+			continue;
+		// paused plugins see the change when they're running again
+		if(watch->plugin->status != PL_RUNNING)
+			continue;
+		old = watch->last;
+		watch->last = strdup(value);
+		if(!watch->last) {
+			watch->last = old;
+			continue;
+		}
+		META_DEBUG(5, ("Cvar '%s' changed from '%s' to '%s'; calling %s", 
+				watch->cvar->name, old, value, watch->plugin->file));
+		watch->pfnChanged(watch->cvar, old);
+		free(old);
+	}
+}
@@ -0,0 +1,64 @@
+/*
+ * Copyright (c) 2004-2006 Jussi Kivilinna
+ *
+ *    This file is part of "Metamod All-Mod-Support"-patch for Metamod.
+ *
+ *    Metamod is free software; you can redistribute it and/or modify it
+ *    under the terms of the GNU General Public License as published by the
+ *    Free Software Foundation; either version 2 of the License, or (at
+ *    your option) any later version.
+ *
+ *    Metamod is distributed in the hope that it will be useful, but
+ *    WITHOUT ANY WARRANTY; without even the implied warranty of
+ *    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ *    General Public License for more details.
+ *
+ *    You should have received a copy of the GNU General Public License
+ *    along with Metamod; if not, write to the Free Software Foundation,
+ *    Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+ *
+ *    In addition, as a special exception, the author gives permission to
+ *    link the code of this program with the Half-Life Game Engine ("HL
+ *    Engine") and Modified Game Libraries ("MODs") developed by Valve,
+ *    L.L.C ("Valve").  You must obey the GNU General Public License in all
+ *    respects for all of the code used other than the HL Engine and MODs
+ *    from Valve.  If you modify this file, you may extend this exception
+ *    to your version of the file, but you are not obligated to do so.  If
+ *    you do not wish to do so, delete this exception statement from your
+ *    version.
+ *
+ */
+
+#ifndef CVAR_WATCH_H
+#define CVAR_WATCH_H
+
+#include <extdll.h>			// cvar_t
+
+#include "comp_dep.h"
+#include "types_meta.h"		// mBOOL
+#include "mplugin.h"		// MPlugin
+#include "mutil.h"			// CVAR_CHANGE_FN
+
+// Cvar handles for plugins, from GET_CVAR_HANDLE.
+//
+// A handle is the engine's own cvar_t, looked up by name once; engine
+// cvars (and those plugins register through metamod) stay put for the
+// life of the server, so plugins can read value and string from it every
+// frame instead of calling CVAR_GET_FLOAT by name.  Plugins can also have
+// a function called when a cvar's value changes.  The engine changes
+// cvars without going through any function we see (console commands,
+// config files), so watched cvars are compared against their last value
+// once a frame.
+
+// Watched cvars, all plugins together.
+#define MAX_CVAR_WATCHES	256
+
+// Look up cvar for plugin, and watch it with the given function; NULL
+// function stops watching it.
+cvar_t * DLLINTERNAL cvar_watch_get(MPlugin *plug, const char *name, CVAR_CHANGE_FN pfnChanged);
+void DLLINTERNAL cvar_watch_remove_plugin(MPlugin *plug);
+
+// check watched cvars; called every frame
+void DLLINTERNAL cvar_watch_frame(void);
+
+#endif /* CVAR_WATCH_H */
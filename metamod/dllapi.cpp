@@ -44,143 +44,167 @@
 #include "commands_meta.h"	// client_meta, etc
 #include "log_meta.h"		// META_ERROR, etc
 #include "api_hook.h"
+#include "api_budget.h"		// api_budget_end_frame
+#include "api_stats.h"		// api_stats_frame
+#include "plugin_preload.h"	// preload_frame
+#include "file_watch.h"		// fwatch_frame, etc
+#include "ent_filter.h"		// ent_filter_plugins, etc
+#include "log_async.h"		// log_async_flush_console, etc
+#include "api_async.h"		// API_ASYNC_POST, api_async_stop
+#include "cvar_watch.h"		// cvar_watch_frame
 
 #include "SteamworksAPI_Meta.h"
 
 
 // Original DLL routines, functions returning "void".
-#define META_DLLAPI_HANDLE_void(FN_TYPE, pfnName, pack_args_type, pfn_args) \
-	API_START_TSC_TRACKING(); \
-	API_PACK_ARGS(pack_args_type, pfn_args); \
-	main_hook_function_void(offsetof(dllapi_info_t, pfnName), e_api_dllapi, offsetof(DLL_FUNCTIONS, pfnName), &packed_args); \
-	API_END_TSC_TRACKING()
+#define META_DLLAPI_HANDLE_void(FN_TYPE, pfnName, pfn_args) \
+	main_hook_function_void<FN_TYPE>(&dllapi_info.pfnName, e_api_dllapi, offsetof(DLL_FUNCTIONS, pfnName), API_CALL_ROUTINE(FN_TYPE, pfn_args))
+
+// Entity dispatch routines, which plugins may have limited to some
+// entities.  Plugins not wanting the entity are skipped, and if none
+// wants it the gamedll is called directly.
+#define META_DLLAPI_HANDLE_void_ent(kind, pent, FN_TYPE, pfnName, pfn_args) \
+	if(unlikely(ent_filter_kinds & (1 << (kind)))) { \
+		const unsigned int *plugin_mask = ent_filter_plugins(kind, pent); \
+		if(!plugin_mask) { \
+			if(likely(GameDLL.funcs.dllapi_table != NULL) && likely(GameDLL.funcs.dllapi_table->pfnName != NULL)) \
+				(*GameDLL.funcs.dllapi_table->pfnName) pfn_args; \
+			return; \
+		} \
+		main_hook_function_void<FN_TYPE, true>(&dllapi_info.pfnName, e_api_dllapi, offsetof(DLL_FUNCTIONS, pfnName), API_CALL_ROUTINE(FN_TYPE, pfn_args), plugin_mask); \
+	} \
+	else \
+		main_hook_function_void<FN_TYPE>(&dllapi_info.pfnName, e_api_dllapi, offsetof(DLL_FUNCTIONS, pfnName), API_CALL_ROUTINE(FN_TYPE, pfn_args))
 
 // Original DLL routines, functions returning an actual value.
-#define META_DLLAPI_HANDLE(ret_t, ret_init, FN_TYPE, pfnName, pack_args_type, pfn_args) \
-	API_START_TSC_TRACKING(); \
-	API_PACK_ARGS(pack_args_type, pfn_args); \
-	class_ret_t ret_val(main_hook_function(class_ret_t((ret_t)ret_init), offsetof(dllapi_info_t, pfnName), e_api_dllapi, offsetof(DLL_FUNCTIONS, pfnName), &packed_args)); \
-	API_END_TSC_TRACKING()
+#define META_DLLAPI_HANDLE(ret_t, ret_init, FN_TYPE, pfnName, pfn_args) \
+	ret_t ret_val = main_hook_function<ret_t, FN_TYPE>((ret_t)ret_init, &dllapi_info.pfnName, e_api_dllapi, offsetof(DLL_FUNCTIONS, pfnName), API_CALL_ROUTINE(FN_TYPE, pfn_args))
+
+// Queue the call for plugins' async observers; after the HANDLE macro.
+#define META_DLLAPI_ASYNC_POST(FN_TYPE, pfnName, pfn_args) \
+	API_ASYNC_POST(e_api_dllapi, DLL_FUNCTIONS, pfnName, FN_TYPE, NULL, pfn_args)
 
 // The "new" api routines (just 3 right now), functions returning "void".
-#define META_NEWAPI_HANDLE_void(FN_TYPE, pfnName, pack_args_type, pfn_args) \
-	API_START_TSC_TRACKING(); \
-	API_PACK_ARGS(pack_args_type, pfn_args); \
-	main_hook_function_void(offsetof(newapi_info_t, pfnName), e_api_newapi, offsetof(NEW_DLL_FUNCTIONS, pfnName), &packed_args); \
-	API_END_TSC_TRACKING()
+#define META_NEWAPI_HANDLE_void(FN_TYPE, pfnName, pfn_args) \
+	main_hook_function_void<FN_TYPE>(&newapi_info.pfnName, e_api_newapi, offsetof(NEW_DLL_FUNCTIONS, pfnName), API_CALL_ROUTINE(FN_TYPE, pfn_args))
 
 // The "new" api routines (just 3 right now), functions returning an actual value.
-#define META_NEWAPI_HANDLE(ret_t, ret_init, FN_TYPE, pfnName, pack_args_type, pfn_args) \
-	API_START_TSC_TRACKING(); \
-	API_PACK_ARGS(pack_args_type, pfn_args); \
-	class_ret_t ret_val(main_hook_function(class_ret_t((ret_t)ret_init), offsetof(newapi_info_t, pfnName), e_api_newapi, offsetof(NEW_DLL_FUNCTIONS, pfnName), &packed_args)); \
-	API_END_TSC_TRACKING()
+#define META_NEWAPI_HANDLE(ret_t, ret_init, FN_TYPE, pfnName, pfn_args) \
+	ret_t ret_val = main_hook_function<ret_t, FN_TYPE>((ret_t)ret_init, &newapi_info.pfnName, e_api_newapi, offsetof(NEW_DLL_FUNCTIONS, pfnName), API_CALL_ROUTINE(FN_TYPE, pfn_args))
 
 
 // From SDK dlls/game.cpp:
 static void mm_GameDLLInit(void) {
-	META_DLLAPI_HANDLE_void(FN_GAMEINIT, pfnGameInit, void, (VOID_ARG));
+	META_DLLAPI_HANDLE_void(FN_GAMEINIT, pfnGameInit, ());
 	RETURN_API_void();
 }
 
 // From SDK dlls/cbase.cpp:
 static int mm_DispatchSpawn(edict_t *pent) {
 	// 0==Success, -1==Failure ?
-	META_DLLAPI_HANDLE(int, 0, FN_DISPATCHSPAWN, pfnSpawn, p, (pent));
+	META_DLLAPI_HANDLE(int, 0, FN_DISPATCHSPAWN, pfnSpawn, (pent));
+	ent_filter_spawned(pent);
 	RETURN_API(int);
 }
 static void mm_DispatchThink(edict_t *pent) {
-	META_DLLAPI_HANDLE_void(FN_DISPATCHTHINK, pfnThink, p, (pent));
+	META_DLLAPI_HANDLE_void_ent(ENT_DISPATCH_THINK, pent, FN_DISPATCHTHINK, pfnThink, (pent));
 	RETURN_API_void();
 }
 static void mm_DispatchUse(edict_t *pentUsed, edict_t *pentOther) {
-	META_DLLAPI_HANDLE_void(FN_DISPATCHUSE, pfnUse, 2p, (pentUsed, pentOther));
+	META_DLLAPI_HANDLE_void_ent(ENT_DISPATCH_USE, pentUsed, FN_DISPATCHUSE, pfnUse, (pentUsed, pentOther));
 	RETURN_API_void();
 }
 static void mm_DispatchTouch(edict_t *pentTouched, edict_t *pentOther) {
-	META_DLLAPI_HANDLE_void(FN_DISPATCHTOUCH, pfnTouch, 2p, (pentTouched, pentOther));
+	META_DLLAPI_HANDLE_void_ent(ENT_DISPATCH_TOUCH, pentTouched, FN_DISPATCHTOUCH, pfnTouch, (pentTouched, pentOther));
 	RETURN_API_void();
 }
 static void mm_DispatchBlocked(edict_t *pentBlocked, edict_t *pentOther) {
-	META_DLLAPI_HANDLE_void(FN_DISPATCHBLOCKED, pfnBlocked, 2p, (pentBlocked, pentOther));
+	META_DLLAPI_HANDLE_void_ent(ENT_DISPATCH_BLOCKED, pentBlocked, FN_DISPATCHBLOCKED, pfnBlocked, (pentBlocked, pentOther));
 	RETURN_API_void();
 }
 static void mm_DispatchKeyValue(edict_t *pentKeyvalue, KeyValueData *pkvd) {
-	META_DLLAPI_HANDLE_void(FN_DISPATCHKEYVALUE, pfnKeyValue, 2p, (pentKeyvalue, pkvd));
+	META_DLLAPI_HANDLE_void(FN_DISPATCHKEYVALUE, pfnKeyValue, (pentKeyvalue, pkvd));
 	RETURN_API_void();
 }
 static void mm_DispatchSave(edict_t *pent, SAVERESTOREDATA *pSaveData) {
-	META_DLLAPI_HANDLE_void(FN_DISPATCHSAVE, pfnSave, 2p, (pent, pSaveData));
+	META_DLLAPI_HANDLE_void(FN_DISPATCHSAVE, pfnSave, (pent, pSaveData));
 	RETURN_API_void();
 }
 static int mm_DispatchRestore(edict_t *pent, SAVERESTOREDATA *pSaveData, int globalEntity) {
 	// 0==Success, -1==Failure ?
-	META_DLLAPI_HANDLE(int, 0, FN_DISPATCHRESTORE, pfnRestore, 2pi, (pent, pSaveData, globalEntity));
+	META_DLLAPI_HANDLE(int, 0, FN_DISPATCHRESTORE, pfnRestore, (pent, pSaveData, globalEntity));
 	RETURN_API(int);
 }
 static void mm_DispatchObjectCollsionBox(edict_t *pent) {
-	META_DLLAPI_HANDLE_void(FN_DISPATCHOBJECTCOLLISIONBOX, pfnSetAbsBox, p, (pent));
+	META_DLLAPI_HANDLE_void(FN_DISPATCHOBJECTCOLLISIONBOX, pfnSetAbsBox, (pent));
 	RETURN_API_void();
 }
 static void mm_SaveWriteFields(SAVERESTOREDATA *pSaveData, const char *pname, void *pBaseData, TYPEDESCRIPTION *pFields, int fieldCount) {
-	META_DLLAPI_HANDLE_void(FN_SAVEWRITEFIELDS, pfnSaveWriteFields, 4pi, (pSaveData, pname, pBaseData, pFields, fieldCount));
+	META_DLLAPI_HANDLE_void(FN_SAVEWRITEFIELDS, pfnSaveWriteFields, (pSaveData, pname, pBaseData, pFields, fieldCount));
 	RETURN_API_void();
 }
 static void mm_SaveReadFields(SAVERESTOREDATA *pSaveData, const char *pname, void *pBaseData, TYPEDESCRIPTION *pFields, int fieldCount) {
-	META_DLLAPI_HANDLE_void(FN_SAVEREADFIELDS, pfnSaveReadFields, 4pi, (pSaveData, pname, pBaseData, pFields, fieldCount));
+	META_DLLAPI_HANDLE_void(FN_SAVEREADFIELDS, pfnSaveReadFields, (pSaveData, pname, pBaseData, pFields, fieldCount));
 	RETURN_API_void();
 }
 
 // From SDK dlls/world.cpp:
 static void mm_SaveGlobalState(SAVERESTOREDATA *pSaveData) {
-	META_DLLAPI_HANDLE_void(FN_SAVEGLOBALSTATE, pfnSaveGlobalState, p, (pSaveData));
+	META_DLLAPI_HANDLE_void(FN_SAVEGLOBALSTATE, pfnSaveGlobalState, (pSaveData));
 	RETURN_API_void();
 }
 static void mm_RestoreGlobalState(SAVERESTOREDATA *pSaveData) {
-	META_DLLAPI_HANDLE_void(FN_RESTOREGLOBALSTATE, pfnRestoreGlobalState, p, (pSaveData));
+	META_DLLAPI_HANDLE_void(FN_RESTOREGLOBALSTATE, pfnRestoreGlobalState, (pSaveData));
 	RETURN_API_void();
 }
 static void mm_ResetGlobalState(void) {
-	META_DLLAPI_HANDLE_void(FN_RESETGLOBALSTATE, pfnResetGlobalState, void, (VOID_ARG));
+	META_DLLAPI_HANDLE_void(FN_RESETGLOBALSTATE, pfnResetGlobalState, ());
 	RETURN_API_void();
 }
 
 // From SDK dlls/client.cpp:
 static qboolean mm_ClientConnect(edict_t *pEntity, const char *pszName, const char *pszAddress, char szRejectReason[128]) {
 	g_Players.clear_player_cvar_query(pEntity);
-	META_DLLAPI_HANDLE(qboolean, TRUE, FN_CLIENTCONNECT, pfnClientConnect, 4p, (pEntity, pszName, pszAddress, szRejectReason));
+	META_DLLAPI_HANDLE(qboolean, TRUE, FN_CLIENTCONNECT, pfnClientConnect, (pEntity, pszName, pszAddress, szRejectReason));
+	META_DLLAPI_ASYNC_POST(FN_CLIENTCONNECT, pfnClientConnect, (pEntity, pszName, pszAddress, szRejectReason));
 	RETURN_API(qboolean);
 }
 static void mm_ClientDisconnect(edict_t *pEntity) {
 	g_Players.clear_player_cvar_query(pEntity);
-	META_DLLAPI_HANDLE_void(FN_CLIENTDISCONNECT, pfnClientDisconnect, p, (pEntity));
+	META_DLLAPI_HANDLE_void(FN_CLIENTDISCONNECT, pfnClientDisconnect, (pEntity));
+	META_DLLAPI_ASYNC_POST(FN_CLIENTDISCONNECT, pfnClientDisconnect, (pEntity));
 	RETURN_API_void();
 }
 static void mm_ClientKill(edict_t *pEntity) {
-	META_DLLAPI_HANDLE_void(FN_CLIENTKILL, pfnClientKill, p, (pEntity));
+	META_DLLAPI_HANDLE_void(FN_CLIENTKILL, pfnClientKill, (pEntity));
+	META_DLLAPI_ASYNC_POST(FN_CLIENTKILL, pfnClientKill, (pEntity));
 	RETURN_API_void();
 }
 static void mm_ClientPutInServer(edict_t *pEntity) {
-	META_DLLAPI_HANDLE_void(FN_CLIENTPUTINSERVER, pfnClientPutInServer, p, (pEntity));
+	META_DLLAPI_HANDLE_void(FN_CLIENTPUTINSERVER, pfnClientPutInServer, (pEntity));
+	META_DLLAPI_ASYNC_POST(FN_CLIENTPUTINSERVER, pfnClientPutInServer, (pEntity));
 	RETURN_API_void();
 }
 static void mm_ClientCommand(edict_t *pEntity) {
 	if(Config->clientmeta && strmatch(CMD_ARGV(0), "meta")) {
 		client_meta(pEntity);
 	}
-	META_DLLAPI_HANDLE_void(FN_CLIENTCOMMAND, pfnClientCommand, p, (pEntity));
+	META_DLLAPI_HANDLE_void(FN_CLIENTCOMMAND, pfnClientCommand, (pEntity));
 	RETURN_API_void();
 }
 static void mm_ClientUserInfoChanged(edict_t *pEntity, char *infobuffer) {
-	META_DLLAPI_HANDLE_void(FN_CLIENTUSERINFOCHANGED, pfnClientUserInfoChanged, 2p, (pEntity, infobuffer));
+	META_DLLAPI_HANDLE_void(FN_CLIENTUSERINFOCHANGED, pfnClientUserInfoChanged, (pEntity, infobuffer));
+	META_DLLAPI_ASYNC_POST(FN_CLIENTUSERINFOCHANGED, pfnClientUserInfoChanged, (pEntity, infobuffer));
 	RETURN_API_void();
 }
 static void mm_ServerActivate(edict_t *pEdictList, int edictCount, int clientMax) {
-	META_DLLAPI_HANDLE_void(FN_SERVERACTIVATE, pfnServerActivate, p2i, (pEdictList, edictCount, clientMax));
+	META_DLLAPI_HANDLE_void(FN_SERVERACTIVATE, pfnServerActivate, (pEdictList, edictCount, clientMax));
+	META_DLLAPI_ASYNC_POST(FN_SERVERACTIVATE, pfnServerActivate, (pEdictList, edictCount, clientMax));
 	RETURN_API_void();
 }
 static void mm_ServerDeactivate(void) {
-	META_DLLAPI_HANDLE_void(FN_SERVERDEACTIVATE, pfnServerDeactivate, void, (VOID_ARG));
+	META_DLLAPI_HANDLE_void(FN_SERVERDEACTIVATE, pfnServerDeactivate, ());
+	META_DLLAPI_ASYNC_POST(FN_SERVERDEACTIVATE, pfnServerDeactivate, ());
 	// Update loaded plugins.  Look for new plugins in inifile, as well as
 	// any plugins waiting for a changelevel to load.  
 	//
@@ -194,113 +218,132 @@ static void mm_ServerDeactivate(void) {
 	// from the previous map.  It's also called right before shutdown,
 	// which means whenever hlds quits, it'll reload the plugins just
 	// before it exits, which is rather silly, but oh well.
-	Plugins->refresh(PT_CHANGELEVEL);
+	//
+	// When files are watched for changes, plugins.ini is only re-read if
+	// something changed; otherwise just retry actions delayed until now.
+	// Events are only read once a second from StartFrame, so read any
+	// still pending first.
+	fwatch_drain();
+	if(!Config->watch_autoapply && fwatch_active())
+		Plugins->retry_all(PT_CHANGELEVEL);
+	else if(fwatch_pending())
+		fwatch_apply(PT_CHANGELEVEL);
+	else
+		Plugins->retry_all(PT_CHANGELEVEL);
 	Plugins->unpause_all();
+	ent_filter_new_map();
 	// Plugins->retry_all(PT_CHANGELEVEL);
 	g_Players.clear_all_cvar_queries();
 	requestid_counter = 0;
 	RETURN_API_void();
 }
 static void mm_PlayerPreThink(edict_t *pEntity) {
-	META_DLLAPI_HANDLE_void(FN_PLAYERPRETHINK, pfnPlayerPreThink, p, (pEntity));
+	META_DLLAPI_HANDLE_void(FN_PLAYERPRETHINK, pfnPlayerPreThink, (pEntity));
 	RETURN_API_void();
 }
 static void mm_PlayerPostThink(edict_t *pEntity) {
-	META_DLLAPI_HANDLE_void(FN_PLAYERPOSTTHINK, pfnPlayerPostThink, p, (pEntity));
+	META_DLLAPI_HANDLE_void(FN_PLAYERPOSTTHINK, pfnPlayerPostThink, (pEntity));
 	RETURN_API_void();
 }
 static void mm_StartFrame(void) {
 	meta_debug_value = (int)meta_debug.value;
+	api_budget_end_frame();
+	api_stats_frame();
+	preload_frame();
+	fwatch_frame();
+	cvar_watch_frame();
+	if(log_async_active)
+		log_async_flush_console();
 
-	META_DLLAPI_HANDLE_void(FN_STARTFRAME, pfnStartFrame, void, (VOID_ARG));
+	META_DLLAPI_HANDLE_void(FN_STARTFRAME, pfnStartFrame, ());
 	RETURN_API_void();
 }
 static void mm_ParmsNewLevel(void) {
-	META_DLLAPI_HANDLE_void(FN_PARMSNEWLEVEL, pfnParmsNewLevel, void, (VOID_ARG));
+	META_DLLAPI_HANDLE_void(FN_PARMSNEWLEVEL, pfnParmsNewLevel, ());
 	RETURN_API_void();
 }
 static void mm_ParmsChangeLevel(void) {
-	META_DLLAPI_HANDLE_void(FN_PARMSCHANGELEVEL, pfnParmsChangeLevel, void, (VOID_ARG));
+	META_DLLAPI_HANDLE_void(FN_PARMSCHANGELEVEL, pfnParmsChangeLevel, ());
 	RETURN_API_void();
 }
 static const char *mm_GetGameDescription(void) {
-	META_DLLAPI_HANDLE(const char *, NULL, FN_GETGAMEDESCRIPTION, pfnGetGameDescription, void, (VOID_ARG));
+	META_DLLAPI_HANDLE(const char *, NULL, FN_GETGAMEDESCRIPTION, pfnGetGameDescription, ());
 	RETURN_API(const char *);
 }
 static void mm_PlayerCustomization(edict_t *pEntity, customization_t *pCust) {
-	META_DLLAPI_HANDLE_void(FN_PLAYERCUSTOMIZATION, pfnPlayerCustomization, 2p, (pEntity, pCust));
+	META_DLLAPI_HANDLE_void(FN_PLAYERCUSTOMIZATION, pfnPlayerCustomization, (pEntity, pCust));
 	RETURN_API_void();
 }
 static void mm_SpectatorConnect(edict_t *pEntity) {
-	META_DLLAPI_HANDLE_void(FN_SPECTATORCONNECT, pfnSpectatorConnect, p, (pEntity));
+	META_DLLAPI_HANDLE_void(FN_SPECTATORCONNECT, pfnSpectatorConnect, (pEntity));
 	RETURN_API_void();
 }
 static void mm_SpectatorDisconnect(edict_t *pEntity) {
-	META_DLLAPI_HANDLE_void(FN_SPECTATORDISCONNECT, pfnSpectatorDisconnect, p, (pEntity));
+	META_DLLAPI_HANDLE_void(FN_SPECTATORDISCONNECT, pfnSpectatorDisconnect, (pEntity));
 	RETURN_API_void();
 }
 static void mm_SpectatorThink(edict_t *pEntity) {
-	META_DLLAPI_HANDLE_void(FN_SPECTATORTHINK, pfnSpectatorThink, p, (pEntity));
+	META_DLLAPI_HANDLE_void(FN_SPECTATORTHINK, pfnSpectatorThink, (pEntity));
 	RETURN_API_void();
 }
 static void mm_Sys_Error(const char *error_string) {
-	META_DLLAPI_HANDLE_void(FN_SYS_ERROR, pfnSys_Error, p, (error_string));
+	META_DLLAPI_HANDLE_void(FN_SYS_ERROR, pfnSys_Error, (error_string));
 	RETURN_API_void();
 }
 
 // From SDK pm_shared/pm_shared.c:
 static void mm_PM_Move (struct playermove_s *ppmove, int server) {
-	META_DLLAPI_HANDLE_void(FN_PM_MOVE, pfnPM_Move, pi, (ppmove, server));
+	META_DLLAPI_HANDLE_void(FN_PM_MOVE, pfnPM_Move, (ppmove, server));
 	RETURN_API_void();
 }
 static void mm_PM_Init(struct playermove_s *ppmove) {
-	META_DLLAPI_HANDLE_void(FN_PM_INIT, pfnPM_Init, p, (ppmove));
+	META_DLLAPI_HANDLE_void(FN_PM_INIT, pfnPM_Init, (ppmove));
 	RETURN_API_void();
 }
 static char mm_PM_FindTextureType(char *name) {
-	META_DLLAPI_HANDLE(char, '\0', FN_PM_FINDTEXTURETYPE, pfnPM_FindTextureType, p, (name));
+	META_DLLAPI_HANDLE(char, '\0', FN_PM_FINDTEXTURETYPE, pfnPM_FindTextureType, (name));
 	RETURN_API(char);
 }
 
 // From SDK dlls/client.cpp:
 static void mm_SetupVisibility(edict_t *pViewEntity, edict_t *pClient, unsigned char **pvs, unsigned char **pas) {
-	META_DLLAPI_HANDLE_void(FN_SETUPVISIBILITY, pfnSetupVisibility, 4p, (pViewEntity, pClient, pvs, pas));
+	META_DLLAPI_HANDLE_void(FN_SETUPVISIBILITY, pfnSetupVisibility, (pViewEntity, pClient, pvs, pas));
 	RETURN_API_void();
 }
 static void mm_UpdateClientData (const struct edict_s *ent, int sendweapons, struct clientdata_s *cd) {
-	META_DLLAPI_HANDLE_void(FN_UPDATECLIENTDATA, pfnUpdateClientData, pip, (ent, sendweapons, cd));
+	META_DLLAPI_HANDLE_void(FN_UPDATECLIENTDATA, pfnUpdateClientData, (ent, sendweapons, cd));
 	RETURN_API_void();
 }
 static int mm_AddToFullPack(struct entity_state_s *state, int e, edict_t *ent, edict_t *host, int hostflags, int player, unsigned char *pSet) {
-	META_DLLAPI_HANDLE(int, 0, FN_ADDTOFULLPACK, pfnAddToFullPack, pi2p2ip, (state, e, ent, host, hostflags, player, pSet));
+	META_DLLAPI_HANDLE(int, 0, FN_ADDTOFULLPACK, pfnAddToFullPack, (state, e, ent, host, hostflags, player, pSet));
 	RETURN_API(int);
 }
 static void mm_CreateBaseline(int player, int eindex, struct entity_state_s *baseline, struct edict_s *entity, int playermodelindex, vec3_t player_mins, vec3_t player_maxs) {
-	META_DLLAPI_HANDLE_void(FN_CREATEBASELINE, pfnCreateBaseline, 2i2pi2p, (player, eindex, baseline, entity, playermodelindex, (float*)player_mins, (float*)player_maxs));
+	META_DLLAPI_HANDLE_void(FN_CREATEBASELINE, pfnCreateBaseline, (player, eindex, baseline, entity, playermodelindex, (float*)player_mins, (float*)player_maxs));
 	RETURN_API_void();
 }
 static void mm_RegisterEncoders(void) {
-	META_DLLAPI_HANDLE_void(FN_REGISTERENCODERS, pfnRegisterEncoders, void, (VOID_ARG));
+	META_DLLAPI_HANDLE_void(FN_REGISTERENCODERS, pfnRegisterEncoders, ());
 	RETURN_API_void();
 }
 static int mm_GetWeaponData(struct edict_s *player, struct weapon_data_s *info) {
-	META_DLLAPI_HANDLE(int, 0, FN_GETWEAPONDATA, pfnGetWeaponData, 2p, (player, info));
+	META_DLLAPI_HANDLE(int, 0, FN_GETWEAPONDATA, pfnGetWeaponData, (player, info));
 	RETURN_API(int);
 }
 static void mm_CmdStart(const edict_t *player, const struct usercmd_s *cmd, unsigned int random_seed) {
-	META_DLLAPI_HANDLE_void(FN_CMDSTART, pfnCmdStart, 2pui, (player, cmd, random_seed));
+	META_DLLAPI_HANDLE_void(FN_CMDSTART, pfnCmdStart, (player, cmd, random_seed));
 	RETURN_API_void();
 }
 static void mm_CmdEnd (const edict_t *player) {
-	META_DLLAPI_HANDLE_void(FN_CMDEND, pfnCmdEnd, p, (player));
+	META_DLLAPI_HANDLE_void(FN_CMDEND, pfnCmdEnd, (player));
 	RETURN_API_void();
 }
 static int mm_ConnectionlessPacket(const struct netadr_s *net_from, const char *args, char *response_buffer, int *response_buffer_size) {
-	META_DLLAPI_HANDLE(int, 0, FN_CONNECTIONLESSPACKET, pfnConnectionlessPacket, 4p, (net_from, args, response_buffer, response_buffer_size));
+	META_DLLAPI_HANDLE(int, 0, FN_CONNECTIONLESSPACKET, pfnConnectionlessPacket, (net_from, args, response_buffer, response_buffer_size));
 	RETURN_API(int);
 }
 static int mm_GetHullBounds(int hullnumber, float *mins, float *maxs) {
-	META_DLLAPI_HANDLE(int, 0, FN_GETHULLBOUNDS, pfnGetHullBounds, i2p, (hullnumber, mins, maxs));
+	META_DLLAPI_HANDLE(int, 0, FN_GETHULLBOUNDS, pfnGetHullBounds, (hullnumber, mins, maxs));
 	RETURN_API(int);
 }
 static void mm_CreateInstancedBaselines (void) {
@@ -308,15 +351,15 @@ static void mm_CreateInstancedBaselines (void) {
 	//This is the first server API call that occurs after the Steam game server is initialized that isn't conditional.
 	MetaSteamworks()->OnCreateInstancedBaselines();
 
-	META_DLLAPI_HANDLE_void(FN_CREATEINSTANCEDBASELINES, pfnCreateInstancedBaselines, void, (VOID_ARG));
+	META_DLLAPI_HANDLE_void(FN_CREATEINSTANCEDBASELINES, pfnCreateInstancedBaselines, ());
 	RETURN_API_void();
 }
 static int mm_InconsistentFile(const edict_t *player, const char *filename, char *disconnect_message) {
-	META_DLLAPI_HANDLE(int, 0, FN_INCONSISTENTFILE, pfnInconsistentFile, 3p, (player, filename, disconnect_message));
+	META_DLLAPI_HANDLE(int, 0, FN_INCONSISTENTFILE, pfnInconsistentFile, (player, filename, disconnect_message));
 	RETURN_API(int);
 }
 static int mm_AllowLagCompensation(void) {
-	META_DLLAPI_HANDLE(int, 0, FN_ALLOWLAGCOMPENSATION, pfnAllowLagCompensation, void, (VOID_ARG));
+	META_DLLAPI_HANDLE(int, 0, FN_ALLOWLAGCOMPENSATION, pfnAllowLagCompensation, ());
 	RETURN_API(int);
 }
 
@@ -324,29 +367,32 @@ static int mm_AllowLagCompensation(void) {
 // New API functions
 // From SDK ?
 static void mm_OnFreeEntPrivateData(edict_t *pEnt) {
-	META_NEWAPI_HANDLE_void(FN_ONFREEENTPRIVATEDATA, pfnOnFreeEntPrivateData, p, (pEnt));
+	ent_filter_freed(pEnt);
+	META_NEWAPI_HANDLE_void(FN_ONFREEENTPRIVATEDATA, pfnOnFreeEntPrivateData, (pEnt));
 	RETURN_API_void();
 }
 static void mm_GameShutdown(void) {
 	MetaSteamworks()->OnGameShutdown();
 
-	META_NEWAPI_HANDLE_void(FN_GAMESHUTDOWN, pfnGameShutdown, void, (VOID_ARG));
+	META_NEWAPI_HANDLE_void(FN_GAMESHUTDOWN, pfnGameShutdown, ());
+	api_async_stop();
+	log_async_stop();
 	RETURN_API_void();
 }
 static int mm_ShouldCollide(edict_t *pentTouched, edict_t *pentOther) {
-	META_NEWAPI_HANDLE(int, 1, FN_SHOULDCOLLIDE, pfnShouldCollide, 2p, (pentTouched, pentOther));
+	META_NEWAPI_HANDLE(int, 1, FN_SHOULDCOLLIDE, pfnShouldCollide, (pentTouched, pentOther));
 	RETURN_API(int);
 }
 // Added 2005/08/11 (no SDK update):
 static void mm_CvarValue(const edict_t *pEnt, const char *value) {
 	g_Players.clear_player_cvar_query(pEnt);
-	META_NEWAPI_HANDLE_void(FN_CVARVALUE, pfnCvarValue, 2p, (pEnt, value));
+	META_NEWAPI_HANDLE_void(FN_CVARVALUE, pfnCvarValue, (pEnt, value));
 	
 	RETURN_API_void();
 }
 // Added 2005/11/21 (no SDK update):
 static void mm_CvarValue2(const edict_t *pEnt, int requestID, const char *cvarName, const char *value) {
-	META_NEWAPI_HANDLE_void(FN_CVARVALUE2, pfnCvarValue2, pi2p, (pEnt, requestID, cvarName, value));
+	META_NEWAPI_HANDLE_void(FN_CVARVALUE2, pfnCvarValue2, (pEnt, requestID, cvarName, value));
 	
 	RETURN_API_void();
 }
@@ -420,6 +466,11 @@ static DLL_FUNCTIONS gFunctionTable =
 
 DLL_FUNCTIONS *g_pHookedDllFunctions = &gFunctionTable;
 
+// The tables we filled in for the engine; update_dllapi_passthrough()
+// rewrites their slots as plugins come and go.
+static DLL_FUNCTIONS *pEngineDllFunctions = NULL;
+static NEW_DLL_FUNCTIONS *pEngineNewDllFunctions = NULL;
+
 // It's not clear what the difference is between GetAPI and GetAPI2; they
 // both appear to return the exact same function table.  
 //
@@ -448,6 +499,8 @@ C_DLLEXPORT int GetEntityAPI(DLL_FUNCTIONS *pFunctionTable, int interfaceVersion
 		return(FALSE);
 	}
 	memcpy(pFunctionTable, &gFunctionTable, sizeof(DLL_FUNCTIONS));
+	pEngineDllFunctions = pFunctionTable;
+	update_dllapi_passthrough();
 	return(TRUE);
 }
 
@@ -465,6 +518,8 @@ C_DLLEXPORT int GetEntityAPI2(DLL_FUNCTIONS *pFunctionTable, int *interfaceVersi
 		return(FALSE);
 	}
 	memcpy(pFunctionTable, &gFunctionTable, sizeof(DLL_FUNCTIONS));
+	pEngineDllFunctions = pFunctionTable;
+	update_dllapi_passthrough();
 	return(TRUE);
 }
 
@@ -515,7 +570,57 @@ C_DLLEXPORT int GetNewDLLFunctions(NEW_DLL_FUNCTIONS *pNewFunctionTable, int *in
 	}
 
 	sNewFunctionTable.copy_to(pNewFunctionTable);
-
+	pEngineNewDllFunctions = pNewFunctionTable;
+	update_dllapi_passthrough();
 
 	return(TRUE);
 }
+
+// Wrappers that do work of their own besides calling plugins, so engine
+// must always call them.
+static const unsigned int dllapi_always_wrapped[] = {
+	offsetof(DLL_FUNCTIONS, pfnSpawn),
+	offsetof(DLL_FUNCTIONS, pfnClientConnect),
+	offsetof(DLL_FUNCTIONS, pfnClientDisconnect),
+	offsetof(DLL_FUNCTIONS, pfnClientCommand),
+	offsetof(DLL_FUNCTIONS, pfnServerDeactivate),
+	offsetof(DLL_FUNCTIONS, pfnStartFrame),
+	offsetof(DLL_FUNCTIONS, pfnCreateInstancedBaselines),
+};
+
+static const unsigned int newapi_always_wrapped[] = {
+	offsetof(NEW_DLL_FUNCTIONS, pfnOnFreeEntPrivateData),
+	offsetof(NEW_DLL_FUNCTIONS, pfnGameShutdown),
+	offsetof(NEW_DLL_FUNCTIONS, pfnCvarValue),
+};
+
+// Point each slot of an engine table either at our wrapper or, if no
+// plugin hooks the function, straight at the gamedll routine.
+static void DLLINTERNAL set_passthrough_slots(void **engine_table, void **wrappers, void **gamedll_table, enum_api_t api, unsigned int num_funcs, const unsigned int *always_wrapped, unsigned int num_always_wrapped) {
+	unsigned int fn, i;
+	mBOOL wrap;
+
+	for(fn=0; fn < num_funcs; fn++) {
+		wrap = (gamedll_table == NULL || gamedll_table[fn] == NULL || API_FUNC_HOOKED(api, fn * sizeof(void*))) ? mTRUE : mFALSE;
+		for(i=0; !wrap && i < num_always_wrapped; i++) {
+			if(always_wrapped[i] == fn * sizeof(void*))
+				wrap = mTRUE;
+		}
+		engine_table[fn] = wrap ? wrappers[fn] : gamedll_table[fn];
+	}
+}
+
+// Called after plugin hook lists change, and once engine has fetched the
+// tables.
+void DLLINTERNAL update_dllapi_passthrough(void) {
+	if(pEngineDllFunctions) {
+		set_passthrough_slots((void**)pEngineDllFunctions, (void**)&gFunctionTable, (void**)GameDLL.funcs.dllapi_table,
+				e_api_dllapi, sizeof(dllapi_info_t) / sizeof(api_info_t) - 1,
+				dllapi_always_wrapped, sizeof(dllapi_always_wrapped) / sizeof(dllapi_always_wrapped[0]));
+	}
+	if(pEngineNewDllFunctions) {
+		set_passthrough_slots((void**)pEngineNewDllFunctions, (void**)&sNewFunctionTable, (void**)GameDLL.funcs.newapi_table,
+				e_api_newapi, sizeof(newapi_info_t) / sizeof(api_info_t) - 1,
+				newapi_always_wrapped, sizeof(newapi_always_wrapped) / sizeof(newapi_always_wrapped[0]));
+	}
+}
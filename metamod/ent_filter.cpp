@@ -0,0 +1,280 @@
+/*
+ * Copyright (c) 2004-2006 Jussi Kivilinna
+ *
+ *    This file is part of "Metamod All-Mod-Support"-patch for Metamod.
+ *
+ *    Metamod is free software; you can redistribute it and/or modify it
+ *    under the terms of the GNU General Public License as published by the
+ *    Free Software Foundation; either version 2 of the License, or (at
+ *    your option) any later version.
+ *
+ *    Metamod is distributed in the hope that it will be useful, but
+ *    WITHOUT ANY WARRANTY; without even the implied warranty of
+ *    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ *    General Public License for more details.
+ *
+ *    You should have received a copy of the GNU General Public License
+ *    along with Metamod; if not, write to the Free Software Foundation,
+ *    Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+ *
+ *    In addition, as a special exception, the author gives permission to
+ *    link the code of this program with the Half-Life Game Engine ("HL
+ *    Engine") and Modified Game Libraries ("MODs") developed by Valve,
+ *    L.L.C ("Valve").  You must obey the GNU General Public License in all
+ *    respects for all of the code used other than the HL Engine and MODs
+ *    from Valve.  If you modify this file, you may extend this exception
+ *    to your version of the file, but you are not obligated to do so.  If
+ *    you do not wish to do so, delete this exception statement from your
+ *    version.
+ *
+ */
+
+#include <stddef.h>			// offsetof
+#include <stdlib.h>			// calloc
+#include <string.h>			// strncmp, memset
+
+#include <extdll.h>			// always
+
+#include "ent_filter.h"		// me
+#include "api_hook.h"		// PLUGIN_MASK_WORDS, etc
+#include "metamod.h"		// Plugins, gpGlobals
+#include "mutil.h"			// ENT_HOOK_ALL
+#include "sdk_util.h"		// INDEXENT, STRING
+#include "log_meta.h"		// META_DEBUG, etc
+#include "osdep.h"			// likely, unlikely
+
+#define MAX_ENT_RULES		512
+
+typedef struct ent_rule_s {
+	MPlugin *plugin;
+	int hooks;					// ENT_HOOK_* flags
+	char classname[64];			// empty for any; trailing '*' for prefix
+	int prefix;					// classname ends with '*'
+	int first_index;
+	int last_index;				// -1 for no limit
+} ent_rule_t;
+
+// Plugins wanting an edict, for each kind of dispatch.
+typedef struct ent_cache_s {
+	int generation;				// 0 if not computed yet
+	int serial;					// edict serialnumber when computed
+	unsigned char wanted[NUM_ENT_DISPATCH];
+	unsigned int plugins[NUM_ENT_DISPATCH][PLUGIN_MASK_WORDS];
+} ent_cache_t;
+
+static const unsigned int ent_dispatch_offsets[NUM_ENT_DISPATCH] = {
+	offsetof(DLL_FUNCTIONS, pfnThink),
+	offsetof(DLL_FUNCTIONS, pfnUse),
+	offsetof(DLL_FUNCTIONS, pfnTouch),
+	offsetof(DLL_FUNCTIONS, pfnBlocked),
+};
+
+int ent_filter_kinds = 0;
+
+static ent_rule_t ent_rules[MAX_ENT_RULES];
+static int num_ent_rules = 0;
+
+// running plugins hooking each kind, and those of them with filters
+static unsigned int hooking_plugins[NUM_ENT_DISPATCH][PLUGIN_MASK_WORDS];
+static unsigned int filtered_plugins[NUM_ENT_DISPATCH][PLUGIN_MASK_WORDS];
+
+// Cached sets are stale unless they have the current generation.
+static int ent_generation = 1;
+static ent_cache_t *ent_cache = NULL;
+static int ent_cache_size = 0;
+static edict_t *edict_base = NULL;
+
+static mBOOL DLLINTERNAL rule_matches(const ent_rule_t *rule, const char *classname, int index) {
+	if(index < rule->first_index)
+		return(mFALSE);
+	if(rule->last_index >= 0 && index > rule->last_index)
+		return(mFALSE);
+	if(!rule->classname[0])
+		return(mTRUE);
+	if(rule->prefix)
+		return(strncmp(classname, rule->classname, strlen(rule->classname)) ? mFALSE : mTRUE);
+	return(strcmp(classname, rule->classname) ? mFALSE : mTRUE);
+}
+
+static void DLLINTERNAL compute_entry(ent_cache_t *entry, edict_t *pent, int index) {
+	const char *classname;
+	const ent_rule_t *rule;
+	int kind, i, w;
+
+	classname = pent->v.classname ? STRING(pent->v.classname) : "";
+	for(kind=0; kind < NUM_ENT_DISPATCH; kind++) {
+		for(w=0; w < PLUGIN_MASK_WORDS; w++)
+			entry->plugins[kind][w] = hooking_plugins[kind][w] & ~filtered_plugins[kind][w];
+	}
+	for(i=0; i < num_ent_rules; i++) {
+		rule = &ent_rules[i];
+		if(!rule_matches(rule, classname, index))
+			continue;
+		for(kind=0; kind < NUM_ENT_DISPATCH; kind++) {
+			if((rule->hooks & (1 << kind)) && PLUGIN_MASK_TEST(hooking_plugins[kind], rule->plugin->index))
+				PLUGIN_MASK_SET(entry->plugins[kind], rule->plugin->index);
+		}
+	}
+	for(kind=0; kind < NUM_ENT_DISPATCH; kind++) {
+		entry->wanted[kind] = 0;
+		for(w=0; w < PLUGIN_MASK_WORDS; w++) {
+			if(entry->plugins[kind][w])
+				entry->wanted[kind] = 1;
+		}
+	}
+	entry->serial = pent->serialnumber;
+	entry->generation = ent_generation;
+}
+
+// Find cache entry for edict, allocating the cache on first use.
+static ent_cache_t * DLLINTERNAL get_entry(edict_t *pent, int *index) {
+	if(unlikely(!ent_cache)) {
+		if(!gpGlobals || gpGlobals->maxEntities <= 0)
+			return(NULL);
+		ent_cache = (ent_cache_t *)calloc(gpGlobals->maxEntities, sizeof(ent_cache_t));
+		if(!ent_cache) {
+			META_ERROR("Failed malloc() for entity hook filters; filters disabled");
+			return(NULL);
+		}
+		ent_cache_size = gpGlobals->maxEntities;
+	}
+	if(unlikely(!edict_base))
+		edict_base = INDEXENT(0);
+	if(!pent || !edict_base || pent < edict_base || pent - edict_base >= ent_cache_size)
+		return(NULL);
+	*index = (int)(pent - edict_base);
+	return(&ent_cache[*index]);
+}
+
+const unsigned int * DLLINTERNAL ent_filter_plugins(ent_dispatch_t kind, edict_t *pent) {
+	ent_cache_t *entry;
+	int index;
+
+	entry = get_entry(pent, &index);
+	if(unlikely(!entry)) {
+		// unknown edict; call all plugins hooking it
+		return(hooking_plugins[kind]);
+	}
+	// edict's serialnumber changes when it's freed, in case the gamedll
+	// doesn't have OnFreeEntPrivateData
+	if(unlikely(entry->generation != ent_generation || entry->serial != pent->serialnumber))
+		compute_entry(entry, pent, index);
+	return(entry->wanted[kind] ? entry->plugins[kind] : NULL);
+}
+
+void DLLINTERNAL ent_filter_spawned(edict_t *pent) {
+	ent_cache_t *entry;
+	int index;
+
+	if(!ent_filter_kinds)
+		return;
+	entry = get_entry(pent, &index);
+	if(entry)
+		compute_entry(entry, pent, index);
+}
+
+void DLLINTERNAL ent_filter_freed(edict_t *pent) {
+	ent_cache_t *entry;
+	int index;
+
+	if(!ent_cache)
+		return;
+	entry = get_entry(pent, &index);
+	if(entry)
+		entry->generation = 0;
+}
+
+void DLLINTERNAL ent_filter_new_map(void) {
+	edict_base = NULL;
+	ent_generation++;
+}
+
+mBOOL DLLINTERNAL ent_filter_add(MPlugin *plug, int hooks, const char *classname, int first_index, int last_index) {
+	ent_rule_t *rule;
+	int len;
+
+	hooks &= ENT_HOOK_ALL;
+	if(!hooks || first_index < 0 || (last_index >= 0 && last_index < first_index))
+		RETURN_ERRNO(mFALSE, ME_ARGUMENT);
+	if(!classname)
+		classname = "";
+	len = strlen(classname);
+	if(len >= (int)sizeof(rule->classname))
+		RETURN_ERRNO(mFALSE, ME_ARGUMENT);
+	if(num_ent_rules >= MAX_ENT_RULES) {
+		META_WARNING("Too many entity hook filters; plugin '%s' gets all entities", plug->desc);
+		RETURN_ERRNO(mFALSE, ME_MAXREACHED);
+	}
+
+	rule = &ent_rules[num_ent_rules++];
+	rule->plugin = plug;
+	rule->hooks = hooks;
+	strcpy(rule->classname, classname);
+	rule->prefix = 0;
+	if(len > 0 && classname[len - 1] == '*') {
+		rule->classname[len - 1] = '\0';
+		rule->prefix = 1;
+	}
+	rule->first_index = first_index;
+	rule->last_index = last_index;
+	META_DEBUG(4, ("Plugin '%s' filters entity hooks 0x%x to '%s' [%d,%d]", plug->desc, hooks, classname, first_index, last_index));
+
+	ent_filter_update();
+	return(mTRUE);
+}
+
+mBOOL DLLINTERNAL ent_filter_clear(MPlugin *plug, int hooks) {
+	int i, n;
+
+	n = 0;
+	for(i=0; i < num_ent_rules; i++) {
+		if(ent_rules[i].plugin == plug) {
+			ent_rules[i].hooks &= ~hooks;
+			if(!ent_rules[i].hooks)
+				continue;
+		}
+		ent_rules[n++] = ent_rules[i];
+	}
+	num_ent_rules = n;
+
+	ent_filter_update();
+	return(mTRUE);
+}
+
+void DLLINTERNAL ent_filter_remove_plugin(MPlugin *plug) {
+	ent_filter_clear(plug, ENT_HOOK_ALL);
+}
+
+void DLLINTERNAL ent_filter_update(void) {
+	MPlugin *iplug;
+	int i, post, kind, w;
+
+	memset(hooking_plugins, 0, sizeof(hooking_plugins));
+	memset(filtered_plugins, 0, sizeof(filtered_plugins));
+	for(i=0; Plugins && i < Plugins->endlist; i++) {
+		iplug=&Plugins->plist[i];
+		if(iplug->status != PL_RUNNING)
+			continue;
+		for(post=0; post < 2; post++) {
+			for(kind=0; kind < NUM_ENT_DISPATCH; kind++) {
+				if(get_plugin_hook(iplug, post, e_api_dllapi, ent_dispatch_offsets[kind]))
+					PLUGIN_MASK_SET(hooking_plugins[kind], iplug->index);
+			}
+		}
+	}
+	for(i=0; i < num_ent_rules; i++) {
+		for(kind=0; kind < NUM_ENT_DISPATCH; kind++) {
+			if(ent_rules[i].hooks & (1 << kind))
+				PLUGIN_MASK_SET(filtered_plugins[kind], ent_rules[i].plugin->index);
+		}
+	}
+
+	ent_filter_kinds = 0;
+	for(kind=0; kind < NUM_ENT_DISPATCH; kind++) {
+		for(w=0; w < PLUGIN_MASK_WORDS; w++) {
+			if(hooking_plugins[kind][w] & filtered_plugins[kind][w])
+				ent_filter_kinds |= 1 << kind;
+		}
+	}
+	ent_generation++;
+}
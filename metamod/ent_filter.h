@@ -0,0 +1,78 @@
+/*
+ * Copyright (c) 2004-2006 Jussi Kivilinna
+ *
+ *    This file is part of "Metamod All-Mod-Support"-patch for Metamod.
+ *
+ *    Metamod is free software; you can redistribute it and/or modify it
+ *    under the terms of the GNU General Public License as published by the
+ *    Free Software Foundation; either version 2 of the License, or (at
+ *    your option) any later version.
+ *
+ *    Metamod is distributed in the hope that it will be useful, but
+ *    WITHOUT ANY WARRANTY; without even the implied warranty of
+ *    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ *    General Public License for more details.
+ *
+ *    You should have received a copy of the GNU General Public License
+ *    along with Metamod; if not, write to the Free Software Foundation,
+ *    Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+ *
+ *    In addition, as a special exception, the author gives permission to
+ *    link the code of this program with the Half-Life Game Engine ("HL
+ *    Engine") and Modified Game Libraries ("MODs") developed by Valve,
+ *    L.L.C ("Valve").  You must obey the GNU General Public License in all
+ *    respects for all of the code used other than the HL Engine and MODs
+ *    from Valve.  If you modify this file, you may extend this exception
+ *    to your version of the file, but you are not obligated to do so.  If
+ *    you do not wish to do so, delete this exception statement from your
+ *    version.
+ *
+ */
+
+#ifndef ENT_FILTER_H
+#define ENT_FILTER_H
+
+#include <extdll.h>			// edict_t
+
+#include "comp_dep.h"
+#include "types_meta.h"		// mBOOL
+#include "mplugin.h"		// MPlugin
+
+// Entity-filtered dispatch of Think/Use/Touch/Blocked.
+//
+// Plugins can limit their hooks of these to some entities, by classname
+// or entity index, with ADD_ENT_HOOK_FILTER.  For each edict we keep the
+// set of plugins wanting it, computed at DispatchSpawn (or, for entities
+// the gamedll spawns itself, on first dispatch) and dropped when the
+// edict is freed, so plugins not wanting an entity aren't called for it.
+// Plugins without filters get all entities, as usual.
+
+// Dispatch routines that can be filtered; bit n of the ENT_HOOK_* flags
+// in mutil.h is kind n.
+typedef enum {
+	ENT_DISPATCH_THINK = 0,
+	ENT_DISPATCH_USE,
+	ENT_DISPATCH_TOUCH,
+	ENT_DISPATCH_BLOCKED,
+	NUM_ENT_DISPATCH,
+} ent_dispatch_t;
+
+// Bit for each kind some running plugin hooking it has filters for.
+extern int ent_filter_kinds DLLHIDDEN;
+
+// plugins to call for kind of dispatch to edict; NULL if none
+const unsigned int * DLLINTERNAL ent_filter_plugins(ent_dispatch_t kind, edict_t *pent);
+
+void DLLINTERNAL ent_filter_spawned(edict_t *pent);
+void DLLINTERNAL ent_filter_freed(edict_t *pent);
+// edicts are reallocated for each map
+void DLLINTERNAL ent_filter_new_map(void);
+
+mBOOL DLLINTERNAL ent_filter_add(MPlugin *plug, int hooks, const char *classname, int first_index, int last_index);
+mBOOL DLLINTERNAL ent_filter_clear(MPlugin *plug, int hooks);
+void DLLINTERNAL ent_filter_remove_plugin(MPlugin *plug);
+
+// recheck plugins' hooks and filters; called when hook lists are rebuilt
+void DLLINTERNAL ent_filter_update(void);
+
+#endif /* ENT_FILTER_H */
@@ -0,0 +1,297 @@
+/*
+ * Copyright (c) 2004-2006 Jussi Kivilinna
+ *
+ *    This file is part of "Metamod All-Mod-Support"-patch for Metamod.
+ *
+ *    Metamod is free software; you can redistribute it and/or modify it
+ *    under the terms of the GNU General Public License as published by the
+ *    Free Software Foundation; either version 2 of the License, or (at
+ *    your option) any later version.
+ *
+ *    Metamod is distributed in the hope that it will be useful, but
+ *    WITHOUT ANY WARRANTY; without even the implied warranty of
+ *    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ *    General Public License for more details.
+ *
+ *    You should have received a copy of the GNU General Public License
+ *    along with Metamod; if not, write to the Free Software Foundation,
+ *    Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+ *
+ *    In addition, as a special exception, the author gives permission to
+ *    link the code of this program with the Half-Life Game Engine ("HL
+ *    Engine") and Modified Game Libraries ("MODs") developed by Valve,
+ *    L.L.C ("Valve").  You must obey the GNU General Public License in all
+ *    respects for all of the code used other than the HL Engine and MODs
+ *    from Valve.  If you modify this file, you may extend this exception
+ *    to your version of the file, but you are not obligated to do so.  If
+ *    you do not wish to do so, delete this exception statement from your
+ *    version.
+ *
+ */
+
+#include <string.h>			// strrchr, strerror
+#include <errno.h>			// errno
+#include <time.h>			// time
+#ifdef linux
+	#include <sys/inotify.h>	// inotify_init1, etc
+	#include <unistd.h>			// read
+#endif
+
+#include <extdll.h>			// always
+
+#include "file_watch.h"		// me
+#include "metamod.h"		// Plugins, Config, meta_reload_config
+#include "mlist.h"			// MAX_PLUGINS, etc
+#include "mplugin.h"		// MPlugin
+#include "log_meta.h"		// META_LOG, etc
+#include "support_meta.h"	// STRNCPY, strmatch
+
+#ifdef linux
+
+// Slots in the watch table; plugins go by their (1-based) index.
+#define FWATCH_INI			0
+#define FWATCH_CFG			1
+#define FWATCH_PLUGIN(i)	(1 + (i))
+#define FWATCH_NUM			(MAX_PLUGINS + 2)
+
+// Written, replaced, touched or removed.
+#define FWATCH_MASK		(IN_CLOSE_WRITE | IN_MOVED_TO | IN_ATTRIB | IN_DELETE | IN_MOVED_FROM)
+
+typedef struct fwatch_file_s {
+	mBOOL used;
+	int wd;						// watch on the directory, or -1
+	char dir[PATH_MAX];
+	char name[NAME_MAX+1];
+	mBOOL changed;				// since loaded / last refresh
+} fwatch_file_t;
+
+static int fwatch_fd = -1;
+static fwatch_file_t fwatch_files[FWATCH_NUM];
+static mBOOL fwatch_queued = mFALSE;
+static time_t fwatch_last_read = 0;
+
+static void DLLINTERNAL fwatch_add(int slot, const char *path) {
+	fwatch_file_t *wf = &fwatch_files[slot];
+	char *cp;
+
+	wf->used=mTRUE;
+	wf->wd=-1;
+	wf->changed=mFALSE;
+	STRNCPY(wf->dir, path, sizeof(wf->dir));
+	if((cp=strrchr(wf->dir, '/')) == nullptr) {
+		META_WARNING("Not watching '%s'; not a full pathname", path);
+		return;
+	}
+	STRNCPY(wf->name, cp+1, sizeof(wf->name));
+	if(cp==wf->dir)
+		cp++;
+	*cp='\0';
+
+	// Directories shared by several files give the same watch.
+	if((wf->wd=inotify_add_watch(fwatch_fd, wf->dir, FWATCH_MASK)) < 0)
+		META_WARNING("Couldn't watch '%s' for changes: %s", wf->dir, strerror(errno));
+	else
+		META_DEBUG(4, ("Watching '%s' in '%s' (wd %d)", wf->name, wf->dir, wf->wd));
+}
+
+static void DLLINTERNAL fwatch_remove(int slot) {
+	fwatch_file_t *wf = &fwatch_files[slot];
+	int wd, i;
+
+	wd=wf->wd;
+	wf->used=mFALSE;
+	wf->wd=-1;
+	if(wd < 0)
+		return;
+	for(i=0; i < FWATCH_NUM; i++) {
+		if(fwatch_files[i].used && fwatch_files[i].wd==wd)
+			return;
+	}
+	inotify_rm_watch(fwatch_fd, wd);
+}
+
+static void DLLINTERNAL fwatch_changed(int slot) {
+	fwatch_file_t *wf = &fwatch_files[slot];
+	const char *when;
+	MPlugin *plug;
+
+	if(wf->changed)
+		return;
+	wf->changed=mTRUE;
+	fwatch_queued=mTRUE;
+
+	when = Config->watch_autoapply ? "refreshing at next map change" : "use 'meta refresh' to apply";
+	if(slot==FWATCH_INI)
+		META_LOG("Plugins file changed: %s/%s; %s", wf->dir, wf->name, when);
+	else if(slot==FWATCH_CFG)
+		META_LOG("Config file changed: %s/%s; %s", wf->dir, wf->name, when);
+	else if((plug=Plugins->find(slot - 1)) != nullptr)
+		META_LOG("dll: File of plugin '%s' changed on disk; %s", plug->desc, when);
+}
+
+void DLLINTERNAL fwatch_start(const char *inifile, const char *cfgfile) {
+	int i;
+
+	if(!Config->watch_files || fwatch_fd >= 0)
+		return;
+	if((fwatch_fd=inotify_init1(IN_NONBLOCK | IN_CLOEXEC)) < 0) {
+		META_WARNING("Couldn't watch files for changes: %s; checking them at each map change", strerror(errno));
+		return;
+	}
+
+	if(inifile)
+		fwatch_add(FWATCH_INI, inifile);
+	if(cfgfile) {
+		fwatch_add(FWATCH_CFG, cfgfile);
+		// config.ini is optional, so rather than checking it at every
+		// map change, just don't notice edits to it.
+		if(fwatch_files[FWATCH_CFG].wd < 0)
+			fwatch_files[FWATCH_CFG].used=mFALSE;
+	}
+	for(i=0; i < Plugins->endlist; i++) {
+		if(Plugins->plist[i].status >= PL_RUNNING)
+			fwatch_add_plugin(&Plugins->plist[i]);
+	}
+}
+
+mBOOL DLLINTERNAL fwatch_active(void) {
+	return(fwatch_fd >= 0 ? mTRUE : mFALSE);
+}
+
+void DLLINTERNAL fwatch_add_plugin(MPlugin *plug) {
+	if(fwatch_fd < 0)
+		return;
+	if(fwatch_files[FWATCH_PLUGIN(plug->index)].used)
+		fwatch_remove(FWATCH_PLUGIN(plug->index));
+	fwatch_add(FWATCH_PLUGIN(plug->index), plug->pathname);
+}
+
+void DLLINTERNAL fwatch_remove_plugin(MPlugin *plug) {
+	if(fwatch_fd < 0 || !fwatch_files[FWATCH_PLUGIN(plug->index)].used)
+		return;
+	fwatch_remove(FWATCH_PLUGIN(plug->index));
+}
+
+mBOOL DLLINTERNAL fwatch_plugin_unchanged(MPlugin *plug) {
+	fwatch_file_t *wf;
+
+	if(fwatch_fd < 0)
+		return(mFALSE);
+	wf=&fwatch_files[FWATCH_PLUGIN(plug->index)];
+	return(wf->used && wf->wd >= 0 && !wf->changed ? mTRUE : mFALSE);
+}
+
+void DLLINTERNAL fwatch_drain(void) {
+	char buf[4096] __attribute__((aligned(__alignof__(struct inotify_event))));
+	const struct inotify_event *ev;
+	ssize_t len;
+	char *cp;
+	int i;
+
+	if(fwatch_fd < 0)
+		return;
+	while((len=read(fwatch_fd, buf, sizeof(buf))) > 0) {
+		for(cp=buf; cp < buf + len; cp += sizeof(struct inotify_event) + ev->len) {
+			ev=(const struct inotify_event *) cp;
+			if(ev->mask & IN_Q_OVERFLOW) {
+				// lost events; assume everything changed
+				META_DEBUG(2, ("File watch queue overflowed"));
+				for(i=0; i < FWATCH_NUM; i++) {
+					if(fwatch_files[i].used)
+						fwatch_changed(i);
+				}
+				continue;
+			}
+			for(i=0; i < FWATCH_NUM; i++) {
+				if(!fwatch_files[i].used || fwatch_files[i].wd != ev->wd)
+					continue;
+				if(ev->mask & IN_IGNORED) {
+					// directory gone; back to stat'ing at each map change
+					fwatch_files[i].wd=-1;
+					fwatch_changed(i);
+				}
+				else if(ev->len && strmatch(fwatch_files[i].name, ev->name))
+					fwatch_changed(i);
+			}
+		}
+	}
+}
+
+void DLLINTERNAL fwatch_frame(void) {
+	time_t now;
+
+	if(fwatch_fd < 0)
+		return;
+	// A second's delay is nothing for a deployment, and saves a syscall
+	// every frame.
+	now=time(NULL);
+	if(now==fwatch_last_read)
+		return;
+	fwatch_last_read=now;
+	fwatch_drain();
+}
+
+mBOOL DLLINTERNAL fwatch_pending(void) {
+	int i;
+
+	if(fwatch_fd < 0 || fwatch_queued)
+		return(mTRUE);
+	// Files we couldn't watch have to be checked every time.
+	for(i=0; i < FWATCH_NUM; i++) {
+		if(fwatch_files[i].used && fwatch_files[i].wd < 0)
+			return(mTRUE);
+	}
+	return(mFALSE);
+}
+
+mBOOL DLLINTERNAL fwatch_apply(PLUG_LOADTIME now) {
+	fwatch_file_t *wf = &fwatch_files[FWATCH_CFG];
+	char cfgfile[PATH_MAX];
+
+	// changes from since the last frame's read, too
+	fwatch_drain();
+	if(wf->used && wf->changed) {
+		safevoid_snprintf(cfgfile, sizeof(cfgfile), "%s/%s", wf->dir, wf->name);
+		meta_reload_config(cfgfile);
+	}
+	fwatch_files[FWATCH_INI].changed=mFALSE;
+	fwatch_files[FWATCH_CFG].changed=mFALSE;
+	fwatch_queued=mFALSE;
+	// Changed plugin files are forgotten as the plugins are reloaded.
+	return(Plugins->refresh(now));
+}
+
+#else /* linux */
+
+void DLLINTERNAL fwatch_start(const char * /*inifile*/, const char * /*cfgfile*/) {
+}
+
+mBOOL DLLINTERNAL fwatch_active(void) {
+	return(mFALSE);
+}
+
+void DLLINTERNAL fwatch_add_plugin(MPlugin * /*plug*/) {
+}
+
+void DLLINTERNAL fwatch_remove_plugin(MPlugin * /*plug*/) {
+}
+
+mBOOL DLLINTERNAL fwatch_plugin_unchanged(MPlugin * /*plug*/) {
+	return(mFALSE);
+}
+
+void DLLINTERNAL fwatch_drain(void) {
+}
+
+void DLLINTERNAL fwatch_frame(void) {
+}
+
+mBOOL DLLINTERNAL fwatch_pending(void) {
+	return(mTRUE);
+}
+
+mBOOL DLLINTERNAL fwatch_apply(PLUG_LOADTIME now) {
+	return(Plugins->refresh(now));
+}
+
+#endif /* linux */
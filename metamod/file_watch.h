@@ -0,0 +1,82 @@
+/*
+ * Copyright (c) 2004-2006 Jussi Kivilinna
+ *
+ *    This file is part of "Metamod All-Mod-Support"-patch for Metamod.
+ *
+ *    Metamod is free software; you can redistribute it and/or modify it
+ *    under the terms of the GNU General Public License as published by the
+ *    Free Software Foundation; either version 2 of the License, or (at
+ *    your option) any later version.
+ *
+ *    Metamod is distributed in the hope that it will be useful, but
+ *    WITHOUT ANY WARRANTY; without even the implied warranty of
+ *    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ *    General Public License for more details.
+ *
+ *    You should have received a copy of the GNU General Public License
+ *    along with Metamod; if not, write to the Free Software Foundation,
+ *    Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+ *
+ *    In addition, as a special exception, the author gives permission to
+ *    link the code of this program with the Half-Life Game Engine ("HL
+ *    Engine") and Modified Game Libraries ("MODs") developed by Valve,
+ *    L.L.C ("Valve").  You must obey the GNU General Public License in all
+ *    respects for all of the code used other than the HL Engine and MODs
+ *    from Valve.  If you modify this file, you may extend this exception
+ *    to your version of the file, but you are not obligated to do so.  If
+ *    you do not wish to do so, delete this exception statement from your
+ *    version.
+ *
+ */
+
+#ifndef FILE_WATCH_H
+#define FILE_WATCH_H
+
+#include "types_meta.h"		// mBOOL
+#include "osdep.h"			// DLLINTERNAL
+#include "plinfo.h"			// PLUG_LOADTIME
+
+class MPlugin;
+
+// Change detection for plugins.ini, config.ini and the files of loaded
+// plugins, so a map change doesn't have to re-read and stat everything to
+// notice a deployment.
+//
+// On linux this uses inotify.  The directories holding the files are
+// watched, rather than the files, so that a file replaced by rename (the
+// usual way to deploy) is still noticed.  Events are read from StartFrame,
+// at most once a second, and at each map change, and queue a refresh; it's
+// applied at the next map change if "watch_autoapply" is set, or by "meta
+// refresh".
+//
+// Where there's no watch (other platforms, "watch_files no", or a failed
+// inotify call), everything is re-read and stat'ed at each map change, as
+// before.
+
+// Start watching plugins.ini and config.ini (either may be NULL), and any
+// plugins already running.
+void DLLINTERNAL fwatch_start(const char *inifile, const char *cfgfile);
+mBOOL DLLINTERNAL fwatch_active(void);
+
+// Watch/unwatch a plugin's file, as it's loaded and unloaded.  Adding also
+// forgets earlier changes to the file.
+void DLLINTERNAL fwatch_add_plugin(MPlugin *plug);
+void DLLINTERNAL fwatch_remove_plugin(MPlugin *plug);
+
+// Whether the plugin's file is known unchanged since it was loaded, so
+// there's no need to stat it.
+mBOOL DLLINTERNAL fwatch_plugin_unchanged(MPlugin *plug);
+
+// Read pending change events.  Main thread only.
+void DLLINTERNAL fwatch_drain(void);
+// Same, at most once a second; called every StartFrame.
+void DLLINTERNAL fwatch_frame(void);
+
+// Whether changes are queued for the next refresh.
+mBOOL DLLINTERNAL fwatch_pending(void);
+
+// Apply queued changes, after reading any pending events: re-read
+// config.ini if it changed, and refresh plugins from plugins.ini.
+mBOOL DLLINTERNAL fwatch_apply(PLUG_LOADTIME now);
+
+#endif /* FILE_WATCH_H */
@@ -34,15 +34,161 @@
  *
  */
 
+#include <sys/stat.h>				// stat
+#include <stdio.h>				// rename
+
 #include <extdll.h>				// always
 #include "osdep_p.h"				// is_gamedll, ...
 #include "game_autodetect.h"			// me
 #include "support_meta.h"			// full_gamedir_path,
+#include "log_meta.h"				// META_DEBUG, etc
+
+
+// Results of is_gamedll() are kept in AUTODETECT_CACHE between runs, so
+// restarts don't map and scan every library in dlls/ again.  An entry is
+// used only while the file's size, mtime, inode and build-id (where the
+// format has one) all still match.
+#define AUTODETECT_CACHE_HEADER	"# metamod gamedll autodetect cache v1; safe to delete"
+#define MAX_AUTODETECT_CACHE	64
+#define BUILD_ID_HEX_MAX		132
+
+typedef struct autodetect_cache_entry_s {
+	char path[256];
+	long long size;
+	long long mtime;
+	long long inode;
+	char build_id[BUILD_ID_HEX_MAX];
+	int is_gamedll;
+	int used;			// looked up this run; others are dropped on save
+} autodetect_cache_entry_t;
+
+static autodetect_cache_entry_t autodetect_cache[MAX_AUTODETECT_CACHE];
+static int num_autodetect_cache;
+static mBOOL autodetect_cache_dirty;
+
+static void DLLINTERNAL load_autodetect_cache(const gamedll_t *gamedll) {
+	autodetect_cache_entry_t *entry;
+	char path[PATH_MAX];
+	char line[512];
+	char *cp;
+	FILE *fp;
+	int len;
+
+	num_autodetect_cache = 0;
+	autodetect_cache_dirty = mFALSE;
+
+	safevoid_snprintf(path, sizeof(path), "%s/%s", gamedll->gamedir, AUTODETECT_CACHE);
+	if(!(fp = fopen(path, "r"))) {
+		META_DEBUG(4, ("GameDLL-Autodetection: No cache '%s'.", path));
+		return;
+	}
+	if(fgets(line, sizeof(line), fp))
+		line[strcspn(line, "\r\n")] = '\0';
+	else
+		line[0] = '\0';
+	if(!strmatch(line, AUTODETECT_CACHE_HEADER)) {
+		META_DEBUG(4, ("GameDLL-Autodetection: Ignoring cache '%s' of other version.", path));
+		fclose(fp);
+		return;
+	}
+	while(num_autodetect_cache < MAX_AUTODETECT_CACHE && fgets(line, sizeof(line), fp)) {
+		entry = &autodetect_cache[num_autodetect_cache];
+		len = 0;
+		if(sscanf(line, "%d %lld %lld %lld %131s %n", &entry->is_gamedll, &entry->size,
+				&entry->mtime, &entry->inode, entry->build_id, &len) < 5 || !len)
+			continue;
+		cp = line + len;
+		cp[strcspn(cp, "\r\n")] = '\0';
+		if(!*cp)
+			continue;
+		STRNCPY(entry->path, cp, sizeof(entry->path));
+		entry->used = 0;
+		num_autodetect_cache++;
+	}
+	fclose(fp);
+	META_DEBUG(4, ("GameDLL-Autodetection: Read %d entries from cache '%s'.", num_autodetect_cache, path));
+}
+
+static void DLLINTERNAL save_autodetect_cache(const gamedll_t *gamedll) {
+	char path[PATH_MAX];
+	char tmppath[PATH_MAX];
+	FILE *fp;
+	int i;
+
+	if(!autodetect_cache_dirty)
+		return;
+
+	// Write aside and rename, so a crash never leaves half a file.
+	safevoid_snprintf(path, sizeof(path), "%s/%s", gamedll->gamedir, AUTODETECT_CACHE);
+	safevoid_snprintf(tmppath, sizeof(tmppath), "%s.tmp", path);
+	if(!(fp = fopen(tmppath, "w"))) {
+		// read-only gamedir is fine; we just scan again next time
+		META_DEBUG(4, ("GameDLL-Autodetection: Couldn't write cache '%s': %s", tmppath, str_os_error()));
+		return;
+	}
+	fprintf(fp, "%s\n", AUTODETECT_CACHE_HEADER);
+	for(i=0; i < num_autodetect_cache; i++) {
+		if(!autodetect_cache[i].used)
+			continue;
+		fprintf(fp, "%d %lld %lld %lld %s %s\n", autodetect_cache[i].is_gamedll,
+				autodetect_cache[i].size, autodetect_cache[i].mtime, autodetect_cache[i].inode,
+				autodetect_cache[i].build_id, autodetect_cache[i].path);
+	}
+	if(fclose(fp) != 0 || rename(tmppath, path) != 0) {
+		META_DEBUG(4, ("GameDLL-Autodetection: Couldn't write cache '%s': %s", path, str_os_error()));
+		unlink(tmppath);
+		return;
+	}
+	autodetect_cache_dirty = mFALSE;
+	META_DEBUG(4, ("GameDLL-Autodetection: Wrote cache '%s'.", path));
+}
+
+// is_gamedll(), answered from the cache when the file is unchanged.
+static mBOOL DLLINTERNAL cached_is_gamedll(const char *filename) {
+	autodetect_cache_entry_t *entry = 0;
+	char build_id[BUILD_ID_HEX_MAX];
+	struct stat st;
+	mBOOL result;
+	int i;
+
+	if(stat(filename, &st) != 0)
+		return(is_gamedll(filename));
+	if(!get_dll_build_id(filename, build_id, sizeof(build_id)))
+		STRNCPY(build_id, "-", sizeof(build_id));
 
+	for(i=0; i < num_autodetect_cache; i++) {
+		if(strmatch(autodetect_cache[i].path, filename)) {
+			entry = &autodetect_cache[i];
+			break;
+		}
+	}
+	if(entry && entry->size == (long long)st.st_size && entry->mtime == (long long)st.st_mtime &&
+	   entry->inode == (long long)st.st_ino && strmatch(entry->build_id, build_id))
+	{
+		entry->used = 1;
+		META_DEBUG(8, ("is_gamedll(%s): cached %s.", filename, entry->is_gamedll ? "ok" : "failed"));
+		return(entry->is_gamedll ? mTRUE : mFALSE);
+	}
+
+	result = is_gamedll(filename);
+
+	if(!entry && num_autodetect_cache < MAX_AUTODETECT_CACHE)
+		entry = &autodetect_cache[num_autodetect_cache++];
+	if(entry) {
+		STRNCPY(entry->path, filename, sizeof(entry->path));
+		entry->size = st.st_size;
+		entry->mtime = st.st_mtime;
+		entry->inode = st.st_ino;
+		STRNCPY(entry->build_id, build_id, sizeof(entry->build_id));
+		entry->is_gamedll = result ? 1 : 0;
+		entry->used = 1;
+		autodetect_cache_dirty = mTRUE;
+	}
+	return(result);
+}
 
 // Search gamedir/dlls/*.dll for gamedlls
-//TODO: add META_DEBUG
-const char * DLLINTERNAL autodetect_gamedll(const gamedll_t *gamedll, const char *knownfn)
+static const char * DLLINTERNAL search_gamedlls(const gamedll_t *gamedll, const char *knownfn)
 {
 	static char buf[256];
 	char dllpath[256];
@@ -63,7 +209,7 @@ const char * DLLINTERNAL autodetect_gamedll(const gamedll_t *gamedll, const char
 	safevoid_snprintf(fnpath, sizeof(fnpath), "%s/%s", dllpath, knownfn);
 	
 	// Check if knownfn exists and is valid gamedll
-	if(is_gamedll(fnpath)) {
+	if(cached_is_gamedll(fnpath)) {
 		// knownfn exists and is loadable gamedll, return 0.
 		return(0);
 	}
@@ -111,7 +257,7 @@ const char * DLLINTERNAL autodetect_gamedll(const gamedll_t *gamedll, const char
 		safevoid_snprintf(fnpath, sizeof(fnpath), "%s/%s", dllpath, ent->d_name);
 		
 		// Check if dll is gamedll
-		if(is_gamedll(fnpath)) {
+		if(cached_is_gamedll(fnpath)) {
 			META_DEBUG(8, ("is_gamedll(%s): ok.", fnpath));
 			//gamedll detected
 			STRNCPY(buf, ent->d_name, sizeof(buf));
@@ -128,3 +274,14 @@ const char * DLLINTERNAL autodetect_gamedll(const gamedll_t *gamedll, const char
 	return(0);
 }
 
+
+const char * DLLINTERNAL autodetect_gamedll(const gamedll_t *gamedll, const char *knownfn)
+{
+	const char *fn;
+
+	load_autodetect_cache(gamedll);
+	fn = search_gamedlls(gamedll, knownfn);
+	save_autodetect_cache(gamedll);
+
+	return(fn);
+}
@@ -49,6 +49,10 @@
 //Initializes replacement code
 int DLLINTERNAL init_linkent_replacement(DLHANDLE moduleMetamod, DLHANDLE moduleGame);
 
+//Finds exported entity function in game dll, without going through dlsym
+//where possible
+void * DLLINTERNAL lookup_game_entity(const char *entStr);
+
 
 // Comments from SDK dlls/util.h:
 //! This is the glue that hooks .MAP entity class names to our CPP classes.
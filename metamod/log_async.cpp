@@ -0,0 +1,255 @@
+/*
+ * Copyright (c) 2004-2006 Jussi Kivilinna
+ *
+ *    This file is part of "Metamod All-Mod-Support"-patch for Metamod.
+ *
+ *    Metamod is free software; you can redistribute it and/or modify it
+ *    under the terms of the GNU General Public License as published by the
+ *    Free Software Foundation; either version 2 of the License, or (at
+ *    your option) any later version.
+ *
+ *    Metamod is distributed in the hope that it will be useful, but
+ *    WITHOUT ANY WARRANTY; without even the implied warranty of
+ *    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ *    General Public License for more details.
+ *
+ *    You should have received a copy of the GNU General Public License
+ *    along with Metamod; if not, write to the Free Software Foundation,
+ *    Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+ *
+ *    In addition, as a special exception, the author gives permission to
+ *    link the code of this program with the Half-Life Game Engine ("HL
+ *    Engine") and Modified Game Libraries ("MODs") developed by Valve,
+ *    L.L.C ("Valve").  You must obey the GNU General Public License in all
+ *    respects for all of the code used other than the HL Engine and MODs
+ *    from Valve.  If you modify this file, you may extend this exception
+ *    to your version of the file, but you are not obligated to do so.  If
+ *    you do not wish to do so, delete this exception statement from your
+ *    version.
+ *
+ */
+
+#include <stdio.h>			// fopen, vsnprintf, etc
+#include <string.h>			// strlen, strerror
+#include <errno.h>			// errno
+#include <time.h>			// time, localtime_r
+#include <atomic>			// std::atomic
+#include <chrono>			// std::chrono::milliseconds
+#include <thread>			// std::thread, std::this_thread
+
+#include <extdll.h>			// always
+#include "enginecallbacks.h"	// ALERT
+
+#include "log_async.h"		// me
+#include "log_meta.h"		// MAX_LOGMSG_LEN
+#include "osdep.h"			// win32 vsnprintf, etc
+#include "support_meta.h"	// STRNCPY
+
+#define LOG_ASYNC_RING_MASK		(LOG_ASYNC_RING_SIZE - 1)
+
+// How long the writer sleeps when there's nothing to write.
+#define LOG_ASYNC_WRITER_SLEEP_MS	10
+
+typedef struct log_rec_s {
+	// position + 1 once the record is filled in
+	std::atomic<unsigned int> seq;
+	ALERT_TYPE atype;
+	time_t time;
+	char text[MAX_LOGMSG_LEN];		// prefix and message, no newline
+} log_rec_t;
+
+volatile mBOOL log_async_active = mFALSE;
+
+static log_rec_t log_ring[LOG_ASYNC_RING_SIZE];
+
+// Records are claimed at head; the engine console and the file writer
+// each read at their own tail.  A record can be reused once both have
+// passed it.
+static std::atomic<unsigned int> log_head(0);
+static std::atomic<unsigned int> console_tail(0);
+static std::atomic<unsigned int> file_tail(0);
+static std::atomic<bool> file_enabled(false);
+
+static std::atomic<unsigned int> log_dropped(0);
+static unsigned int console_dropped_shown = 0;
+
+static std::thread *writer_thread = NULL;
+static std::atomic<bool> writer_stop(false);
+static FILE *log_fp = NULL;
+static char log_path[PATH_MAX];
+static unsigned long log_maxsize = 0;
+static unsigned long log_size = 0;
+
+static inline unsigned int DLLINTERNAL oldest_tail(void) {
+	unsigned int ctail = console_tail.load(std::memory_order_acquire);
+	unsigned int ftail;
+
+	if(!file_enabled.load(std::memory_order_relaxed))
+		return(ctail);
+	ftail = file_tail.load(std::memory_order_acquire);
+	// the one further behind, allowing for wraparound
+	return(ctail - ftail <= LOG_ASYNC_RING_SIZE ? ftail : ctail);
+}
+
+mBOOL DLLINTERNAL log_async_push(ALERT_TYPE atype, const char *prefix, const char *fmt, va_list ap) {
+	unsigned int pos;
+	log_rec_t *rec;
+	int len;
+
+	pos = log_head.load(std::memory_order_relaxed);
+	do {
+		if(pos - oldest_tail() >= LOG_ASYNC_RING_SIZE) {
+			log_dropped.fetch_add(1, std::memory_order_relaxed);
+			return(mFALSE);
+		}
+	} while(!log_head.compare_exchange_weak(pos, pos + 1, std::memory_order_relaxed));
+
+	rec = &log_ring[pos & LOG_ASYNC_RING_MASK];
+	rec->atype = atype;
+	rec->time = time(NULL);
+	len = safe_snprintf(rec->text, sizeof(rec->text), "%s ", prefix);
+	if(len < 0 || len >= (int)sizeof(rec->text))
+		len = 0;
+	safevoid_vsnprintf(rec->text + len, sizeof(rec->text) - len, fmt, ap);
+	rec->seq.store(pos + 1, std::memory_order_release);
+	return(mTRUE);
+}
+
+void DLLINTERNAL log_async_flush_console(void) {
+	static mBOOL flushing = mFALSE;
+	unsigned int tail, dropped;
+	log_rec_t *rec;
+
+	// ALERT could end up logging through us again
+	if(flushing)
+		return;
+	flushing = mTRUE;
+
+	tail = console_tail.load(std::memory_order_relaxed);
+	for(;;) {
+		rec = &log_ring[tail & LOG_ASYNC_RING_MASK];
+		if(rec->seq.load(std::memory_order_acquire) != tail + 1)
+			break;
+		ALERT(rec->atype, "%s\n", rec->text);
+		console_tail.store(++tail, std::memory_order_release);
+	}
+
+	dropped = log_dropped.load(std::memory_order_relaxed);
+	if(dropped != console_dropped_shown) {
+		ALERT(at_logged, "[META] WARNING: Dropped %u log messages; log queue full\n", 
+				dropped - console_dropped_shown);
+		console_dropped_shown = dropped;
+	}
+
+	flushing = mFALSE;
+}
+
+unsigned int DLLINTERNAL log_async_dropped(void) {
+	return(log_dropped.load(std::memory_order_relaxed));
+}
+
+// Move the full log file aside as "<file>.1", replacing an older one.
+static void DLLINTERNAL rotate_log_file(void) {
+	char oldpath[PATH_MAX + 2];
+
+	fclose(log_fp);
+	safevoid_snprintf(oldpath, sizeof(oldpath), "%s.1", log_path);
+	remove(oldpath);
+	rename(log_path, oldpath);
+	// if this fails, records are still consumed, just not written
+	log_fp = fopen(log_path, "a");
+	log_size = 0;
+}
+
+// Write out records up to head.  Writer thread only.
+static unsigned int DLLINTERNAL write_log_records(void) {
+	char stamp[32];
+	struct tm tm;
+	unsigned int tail, count;
+	log_rec_t *rec;
+	int len;
+
+	count = 0;
+	tail = file_tail.load(std::memory_order_relaxed);
+	for(;;) {
+		rec = &log_ring[tail & LOG_ASYNC_RING_MASK];
+		if(rec->seq.load(std::memory_order_acquire) != tail + 1)
+			break;
+		if(log_fp) {
+#ifdef _WIN32
+			localtime_s(&tm, &rec->time);
+#else
+			localtime_r(&rec->time, &tm);
+#endif
+			// same timestamp format as the engine's logs
+			strftime(stamp, sizeof(stamp), "L %m/%d/%Y - %H:%M:%S: ", &tm);
+			len = fprintf(log_fp, "%s%s\n", stamp, rec->text);
+			if(len > 0)
+				log_size += len;
+		}
+		file_tail.store(++tail, std::memory_order_release);
+		count++;
+	}
+
+	if(count && log_fp) {
+		fflush(log_fp);
+		if(log_maxsize && log_size >= log_maxsize)
+			rotate_log_file();
+	}
+	return(count);
+}
+
+static void DLLINTERNAL log_writer_main(void) {
+	while(!writer_stop.load(std::memory_order_acquire)) {
+		if(!write_log_records())
+			std::this_thread::sleep_for(std::chrono::milliseconds(LOG_ASYNC_WRITER_SLEEP_MS));
+	}
+	// whatever was queued before the stop
+	write_log_records();
+}
+
+void DLLINTERNAL log_async_start(const char *logfile, int maxsize_kb) {
+	if(log_async_active)
+		return;
+
+	// nothing is queued while inactive; skip any stale records
+	console_tail.store(log_head.load());
+	file_tail.store(log_head.load());
+
+	if(logfile && logfile[0]) {
+		STRNCPY(log_path, logfile, sizeof(log_path));
+		log_fp = fopen(log_path, "a");
+		if(!log_fp)
+			META_WARNING("Couldn't open log file '%s': %s", log_path, strerror(errno));
+		else {
+			fseek(log_fp, 0, SEEK_END);
+			log_size = (unsigned long)ftell(log_fp);
+			log_maxsize = maxsize_kb > 0 ? (unsigned long)maxsize_kb * 1024 : 0;
+			writer_stop.store(false);
+			file_enabled.store(true);
+			writer_thread = new std::thread(log_writer_main);
+		}
+	}
+
+	log_async_active = mTRUE;
+	META_DEBUG(2, ("Started async logging; log file: %s", log_fp ? log_path : "none"));
+}
+
+void DLLINTERNAL log_async_stop(void) {
+	if(!log_async_active)
+		return;
+	log_async_active = mFALSE;
+
+	log_async_flush_console();
+	if(writer_thread) {
+		writer_stop.store(true, std::memory_order_release);
+		writer_thread->join();
+		delete writer_thread;
+		writer_thread = NULL;
+	}
+	file_enabled.store(false);
+	if(log_fp) {
+		fclose(log_fp);
+		log_fp = NULL;
+	}
+}
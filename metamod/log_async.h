@@ -0,0 +1,72 @@
+/*
+ * Copyright (c) 2004-2006 Jussi Kivilinna
+ *
+ *    This file is part of "Metamod All-Mod-Support"-patch for Metamod.
+ *
+ *    Metamod is free software; you can redistribute it and/or modify it
+ *    under the terms of the GNU General Public License as published by the
+ *    Free Software Foundation; either version 2 of the License, or (at
+ *    your option) any later version.
+ *
+ *    Metamod is distributed in the hope that it will be useful, but
+ *    WITHOUT ANY WARRANTY; without even the implied warranty of
+ *    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ *    General Public License for more details.
+ *
+ *    You should have received a copy of the GNU General Public License
+ *    along with Metamod; if not, write to the Free Software Foundation,
+ *    Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+ *
+ *    In addition, as a special exception, the author gives permission to
+ *    link the code of this program with the Half-Life Game Engine ("HL
+ *    Engine") and Modified Game Libraries ("MODs") developed by Valve,
+ *    L.L.C ("Valve").  You must obey the GNU General Public License in all
+ *    respects for all of the code used other than the HL Engine and MODs
+ *    from Valve.  If you modify this file, you may extend this exception
+ *    to your version of the file, but you are not obligated to do so.  If
+ *    you do not wish to do so, delete this exception statement from your
+ *    version.
+ *
+ */
+
+#ifndef LOG_ASYNC_H
+#define LOG_ASYNC_H
+
+#include <stdarg.h>			// va_list
+
+#include <extdll.h>			// ALERT_TYPE
+
+#include "types_meta.h"		// mBOOL
+#include "osdep.h"			// DLLINTERNAL
+
+// Asynchronous backend for META_LOG, META_WARNING and friends.
+//
+// Messages are formatted on the calling thread straight into a fixed ring
+// of records; claiming a record is a compare-and-swap, so any thread can
+// log without locks or I/O.  A writer thread appends the records to the
+// metamod log file, if one is configured, rotating it by size, and the
+// main thread prints them to the engine once per frame.  When the ring is
+// full, messages are dropped and counted rather than waited for.
+
+// Must be a power of 2.
+#define LOG_ASYNC_RING_SIZE	512
+
+extern volatile mBOOL log_async_active DLLHIDDEN;
+
+// Start queueing messages; logfile may be NULL for engine output only.
+// maxsize_kb is the size at which the log file is rotated, 0 for never.
+void DLLINTERNAL log_async_start(const char *logfile, int maxsize_kb);
+// Print and write everything queued, stop the writer, and go back to
+// logging synchronously.
+void DLLINTERNAL log_async_stop(void);
+
+// Queue a message; mFALSE if it was dropped.
+mBOOL DLLINTERNAL log_async_push(ALERT_TYPE atype, const char *prefix, const char *fmt, va_list ap);
+
+// Print queued messages to the engine.  Main thread only.
+void DLLINTERNAL log_async_flush_console(void);
+
+// Messages dropped on a full ring since start.
+unsigned int DLLINTERNAL log_async_dropped(void);
+
+#endif /* LOG_ASYNC_H */
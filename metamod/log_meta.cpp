@@ -44,6 +44,7 @@
 #include "log_meta.h"			// me
 #include "osdep.h"				// win32 vsnprintf, etc
 #include "support_meta.h"		// MAX
+#include "log_async.h"			// log_async_push, etc
 
 cvar_t meta_debug = {"meta_debug", "0", FCVAR_EXTDLL, 0, NULL};
 
@@ -64,6 +65,10 @@ void DLLINTERNAL META_CONS(const char *fmt, ...) {
 	char buf[MAX_LOGMSG_LEN];
 	unsigned int len;
 
+	// keep queued log messages ahead of this in the console
+	if(log_async_active)
+		log_async_flush_console();
+
 	va_start(ap, fmt);
 	safevoid_vsnprintf(buf, sizeof(buf), fmt, ap);
 	va_end(ap);
@@ -164,8 +169,17 @@ void DLLINTERNAL META_DEBUG_SET_LEVEL(int level) {
 
 void DLLINTERNAL META_DO_DEBUG(const char *fmt, ...) {
 	char meta_debug_str[1024];
+	char prefix[32];
 	va_list ap;
 	
+	if(log_async_active) {
+		safevoid_snprintf(prefix, sizeof(prefix), "[META] (debug:%d)", debug_level);
+		va_start(ap, fmt);
+		log_async_push(at_logged, prefix, fmt, ap);
+		va_end(ap);
+		return;
+	}
+
 	va_start(ap, fmt);
 	safevoid_vsnprintf(meta_debug_str, sizeof(meta_debug_str), fmt, ap);
 	va_end(ap);
@@ -192,6 +206,11 @@ static void buffered_ALERT(MLOG_SERVICE service, ALERT_TYPE atype, const char *p
 	BufferedMessage *msg;
 
 	if (NULL != g_engfuncs.pfnAlertMessage) {
+		// queued messages go to the engine at the next frame
+		if(log_async_active) {
+			log_async_push(atype, prefix, fmt, ap);
+			return;
+		}
 		vsnprintf(buf, sizeof(buf), fmt, ap);
 		ALERT(atype, "%s %s\n", prefix, buf);
 		return;
@@ -65,7 +65,15 @@
 // Version 5:11 added plugin loading and unloading API [v1.18]
 // Version 5:12 added IS_QUERYING_CLIENT_CVAR to mutils [v1.18]
 // Version 5:13 added MAKE_REQUESTID and GET_HOOK_TABLES to mutils [v1.19]
-#define META_INTERFACE_VERSION "5:13"
+// Version 5:14 added HOOK_USER_MSG, UNHOOK_USER_MSG and SET_USER_MSG_DATA to mutils [v1.21]
+// Version 5:15 added SET_MSG_HOOK_FILTER to mutils [v1.21]
+// Version 5:16 added ADD_ENT_HOOK_FILTER and CLEAR_ENT_HOOK_FILTER to mutils [v1.21]
+// Version 5:17 added SET_HOOK_PRIORITY to mutils [v1.21]
+// Version 5:18 added SET_ASYNC_POST_HOOK to mutils [v1.21]
+// Version 5:19 added REG_CLIENT_COMMAND to mutils [v1.21]
+// Version 5:20 added GET_CVAR_HANDLE to mutils [v1.21]
+// Version 5:21 added SET_HOOK_ENABLED to mutils [v1.21]
+#define META_INTERFACE_VERSION "5:21"
 
 // Flags returned by a plugin's api function.
 // NOTE: order is crucial, as greater/less comparisons are made.
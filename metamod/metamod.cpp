@@ -49,6 +49,7 @@
 #include "reg_support.h"		// meta_AddServerCommand, etc
 #include "game_support.h"		// lookup_game, etc
 #include "commands_meta.h"		// meta_register_cmdcvar, etc
+#include "api_prof.h"			// api_prof_init
 #include "thread_logparse.h"	// logparse_handle, etc
 #include "support_meta.h"		// valid_gamedir_file, etc
 #include "log_meta.h"			// META_LOG, etc
@@ -56,6 +57,11 @@
 #include "info_name.h"			// VNAME, etc
 #include "vdate.h"				// COMPILE_TIME, etc
 #include "linkent.h"
+#include "log_async.h"			// log_async_start, etc
+#include "file_watch.h"			// fwatch_start
+#ifdef linux
+	#include "osdep_modmap_linux.h"	// modmap_update
+#endif
 #include "SteamworksAPI_Meta.h"
 
 cvar_t meta_version = {"metamod_version", VVERSION, FCVAR_SERVER, 0, NULL};
@@ -69,6 +75,15 @@ option_t global_options[] = {
 	{ "exec_cfg",		CF_STR,			&Config->exec_cfg,		EXEC_CFG },
 	{ "autodetect",		CF_BOOL,		&Config->autodetect,	"yes" },
 	{ "clientmeta",		CF_BOOL,		&Config->clientmeta,	"yes" },
+	{ "budget_usec",	CF_INT,			&Config->budget_usec,	"0" },
+	{ "budget_plugins",	CF_STR,			&Config->budget_plugins,	NULL },
+	{ "budget_frames",	CF_INT,			&Config->budget_frames,	"10" },
+	{ "budget_autopause",	CF_BOOL,		&Config->budget_autopause,	"no" },
+	{ "log_async",		CF_BOOL,		&Config->log_async,		"yes" },
+	{ "logfile",		CF_PATH,		&Config->logfile,		NULL },
+	{ "logfile_size",	CF_INT,			&Config->logfile_size,	"10240" },
+	{ "watch_files",	CF_BOOL,		&Config->watch_files,	"yes" },
+	{ "watch_autoapply",	CF_BOOL,		&Config->watch_autoapply,	"yes" },
 	// list terminator
 	{ NULL, CF_NONE, NULL, NULL }
 };
@@ -84,6 +99,7 @@ meta_enginefuncs_t g_plugin_engfuncs;
 
 MPluginList *Plugins;
 MRegCmdList *RegCmds;
+MRegCmdList *RegClientCmds;
 MRegCvarList *RegCvars;
 MRegMsgList *RegMsgs;
 
@@ -94,6 +110,36 @@ DLHANDLE metamod_handle;
 int metamod_not_loaded = 0;
 
 
+// Override config options with localinfo commandline options.
+static void DLLINTERNAL meta_localinfo_options(void) {
+	char *cp;
+
+	if((cp=LOCALINFO("mm_debug")) != nullptr && *cp != '\0') {
+		META_LOG("Debuglevel specified via localinfo: %s", cp);
+		Config->set("debuglevel", cp);
+	}
+	if((cp=LOCALINFO("mm_gamedll")) != nullptr && *cp != '\0') {
+		META_LOG("Gamedll specified via localinfo: %s", cp);
+		Config->set("gamedll", cp);
+	}
+	if((cp=LOCALINFO("mm_pluginsfile")) != nullptr && *cp != '\0') {
+		META_LOG("Pluginsfile specified via localinfo: %s", cp);
+		Config->set("plugins_file", cp);
+	}
+	if((cp=LOCALINFO("mm_execcfg")) != nullptr && *cp != '\0') {
+		META_LOG("Execcfg specified via localinfo: %s", cp);
+		Config->set("exec_cfg", cp);
+	}
+	if((cp=LOCALINFO("mm_autodetect")) != nullptr && *cp != '\0') {
+		META_LOG("Autodetect specified via localinfo: %s", cp);
+		Config->set("autodetect", cp);
+	}
+	if((cp=LOCALINFO("mm_clientmeta")) != nullptr && *cp != '\0') {
+		META_LOG("Clientmeta specified via localinfo: %s", cp);
+		Config->set("clientmeta", cp);
+	}
+}
+
 // Very first metamod function that's run.
 // Do startup operations...
 int DLLINTERNAL metamod_startup(void) {	
@@ -137,6 +183,7 @@ int DLLINTERNAL metamod_startup(void) {
 	// Can I do these here, rather than waiting for GameDLLInit() ?  
 	// Looks like it works okay..
 	meta_register_cmdcvar();
+	api_prof_init();
 	{
 		//dirty hacks
 		int vers[4] = {RC_VERS_DWORD};
@@ -175,31 +222,7 @@ int DLLINTERNAL metamod_startup(void) {
 		META_DEBUG(2, ("No config.ini file found: %s", CONFIG_INI));
 
 	// Now, override config options with localinfo commandline options.
-	if((cp=LOCALINFO("mm_debug")) != nullptr && *cp != '\0') {
-		META_LOG("Debuglevel specified via localinfo: %s", cp);
-		Config->set("debuglevel", cp);
-	}
-	if((cp=LOCALINFO("mm_gamedll")) != nullptr && *cp != '\0') {
-		META_LOG("Gamedll specified via localinfo: %s", cp);
-		Config->set("gamedll", cp);
-	}
-	if((cp=LOCALINFO("mm_pluginsfile")) != nullptr && *cp != '\0') {
-		META_LOG("Pluginsfile specified via localinfo: %s", cp);
-		Config->set("plugins_file", cp);
-	}
-	if((cp=LOCALINFO("mm_execcfg")) != nullptr && *cp != '\0') {
-		META_LOG("Execcfg specified via localinfo: %s", cp);
-		Config->set("exec_cfg", cp);
-	}
-	if((cp=LOCALINFO("mm_autodetect")) != nullptr && *cp != '\0') {
-		META_LOG("Autodetect specified via localinfo: %s", cp);
-		Config->set("autodetect", cp);
-	}
-	if((cp=LOCALINFO("mm_clientmeta")) != nullptr && *cp != '\0') {
-		META_LOG("Clientmeta specified via localinfo: %s", cp);
-		Config->set("clientmeta", cp);
-	}
-
+	meta_localinfo_options();
 
 	// Check for an initial debug level, since cfg files don't get exec'd
 	// until later.
@@ -208,7 +231,8 @@ int DLLINTERNAL metamod_startup(void) {
 	}
 
 	// Prepare for registered commands from plugins.
-	RegCmds = new MRegCmdList();
+	RegCmds = new MRegCmdList(mFALSE);
+	RegClientCmds = new MRegCmdList(mTRUE);
 	RegCvars = new MRegCvarList();
 
 	// Prepare for registered user messages from gamedll.
@@ -287,6 +311,14 @@ int DLLINTERNAL metamod_startup(void) {
 		// Exit on failure here?  Dunno...
 	}
 
+	// Notice deployments as they happen, rather than checking every file
+	// at each map change.
+	{
+		char cfgpath[PATH_MAX];
+		full_gamedir_path(cfile, cfgpath);
+		fwatch_start(Plugins->inifile, cfgpath);
+	}
+
 	// Allow for commands to metamod plugins at startup.  Autoexec.cfg is
 	// read too early, and server.cfg is read too late.
 	//
@@ -310,10 +342,28 @@ int DLLINTERNAL metamod_startup(void) {
 			SERVER_COMMAND(cmd);
 		}
 	}
+
+	// From here on, logging from hooks doesn't wait on the engine or disk.
+	// Started only once startup has succeeded, since a failed startup never
+	// reaches StartFrame to flush the queue, and startup output could
+	// overrun the ring before the first frame anyway.
+	if(Config->log_async)
+		log_async_start(Config->logfile, Config->logfile_size);
 	
 	return(1);
 }
 
+// Re-read config.ini, after it changed on disk.  Localinfo options still
+// take precedence.  Most options are only used at startup; this is for
+// ones looked at as the server runs, like clientmeta and the budgets.
+// Options no longer in the file keep their current values.
+void DLLINTERNAL meta_reload_config(const char *cfgfile) {
+	if(!Config->load(cfgfile))
+		return;
+	meta_localinfo_options();
+	META_LOG("Re-read config file: %s", cfgfile);
+}
+
 // Set initial GameDLL fields (name, gamedir).
 // meta_errno values:
 //  - ME_NULLRESULT	getcwd failed
@@ -450,6 +500,9 @@ mBOOL DLLINTERNAL meta_load_gamedll(void) {
 				DLERROR());
 		RETURN_ERRNO(mFALSE, ME_DLOPEN);
 	}
+#ifdef linux
+	modmap_update();
+#endif
 
 	// Used to only pass our table of engine funcs if a loaded plugin
 	// wanted to catch one of the functions, but now that plugins are
@@ -63,6 +63,9 @@
 // generic config file
 #define CONFIG_INI			"addons/metamod/config.ini"
 
+// results of gamedll autodetection, to skip scanning unchanged dlls
+#define AUTODETECT_CACHE	"addons/metamod/autodetect.cache"
+
 // metamod module handle
 extern DLHANDLE metamod_handle DLLHIDDEN;
 
@@ -101,6 +104,9 @@ extern MPluginList *Plugins DLLHIDDEN;
 // List of command functions registered by plugins.
 extern MRegCmdList *RegCmds DLLHIDDEN;
 
+// List of client command functions registered by plugins.
+extern MRegCmdList *RegClientCmds DLLHIDDEN;
+
 // List of cvar structures registered by plugins.
 extern MRegCvarList *RegCvars DLLHIDDEN;
 
@@ -117,6 +123,9 @@ extern meta_globals_t PrivateMetaGlobals DLLHIDDEN;
 extern DLL_FUNCTIONS *g_pHookedDllFunctions DLLHIDDEN;
 extern NEW_DLL_FUNCTIONS *g_pHookedNewDllFunctions DLLHIDDEN;
 
+// Point unhooked slots of the tables given to engine straight at gamedll.
+void DLLINTERNAL update_dllapi_passthrough(void);
+
 extern int metamod_not_loaded DLLHIDDEN;
 
 // Holds cached player info, right now only things for querying cvars
@@ -126,6 +135,7 @@ extern MPlayerList g_Players DLLHIDDEN;
 extern int requestid_counter DLLHIDDEN;
 
 int DLLINTERNAL metamod_startup(void);
+void DLLINTERNAL meta_reload_config(const char *cfgfile);
 
 mBOOL DLLINTERNAL meta_init_gamedll(void);
 mBOOL DLLINTERNAL meta_factories_init(void);
@@ -196,66 +206,8 @@ mBOOL DLLINTERNAL meta_load_gamedll(void);
 
 // return a value
 #define RETURN_API(ret_t) \
-	{return(GET_RET_CLASS(ret_val, ret_t));}
+	{return(ret_val);}
 
 // ===== end macros ===========================================================
 
-#ifdef META_PERFMON
-
-// ============================================================================
-// Api-hook performance monitoring
-// ============================================================================
-
-extern long double total_tsc DLLHIDDEN;
-extern unsigned long long count_tsc DLLHIDDEN;
-extern unsigned long long active_tsc DLLHIDDEN;
-extern unsigned long long min_tsc DLLHIDDEN;
-
-inline unsigned long long DLLINTERNAL GET_TSC(void) {
-	union { struct { unsigned int eax, edx;	} split; unsigned long long full; } tsc;
-#ifdef __GNUC__
-	__asm__ __volatile__("rdtsc":"=a"(tsc.split.eax), "=d"(tsc.split.edx));	
-#else
-	__asm
-	{
-		rdtsc
-		mov tsc.split.eax, eax
-		mov tsc.split.edx, edx
-	}
-#endif
-	return(tsc.full);
-}
-
-#define API_START_TSC_TRACKING() \
-	active_tsc = GET_TSC()
-
-#define API_PAUSE_TSC_TRACKING() \
-	total_tsc += GET_TSC() - active_tsc
-
-#define API_UNPAUSE_TSC_TRACKING() \
-	active_tsc = GET_TSC()
-
-#define API_END_TSC_TRACKING() { \
-		unsigned long long run_tsc = GET_TSC() - active_tsc; \
-		total_tsc += run_tsc; \
-		count_tsc++; \
-		if(min_tsc == 0 || run_tsc < min_tsc) \
-			min_tsc = run_tsc; \
-	}
-
-// ===== end ==================================================================
-
-#else
-
-// ===== performance monitor disabled =========================================
-
-#define API_START_TSC_TRACKING()
-#define API_PAUSE_TSC_TRACKING()
-#define API_UNPAUSE_TSC_TRACKING()
-#define API_END_TSC_TRACKING()
-
-// ===== end ==================================================================
-
-#endif /*META_PERFMON*/
-
 #endif /* METAMOD_H */
@@ -47,6 +47,9 @@
 #include "log_meta.h"			// META_LOG, etc
 #include "osdep.h"				// win32 snprintf, normalize_pathname,
 #include "osdep_p.h"
+#ifdef linux
+	#include "osdep_modmap_linux.h"	// modmap_find
+#endif
 
 // Constructor
 MPluginList::MPluginList(const char *ifile) 
@@ -210,10 +213,18 @@ MPlugin * DLLINTERNAL MPluginList::find(const char *findpath) {
 //  - errno's from DLFNAME()
 MPlugin * DLLINTERNAL MPluginList::find_memloc(void *memptr) {
 #ifdef linux
+	const modmap_range_t *range;
 	const char *dlfile;
 
 	if(!memptr)
 		RETURN_ERRNO(NULL, ME_ARGUMENT);
+	// Known modules are in the address map; only ask dladdr() about
+	// the rest.
+	if((range=modmap_find(memptr)) != nullptr) {
+		if(range->plugin && range->plugin->status >= PL_VALID)
+			return(range->plugin);
+		RETURN_ERRNO(NULL, ME_NOTFOUND);
+	}
 	if(!(dlfile=DLFNAME(memptr))) {
 		META_DEBUG(8, ("DLFNAME failed to find memloc %d", memptr));
 		// meta_errno should be already set in DLFNAME
@@ -798,7 +809,8 @@ mBOOL DLLINTERNAL MPluginList::refresh(PLUG_LOADTIME now) {
 	return(mTRUE);
 }
 
-// Re-enable any plugins currently paused.
+// Re-enable any plugins currently paused, except ones the frame budget
+// watchdog paused; those stay paused until unpaused by hand.
 // meta_errno values:
 //  - none
 void DLLINTERNAL MPluginList::unpause_all(void) {
@@ -806,8 +818,13 @@ void DLLINTERNAL MPluginList::unpause_all(void) {
 	MPlugin *iplug;
 	for(i=0; i < endlist; i++) {
 		iplug=&plist[i];
-		if(iplug->status==PL_PAUSED)
-			iplug->unpause();
+		if(iplug->status!=PL_PAUSED)
+			continue;
+		if(iplug->budget_paused) {
+			META_DEBUG(2, ("Leaving plugin '%s' paused; over frame budget", iplug->desc));
+			continue;
+		}
+		iplug->unpause();
 	}
 }
 
@@ -820,7 +837,9 @@ void DLLINTERNAL MPluginList::retry_all(PLUG_LOADTIME now) {
 	MPlugin *iplug;
 	for(i=0; i < endlist; i++) {
 		iplug=&plist[i];
-		if(iplug->action != PA_NONE)
+		if(iplug->status < PL_VALID)
+			continue;
+		if(iplug->action != PA_NONE && iplug->action != PA_KEEP)
 			iplug->retry(now, PNL_DELAYED);
 	}
 }
@@ -53,6 +53,18 @@
 #include "osdep.h"				// win32 snprintf, is_absolute_path,
 #include "mm_pextensions.h"
 #include "engine_t.h"			//Engine.ident
+#include "api_hook.h"			// rebuild_api_hook_lists, etc
+#include "api_prof.h"			// api_prof_reset_plugin
+#include "api_budget.h"			// api_budget_reset_plugin
+#include "api_stats.h"			// api_stats_reset_plugin
+#include "msg_capture.h"		// msg_capture_remove_plugin
+#include "ent_filter.h"			// ent_filter_remove_plugin
+#include "file_watch.h"			// fwatch_add_plugin, etc
+#include "api_async.h"			// api_async_drain, etc
+#include "cvar_watch.h"			// cvar_watch_remove_plugin
+#ifdef linux
+	#include "osdep_modmap_linux.h"	// modmap_update
+#endif
 
 #include "SteamworksAPI_Meta.h"
 
@@ -568,6 +580,9 @@ mBOOL DLLINTERNAL MPlugin::load(PLUG_LOADTIME now) {
 				}
 				else
 					handle=NULL;
+#ifdef linux
+				modmap_update();
+#endif
 			}
 			status=PL_BADFILE;
 			info=NULL; // prevent crash
@@ -594,6 +609,12 @@ mBOOL DLLINTERNAL MPlugin::load(PLUG_LOADTIME now) {
 		}
 	}
 
+	// default hook order, all msg ids and no async observers, before
+	// plugin sets its own from Meta_Attach
+	reset_hook_priority(index);
+	set_msg_hook_filter(index, NULL, 0);
+	api_async_remove_plugin(index);
+
 	// attach plugin; get function tables
 	if(attach(now) != mTRUE) {
 		META_WARNING("dll: Failed to attach plugin '%s'", desc);
@@ -609,6 +630,13 @@ mBOOL DLLINTERNAL MPlugin::load(PLUG_LOADTIME now) {
 	
 	status=PL_RUNNING;
 	action=PA_NONE;
+	// don't mix in timings of a plugin that had this slot before
+	api_prof_reset_plugin(index);
+	api_budget_reset_plugin(this);
+	api_stats_reset_plugin(index);
+	// notice when the file is updated
+	fwatch_add_plugin(this);
+	rebuild_api_hook_lists();
 		
 	// If not loading at server startup, then need to call plugin's
 	// GameInit, since we've passed that.
@@ -646,12 +674,19 @@ mBOOL DLLINTERNAL MPlugin::query(void) {
 	GIVE_ENGINE_FUNCTIONS_FN pfn_give_engfuncs;
 	META_QUERY_FN pfn_query;
 
-	// open the plugin DLL
-	if((handle=DLOPEN(pathname)) == nullptr) {
+	// open the plugin DLL, unless it was opened in the background
+	if(preload_handle) {
+		handle=preload_handle;
+		preload_handle=NULL;
+	}
+	else if((handle=DLOPEN(pathname)) == nullptr) {
 		META_WARNING("dll: Failed query plugin '%s'; Couldn't open file '%s': %s",
 				desc, pathname, DLERROR());
 		RETURN_ERRNO(mFALSE, ME_DLOPEN);
 	}
+#ifdef linux
+	modmap_update();
+#endif
 
 	// First, we check to see if they have a Meta_Query.  We would normally
 	// dlsym this just prior to calling it, after having called
@@ -1109,6 +1144,9 @@ mBOOL DLLINTERNAL MPlugin::unload(PLUG_LOADTIME now, PL_UNLOAD_REASON reason, PL
 	// calling ServerActivate when loading during map, since the SDK
 	// indicates these two routines should match call for call.
 
+	// let it see the calls it has queued before it goes
+	api_async_drain();
+
 	// detach plugin
 	if(!detach(now, reason)) {
 		if(reason == PNL_RELOAD) {
@@ -1133,8 +1171,17 @@ mBOOL DLLINTERNAL MPlugin::unload(PLUG_LOADTIME now, PL_UNLOAD_REASON reason, PL
 
 	// Unmark registered commands for this plugin (by index number).
 	RegCmds->disable(index);
+	RegClientCmds->disable(index);
 	// Unmark registered cvars for this plugin (by index number).
 	RegCvars->disable(index);
+	// Stop calling its cvar change functions.
+	cvar_watch_remove_plugin(this);
+	// Drop user msg hooks into the dll.
+	msg_capture_remove_plugin(this);
+	// Drop entity hook filters.
+	ent_filter_remove_plugin(this);
+	// Drop async observers, and wait out calls to them.
+	api_async_remove_plugin(index);
 
 	// Close the file.  Note: after this, attempts to reference any memory
 	// locations in the file will produce a segfault.
@@ -1144,6 +1191,10 @@ mBOOL DLLINTERNAL MPlugin::unload(PLUG_LOADTIME now, PL_UNLOAD_REASON reason, PL
 		META_WARNING("dll: Couldn't dlclose plugin file '%s': %s", file, DLERROR());
 	}
 	handle=NULL;
+#ifdef linux
+	modmap_update();
+#endif
+	fwatch_remove_plugin(this);
 
 	if(action==PA_UNLOAD) {
 		status=PL_EMPTY;
@@ -1154,6 +1205,7 @@ mBOOL DLLINTERNAL MPlugin::unload(PLUG_LOADTIME now, PL_UNLOAD_REASON reason, PL
 		action=PA_LOAD;
 		clear();
 	}
+	rebuild_api_hook_lists();
 	META_LOG("dll: Unloaded plugin '%s' for reason '%s'", desc, str_reason(reason, real_reason));
 	return(mTRUE);
 }
@@ -1235,6 +1287,25 @@ mBOOL DLLINTERNAL MPlugin::reload(PLUG_LOADTIME now, PL_UNLOAD_REASON reason) {
 	return(mTRUE);
 }
 
+// Reload a plugin, using an already opened copy of the file if given.
+// meta_errno values:
+//  - errno's from reload()
+mBOOL DLLINTERNAL MPlugin::reload_preloaded(PLUG_LOADTIME now, PL_UNLOAD_REASON reason, DLHANDLE preloaded) {
+	mBOOL ret;
+
+	preload_handle=preloaded;
+	ret=reload(now, reason);
+	// not used if reload stopped before querying the new copy
+	if(preload_handle) {
+		DLCLOSE(preload_handle);
+		preload_handle=NULL;
+#ifdef linux
+		modmap_update();
+#endif
+	}
+	return(ret);
+}
+
 // Pause a plugin; temporarily disabled for API routines.
 // meta_errno values:
 //  - ME_ALREADY	this plugin already paused
@@ -1258,6 +1329,8 @@ mBOOL MPlugin::pause(void) {
 	}
 
 	status=PL_PAUSED;
+	budget_paused=mFALSE;
+	rebuild_api_hook_lists();
 	META_LOG("Paused plugin '%s'", desc);
 	return(mTRUE);
 }
@@ -1271,6 +1344,8 @@ mBOOL DLLINTERNAL MPlugin::unpause(void) {
 		RETURN_ERRNO(mFALSE, ME_BADREQ);
 	}
 	status=PL_RUNNING;
+	budget_paused=mFALSE;
+	rebuild_api_hook_lists();
 	META_LOG("Unpaused plugin '%s'", desc);
 	return(mTRUE);
 }
@@ -1335,12 +1410,18 @@ mBOOL DLLINTERNAL MPlugin::clear(void) {
 		status=PL_FAILED;
 		RETURN_ERRNO(mFALSE, ME_DLERROR);
 	}
-	handle=NULL;
+	if(handle) {
+		handle=NULL;
+#ifdef linux
+		modmap_update();
+#endif
+	}
 
 	free_api_pointers();
 	
 	status=PL_EMPTY;
 	action=PA_NULL;
+	budget_paused=mFALSE;
 	handle=NULL;
 	info=NULL;
 	time_loaded=0;
@@ -1428,6 +1509,7 @@ void DLLINTERNAL MPlugin::show(void) {
 	else
 		META_CONS("No Engine-Post functions.");
 	RegCmds->show(index);
+	RegClientCmds->show(index);
 	RegCvars->show(index);
 	
 	if(Plugins->found_child_plugins(index))
@@ -1445,6 +1527,9 @@ mBOOL DLLINTERNAL MPlugin::newer_file(void) {
 	struct stat st;
 	time_t file_time;
 
+	// no change events for the file since it was loaded
+	if(fwatch_plugin_unchanged(this))
+		RETURN_ERRNO(mFALSE, ME_NOERROR);
 	if(stat(pathname, &st) != 0)
 		RETURN_ERRNO(mFALSE, ME_NOFILE);
 	file_time=st.st_ctime > st.st_mtime ? st.st_ctime : st.st_mtime;
@@ -137,6 +137,7 @@ class MPlugin : public class_metamod_new {
 		int source_plugin_index;			// index of plugin that loaded this plugin. -1 means source plugin has been unloaded.
 		int unloader_index;
 		mBOOL is_unloader;				// fix to prevent other plugins unload active unloader.
+		mBOOL budget_paused;				// paused by frame budget watchdog; stays paused across changelevel
 		
 		DLHANDLE handle;				// handle for dlopen, dlsym, etc
 		plugin_info_t *info;				// information plugin provides about itself
@@ -164,6 +165,7 @@ class MPlugin : public class_metamod_new {
 		mBOOL DLLINTERNAL load(PLUG_LOADTIME now);
 		mBOOL DLLINTERNAL unload(PLUG_LOADTIME now, PL_UNLOAD_REASON reason, PL_UNLOAD_REASON real_reason);
 		mBOOL DLLINTERNAL reload(PLUG_LOADTIME now, PL_UNLOAD_REASON reason);
+		mBOOL DLLINTERNAL reload_preloaded(PLUG_LOADTIME now, PL_UNLOAD_REASON reason, DLHANDLE preloaded);
 		mBOOL DLLINTERNAL pause(void);
 		mBOOL DLLINTERNAL unpause(void);
 		mBOOL DLLINTERNAL retry(PLUG_LOADTIME now, PL_UNLOAD_REASON reason); // if previously failed
@@ -206,6 +208,7 @@ class MPlugin : public class_metamod_new {
 		gamedll_funcs_t gamedll_funcs;
 		mutil_funcs_t mutil_funcs;
 		MetaFactories_t factories;
+		DLHANDLE preload_handle;			// already open new copy, for query()
 };
 
 // Macros used by MPlugin::show(), to list the functions that the plugin
@@ -55,6 +55,100 @@
 #include "osdep.h"			// os_safe_call, etc
 
 
+///// class MRegNameIndex:
+
+// Constructor
+MRegNameIndex::MRegNameIndex(mBOOL case_insensitive)
+	: table(0), mask(0), count(0), nocase(case_insensitive), failed(mFALSE)
+{
+}
+
+// djb2, folding case if the index is case-insensitive.
+unsigned int DLLINTERNAL MRegNameIndex::hash(const char *name) const {
+	unsigned int h = 5381;
+	unsigned char c;
+
+	while((c = (unsigned char)*name++) != 0) {
+		if(nocase && c >= 'A' && c <= 'Z')
+			c += 'a' - 'A';
+		h = h * 33 + c;
+	}
+	return(h);
+}
+
+mBOOL DLLINTERNAL MRegNameIndex::match(const entry_t *entry, const char *name, unsigned int h) const {
+	if(entry->hash != h)
+		return(mFALSE);
+	if(nocase)
+		return(strcasecmp(entry->name, name) ? mFALSE : mTRUE);
+	return(mm_strcmp(entry->name, name) ? mFALSE : mTRUE);
+}
+
+// Double the table (or create it), keeping load at or below 1/2.
+mBOOL DLLINTERNAL MRegNameIndex::grow(void) {
+	entry_t *newtable;
+	unsigned int newsize, i, j;
+
+	newsize = table ? (mask + 1) * 2 : 64;
+	newtable = (entry_t *) calloc(newsize, sizeof(entry_t));
+	if(!newtable)
+		return(mFALSE);
+	if(table) {
+		for(i=0; i <= mask; i++) {
+			if(!table[i].name)
+				continue;
+			for(j = table[i].hash & (newsize - 1); newtable[j].name; j = (j + 1) & (newsize - 1))
+				;
+			newtable[j] = table[i];
+		}
+		free(table);
+	}
+	table = newtable;
+	mask = newsize - 1;
+	return(mTRUE);
+}
+
+// Find the slot for the given name.
+int DLLINTERNAL MRegNameIndex::find(const char *name) const {
+	unsigned int h, i;
+
+	if(!table || !name)
+		return(-1);
+	h = hash(name);
+	for(i = h & mask; table[i].name; i = (i + 1) & mask) {
+		if(match(&table[i], name, h))
+			return(table[i].slot);
+	}
+	return(-1);
+}
+
+// Add a name for the given slot.  If the table can't grow, the index is
+// marked unusable, and the list falls back to scanning.
+void DLLINTERNAL MRegNameIndex::add(const char *name, int slot) {
+	unsigned int h, i;
+
+	if(failed || !name)
+		return;
+	if(!table || (unsigned int)(count + 1) * 2 > mask + 1) {
+		if(!grow()) {
+			META_WARNING("Couldn't grow reg name index for '%s'; using list scan", name);
+			failed = mTRUE;
+			return;
+		}
+	}
+	h = hash(name);
+	for(i = h & mask; table[i].name; i = (i + 1) & mask) {
+		// list scans always found the first entry of a name
+		if(match(&table[i], name, h))
+			return;
+	}
+	table[i].name = name;
+	table[i].hash = h;
+	table[i].slot = slot;
+	count++;
+}
+
+
 ///// class MRegCmd:
 
 // Init values.  It would probably be more "proper" to use containers and
@@ -64,6 +158,7 @@ void DLLINTERNAL MRegCmd::init(int idx)
 	index = idx;
 	name = NULL;
 	pfnCmd = NULL;
+	pfnClientCmd = NULL;
 	plugid = 0;
 	status = RG_INVALID;
 }
@@ -97,11 +192,37 @@ mBOOL DLLINTERNAL MRegCmd::call(void) {
 }
 
 
+// Try to call the client command function, like call(void).  Sets
+// handled to what the function returned.
+// meta_errno values:
+//  - ME_BADREQ		function disabled/invalid
+//  - ME_ARGUMENT	function pointer is null
+mBOOL DLLINTERNAL MRegCmd::call(edict_t *pEntity, qboolean *handled) {
+	// can we expect to call this function?
+	if(status != RG_VALID)
+		RETURN_ERRNO(mFALSE, ME_BADREQ);
+	if(!pfnClientCmd)
+		RETURN_ERRNO(mFALSE, ME_ARGUMENT);
+
+	// try to call this function
+	if(!IS_VALID_PTR((void *) pfnClientCmd)) {
+		META_DEBUG(4, ("Plugin client cmd '%s' called after unloaded; removed from list", name));
+		status=RG_INVALID;
+		pfnClientCmd=NULL;
+		// meta_errno should be already set in is_valid_ptr()
+		return(mFALSE);
+	}
+	*handled=pfnClientCmd(pEntity);
+	return(mTRUE);
+}
+
+
 ///// class MRegCmdList:
 
 // Constructor
-MRegCmdList::MRegCmdList(void)
-	: mlist(0), size(REG_CMD_GROWSIZE), endlist(0)
+MRegCmdList::MRegCmdList(mBOOL client_cmds)
+	: mlist(0), size(REG_CMD_GROWSIZE), endlist(0), client(client_cmds), 
+	  names(client_cmds ? mFALSE : mTRUE)
 {
 	int i;
 	mlist = (MRegCmd *) calloc(1, size * sizeof(MRegCmd));
@@ -116,8 +237,13 @@ MRegCmdList::MRegCmdList(void)
 //  - ME_NOTFOUND	couldn't find a matching function
 MRegCmd * DLLINTERNAL MRegCmdList::find(const char *findname) {
 	int i;
+	if(names.usable()) {
+		if((i=names.find(findname)) >= 0)
+			return(&mlist[i]);
+		RETURN_ERRNO(NULL, ME_NOTFOUND);
+	}
 	for(i=0; i < endlist; i++) {
-		if(!strcasecmp(mlist[i].name, findname))
+		if(client ? !mm_strcmp(mlist[i].name, findname) : !strcasecmp(mlist[i].name, findname))
 			return(&mlist[i]);
 	}
 	RETURN_ERRNO(NULL, ME_NOTFOUND);
@@ -163,6 +289,7 @@ MRegCmd * DLLINTERNAL MRegCmdList::add(const char *addname) {
 				addname, strerror(errno));
 		RETURN_ERRNO(NULL, ME_NOMEM);
 	}
+	names.add(icmd->name, endlist);
 	endlist++;
 	
 	return(icmd);
@@ -177,6 +304,16 @@ void DLLINTERNAL MRegCmdList::disable(int plugin_id) {
 	}
 }
 
+// Whether the given plugin (by index id) has any valid functions.
+mBOOL DLLINTERNAL MRegCmdList::any_valid(int plugin_id) {
+	int i;
+	for(i=0; i < endlist; i++) {
+		if(mlist[i].plugid == plugin_id && mlist[i].status == RG_VALID)
+			return(mTRUE);
+	}
+	return(mFALSE);
+}
+
 // List all the registered commands.
 void DLLINTERNAL MRegCmdList::show(void) {
 	int i, n=0, a=0;
@@ -184,7 +321,7 @@ void DLLINTERNAL MRegCmdList::show(void) {
 	MPlugin *iplug;
 	char bplug[18+1];	// +1 for term null
 
-	META_CONS("Registered plugin commands:");
+	META_CONS("Registered plugin %scommands:", client ? "client " : "");
 	META_CONS("  %*s  %-*s  %-s", 
 			WIDTH_MAX_REG, "",
 			sizeof(bplug)-1, "plugin", "command");
@@ -214,7 +351,7 @@ void DLLINTERNAL MRegCmdList::show(void) {
 		n++;
 	}
 	
-	META_CONS("%d commands, %d available (%d allocated)", n, a, size);
+	META_CONS("%d %scommands, %d available (%d allocated)", n, client ? "client " : "", a, size);
 }
 
 // List all the registered commands for the given plugin id.
@@ -232,7 +369,7 @@ void DLLINTERNAL MRegCmdList::show(int plugin_id) {
 	}
 	*/
 	
-	META_CONS("Registered commands:");
+	META_CONS("Registered %scommands:", client ? "client " : "");
 	for(i=0; i < endlist; i++) {
 		icmd = &mlist[i];
 		if(icmd->plugid != plugin_id)
@@ -240,7 +377,7 @@ void DLLINTERNAL MRegCmdList::show(int plugin_id) {
 		META_CONS("   %s", icmd->name);
 		n++;
 	}
-	META_CONS("%d commands", n);
+	META_CONS("%d %scommands", n, client ? "client " : "");
 }
 
 
@@ -279,7 +416,7 @@ mBOOL DLLINTERNAL MRegCvar::set(cvar_t *src) {
 
 // Constructor
 MRegCvarList::MRegCvarList(void)
-	: vlist(0), size(REG_CVAR_GROWSIZE), endlist(0)
+	: vlist(0), size(REG_CVAR_GROWSIZE), endlist(0), names(mTRUE)
 {
 	int i;
 	vlist = (MRegCvar *) calloc(1, size * sizeof(MRegCvar));
@@ -336,6 +473,7 @@ MRegCvar * DLLINTERNAL MRegCvarList::add(const char *addname) {
 				addname, strerror(errno));
 		RETURN_ERRNO(NULL, ME_NOMEM);
 	}
+	names.add(icvar->data->name, endlist);
 	endlist++;
 	
 	return(icvar);
@@ -346,6 +484,11 @@ MRegCvar * DLLINTERNAL MRegCvarList::add(const char *addname) {
 //  - ME_NOTFOUND	couldn't find a matching cvar
 MRegCvar * DLLINTERNAL MRegCvarList::find(const char *findname) {
 	int i;
+	if(names.usable()) {
+		if((i=names.find(findname)) >= 0)
+			return(&vlist[i]);
+		RETURN_ERRNO(NULL, ME_NOTFOUND);
+	}
 	for(i=0; i < endlist; i++) {
 		if(!strcasecmp(vlist[i].data->name, findname))
 			return(&vlist[i]);
@@ -450,11 +593,12 @@ void DLLINTERNAL MRegCvarList::show(int plugin_id) {
 
 // Constructor
 MRegMsgList::MRegMsgList(void)
-	: size(MAX_REG_MSGS), endlist(0)
+	: size(MAX_REG_MSGS), endlist(0), names(mFALSE)
 {
 	int i;
 	// initialize array
 	memset(mlist, 0, sizeof(mlist));
+	memset(byid, 0, sizeof(byid));
 	for(i=0; i < size; i++) {
 		mlist[i].index=i+1;		// 1-based
 	}
@@ -484,6 +628,11 @@ MRegMsg * DLLINTERNAL MRegMsgList::add(const char *addname, int addmsgid, int ad
 	imsg->msgid=addmsgid;
 	imsg->size=addsize;
 
+	// first registration of an id or name wins, as with list scans
+	if(addmsgid >= 0 && addmsgid < MAX_REG_MSGS && !byid[addmsgid])
+		byid[addmsgid]=endlist;
+	names.add(addname, endlist - 1);
+
 	return(imsg);
 }
 
@@ -492,6 +641,11 @@ MRegMsg * DLLINTERNAL MRegMsgList::add(const char *addname, int addmsgid, int ad
 //  - ME_NOTFOUND	couldn't find a matching cvar
 MRegMsg * DLLINTERNAL MRegMsgList::find(const char *findname) {
 	int i;
+	if(names.usable()) {
+		if((i=names.find(findname)) >= 0)
+			return(&mlist[i]);
+		RETURN_ERRNO(NULL, ME_NOTFOUND);
+	}
 	for(i=0; i < endlist; i++) {
 		if(!mm_strcmp(mlist[i].name, findname))
 			return(&mlist[i]);
@@ -504,6 +658,11 @@ MRegMsg * DLLINTERNAL MRegMsgList::find(const char *findname) {
 //  - ME_NOTFOUND	couldn't find a matching cvar
 MRegMsg * DLLINTERNAL MRegMsgList::find(int findmsgid) {
 	int i;
+	if(findmsgid >= 0 && findmsgid < MAX_REG_MSGS) {
+		if(byid[findmsgid])
+			return(&mlist[byid[findmsgid] - 1]);
+		RETURN_ERRNO(NULL, ME_NOTFOUND);
+	}
 	for(i=0; i < endlist; i++) {
 		if(mlist[i].msgid == findmsgid)
 			return(&mlist[i]);
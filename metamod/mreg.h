@@ -70,6 +70,48 @@ typedef enum {
 // Pointer to function registered by AddServerCommand.
 typedef void (*REG_CMD_FN) (void);
 
+// Pointer to function registered by REG_CLIENT_COMMAND; returns whether it
+// handled the command.
+typedef qboolean (*REG_CLIENT_CMD_FN) (edict_t *pEntity);
+
+
+// Hash index from name to a Reg*List slot, so lookups don't scan the
+// list.  Names aren't copied; they must stay put for the life of the
+// list (reg cmd/cvar names are strdup'd and never freed, msg names are
+// constants in the gamedll).  Slots rather than pointers are stored, as
+// the lists move when grown.
+class MRegNameIndex : public class_metamod_new {
+	private:
+	// data:
+		typedef struct {
+			const char *name;		// NULL for empty
+			unsigned int hash;
+			int slot;
+		} entry_t;
+		entry_t *table;			// open addressing; size is power of 2
+		unsigned int mask;
+		int count;
+		mBOOL nocase;			// case-insensitive names
+		mBOOL failed;			// an add failed; callers must scan
+		// Private; to satisfy -Weffc++ "has pointer data members but does
+		// not override" copy/assignment constructor.
+		void operator=(const MRegNameIndex &src);
+		MRegNameIndex(const MRegNameIndex &src);
+	// functions:
+		unsigned int DLLINTERNAL hash(const char *name) const;
+		mBOOL DLLINTERNAL match(const entry_t *entry, const char *name, unsigned int h) const;
+		mBOOL DLLINTERNAL grow(void);
+
+	public:
+	// constructor:
+		MRegNameIndex(mBOOL case_insensitive) DLLINTERNAL;
+
+	// functions:
+		mBOOL DLLINTERNAL usable(void) const { return(failed ? mFALSE : mTRUE); }
+		int DLLINTERNAL find(const char *name) const;	// slot, or -1
+		void DLLINTERNAL add(const char *name, int slot);	// keeps first slot for a name
+};
+
 
 // An individual registered function/command.
 class MRegCmd : public class_metamod_new {
@@ -80,21 +122,26 @@ class MRegCmd : public class_metamod_new {
 	public:
 		char *name;			// space is malloc'd
 		REG_CMD_FN pfnCmd;		// pointer to the function
+		REG_CLIENT_CMD_FN pfnClientCmd;	// same, for client commands
 		int plugid;			// index id of corresponding plugin
 		REG_STATUS status;		// whether corresponding plugin is loaded
 	// functions:
 		void DLLINTERNAL init(int idx);	// init values, as not using constructors
 		mBOOL DLLINTERNAL call(void);	// try to call the function
+		mBOOL DLLINTERNAL call(edict_t *pEntity, qboolean *handled);	// client command
 };
 
 
-// A list of registered commands.
+// A list of registered commands; either server commands, or client
+// commands dispatched from ClientCommand.
 class MRegCmdList : public class_metamod_new {
 	private:
 	// data:
 		MRegCmd *mlist;			// malloc'd array of registered commands
 		int size;			// current size of list
 		int endlist;			// index of last used entry
+		mBOOL client;			// client commands; names are case-sensitive
+		MRegNameIndex names;		// name -> mlist slot
 		// Private; to satisfy -Weffc++ "has pointer data members but does
 		// not override" copy/assignment constructor.
 		void operator=(const MRegCmdList &src);
@@ -102,12 +149,13 @@ class MRegCmdList : public class_metamod_new {
 
 	public:
 	// constructor:
-		MRegCmdList(void) DLLINTERNAL;
+		MRegCmdList(mBOOL client_cmds) DLLINTERNAL;
 
 	// functions:
 		MRegCmd * DLLINTERNAL find(const char *findname);	// find by MRegCmd->name
 		MRegCmd * DLLINTERNAL add(const char *addname);
 		void DLLINTERNAL disable(int plugin_id);		// change status to Invalid
+		mBOOL DLLINTERNAL any_valid(int plugin_id);		// plugin has valid ones
 		void DLLINTERNAL show(void);			// list all funcs to console
 		void DLLINTERNAL show(int plugin_id);		// list given plugin's funcs to console
 };
@@ -137,6 +185,7 @@ class MRegCvarList : public class_metamod_new {
 		MRegCvar *vlist;		// malloc'd array of registered cvars
 		int size;			// size of list, ie MAX_REG_CVARS
 		int endlist;			// index of last used entry
+		MRegNameIndex names;		// name -> vlist slot
 		// Private; to satisfy -Weffc++ "has pointer data members but does
 		// not override" copy/assignment constructor.
 		void operator=(const MRegCvarList &src);
@@ -176,6 +225,8 @@ class MRegMsgList : public class_metamod_new {
 		MRegMsg mlist[MAX_REG_MSGS];	// array of registered msgs
 		int size;						// size of list, ie MAX_REG_MSGS
 		int endlist;					// index of last used entry
+		int byid[MAX_REG_MSGS];			// msgid -> mlist slot + 1; 0 if none
+		MRegNameIndex names;			// name -> mlist slot
 
 	public:
 	// constructor:
@@ -0,0 +1,359 @@
+/*
+ * Copyright (c) 2004-2006 Jussi Kivilinna
+ *
+ *    This file is part of "Metamod All-Mod-Support"-patch for Metamod.
+ *
+ *    Metamod is free software; you can redistribute it and/or modify it
+ *    under the terms of the GNU General Public License as published by the
+ *    Free Software Foundation; either version 2 of the License, or (at
+ *    your option) any later version.
+ *
+ *    Metamod is distributed in the hope that it will be useful, but
+ *    WITHOUT ANY WARRANTY; without even the implied warranty of
+ *    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ *    General Public License for more details.
+ *
+ *    You should have received a copy of the GNU General Public License
+ *    along with Metamod; if not, write to the Free Software Foundation,
+ *    Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+ *
+ *    In addition, as a special exception, the author gives permission to
+ *    link the code of this program with the Half-Life Game Engine ("HL
+ *    Engine") and Modified Game Libraries ("MODs") developed by Valve,
+ *    L.L.C ("Valve").  You must obey the GNU General Public License in all
+ *    respects for all of the code used other than the HL Engine and MODs
+ *    from Valve.  If you modify this file, you may extend this exception
+ *    to your version of the file, but you are not obligated to do so.  If
+ *    you do not wish to do so, delete this exception statement from your
+ *    version.
+ *
+ */
+
+#include <string.h>			// memcpy, strlen
+
+#include <extdll.h>			// always
+
+#include "msg_capture.h"	// me
+#include "engine_api.h"		// meta_engfuncs
+#include "metamod.h"		// RegMsgs
+#include "mreg.h"			// MRegMsgList
+#include "log_meta.h"		// META_DEBUG, etc
+#include "osdep.h"			// likely, unlikely
+
+// Big enough for any user message; svc messages can be larger, and are
+// passed on uncaptured if they don't fit.
+#define MAX_CAPTURE_DATA	1024
+#define MAX_CAPTURE_WRITES	512
+#define MAX_MSG_HOOKS		256
+
+typedef struct msg_hook_s {
+	MPlugin *plugin;
+	int msgid;
+	USER_MSG_FN pfn;
+} msg_hook_t;
+
+typedef struct msg_write_rec_s {
+	msg_write_t type;
+	union {
+		int ival;
+		float fval;
+		int str_offset;		// start of string in data
+	};
+} msg_write_rec_t;
+
+unsigned char msg_capture_hooks[256];
+mBOOL msg_capturing = mFALSE;
+
+static msg_hook_t msg_hooks[MAX_MSG_HOOKS];
+static int num_msg_hooks = 0;
+// hook being called, kept right if hooks are removed meanwhile
+static int msg_hook_iter = -1;
+
+// message being captured
+static user_msg_t capture_msg;
+static float capture_origin[3];
+static unsigned char capture_data[MAX_CAPTURE_DATA];
+static msg_write_rec_t capture_writes[MAX_CAPTURE_WRITES];
+static int num_capture_writes;
+
+// payload set by hooks, and whether we're calling hooks
+static unsigned char *rewrite_data = NULL;
+static int rewrite_size = 0;
+static mBOOL in_msg_hooks = mFALSE;
+
+// passing a message on, through meta_engfuncs
+static mBOOL msg_replaying = mFALSE;
+
+static void DLLINTERNAL finish_capture(mBOOL end_msg);
+
+mBOOL DLLINTERNAL msg_capture_begin(int msg_dest, int msg_type, const float *pOrigin, edict_t *ed) {
+	if(msg_replaying || in_msg_hooks || msg_type < 0 || msg_type > 255)
+		return(mFALSE);
+	if(unlikely(msg_capturing)) {
+		// no MessageEnd for previous message; pass it on so the engine
+		// can complain about it
+		META_DEBUG(3, ("MessageBegin while capturing message %d", capture_msg.msg_type));
+		finish_capture(mFALSE);
+	}
+
+	capture_msg.msg_dest = msg_dest;
+	capture_msg.msg_type = msg_type;
+	if(pOrigin) {
+		capture_origin[0] = pOrigin[0];
+		capture_origin[1] = pOrigin[1];
+		capture_origin[2] = pOrigin[2];
+		capture_msg.origin = capture_origin;
+	}
+	else
+		capture_msg.origin = NULL;
+	capture_msg.ed = ed;
+	capture_msg.data = capture_data;
+	capture_msg.size = 0;
+	num_capture_writes = 0;
+	msg_capturing = mTRUE;
+	return(mTRUE);
+}
+
+// Pass message on, through the normal wrappers.  If 'data' is given, it's
+// sent as bytes instead of the writes that were captured.  With 'end_msg',
+// it's ended too; otherwise the caller's own MessageEnd or MessageBegin
+// follows.
+static void DLLINTERNAL replay_msg(const unsigned char *data, int size, mBOOL end_msg) {
+	msg_write_rec_t *rec;
+	int i;
+
+	msg_replaying = mTRUE;
+	meta_engfuncs.pfnMessageBegin(capture_msg.msg_dest, capture_msg.msg_type, capture_msg.origin, capture_msg.ed);
+	if(data) {
+		for(i=0; i < size; i++)
+			meta_engfuncs.pfnWriteByte(data[i]);
+	}
+	else {
+		for(i=0; i < num_capture_writes; i++) {
+			rec = &capture_writes[i];
+			switch(rec->type) {
+				case MSG_WRITE_BYTE:
+					meta_engfuncs.pfnWriteByte(rec->ival);
+					break;
+				case MSG_WRITE_CHAR:
+					meta_engfuncs.pfnWriteChar(rec->ival);
+					break;
+				case MSG_WRITE_SHORT:
+					meta_engfuncs.pfnWriteShort(rec->ival);
+					break;
+				case MSG_WRITE_LONG:
+					meta_engfuncs.pfnWriteLong(rec->ival);
+					break;
+				case MSG_WRITE_ANGLE:
+					meta_engfuncs.pfnWriteAngle(rec->fval);
+					break;
+				case MSG_WRITE_COORD:
+					meta_engfuncs.pfnWriteCoord(rec->fval);
+					break;
+				case MSG_WRITE_STRING:
+					meta_engfuncs.pfnWriteString((const char *)&capture_data[rec->str_offset]);
+					break;
+				case MSG_WRITE_ENTITY:
+					meta_engfuncs.pfnWriteEntity(rec->ival);
+					break;
+			}
+		}
+	}
+	if(end_msg)
+		meta_engfuncs.pfnMessageEnd();
+	msg_replaying = mFALSE;
+}
+
+// Message doesn't fit; pass on what we have, and let the rest of it through
+// uncaptured.
+static void DLLINTERNAL capture_overflow(void) {
+	META_DEBUG(3, ("Captured message %d too large; passing it on uncaptured", capture_msg.msg_type));
+	msg_capturing = mFALSE;
+	replay_msg(NULL, 0, mFALSE);
+}
+
+// add bytes for write to payload
+static mBOOL DLLINTERNAL capture_bytes(const void *bytes, int size) {
+	if(unlikely(num_capture_writes >= MAX_CAPTURE_WRITES || capture_msg.size + size > MAX_CAPTURE_DATA)) {
+		capture_overflow();
+		return(mFALSE);
+	}
+	memcpy(&capture_data[capture_msg.size], bytes, size);
+	capture_msg.size += size;
+	return(mTRUE);
+}
+
+// store little-endian, as the engine does
+static int DLLINTERNAL encode_int(unsigned char *buf, int value, int size) {
+	int i;
+
+	for(i=0; i < size; i++)
+		buf[i] = (unsigned char)((unsigned int)value >> (i * 8));
+	return(size);
+}
+
+mBOOL DLLINTERNAL msg_capture_write_int(msg_write_t type, int iValue) {
+	unsigned char buf[4];
+	int size;
+
+	switch(type) {
+		case MSG_WRITE_SHORT:
+		case MSG_WRITE_ENTITY:
+			size = encode_int(buf, iValue, 2);
+			break;
+		case MSG_WRITE_LONG:
+			size = encode_int(buf, iValue, 4);
+			break;
+		default:
+			size = encode_int(buf, iValue, 1);
+			break;
+	}
+	if(!capture_bytes(buf, size))
+		return(mFALSE);
+	capture_writes[num_capture_writes].type = type;
+	capture_writes[num_capture_writes].ival = iValue;
+	num_capture_writes++;
+	return(mTRUE);
+}
+
+mBOOL DLLINTERNAL msg_capture_write_float(msg_write_t type, float flValue) {
+	unsigned char buf[2];
+	int size;
+
+	if(type == MSG_WRITE_ANGLE)
+		size = encode_int(buf, (int)(flValue * 256 / 360), 1);
+	else
+		size = encode_int(buf, (int)(flValue * 8), 2);
+	if(!capture_bytes(buf, size))
+		return(mFALSE);
+	capture_writes[num_capture_writes].type = type;
+	capture_writes[num_capture_writes].fval = flValue;
+	num_capture_writes++;
+	return(mTRUE);
+}
+
+mBOOL DLLINTERNAL msg_capture_write_string(const char *sz) {
+	int offset;
+
+	if(!sz)
+		sz = "";
+	offset = capture_msg.size;
+	if(!capture_bytes(sz, strlen(sz) + 1))
+		return(mFALSE);
+	capture_writes[num_capture_writes].type = MSG_WRITE_STRING;
+	capture_writes[num_capture_writes].str_offset = offset;
+	num_capture_writes++;
+	return(mTRUE);
+}
+
+// Call the hooks, and pass message on if none stopped it.
+static void DLLINTERNAL finish_capture(mBOOL end_msg) {
+	msg_hook_t *hook;
+	MPlugin *plug;
+	mBOOL pass;
+
+	msg_capturing = mFALSE;
+
+	pass = mTRUE;
+	in_msg_hooks = mTRUE;
+	for(msg_hook_iter=0; msg_hook_iter < num_msg_hooks && pass; msg_hook_iter++) {
+		hook = &msg_hooks[msg_hook_iter];
+		if(hook->msgid != capture_msg.msg_type || hook->plugin->status != PL_RUNNING)
+			continue;
+		plug = hook->plugin;
+		META_DEBUG(7, ("Calling user msg hook for %s:%d", plug->file, capture_msg.msg_type));
+		if(!(*hook->pfn)(&capture_msg)) {
+			META_DEBUG(5, ("Plugin '%s' blocked user msg %d", plug->desc, capture_msg.msg_type));
+			pass = mFALSE;
+		}
+	}
+	msg_hook_iter = -1;
+	in_msg_hooks = mFALSE;
+
+	if(pass)
+		replay_msg(rewrite_data, rewrite_size, end_msg);
+
+	if(rewrite_data) {
+		free(rewrite_data);
+		rewrite_data = NULL;
+		rewrite_size = 0;
+	}
+}
+
+void DLLINTERNAL msg_capture_end(void) {
+	finish_capture(mTRUE);
+}
+
+mBOOL DLLINTERNAL msg_capture_set_data(MPlugin *plug, const void *data, int size) {
+	unsigned char *newdata;
+
+	if(!in_msg_hooks) {
+		META_WARNING("Plugin '%s' tried to set user msg data outside of user msg hook", plug->desc);
+		RETURN_ERRNO(mFALSE, ME_BADREQ);
+	}
+	if(size < 0 || (size && !data))
+		RETURN_ERRNO(mFALSE, ME_ARGUMENT);
+	newdata = (unsigned char *)malloc(size ? size : 1);
+	if(!newdata)
+		RETURN_ERRNO(mFALSE, ME_NOMEM);
+	if(size)
+		memcpy(newdata, data, size);
+	if(rewrite_data)
+		free(rewrite_data);
+	rewrite_data = newdata;
+	rewrite_size = size;
+	// later hooks see the rewritten message
+	capture_msg.data = rewrite_data;
+	capture_msg.size = rewrite_size;
+	return(mTRUE);
+}
+
+mBOOL DLLINTERNAL msg_capture_add_hook(MPlugin *plug, int msgid, USER_MSG_FN pfnHook) {
+	if(!pfnHook || msgid <= 0 || msgid > 255)
+		RETURN_ERRNO(mFALSE, ME_ARGUMENT);
+	if(!RegMsgs->find(msgid)) {
+		META_WARNING("Plugin '%s' tried to hook unregistered user msg %d", plug->desc, msgid);
+		RETURN_ERRNO(mFALSE, ME_NOTFOUND);
+	}
+	if(num_msg_hooks >= MAX_MSG_HOOKS) {
+		META_WARNING("Couldn't hook user msg %d for plugin '%s'; too many user msg hooks", msgid, plug->desc);
+		RETURN_ERRNO(mFALSE, ME_MAXREACHED);
+	}
+	msg_hooks[num_msg_hooks].plugin = plug;
+	msg_hooks[num_msg_hooks].msgid = msgid;
+	msg_hooks[num_msg_hooks].pfn = pfnHook;
+	num_msg_hooks++;
+	msg_capture_hooks[msgid]++;
+	META_DEBUG(4, ("Plugin '%s' hooked user msg %d", plug->desc, msgid));
+	return(mTRUE);
+}
+
+static void DLLINTERNAL remove_hook(int i) {
+	msg_capture_hooks[msg_hooks[i].msgid]--;
+	if(i <= msg_hook_iter)
+		msg_hook_iter--;
+	// keep order of the rest, for the order hooks are called in
+	memmove(&msg_hooks[i], &msg_hooks[i + 1], (num_msg_hooks - i - 1) * sizeof(msg_hook_t));
+	num_msg_hooks--;
+}
+
+mBOOL DLLINTERNAL msg_capture_remove_hook(MPlugin *plug, int msgid, USER_MSG_FN pfnHook) {
+	int i;
+
+	for(i=0; i < num_msg_hooks; i++) {
+		if(msg_hooks[i].plugin == plug && msg_hooks[i].msgid == msgid && msg_hooks[i].pfn == pfnHook) {
+			remove_hook(i);
+			return(mTRUE);
+		}
+	}
+	RETURN_ERRNO(mFALSE, ME_NOTFOUND);
+}
+
+void DLLINTERNAL msg_capture_remove_plugin(MPlugin *plug) {
+	int i;
+
+	for(i=num_msg_hooks - 1; i >= 0; i--) {
+		if(msg_hooks[i].plugin == plug)
+			remove_hook(i);
+	}
+}
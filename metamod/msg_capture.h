@@ -0,0 +1,90 @@
+/*
+ * Copyright (c) 2004-2006 Jussi Kivilinna
+ *
+ *    This file is part of "Metamod All-Mod-Support"-patch for Metamod.
+ *
+ *    Metamod is free software; you can redistribute it and/or modify it
+ *    under the terms of the GNU General Public License as published by the
+ *    Free Software Foundation; either version 2 of the License, or (at
+ *    your option) any later version.
+ *
+ *    Metamod is distributed in the hope that it will be useful, but
+ *    WITHOUT ANY WARRANTY; without even the implied warranty of
+ *    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ *    General Public License for more details.
+ *
+ *    You should have received a copy of the GNU General Public License
+ *    along with Metamod; if not, write to the Free Software Foundation,
+ *    Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+ *
+ *    In addition, as a special exception, the author gives permission to
+ *    link the code of this program with the Half-Life Game Engine ("HL
+ *    Engine") and Modified Game Libraries ("MODs") developed by Valve,
+ *    L.L.C ("Valve").  You must obey the GNU General Public License in all
+ *    respects for all of the code used other than the HL Engine and MODs
+ *    from Valve.  If you modify this file, you may extend this exception
+ *    to your version of the file, but you are not obligated to do so.  If
+ *    you do not wish to do so, delete this exception statement from your
+ *    version.
+ *
+ */
+
+#ifndef MSG_CAPTURE_H
+#define MSG_CAPTURE_H
+
+#include <extdll.h>			// edict_t
+
+#include "comp_dep.h"
+#include "types_meta.h"		// mBOOL
+#include "mutil.h"			// USER_MSG_FN, user_msg_t
+#include "mplugin.h"		// MPlugin
+
+// Whole-message capture of user messages, for plugins that hooked msg ids
+// with HOOK_USER_MSG.
+//
+// Messages with a hooked msg id are not passed on as they are written.
+// MessageBegin and Write* are buffered, and at MessageEnd the hooks get
+// the whole message once.  Unless a hook blocks it, the message (as
+// rewritten by hooks, if they did) is then sent through the normal
+// MessageBegin/Write*/MessageEnd wrappers, so plugins hooking those still
+// see it, and passed on to the engine.
+
+typedef enum {
+	MSG_WRITE_BYTE = 0,
+	MSG_WRITE_CHAR,
+	MSG_WRITE_SHORT,
+	MSG_WRITE_LONG,
+	MSG_WRITE_ANGLE,
+	MSG_WRITE_COORD,
+	MSG_WRITE_STRING,
+	MSG_WRITE_ENTITY,
+} msg_write_t;
+
+// Number of hooks for each msg id.
+extern unsigned char msg_capture_hooks[256] DLLHIDDEN;
+
+// Message being captured, between MessageBegin and MessageEnd.
+extern mBOOL msg_capturing DLLHIDDEN;
+
+// start capturing message, if msg_type is hooked; returns false to pass
+// the message on as usual
+mBOOL DLLINTERNAL msg_capture_begin(int msg_dest, int msg_type, const float *pOrigin, edict_t *ed);
+
+// add write to captured message; returns false if the message couldn't be
+// buffered, and has been passed on instead, including this write
+mBOOL DLLINTERNAL msg_capture_write_int(msg_write_t type, int iValue);
+mBOOL DLLINTERNAL msg_capture_write_float(msg_write_t type, float flValue);
+mBOOL DLLINTERNAL msg_capture_write_string(const char *sz);
+
+// call hooks with the captured message, and pass it on, ended; from
+// MessageEnd
+void DLLINTERNAL msg_capture_end(void);
+
+mBOOL DLLINTERNAL msg_capture_add_hook(MPlugin *plug, int msgid, USER_MSG_FN pfnHook);
+mBOOL DLLINTERNAL msg_capture_remove_hook(MPlugin *plug, int msgid, USER_MSG_FN pfnHook);
+void DLLINTERNAL msg_capture_remove_plugin(MPlugin *plug);
+
+// replace payload of message being passed to hooks
+mBOOL DLLINTERNAL msg_capture_set_data(MPlugin *plug, const void *data, int size);
+
+#endif /* MSG_CAPTURE_H */
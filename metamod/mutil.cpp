@@ -48,6 +48,12 @@
 #include "types_meta.h"		// mBOOL
 #include "osdep.h"			// win32 vsnprintf, etc
 #include "sdk_util.h"		// ALERT, etc
+#include "msg_capture.h"	// msg_capture_add_hook, etc
+#include "api_hook.h"		// set_msg_hook_filter, set_hook_priority, etc
+#include "ent_filter.h"		// ent_filter_add, etc
+#include "api_async.h"		// api_async_set
+#include "reg_support.h"	// meta_RegClientCommand
+#include "cvar_watch.h"		// cvar_watch_get
 
 static hudtextparms_t default_csay_tparms = {
 	-1, 0.25,			// x, y
@@ -164,7 +170,7 @@ static qboolean mutil_CallGameEntity(plid_t plid, const char *entStr, entvars_t
 	plinfo=(plugin_info_t *)plid;
 	META_DEBUG(8, ("Looking up game entity '%s' for plugin '%s'", entStr,
 				plinfo->name));
-	pfnEntity = (ENTITY_FN) DLSYM(GameDLL.handle, entStr);
+	pfnEntity = (ENTITY_FN) lookup_game_entity(entStr);
 	if(!pfnEntity) {
 		META_WARNING("Couldn't find game entity '%s' in game DLL '%s' for plugin '%s'", entStr, GameDLL.name, plinfo->name);
 		return(false);
@@ -372,6 +378,120 @@ static void mutil_GetHookTables(plid_t UNREFERENCED( plid ), enginefuncs_t **pen
 		*pnewdll = g_pHookedNewDllFunctions;
 }
 
+// Hook user messages with msgid, to be called once per message with the
+// whole message.  See user_msg_t.
+static int mutil_HookUserMsg(plid_t plid, int msgid, USER_MSG_FN pfnHook) {
+	MPlugin *plug;
+
+	plug=Plugins->find(plid);
+	if(!plug)
+		return(0);
+	return(msg_capture_add_hook(plug, msgid, pfnHook));
+}
+
+static int mutil_UnhookUserMsg(plid_t plid, int msgid, USER_MSG_FN pfnHook) {
+	MPlugin *plug;
+
+	plug=Plugins->find(plid);
+	if(!plug)
+		return(0);
+	return(msg_capture_remove_hook(plug, msgid, pfnHook));
+}
+
+// Replace payload of user message; only from a user msg hook.
+static int mutil_SetUserMsgData(plid_t plid, const void *data, int size) {
+	MPlugin *plug;
+
+	plug=Plugins->find(plid);
+	if(!plug)
+		return(0);
+	return(msg_capture_set_data(plug, data, size));
+}
+
+// Limit plugin's message function hooks to some msg ids.
+static int mutil_SetMsgHookFilter(plid_t plid, const int *msgids, int count) {
+	MPlugin *plug;
+
+	plug=Plugins->find(plid);
+	if(!plug)
+		return(0);
+	return(set_msg_hook_filter(plug->index, msgids, count));
+}
+
+// Limit plugin's entity dispatch hooks to some entities.
+static int mutil_AddEntHookFilter(plid_t plid, int hooks, const char *classname, int first_index, int last_index) {
+	MPlugin *plug;
+
+	plug=Plugins->find(plid);
+	if(!plug)
+		return(0);
+	return(ent_filter_add(plug, hooks, classname, first_index, last_index));
+}
+
+static int mutil_ClearEntHookFilter(plid_t plid, int hooks) {
+	MPlugin *plug;
+
+	plug=Plugins->find(plid);
+	if(!plug)
+		return(0);
+	return(ent_filter_clear(plug, hooks));
+}
+
+// Order plugin's hooks against other plugins'.
+static int mutil_SetHookPriority(plid_t plid, int table, int func_offset, int priority, int flags) {
+	MPlugin *plug;
+
+	plug=Plugins->find(plid);
+	if(!plug)
+		return(0);
+	return(set_hook_priority(plug->index, table, func_offset, priority, flags));
+}
+
+// Have plugin's observer called with copies of a function's calls, on the
+// async worker.
+static int mutil_SetAsyncPostHook(plid_t plid, int table, int func_offset, void *pfnObserver) {
+	MPlugin *plug;
+
+	plug=Plugins->find(plid);
+	if(!plug)
+		return(0);
+	if(table != HOOK_TABLE_ENGINE && table != HOOK_TABLE_DLLAPI)
+		return(0);
+	if(func_offset < 0)
+		return(0);
+	return(api_async_set(plug->index, (enum_api_t)table, func_offset, pfnObserver));
+}
+
+// Register a client command, dispatched by metamod from ClientCommand.
+static int mutil_RegClientCommand(plid_t plid, const char *cmd_name, CLIENT_CMD_FN pfnHandler) {
+	MPlugin *plug;
+
+	plug=Plugins->find(plid);
+	if(!plug)
+		return(0);
+	return(meta_RegClientCommand(plug, cmd_name, pfnHandler));
+}
+
+// Look up a cvar once, and maybe watch it for changes.
+static cvar_t *mutil_GetCvarHandle(plid_t plid, const char *name, CVAR_CHANGE_FN pfnChanged) {
+	MPlugin *plug;
+
+	plug=Plugins->find(plid);
+	if(!plug)
+		return(NULL);
+	return(cvar_watch_get(plug, name, pfnChanged));
+}
+
+// Turn plugin's hooks of a function off or on.
+static int mutil_SetHookEnabled(plid_t plid, int table, int func_offset, int post, int enabled) {
+	MPlugin *plug;
+
+	plug=Plugins->find(plid);
+	if(!plug)
+		return(0);
+	return(set_hook_enabled(plug->index, table, func_offset, post, enabled));
+}
+
 // Meta Utility Function table.
 mutil_funcs_t MetaUtilFunctions = {
 	mutil_LogConsole,		// pfnLogConsole
@@ -392,4 +512,15 @@ mutil_funcs_t MetaUtilFunctions = {
 	mutil_IsQueryingClientCvar, // pfnIsQueryingClientCvar
 	mutil_MakeRequestID, 	// pfnMakeRequestID
 	mutil_GetHookTables,   // pfnGetHookTables
+	mutil_HookUserMsg,		// pfnHookUserMsg
+	mutil_UnhookUserMsg,	// pfnUnhookUserMsg
+	mutil_SetUserMsgData,	// pfnSetUserMsgData
+	mutil_SetMsgHookFilter,	// pfnSetMsgHookFilter
+	mutil_AddEntHookFilter,	// pfnAddEntHookFilter
+	mutil_ClearEntHookFilter,	// pfnClearEntHookFilter
+	mutil_SetHookPriority,	// pfnSetHookPriority
+	mutil_SetAsyncPostHook,	// pfnSetAsyncPostHook
+	mutil_RegClientCommand,	// pfnRegClientCommand
+	mutil_GetCvarHandle,	// pfnGetCvarHandle
+	mutil_SetHookEnabled,	// pfnSetHookEnabled
 };
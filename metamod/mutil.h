@@ -55,6 +55,52 @@ typedef enum {
 	GINFO_REALDLL_FULLPATH,
 } ginfo_t;
 
+// User message as captured for HookUserMsg hooks.  Payload is the message
+// as the engine would send it; ie WriteShort is 2 bytes little-endian,
+// WriteCoord a short of coord*8, WriteString the string with its NUL.
+typedef struct user_msg_s {
+	int msg_dest;				// MSG_BROADCAST, MSG_ONE, etc
+	int msg_type;				// msg id
+	const float *origin;		// NULL if none given
+	edict_t *ed;				// NULL if none given
+	const unsigned char *data;	// payload
+	int size;					// payload size in bytes
+} user_msg_t;
+
+// Called once for each message with a hooked msg id, at MessageEnd.
+// Return false to block the message.  SetUserMsgData can be called from
+// here to rewrite the message.
+typedef qboolean (*USER_MSG_FN) (const user_msg_t *msg);
+
+// Client command function, for REG_CLIENT_COMMAND.  Gets the command
+// through CMD_ARGV, etc, as the gamedll's ClientCommand would.  Returns
+// TRUE if it handled the command, which supercedes the gamedll's
+// ClientCommand, like MRES_SUPERCEDE from a ClientCommand pre hook.
+typedef qboolean (*CLIENT_CMD_FN) (edict_t *pEntity);
+
+// Cvar change function, for GET_CVAR_HANDLE.  Called at the start of the
+// frame after the value changed; cvar has the new value.
+typedef void (*CVAR_CHANGE_FN) (cvar_t *cvar, const char *old_value);
+
+// Entity dispatch hooks that ADD_ENT_HOOK_FILTER can limit to some
+// entities.
+#define ENT_HOOK_THINK		(1<<0)
+#define ENT_HOOK_USE		(1<<1)
+#define ENT_HOOK_TOUCH		(1<<2)
+#define ENT_HOOK_BLOCKED	(1<<3)
+#define ENT_HOOK_ALL		(ENT_HOOK_THINK | ENT_HOOK_USE | ENT_HOOK_TOUCH | ENT_HOOK_BLOCKED)
+
+// Function tables, for SET_HOOK_PRIORITY and SET_HOOK_ENABLED.
+#define HOOK_TABLE_ALL		-1
+#define HOOK_TABLE_ENGINE	0		// enginefuncs_t
+#define HOOK_TABLE_DLLAPI	1		// DLL_FUNCTIONS
+#define HOOK_TABLE_NEWAPI	2		// NEW_DLL_FUNCTIONS
+
+// Hook flags for SET_HOOK_PRIORITY.
+// Once this plugin's pre hook returns MRES_SUPERCEDE, pre hooks of plugins
+// after it aren't called for that call.  Post hooks still are.
+#define HOOK_STOP_ON_SUPERCEDE	(1<<0)
+
 // Meta Utility Function table type.
 typedef struct meta_util_funcs_s {
 	void		(*pfnLogConsole)		(plid_t plid, const char *fmt, ...);
@@ -82,6 +128,61 @@ typedef struct meta_util_funcs_s {
 	int (*pfnMakeRequestID)	(plid_t plid);
 	
 	void            (*pfnGetHookTables)             (plid_t plid, enginefuncs_t **peng, DLL_FUNCTIONS **pdll, NEW_DLL_FUNCTIONS **pnewdll);
+	
+	int (*pfnHookUserMsg)	(plid_t plid, int msgid, USER_MSG_FN pfnHook);
+	int (*pfnUnhookUserMsg)	(plid_t plid, int msgid, USER_MSG_FN pfnHook);
+	int (*pfnSetUserMsgData)	(plid_t plid, const void *data, int size);
+	
+	// Limit MessageBegin/MessageEnd/Write* hooks to the given msg ids;
+	// msgids NULL means all of them again.
+	int (*pfnSetMsgHookFilter)	(plid_t plid, const int *msgids, int count);
+	
+	// Limit given ENT_HOOK_* hooks to entities with classname (NULL for
+	// any, trailing '*' for prefix) and index in first..last (last -1 for
+	// no limit).  Hooks with filters get entities matching any of them.
+	int (*pfnAddEntHookFilter)	(plid_t plid, int hooks, const char *classname, int first_index, int last_index);
+	int (*pfnClearEntHookFilter)	(plid_t plid, int hooks);
+	
+	// Order plugin's hooks for a function against other plugins': higher
+	// priority hooks are called first, both pre and post; default is 0,
+	// and equal ones go in plugins.ini order.  func_offset is the offset
+	// in the HOOK_TABLE_* table, eg. offsetof(DLL_FUNCTIONS,
+	// pfnClientCommand), or -1 for every function in it.  flags are
+	// HOOK_* flags, replacing earlier ones for those functions.
+	int (*pfnSetHookPriority)	(plid_t plid, int table, int func_offset, int priority, int flags);
+	
+	// Call pfnObserver, of the same type as the function, after each call
+	// of the function in a HOOK_TABLE_ENGINE or HOOK_TABLE_DLLAPI table,
+	// with a copy of its arguments, on a separate thread some time later.
+	// Except an edict_t * argument is passed as an int, the entity index
+	// (-1 for NULL), as the edict may be reused by then.
+	// Observers mustn't call engine functions or use gpMetaGlobals.  Only
+	// some functions can have observers: client connect/disconnect/kill/
+	// putinserver/userinfo, server activate/deactivate, and the message
+	// functions.  pfnObserver NULL removes the observer.
+	int (*pfnSetAsyncPostHook)	(plid_t plid, int table, int func_offset, void *pfnObserver);
+	
+	// Have metamod call pfnHandler for client command cmd_name (case
+	// matters), instead of the plugin checking for it in ClientCommand.
+	// It's called in the plugin's place among ClientCommand pre hooks,
+	// by the plugin's SET_HOOK_PRIORITY for ClientCommand, and other
+	// plugins' hooks still see the command.  Only one running plugin can
+	// have a command.  pfnHandler NULL removes the command; unloading the
+	// plugin removes all of them.
+	int (*pfnRegClientCommand)	(plid_t plid, const char *cmd_name, CLIENT_CMD_FN pfnHandler);
+	
+	// The engine's cvar_t for cvar name, or NULL if there isn't one.  It
+	// stays valid, so read value/string from it rather than looking the
+	// cvar up by name every time.  If pfnChanged is given, it's called
+	// when the value changes; NULL stops that.
+	cvar_t *(*pfnGetCvarHandle)	(plid_t plid, const char *name, CVAR_CHANGE_FN pfnChanged);
+	
+	// Turn plugin's pre (post 0) or post (post 1) hook of a function off
+	// or on, with table and func_offset as for SET_HOOK_PRIORITY.  While
+	// off, the hook isn't called, and costs nothing; the function goes
+	// straight to the engine/gamedll if no other plugin hooks it.  Hooks
+	// start out on, as given in the plugin's function tables.
+	int (*pfnSetHookEnabled)	(plid_t plid, int table, int func_offset, int post, int enabled);
 } mutil_funcs_t;
 extern mutil_funcs_t MetaUtilFunctions DLLHIDDEN;
 
@@ -104,5 +205,16 @@ extern mutil_funcs_t MetaUtilFunctions DLLHIDDEN;
 #define IS_QUERYING_CLIENT_CVAR (*gpMetaUtilFuncs->pfnIsQueryingClientCvar)
 #define MAKE_REQUESTID		(*gpMetaUtilFuncs->pfnMakeRequestID)
 #define GET_HOOK_TABLES         (*gpMetaUtilFuncs->pfnGetHookTables)
+#define HOOK_USER_MSG		(*gpMetaUtilFuncs->pfnHookUserMsg)
+#define UNHOOK_USER_MSG		(*gpMetaUtilFuncs->pfnUnhookUserMsg)
+#define SET_USER_MSG_DATA	(*gpMetaUtilFuncs->pfnSetUserMsgData)
+#define SET_MSG_HOOK_FILTER	(*gpMetaUtilFuncs->pfnSetMsgHookFilter)
+#define ADD_ENT_HOOK_FILTER	(*gpMetaUtilFuncs->pfnAddEntHookFilter)
+#define CLEAR_ENT_HOOK_FILTER	(*gpMetaUtilFuncs->pfnClearEntHookFilter)
+#define SET_HOOK_PRIORITY	(*gpMetaUtilFuncs->pfnSetHookPriority)
+#define SET_ASYNC_POST_HOOK	(*gpMetaUtilFuncs->pfnSetAsyncPostHook)
+#define REG_CLIENT_COMMAND	(*gpMetaUtilFuncs->pfnRegClientCommand)
+#define GET_CVAR_HANDLE		(*gpMetaUtilFuncs->pfnGetCvarHandle)
+#define SET_HOOK_ENABLED	(*gpMetaUtilFuncs->pfnSetHookEnabled)
 
 #endif /* MUTIL_H */
@@ -52,6 +52,9 @@
 #include "types_meta.h"		// mBOOL
 #include "support_meta.h"	// MAX_STRBUF_LEN
 #include "limits.h"		// INT_MAX
+#ifdef linux
+	#include "osdep_modmap_linux.h"	// modmap_find, modmap_refresh
+#endif
 
 
 mBOOL dlclose_handle_invalid;
@@ -364,6 +367,11 @@ char * DLLINTERNAL realpath(const char *file_name, char *resolved_name) {
 //  - ME_NOTFOUND	couldn't find a matching sharedlib for this ptr
 mBOOL DLLINTERNAL IS_VALID_PTR(void *memptr) {
 	Dl_info dli;
+	// cheap check against the modules we know of first; a library
+	// unloaded since the snapshot would still be in it, so only use
+	// one that's up to date
+	if(modmap_refresh() && modmap_find(memptr))
+		return(mTRUE);
 	memset(&dli, 0, sizeof(dli));
 	if(dladdr(memptr, &dli))
 		return(mTRUE);
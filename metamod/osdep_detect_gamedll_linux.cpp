@@ -36,13 +36,15 @@
 #include <dlfcn.h>			// dlopen, dladdr, etc
 #include <signal.h>			// sigaction, etc
 #include <setjmp.h>			// sigsetjmp, longjmp, etc
-#include <sys/mman.h>			// mmap, munmap, mprotect, etc
 #include <link.h>
 #include <elf.h>
+#include <fcntl.h>			// open
+#include <unistd.h>			// pread, close
 
 #include <extdll.h>			// always
 
 #include "osdep_p.h"			// me
+#include "osdep_elf_linux.h"	// elf_open, elf_find_exports
 #include "support_meta.h"		// STRNCPY
 
 /*
@@ -64,89 +66,51 @@ static void signal_handler_sigsegv(int) {
 	longjmp(signal_jmp_buf, 1);
 }
 
-#define invalid_elf_ptr(x) (((unsigned long)&(x)) > file_end - 1)
-#define invalid_elf_offset(x) (((unsigned long)(x)) > filesize - 1)
-#define elf_error_exit() \
-	do { \
-		sigaction(SIGSEGV, &oldaction, 0); \
-		META_DEBUG(3, ("is_gamedll(%s): Invalid ELF.", filename)); \
-		munmap(ehdr, filesize); \
-		return(mFALSE); \
-	} while(0)
+// Exports looked up by is_gamedll().
+enum {
+	EXP_GiveFnptrsToDll = 0,
+	EXP_GetEntityAPI2,
+	EXP_GetEntityAPI,
+	EXP_Meta_Init,
+	EXP_Meta_Query,
+	EXP_Meta_Attach,
+	EXP_Meta_Detach,
+	NUM_GAMEDLL_EXPORTS,
+};
+static const char * const gamedll_exports[NUM_GAMEDLL_EXPORTS] = {
+	"GiveFnptrsToDll",
+	"GetEntityAPI2",
+	"GetEntityAPI",
+	"Meta_Init",
+	"Meta_Query",
+	"Meta_Attach",
+	"Meta_Detach",
+};
+
+#ifdef __x86_64__
+	#define is_func_export(sym) ((sym) && ELF64_ST_TYPE((sym)->st_info) == STT_FUNC && ELF64_ST_BIND((sym)->st_info) == STB_GLOBAL)
+#else
+	#define is_func_export(sym) ((sym) && ELF32_ST_TYPE((sym)->st_info) == STT_FUNC && ELF32_ST_BIND((sym)->st_info) == STB_GLOBAL)
+#endif
 
 mBOOL DLLINTERNAL is_gamedll(const char *filename) {
 	// When these are not static there are some mysterious hidden bugs that I can't find/solve.
 	// So this is simple workaround.
 	static struct sigaction action;
 	static struct sigaction oldaction;
-	static ElfW(Ehdr)  * ehdr = 0;
-	static ElfW(Shdr)  * shdr = 0;
-	static ElfW(Sym)   * symtab = 0;
-	static char        * strtab = 0;
-	static FILE        * pf = 0;
-	static unsigned long filesize = 0;
-	static unsigned long strtab_size = 0;
-	static unsigned long nsyms = 0;
-	static unsigned long i = 0;
-	static unsigned long file_end = 0;
-	static char        * funcname = 0;
-	static int           has_GiveFnptrsToDll = 0;
-	static int           has_GetEntityAPI2 = 0;
-	static int           has_GetEntityAPI = 0;
-	
-	ehdr = 0;
-	shdr = 0;
-	symtab = 0;
-	strtab = 0;
-	pf = 0;
-	filesize = 0;
-	file_end = 0;
-	strtab_size = 0;
-	nsyms = 0;
-	i = 0;
-	funcname = 0;
-	has_GiveFnptrsToDll = 0;
-	has_GetEntityAPI2 = 0;
-	has_GetEntityAPI = 0;
-	
-	// Try open file and get filesize
-	if((pf = fopen(filename, "rb"))) {
-		fseek(pf, 0, SEEK_END);
-		filesize = ftell(pf);
-		fseek(pf, 0, SEEK_SET);
-	} else {
-		META_DEBUG(3, ("is_gamedll(%s): Failed, cannot fopen() file.", filename));
-				
-		return(mFALSE);
-	}
-	
-	// Check that filesize is atleast size of ELF header!
-	if(filesize < sizeof(ElfW(Ehdr))) {
-#ifdef __x86_64__
-		META_DEBUG(3, ("is_gamedll(%s): Failed, file is too small to be ELF64. [%i < %i]", filename, filesize, sizeof(ElfW(Ehdr))));
-#else
-		META_DEBUG(3, ("is_gamedll(%s): Failed, file is too small to be ELF32. [%i < %i]", filename, filesize, sizeof(ElfW(Ehdr))));
-#endif
-		fclose(pf);
-		
-		return(mFALSE);
-	}
+	static elf_file_t elf;
+	static const ElfW(Sym) * syms[NUM_GAMEDLL_EXPORTS];
+	static int i;
 	
-	// mmap library for easy reading
-	ehdr = (ElfW(Ehdr) *)mmap(0, filesize, PROT_READ|PROT_WRITE, MAP_PRIVATE, fileno(pf), 0);
-	file_end = (unsigned long)ehdr + filesize;
-	
-	// not needed anymore
-	fclose(pf);
-	
-	// check if mmap was successful
-	if(!ehdr || (void*)ehdr==(void*)-1) {
-		META_DEBUG(3, ("is_gamedll(%s): Failed, mmap() [0x%x]", filename, ehdr));
+	// Map file and locate its symbol and hash tables; offsets are checked
+	// against file size.
+	if(!elf_open(&elf, filename)) {
+		META_DEBUG(3, ("is_gamedll(%s): Failed, %s.", filename, elf.error));
 		
 		return(mFALSE);
 	}
 	
-	//In case that ELF file is incomplete (because bad upload etc), we protect memory-mapping access with signal-handler
+	//In case that file shrinks while mapped, we protect memory-mapping access with signal-handler
 	if(!setjmp(signal_jmp_buf)) {
 		memset(&action, 0, sizeof(struct sigaction));
 		memset(&oldaction, 0, sizeof(struct sigaction));
@@ -162,164 +126,40 @@ mBOOL DLLINTERNAL is_gamedll(const char *filename) {
 		
 		META_DEBUG(3, ("is_gamedll(%s): Failed, signal SIGSEGV.", filename));
 				
-		munmap(ehdr, filesize);
+		elf_close(&elf);
 		
 		return(mFALSE);
 	}
 	
-	if(mm_strncmp((char *)ehdr, ELFMAG, SELFMAG) != 0 || ehdr->e_ident[EI_VERSION] != EV_CURRENT) {
-		// Reset signal handler.
-		sigaction(SIGSEGV, &oldaction, 0);
-		
-		META_DEBUG(3, ("is_gamedll(%s): Failed, file isn't ELF (%02x%02x%02x%02x:%x).", filename, 
-			((char *)ehdr)[0], ((char *)ehdr)[1], ((char *)ehdr)[2], ((char *)ehdr)[3], ehdr->e_ident[EI_VERSION]));
-		
-		munmap(ehdr, filesize);
-		
-		return(mFALSE);
-	}
-
-#ifdef __x86_64__
-	// check if x86_64-shared-library
-	if(ehdr->e_ident[EI_CLASS] != ELFCLASS64 || ehdr->e_type != ET_DYN || ehdr->e_machine != EM_X86_64) {
-		// Reset signal handler.
-		sigaction(SIGSEGV, &oldaction, 0);
-		
-		META_DEBUG(3, ("is_gamedll(%s): Failed, ELF isn't for target:x86_64. [%x:%x:%x]", filename, 
-			ehdr->e_ident[EI_CLASS], ehdr->e_type, ehdr->e_machine));
-		
-		munmap(ehdr, filesize);
-		
-		return(mFALSE);
-	}
-#else
-	// check if x86-shared-library
-	if(ehdr->e_ident[EI_CLASS] != ELFCLASS32 || ehdr->e_type != ET_DYN || ehdr->e_machine != EM_386) {
-		// Reset signal handler.
-		sigaction(SIGSEGV, &oldaction, 0);
-		
-		META_DEBUG(3, ("is_gamedll(%s): Failed, ELF isn't for target:i386. [%x:%x:%x]", filename, 
-			ehdr->e_ident[EI_CLASS], ehdr->e_type, ehdr->e_machine));
-		
-		munmap(ehdr, filesize);
-		
-		return(mFALSE);
-	}
-#endif
-
-	//Get symtab and strtab info
-	shdr = (ElfW(Shdr) *)((char *)ehdr + ehdr->e_shoff);
-	if(invalid_elf_ptr(shdr[ehdr->e_shnum]))
-		elf_error_exit();
+	// Hash lookups of the few names we care about, rather than comparing
+	// every symbol.
+	elf_find_exports(&elf, gamedll_exports, NUM_GAMEDLL_EXPORTS, syms);
 	
-	for(i = 0; i < ehdr->e_shnum; i++) {
-		// searching for dynamic linker symbol table
-		if(shdr[i].sh_type == SHT_DYNSYM) {
-			if(invalid_elf_offset(shdr[i].sh_offset) ||
-			   invalid_elf_ptr(shdr[shdr[i].sh_link]) ||
-			   invalid_elf_offset(shdr[shdr[i].sh_link].sh_offset) ||
-			   invalid_elf_ptr(strtab[strtab_size]) ||
-			   invalid_elf_ptr(symtab[nsyms]))
-				elf_error_exit();
-				
-			symtab      = (ElfW(Sym) *)((char *)ehdr + shdr[i].sh_offset);
-			strtab      = (char *)((char *)ehdr + shdr[shdr[i].sh_link].sh_offset);
-			strtab_size = shdr[shdr[i].sh_link].sh_size;
-			nsyms       = shdr[i].sh_size / shdr[i].sh_entsize;
+	// Check if metamod plugin
+	for(i = EXP_Meta_Init; i <= EXP_Meta_Detach; i++) {
+		if(is_func_export(syms[i])) {
+			// Metamod plugin.. is not gamedll
+			META_DEBUG(5, ("is_gamedll(%s): Detected Metamod plugin, library exports [%s].", filename, gamedll_exports[i]));
 			
-			break;
-		}
-	}
-	
-	if(!symtab) {
-		//Another method for finding symtab
-		for(i = 0; i < ehdr->e_shnum; i++) {
-			if(shdr[i].sh_type == SHT_SYMTAB) {
-				if(invalid_elf_offset(shdr[i].sh_offset) ||
-				   invalid_elf_ptr(shdr[shdr[i].sh_link]) ||
-				   invalid_elf_offset(shdr[shdr[i].sh_link].sh_offset) ||
-				   invalid_elf_ptr(strtab[strtab_size]) ||
-				   invalid_elf_ptr(symtab[nsyms]))
-					elf_error_exit();
-				
-				symtab      = (ElfW(Sym) *)((char *)ehdr + shdr[i].sh_offset);
-				strtab      = (char *)((char *)ehdr + shdr[shdr[i].sh_link].sh_offset);
-				strtab_size = shdr[shdr[i].sh_link].sh_size;
-				nsyms       = shdr[i].sh_size / shdr[i].sh_entsize;
-				
-				break;
-			}
-		}
-	}
-	
-	if(!symtab) {
-		// Reset signal handler.
-		sigaction(SIGSEGV, &oldaction, 0);
-		
-		META_DEBUG(3, ("is_gamedll(%s): Failed, couldn't locate symtab.", filename));
-		
-		munmap(ehdr, filesize);
-		
-		return(mFALSE);
-	}
-	
-	//Search symbols for exports
-	for(i = 0; i < nsyms; i++) {
-#ifdef __x86_64__
-		// Export?
-		if(ELF64_ST_TYPE(symtab[i].st_info) != STT_FUNC || ELF64_ST_BIND(symtab[i].st_info) != STB_GLOBAL)
-			continue;
-#else
-		// Export?
-		if(ELF32_ST_TYPE(symtab[i].st_info) != STT_FUNC || ELF32_ST_BIND(symtab[i].st_info) != STB_GLOBAL)
-			continue;
-#endif
-		
-		// string outside strtab?
-		if(symtab[i].st_name <= 0 || symtab[i].st_name >= strtab_size)
-			continue;
-		
-		funcname = &strtab[symtab[i].st_name];
-		
-		// Check
-		// Fast check for 'G' first
-		if(funcname[0] == 'G') {
-			// Collect export information
-			if(!has_GiveFnptrsToDll)
-				has_GiveFnptrsToDll = strmatch(funcname, "GiveFnptrsToDll");
-			if(!has_GetEntityAPI2)
-				has_GetEntityAPI2   = strmatch(funcname, "GetEntityAPI2");
-	  		if(!has_GetEntityAPI)
-	  			has_GetEntityAPI    = strmatch(funcname, "GetEntityAPI");
-	  	}
-		// Check if metamod plugin
-		else if(funcname[0] == 'M') {
-			if(strmatch(funcname, "Meta_Init") || 
-			   strmatch(funcname, "Meta_Query") || 
-			   strmatch(funcname, "Meta_Attach") || 
-			   strmatch(funcname, "Meta_Detach")) {
-				// Metamod plugin.. is not gamedll
-				META_DEBUG(5, ("is_gamedll(%s): Detected Metamod plugin, library exports [%s].", filename, funcname));
-		   		
-				// Reset signal handler.
-				sigaction(SIGSEGV, &oldaction, 0);
-				
-				munmap(ehdr, filesize);
-				
-				return(mFALSE);
-			}
+			// Reset signal handler.
+			sigaction(SIGSEGV, &oldaction, 0);
+			
+			elf_close(&elf);
+			
+			return(mFALSE);
 		}
 	}
 	
 	// Check if gamedll
-	if(has_GiveFnptrsToDll && (has_GetEntityAPI2 || has_GetEntityAPI)) {
+	if(is_func_export(syms[EXP_GiveFnptrsToDll]) && 
+	   (is_func_export(syms[EXP_GetEntityAPI2]) || is_func_export(syms[EXP_GetEntityAPI]))) {
 		// This is gamedll!
 		META_DEBUG(5, ("is_gamedll(%s): Detected GameDLL.", filename));
 		
 		// Reset signal handler.
 		sigaction(SIGSEGV, &oldaction, 0);
-				
-		munmap(ehdr, filesize);
+		
+		elf_close(&elf);
 		
 		return(mTRUE);
 	} else {
@@ -329,7 +169,72 @@ mBOOL DLLINTERNAL is_gamedll(const char *filename) {
 	// Reset signal handler.
 	sigaction(SIGSEGV, &oldaction, 0);
 	
-	munmap(ehdr, filesize);
+	elf_close(&elf);
 	
 	return(mFALSE);
 }
+
+// Read the GNU build-id note through the program headers, with a few
+// small reads instead of mapping the whole file like is_gamedll() does.
+mBOOL DLLINTERNAL get_dll_build_id(const char *filename, char *hexbuf, int buflen) {
+	static const char hexdigits[] = "0123456789abcdef";
+	ElfW(Ehdr) ehdr;
+	ElfW(Phdr) phdr;
+	ElfW(Nhdr) *nhdr;
+	unsigned char notes[1024];
+	unsigned long pos, namesz, descsz;
+	int fd, i, j;
+
+	if(buflen > 0)
+		hexbuf[0] = '\0';
+
+	if((fd = open(filename, O_RDONLY)) < 0)
+		return(mFALSE);
+
+	if(pread(fd, &ehdr, sizeof(ehdr), 0) != sizeof(ehdr) ||
+	   mm_strncmp((char *)ehdr.e_ident, ELFMAG, SELFMAG) != 0 ||
+#ifdef __x86_64__
+	   ehdr.e_ident[EI_CLASS] != ELFCLASS64 ||
+#else
+	   ehdr.e_ident[EI_CLASS] != ELFCLASS32 ||
+#endif
+	   ehdr.e_phentsize != sizeof(phdr))
+	{
+		close(fd);
+		return(mFALSE);
+	}
+
+	for(i = 0; i < ehdr.e_phnum; i++) {
+		if(pread(fd, &phdr, sizeof(phdr), ehdr.e_phoff + i * sizeof(phdr)) != sizeof(phdr))
+			break;
+		if(phdr.p_type != PT_NOTE || phdr.p_filesz > sizeof(notes))
+			continue;
+		if(pread(fd, notes, phdr.p_filesz, phdr.p_offset) != (ssize_t)phdr.p_filesz)
+			continue;
+
+		// Notes are header, name and desc, each padded to 4 bytes.
+		for(pos = 0; pos + sizeof(*nhdr) <= phdr.p_filesz; pos += sizeof(*nhdr) + namesz + descsz) {
+			nhdr = (ElfW(Nhdr) *)&notes[pos];
+			namesz = (nhdr->n_namesz + 3) & ~3;
+			descsz = (nhdr->n_descsz + 3) & ~3;
+			if(pos + sizeof(*nhdr) + namesz + descsz > phdr.p_filesz)
+				break;
+			if(nhdr->n_type != NT_GNU_BUILD_ID || nhdr->n_namesz != 4 ||
+			   mm_strncmp((char *)&notes[pos + sizeof(*nhdr)], "GNU", 4) != 0)
+				continue;
+			if((int)nhdr->n_descsz * 2 + 1 > buflen)
+				break;
+			for(j = 0; j < (int)nhdr->n_descsz; j++) {
+				unsigned char c = notes[pos + sizeof(*nhdr) + namesz + j];
+				hexbuf[j * 2] = hexdigits[c >> 4];
+				hexbuf[j * 2 + 1] = hexdigits[c & 0xf];
+			}
+			hexbuf[j * 2] = '\0';
+			close(fd);
+			return(mTRUE);
+		}
+	}
+
+	close(fd);
+	return(mFALSE);
+}
@@ -223,3 +223,11 @@ mBOOL DLLINTERNAL is_gamedll(const char *filename) {
 		return(mFALSE);
 	}
 }
+
+// PE files have no build-id we can read cheaply; the autodetect cache
+// falls back to size and modification time.
+mBOOL DLLINTERNAL get_dll_build_id(const char * /*filename*/, char *hexbuf, int buflen) {
+	if(buflen > 0)
+		hexbuf[0] = '\0';
+	return(mFALSE);
+}
@@ -0,0 +1,337 @@
+/*
+ * Copyright (c) 2004-2006 Jussi Kivilinna
+ *
+ *    This file is part of "Metamod All-Mod-Support"-patch for Metamod.
+ *
+ *    Metamod is free software; you can redistribute it and/or modify it
+ *    under the terms of the GNU General Public License as published by the
+ *    Free Software Foundation; either version 2 of the License, or (at
+ *    your option) any later version.
+ *
+ *    Metamod is distributed in the hope that it will be useful, but
+ *    WITHOUT ANY WARRANTY; without even the implied warranty of
+ *    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ *    General Public License for more details.
+ *
+ *    You should have received a copy of the GNU General Public License
+ *    along with Metamod; if not, write to the Free Software Foundation,
+ *    Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+ *
+ *    In addition, as a special exception, the author gives permission to
+ *    link the code of this program with the Half-Life Game Engine ("HL
+ *    Engine") and Modified Game Libraries ("MODs") developed by Valve,
+ *    L.L.C ("Valve").  You must obey the GNU General Public License in all
+ *    respects for all of the code used other than the HL Engine and MODs
+ *    from Valve.  If you modify this file, you may extend this exception
+ *    to your version of the file, but you are not obligated to do so.  If
+ *    you do not wish to do so, delete this exception statement from your
+ *    version.
+ *
+ */
+
+#include <sys/mman.h>		// mmap, munmap
+#include <sys/stat.h>		// fstat
+#include <fcntl.h>			// open
+#include <unistd.h>			// close
+
+#include <extdll.h>			// always
+
+#include "osdep_elf_linux.h"	// me
+#include "support_meta.h"		// mm_strcmp
+
+#ifdef __x86_64__
+	#define ELF_HOST_CLASS		ELFCLASS64
+	#define ELF_HOST_MACHINE	EM_X86_64
+	#define ELF_HOST_ST_BIND	ELF64_ST_BIND
+#else
+	#define ELF_HOST_CLASS		ELFCLASS32
+	#define ELF_HOST_MACHINE	EM_386
+	#define ELF_HOST_ST_BIND	ELF32_ST_BIND
+#endif
+
+#define ELF_BLOOM_BITS		(sizeof(ElfW(Addr)) * 8)
+
+// Whether [offset, offset + len) is inside the file.
+static inline mBOOL elf_range_ok(const elf_file_t *elf, unsigned long offset, unsigned long len) {
+	return(offset <= elf->size && len <= elf->size - offset ? mTRUE : mFALSE);
+}
+
+static inline mBOOL elf_is_export(const ElfW(Sym) *sym) {
+	int bind = ELF_HOST_ST_BIND(sym->st_info);
+
+	if(sym->st_shndx == SHN_UNDEF || (bind != STB_GLOBAL && bind != STB_WEAK))
+		return(mFALSE);
+	return(mTRUE);
+}
+
+static inline const char *elf_sym_name(const elf_file_t *elf, const ElfW(Sym) *sym) {
+	if(sym->st_name == 0 || sym->st_name >= elf->strtab_size)
+		return(NULL);
+	return(elf->strtab + sym->st_name);
+}
+
+// Name of symbol, if it's an export of given name.
+static inline mBOOL elf_sym_matches(const elf_file_t *elf, const ElfW(Sym) *sym, const char *name) {
+	const char *symname;
+
+	if(!elf_is_export(sym) || !(symname = elf_sym_name(elf, sym)))
+		return(mFALSE);
+	// strtab isn't necessarily terminated at its end
+	if(!memchr(symname, '\0', elf->strtab_size - sym->st_name))
+		return(mFALSE);
+	return(mm_strcmp(symname, name) == 0 ? mTRUE : mFALSE);
+}
+
+mBOOL DLLINTERNAL elf_open(elf_file_t *elf, const char *filename) {
+	const ElfW(Ehdr) *ehdr;
+	const ElfW(Shdr) *shdr, *link;
+	struct stat st;
+	int i, dynsym, fd;
+
+	memset(elf, 0, sizeof(*elf));
+
+	if((fd = open(filename, O_RDONLY)) < 0) {
+		elf->error = "cannot open file";
+		return(mFALSE);
+	}
+	if(fstat(fd, &st) != 0 || (unsigned long)st.st_size < sizeof(ElfW(Ehdr))) {
+		close(fd);
+		elf->error = "file is too small to be ELF";
+		return(mFALSE);
+	}
+	elf->size = st.st_size;
+	elf->base = (unsigned char *)mmap(0, elf->size, PROT_READ, MAP_PRIVATE, fd, 0);
+	close(fd);
+	if(elf->base == (unsigned char *)MAP_FAILED) {
+		elf->base = NULL;
+		elf->error = "mmap() failed";
+		return(mFALSE);
+	}
+
+	ehdr = (const ElfW(Ehdr) *)elf->base;
+	if(memcmp(ehdr->e_ident, ELFMAG, SELFMAG) != 0 || ehdr->e_ident[EI_VERSION] != EV_CURRENT) {
+		elf->error = "file isn't ELF";
+		goto fail;
+	}
+	if(ehdr->e_ident[EI_CLASS] != ELF_HOST_CLASS || ehdr->e_type != ET_DYN || ehdr->e_machine != ELF_HOST_MACHINE) {
+		elf->error = "ELF isn't shared library for this target";
+		goto fail;
+	}
+	if(ehdr->e_shentsize != sizeof(ElfW(Shdr)) ||
+	   !elf_range_ok(elf, ehdr->e_shoff, (unsigned long)ehdr->e_shnum * sizeof(ElfW(Shdr))))
+	{
+		elf->error = "invalid section headers";
+		goto fail;
+	}
+	shdr = (const ElfW(Shdr) *)(elf->base + ehdr->e_shoff);
+
+	// Prefer the dynamic linker's symbol table; that's what the hash
+	// tables index.
+	dynsym = -1;
+	for(i = 0; i < ehdr->e_shnum && dynsym < 0; i++) {
+		if(shdr[i].sh_type == SHT_DYNSYM)
+			dynsym = i;
+	}
+	for(i = 0; i < ehdr->e_shnum && dynsym < 0; i++) {
+		if(shdr[i].sh_type == SHT_SYMTAB)
+			dynsym = i;
+	}
+	if(dynsym < 0) {
+		elf->error = "couldn't locate symtab";
+		goto fail;
+	}
+	if(shdr[dynsym].sh_entsize != sizeof(ElfW(Sym)) || shdr[dynsym].sh_link >= ehdr->e_shnum ||
+	   !elf_range_ok(elf, shdr[dynsym].sh_offset, shdr[dynsym].sh_size))
+	{
+		elf->error = "invalid symtab";
+		goto fail;
+	}
+	link = &shdr[shdr[dynsym].sh_link];
+	if(!elf_range_ok(elf, link->sh_offset, link->sh_size)) {
+		elf->error = "invalid strtab";
+		goto fail;
+	}
+	elf->symtab = (const ElfW(Sym) *)(elf->base + shdr[dynsym].sh_offset);
+	elf->nsyms = shdr[dynsym].sh_size / sizeof(ElfW(Sym));
+	elf->strtab = (const char *)(elf->base + link->sh_offset);
+	elf->strtab_size = link->sh_size;
+
+	for(i = 0; i < ehdr->e_shnum; i++) {
+		if(shdr[i].sh_link != (unsigned int)dynsym || !elf_range_ok(elf, shdr[i].sh_offset, shdr[i].sh_size))
+			continue;
+		if(shdr[i].sh_type == SHT_GNU_HASH && shdr[i].sh_size >= 4 * sizeof(Elf32_Word)) {
+			elf->gnu_hash = (const Elf32_Word *)(elf->base + shdr[i].sh_offset);
+			elf->gnu_hash_size = shdr[i].sh_size;
+		}
+		else if(shdr[i].sh_type == SHT_HASH && shdr[i].sh_size >= 2 * sizeof(Elf32_Word)) {
+			elf->sysv_hash = (const Elf32_Word *)(elf->base + shdr[i].sh_offset);
+			elf->sysv_hash_size = shdr[i].sh_size;
+		}
+	}
+
+	return(mTRUE);
+
+fail:
+	munmap(elf->base, elf->size);
+	elf->base = NULL;
+	return(mFALSE);
+}
+
+void DLLINTERNAL elf_close(elf_file_t *elf) {
+	if(elf->base)
+		munmap(elf->base, elf->size);
+	elf->base = NULL;
+	elf->symtab = NULL;
+	elf->nsyms = 0;
+}
+
+// DT_GNU_HASH lookup; see the glibc dl-lookup.c for the layout.
+// Returns mFALSE if the table turns out to be unusable.
+static mBOOL DLLINTERNAL elf_gnu_lookup(const elf_file_t *elf, const char *name, const ElfW(Sym) **result) {
+	const Elf32_Word *table = elf->gnu_hash;
+	unsigned long words = elf->gnu_hash_size / sizeof(Elf32_Word);
+	const ElfW(Addr) *bloom;
+	const Elf32_Word *buckets, *chain;
+	Elf32_Word nbuckets, symoffset, bloom_size, bloom_shift, hash, chainhash;
+	ElfW(Addr) word, mask;
+	unsigned long symix;
+	const unsigned char *cp;
+
+	nbuckets = table[0];
+	symoffset = table[1];
+	bloom_size = table[2];
+	bloom_shift = table[3];
+	if(!nbuckets || !bloom_size ||
+	   4 + (unsigned long)bloom_size * (sizeof(ElfW(Addr)) / sizeof(Elf32_Word)) + nbuckets > words)
+		return(mFALSE);
+	bloom = (const ElfW(Addr) *)&table[4];
+	buckets = (const Elf32_Word *)&bloom[bloom_size];
+	chain = &buckets[nbuckets];
+
+	hash = 5381;
+	for(cp = (const unsigned char *)name; *cp; cp++)
+		hash = hash * 33 + *cp;
+
+	*result = NULL;
+	word = bloom[(hash / ELF_BLOOM_BITS) % bloom_size];
+	mask = ((ElfW(Addr))1 << (hash % ELF_BLOOM_BITS)) |
+		((ElfW(Addr))1 << ((hash >> bloom_shift) % ELF_BLOOM_BITS));
+	if((word & mask) != mask)
+		return(mTRUE);
+
+	symix = buckets[hash % nbuckets];
+	if(symix < symoffset)
+		return(mTRUE);
+	for(;; symix++) {
+		if(symix >= elf->nsyms || (unsigned long)(&chain[symix - symoffset] - table) >= words)
+			return(mFALSE);
+		chainhash = chain[symix - symoffset];
+		if((hash | 1) == (chainhash | 1) && elf_sym_matches(elf, &elf->symtab[symix], name)) {
+			*result = &elf->symtab[symix];
+			return(mTRUE);
+		}
+		if(chainhash & 1)
+			return(mTRUE);
+	}
+}
+
+// DT_HASH lookup.
+static mBOOL DLLINTERNAL elf_sysv_lookup(const elf_file_t *elf, const char *name, const ElfW(Sym) **result) {
+	const Elf32_Word *table = elf->sysv_hash;
+	unsigned long words = elf->sysv_hash_size / sizeof(Elf32_Word);
+	const Elf32_Word *buckets, *chain;
+	Elf32_Word nbuckets, nchain, hash, g;
+	unsigned long symix, steps;
+	const unsigned char *cp;
+
+	nbuckets = table[0];
+	nchain = table[1];
+	if(!nbuckets || 2 + (unsigned long)nbuckets + nchain > words)
+		return(mFALSE);
+	buckets = &table[2];
+	chain = &buckets[nbuckets];
+
+	hash = 0;
+	for(cp = (const unsigned char *)name; *cp; cp++) {
+		hash = (hash << 4) + *cp;
+		if((g = hash & 0xf0000000) != 0)
+			hash ^= g >> 24;
+		hash &= ~g;
+	}
+
+	*result = NULL;
+	// bounded by nchain, in case of a loop in a damaged table
+	for(symix = buckets[hash % nbuckets], steps = 0; symix != STN_UNDEF; symix = chain[symix], steps++) {
+		if(symix >= nchain || symix >= elf->nsyms || steps > nchain)
+			return(mFALSE);
+		if(elf_sym_matches(elf, &elf->symtab[symix], name)) {
+			*result = &elf->symtab[symix];
+			return(mTRUE);
+		}
+	}
+	return(mTRUE);
+}
+
+const ElfW(Sym) * DLLINTERNAL elf_lookup_export(const elf_file_t *elf, const char *name) {
+	const ElfW(Sym) *sym = NULL;
+
+	if(!elf->symtab)
+		return(NULL);
+	elf_find_exports(elf, &name, 1, &sym);
+	return(sym);
+}
+
+int DLLINTERNAL elf_find_exports(const elf_file_t *elf, const char * const *names, int count, const ElfW(Sym) **syms) {
+	const char *symname;
+	unsigned long i;
+	int j, found = 0;
+	mBOOL hashed = mTRUE;
+
+	for(j = 0; j < count; j++)
+		syms[j] = NULL;
+	if(!elf->symtab)
+		return(0);
+
+	for(j = 0; j < count && hashed; j++) {
+		if(elf->gnu_hash)
+			hashed = elf_gnu_lookup(elf, names[j], &syms[j]);
+		else if(elf->sysv_hash)
+			hashed = elf_sysv_lookup(elf, names[j], &syms[j]);
+		else
+			hashed = mFALSE;
+		if(hashed && syms[j])
+			found++;
+	}
+	if(hashed)
+		return(found);
+
+	// No (usable) hash table; check every symbol against all names.
+	found = 0;
+	for(j = 0; j < count; j++)
+		syms[j] = NULL;
+	for(i = 0; i < elf->nsyms && found < count; i++) {
+		if(!elf_is_export(&elf->symtab[i]) || !(symname = elf_sym_name(elf, &elf->symtab[i])))
+			continue;
+		for(j = 0; j < count; j++) {
+			if(!syms[j] && elf_sym_matches(elf, &elf->symtab[i], names[j])) {
+				syms[j] = &elf->symtab[i];
+				found++;
+			}
+		}
+	}
+	return(found);
+}
+
+void DLLINTERNAL elf_for_each_export(const elf_file_t *elf, elf_export_callback_t callback, void *data) {
+	const char *symname;
+	unsigned long i;
+
+	for(i = 0; i < elf->nsyms; i++) {
+		if(!elf_is_export(&elf->symtab[i]) || !(symname = elf_sym_name(elf, &elf->symtab[i])))
+			continue;
+		if(!memchr(symname, '\0', elf->strtab_size - elf->symtab[i].st_name))
+			continue;
+		if(!callback(symname, &elf->symtab[i], data))
+			return;
+	}
+}
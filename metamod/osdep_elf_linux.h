@@ -0,0 +1,80 @@
+/*
+ * Copyright (c) 2004-2006 Jussi Kivilinna
+ *
+ *    This file is part of "Metamod All-Mod-Support"-patch for Metamod.
+ *
+ *    Metamod is free software; you can redistribute it and/or modify it
+ *    under the terms of the GNU General Public License as published by the
+ *    Free Software Foundation; either version 2 of the License, or (at
+ *    your option) any later version.
+ *
+ *    Metamod is distributed in the hope that it will be useful, but
+ *    WITHOUT ANY WARRANTY; without even the implied warranty of
+ *    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ *    General Public License for more details.
+ *
+ *    You should have received a copy of the GNU General Public License
+ *    along with Metamod; if not, write to the Free Software Foundation,
+ *    Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+ *
+ *    In addition, as a special exception, the author gives permission to
+ *    link the code of this program with the Half-Life Game Engine ("HL
+ *    Engine") and Modified Game Libraries ("MODs") developed by Valve,
+ *    L.L.C ("Valve").  You must obey the GNU General Public License in all
+ *    respects for all of the code used other than the HL Engine and MODs
+ *    from Valve.  If you modify this file, you may extend this exception
+ *    to your version of the file, but you are not obligated to do so.  If
+ *    you do not wish to do so, delete this exception statement from your
+ *    version.
+ *
+ */
+
+#ifndef OSDEP_ELF_LINUX_H
+#define OSDEP_ELF_LINUX_H
+
+#include <link.h>			// ElfW
+#include <elf.h>			// Elf32_Word, etc
+
+#include "types_meta.h"		// mBOOL
+#include "osdep.h"			// DLLINTERNAL
+
+// Reader for the exported symbols of an ELF shared library on disk, for
+// looking at game and plugin dlls without loading them.  Names are looked
+// up through the DT_GNU_HASH or DT_HASH table where the library has one,
+// falling back to a linear scan of the symbol table.
+//
+// Only libraries of the class and machine metamod itself is built for are
+// accepted.  All offsets are checked against the file size, so damaged
+// files fail elf_open() or miss symbols rather than crash.
+typedef struct elf_file_s {
+	unsigned char *base;			// mapped file
+	unsigned long size;
+	const ElfW(Sym) *symtab;		// .dynsym, or .symtab if none
+	unsigned long nsyms;
+	const char *strtab;
+	unsigned long strtab_size;
+	const Elf32_Word *gnu_hash;		// hash tables for symtab, if any
+	unsigned long gnu_hash_size;
+	const Elf32_Word *sysv_hash;
+	unsigned long sysv_hash_size;
+	const char *error;				// why elf_open() failed
+} elf_file_t;
+
+// Callback for elf_for_each_export(); return mFALSE to stop.
+typedef mBOOL (*elf_export_callback_t)(const char *name, const ElfW(Sym) *sym, void *data);
+
+mBOOL DLLINTERNAL elf_open(elf_file_t *elf, const char *filename);
+void DLLINTERNAL elf_close(elf_file_t *elf);
+
+// Defined global or weak symbol of given name, or NULL.
+const ElfW(Sym) * DLLINTERNAL elf_lookup_export(const elf_file_t *elf, const char *name);
+
+// Look up several names at once; syms[i] gets the symbol for names[i] or
+// NULL.  Returns number found.  Without hash tables this is one pass over
+// the symbol table for all names.
+int DLLINTERNAL elf_find_exports(const elf_file_t *elf, const char * const *names, int count, const ElfW(Sym) **syms);
+
+// Call callback for every defined global or weak symbol.
+void DLLINTERNAL elf_for_each_export(const elf_file_t *elf, elf_export_callback_t callback, void *data);
+
+#endif /* OSDEP_ELF_LINUX_H */
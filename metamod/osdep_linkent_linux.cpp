@@ -45,13 +45,25 @@
 
 #include "osdep.h"
 #include "osdep_p.h"
+#include "osdep_elf_linux.h"	// elf_open, elf_for_each_export
 #include "log_meta.h"			// META_LOG, etc
 #include "support_meta.h"
+#include "metamod.h"			// g_engfuncs
 
 //
 // Linux code for dynamic linkents
 //  -- by Jussi Kivilinna
 //
+// The engine finds entity functions with dlsym() on the metamod handle,
+// so those lookups have to reach the game dll.  We index the game dll's
+// exports once at load time and point the engine's GOT entry for dlsym at
+// a replacement that answers from the index.  Only the engine's calls go
+// through it, and the index is read-only after load, so no locking.
+//
+// If the engine's dlsym relocation can't be found, we fall back to
+// writing a jmp into libc's dlsym, which serializes every dlsym call in
+// the process.
+//
 
 //opcode, e9, + sizeof pointer
 #define BYTES_SIZE (1 + sizeof(void*))
@@ -64,12 +76,330 @@ static void * metamod_module_handle = 0;
 //pointer to original dlsym
 static dlsym_func dlsym_original;
 
-//contains jmp to replacement_dlsym @dlsym_original
+//
+// Game dll export index
+//
+
+typedef struct linkent_s {
+	const char *name;
+	void *pfn;
+	unsigned int hash;
+} linkent_t;
+
+static linkent_t *linkent_table = 0;	// open addressing; size is power of 2
+static unsigned int linkent_mask = 0;
+static char *linkent_names = 0;
+
+typedef struct linkent_build_s {
+	ElfW(Addr) base;
+	elf_file_t self;			// metamod's own file, for its exports
+	unsigned int count;
+	unsigned long names_size;
+	char *names_end;
+} linkent_build_t;
+
+static inline unsigned int linkent_hash(const char *name) {
+	unsigned int hash = 5381;
+
+	while(*name)
+		hash = hash * 33 + (unsigned char)*name++;
+	return(hash);
+}
+
+// Whether export is a candidate entity function: a plain C function name
+// (not mangled or reserved), and not shadowed by one of our own exports,
+// which the engine has always gotten first.
+static mBOOL linkent_wanted(const linkent_build_t *build, const char *name, const ElfW(Sym) *sym) {
+#ifdef __x86_64__
+	if(ELF64_ST_TYPE(sym->st_info) != STT_FUNC)
+#else
+	if(ELF32_ST_TYPE(sym->st_info) != STT_FUNC)
+#endif
+		return(mFALSE);
+	if(name[0] == '_' || name[0] == '\0')
+		return(mFALSE);
+	if(elf_lookup_export(&build->self, name))
+		return(mFALSE);
+	return(mTRUE);
+}
+
+static mBOOL linkent_count_export(const char *name, const ElfW(Sym) *sym, void *data) {
+	linkent_build_t *build = (linkent_build_t *)data;
+
+	if(linkent_wanted(build, name, sym)) {
+		build->count++;
+		build->names_size += strlen(name) + 1;
+	}
+	return(mTRUE);
+}
+
+static mBOOL linkent_add_export(const char *name, const ElfW(Sym) *sym, void *data) {
+	linkent_build_t *build = (linkent_build_t *)data;
+	linkent_t *entry;
+	unsigned int hash, i;
+	int len;
+
+	if(!linkent_wanted(build, name, sym))
+		return(mTRUE);
+
+	hash = linkent_hash(name);
+	for(i = hash & linkent_mask; linkent_table[i].name; i = (i + 1) & linkent_mask) {
+		// first definition wins, as with dlsym
+		if(linkent_table[i].hash == hash && !mm_strcmp(linkent_table[i].name, name))
+			return(mTRUE);
+	}
+	len = strlen(name) + 1;
+	memcpy(build->names_end, name, len);
+	entry = &linkent_table[i];
+	entry->name = build->names_end;
+	entry->pfn = (void *)(build->base + sym->st_value);
+	entry->hash = hash;
+	build->names_end += len;
+	return(mTRUE);
+}
+
+static void * DLLINTERNAL linkent_find(const char *name) {
+	unsigned int hash, i;
+
+	if(!linkent_table)
+		return(0);
+	hash = linkent_hash(name);
+	for(i = hash & linkent_mask; linkent_table[i].name; i = (i + 1) & linkent_mask) {
+		if(linkent_table[i].hash == hash && !mm_strcmp(linkent_table[i].name, name))
+			return(linkent_table[i].pfn);
+	}
+	return(0);
+}
+
+static void DLLINTERNAL free_linkent_index(void) {
+	free(linkent_table);
+	free(linkent_names);
+	linkent_table = 0;
+	linkent_names = 0;
+	linkent_mask = 0;
+}
+
+// Read game dll's exports from its file, placed at its load address.
+static mBOOL DLLINTERNAL build_linkent_index(void) {
+	struct link_map *map = 0, *self_map = 0;
+	linkent_build_t build;
+	elf_file_t elf;
+	unsigned int size;
+	void *check;
+
+	if(dlinfo(gamedll_module_handle, RTLD_DI_LINKMAP, &map) != 0 || !map || !map->l_name || !map->l_name[0]) {
+		META_DEBUG(3, ("linkent: Couldn't get link map for game DLL: %s", dlerror()));
+		return(mFALSE);
+	}
+	// our own exports, read once rather than a dlsym() per game export
+	if(dlinfo(metamod_module_handle, RTLD_DI_LINKMAP, &self_map) != 0 || !self_map || !self_map->l_name || !self_map->l_name[0]) {
+		META_DEBUG(3, ("linkent: Couldn't get link map for metamod: %s", dlerror()));
+		return(mFALSE);
+	}
+	memset(&build, 0, sizeof(build));
+	if(!elf_open(&build.self, self_map->l_name)) {
+		META_DEBUG(3, ("linkent: Couldn't read metamod '%s': %s", self_map->l_name, build.self.error));
+		return(mFALSE);
+	}
+	if(!elf_open(&elf, map->l_name)) {
+		META_DEBUG(3, ("linkent: Couldn't read game DLL '%s': %s", map->l_name, elf.error));
+		elf_close(&build.self);
+		return(mFALSE);
+	}
+
+	build.base = map->l_addr;
+	elf_for_each_export(&elf, linkent_count_export, &build);
+
+	// keep load factor at or below 1/2
+	for(size = 16; size < build.count * 2; size <<= 1)
+		;
+	linkent_table = (linkent_t *)calloc(size, sizeof(linkent_t));
+	linkent_names = (char *)malloc(build.names_size + 1);
+	if(!linkent_table || !linkent_names) {
+		elf_close(&elf);
+		elf_close(&build.self);
+		free_linkent_index();
+		META_WARNING("linkent: Couldn't allocate game DLL export index");
+		return(mFALSE);
+	}
+	linkent_mask = size - 1;
+	build.names_end = linkent_names;
+	elf_for_each_export(&elf, linkent_add_export, &build);
+	elf_close(&elf);
+	elf_close(&build.self);
+
+	// The file should be what was loaded; make sure before trusting it.
+	if((check = linkent_find("GiveFnptrsToDll")) != 0 && check != dlsym_original(gamedll_module_handle, "GiveFnptrsToDll")) {
+		META_WARNING("linkent: Game DLL file doesn't match loaded image; not indexing exports");
+		free_linkent_index();
+		return(mFALSE);
+	}
+
+	META_DEBUG(3, ("linkent: Indexed %d game DLL exports from '%s'", build.count, map->l_name));
+	return(mTRUE);
+}
+
+//
+// Replacement dlsym function, for lookups by the engine
+//
+static void * __replacement_dlsym(void * module, const char * funcname)
+{
+	void * func;
+	
+	if(module != metamod_module_handle || !funcname)
+		return(dlsym_original(module, funcname));
+	
+	//indexed game dll export
+	if((func = linkent_find(funcname)) != 0)
+		return(func);
+	
+	//dlsym on metamod module
+	if((func = dlsym_original(module, funcname)) != 0)
+		return(func);
+	
+	//function not in metamod module, try gamedll
+	return(dlsym_original(gamedll_module_handle, funcname));
+}
+
+//
+// Engine GOT hook
+//
+
+typedef struct find_module_s {
+	ElfW(Addr) addr;
+	struct dl_phdr_info info;
+	int found;
+} find_module_t;
+
+// dl_iterate_phdr callback: find object with a segment containing addr.
+static int find_module_callback(struct dl_phdr_info *info, size_t, void *data) {
+	find_module_t *find = (find_module_t *)data;
+	int i;
+
+	for(i = 0; i < info->dlpi_phnum; i++) {
+		const ElfW(Phdr) *phdr = &info->dlpi_phdr[i];
+		ElfW(Addr) start = info->dlpi_addr + phdr->p_vaddr;
+
+		if(phdr->p_type == PT_LOAD && find->addr >= start && find->addr < start + phdr->p_memsz) {
+			find->info = *info;
+			find->found = 1;
+			return(1);
+		}
+	}
+	return(0);
+}
+
+// Dynamic section pointers are usually relocated in memory by the loader,
+// but not on every platform.
+#define dyn_ptr(base, d) ((d)->d_un.d_ptr < (base) ? (base) + (d)->d_un.d_ptr : (d)->d_un.d_ptr)
+
+// Point engine module's GOT entries for dlsym at our replacement.  Returns
+// number of entries changed.
+static int DLLINTERNAL hook_engine_dlsym(void)
+{
+	find_module_t find;
+	const ElfW(Phdr) *relro = 0;
+	const ElfW(Dyn) *dyn = 0;
+	const ElfW(Sym) *symtab = 0;
+	const char *strtab = 0;
+	ElfW(Addr) base, rel[2] = { 0, 0 };
+	unsigned long relsz[2] = { 0, 0 };
+	int i, j, hooked = 0;
+	
+	memset(&find, 0, sizeof(find));
+	find.addr = (ElfW(Addr))g_engfuncs.pfnPrecacheModel;
+	if(!find.addr || !dl_iterate_phdr(find_module_callback, &find) || !find.found) {
+		META_DEBUG(3, ("linkent: Couldn't find engine module"));
+		return(0);
+	}
+	base = find.info.dlpi_addr;
+	
+	for(i = 0; i < find.info.dlpi_phnum; i++) {
+		if(find.info.dlpi_phdr[i].p_type == PT_DYNAMIC)
+			dyn = (const ElfW(Dyn) *)(base + find.info.dlpi_phdr[i].p_vaddr);
+		else if(find.info.dlpi_phdr[i].p_type == PT_GNU_RELRO)
+			relro = &find.info.dlpi_phdr[i];
+	}
+	if(!dyn)
+		return(0);
+	
+	for(; dyn->d_tag != DT_NULL; dyn++) {
+		switch(dyn->d_tag) {
+			case DT_SYMTAB: symtab = (const ElfW(Sym) *)dyn_ptr(base, dyn); break;
+			case DT_STRTAB: strtab = (const char *)dyn_ptr(base, dyn); break;
+			case DT_JMPREL: rel[0] = dyn_ptr(base, dyn); break;
+			case DT_PLTRELSZ: relsz[0] = dyn->d_un.d_val; break;
+#ifdef __x86_64__
+			case DT_RELA: rel[1] = dyn_ptr(base, dyn); break;
+			case DT_RELASZ: relsz[1] = dyn->d_un.d_val; break;
+#else
+			case DT_REL: rel[1] = dyn_ptr(base, dyn); break;
+			case DT_RELSZ: relsz[1] = dyn->d_un.d_val; break;
+#endif
+		}
+	}
+	if(!symtab || !strtab)
+		return(0);
+	
+	// PLT relocations, then GLOB_DAT ones for code built without a PLT.
+	for(j = 0; j < 2; j++) {
+#ifdef __x86_64__
+		const ElfW(Rela) *r = (const ElfW(Rela) *)rel[j];
+		unsigned long n = relsz[j] / sizeof(ElfW(Rela));
+#else
+		const ElfW(Rel) *r = (const ElfW(Rel) *)rel[j];
+		unsigned long n = relsz[j] / sizeof(ElfW(Rel));
+#endif
+		unsigned long k;
+		
+		for(k = 0; r && k < n; k++) {
+#ifdef __x86_64__
+			unsigned long type = ELF64_R_TYPE(r[k].r_info), symidx = ELF64_R_SYM(r[k].r_info);
+			if(type != R_X86_64_JUMP_SLOT && type != R_X86_64_GLOB_DAT)
+				continue;
+#else
+			unsigned long type = ELF32_R_TYPE(r[k].r_info), symidx = ELF32_R_SYM(r[k].r_info);
+			if(type != R_386_JMP_SLOT && type != R_386_GLOB_DAT)
+				continue;
+#endif
+			if(!symidx || !strmatch(strtab + symtab[symidx].st_name, "dlsym"))
+				continue;
+			
+			void ** slot = (void **)(base + r[k].r_offset);
+			unsigned long page = (unsigned long)slot & PAGE_MASK;
+			mBOOL in_relro = relro && 
+				(ElfW(Addr))slot >= base + relro->p_vaddr && 
+				(ElfW(Addr))slot < base + relro->p_vaddr + relro->p_memsz ? mTRUE : mFALSE;
+			
+			//RELRO pages are read-only once loaded
+			if(in_relro && mprotect((void*)page, PAGE_SIZE, PROT_READ|PROT_WRITE)) {
+				META_DEBUG(3, ("linkent: mprotect failed on engine GOT: %i", errno));
+				continue;
+			}
+			*slot = (void*)&__replacement_dlsym;
+			if(in_relro)
+				mprotect((void*)page, PAGE_SIZE, PROT_READ);
+			hooked++;
+		}
+	}
+	
+	META_DEBUG(3, ("linkent: Hooked %d dlsym entries in engine module '%s'", hooked, find.info.dlpi_name));
+	return(hooked);
+}
+
+//
+// Fallback: patch libc's dlsym
+//
+
+//contains jmp to replacement_dlsym @dlsym_code
 static unsigned char dlsym_new_bytes[BYTES_SIZE];
 
 //contains original bytes of dlsym
 static unsigned char dlsym_old_bytes[BYTES_SIZE];
 
+//dlsym code we patch
+static dlsym_func dlsym_code;
+
 //Mutex for our protection
 static pthread_mutex_t mutex_replacement_dlsym = PTHREAD_RECURSIVE_MUTEX_INITIALIZER_NP;
 
@@ -98,7 +428,7 @@ inline void * extract_function_pointer_from_trampoline_jmp(void *x)
 inline void DLLINTERNAL restore_original_dlsym(void)
 {
 	//Copy old dlsym bytes back
-	memcpy((void*)dlsym_original, dlsym_old_bytes, BYTES_SIZE);
+	memcpy((void*)dlsym_code, dlsym_old_bytes, BYTES_SIZE);
 }
 
 //
@@ -107,13 +437,13 @@ inline void DLLINTERNAL restore_original_dlsym(void)
 inline void DLLINTERNAL reset_dlsym_hook(void)
 {
 	//Copy new dlsym bytes back
-	memcpy((void*)dlsym_original, dlsym_new_bytes, BYTES_SIZE);
+	memcpy((void*)dlsym_code, dlsym_new_bytes, BYTES_SIZE);
 }
 
 //
-// Replacement dlsym function
+// Replacement dlsym function, when patched into libc's dlsym code
 //
-static void * __replacement_dlsym(void * module, const char * funcname)
+static void * __patched_dlsym(void * module, const char * funcname)
 {
 	//these are needed in case dlsym calls dlsym, default one doesn't do
 	//it but some LD_PRELOADed library that hooks dlsym might actually
@@ -131,42 +461,8 @@ static void * __replacement_dlsym(void * module, const char * funcname)
 		
 		is_original_restored = 1;
 	}
-		
-	//check if we should hook this call
-	if(module != metamod_module_handle || !metamod_module_handle || !gamedll_module_handle)
-	{
-		//no metamod/gamedll module? should we remove hook now?
-		void * retval = dlsym_original(module, funcname);
-		
-		if(metamod_module_handle && gamedll_module_handle)
-		{
-			if(!was_original_restored)
-			{
-				//reset dlsym hook
-				reset_dlsym_hook();
-				
-				is_original_restored = 0;
-			}
-		}
-		else
-		{
-			//no metamod/gamedll module? should we remove hook now by not reseting it back?
-		}
-		
-		//unlock
-		pthread_mutex_unlock(&mutex_replacement_dlsym);
-		
-		return(retval);
-	}
-	
-	//dlsym on metamod module
-	void * func = dlsym_original(module, funcname);
 	
-	if(!func)
-	{
-		//function not in metamod module, try gamedll
-		func = dlsym_original(gamedll_module_handle, funcname);
-	}
+	void * func = __replacement_dlsym(module, funcname);
 	
 	if(!was_original_restored)
 	{
@@ -182,33 +478,27 @@ static void * __replacement_dlsym(void * module, const char * funcname)
 	return(func);
 }
 
-//
-// Initialize
-//
-int DLLINTERNAL init_linkent_replacement(DLHANDLE MetamodHandle, DLHANDLE GameDllHandle)
+static int DLLINTERNAL patch_dlsym_code(void)
 {
-	metamod_module_handle = MetamodHandle;
-	gamedll_module_handle = GameDllHandle;
-	
 	// dlsym is already known to be pointing to valid function, we loaded gamedll using it earlier!
 	void * sym_ptr = (void*)&dlsym;
 	while(is_code_trampoline_jmp_opcode(sym_ptr)) {
 		sym_ptr = extract_function_pointer_from_trampoline_jmp(sym_ptr);
 	}
 	
-	dlsym_original = (dlsym_func)sym_ptr;
+	dlsym_code = (dlsym_func)sym_ptr;
 	
 	//Backup old bytes of "dlsym" function
-	memcpy(dlsym_old_bytes, (void*)dlsym_original, BYTES_SIZE);
+	memcpy(dlsym_old_bytes, (void*)dlsym_code, BYTES_SIZE);
 	
 	//Construct new bytes: "jmp offset[replacement_sendto] @ sendto_original"
-	construct_jmp_instruction((void*)&dlsym_new_bytes[0], (void*)dlsym_original, (void*)&__replacement_dlsym);
+	construct_jmp_instruction((void*)&dlsym_new_bytes[0], (void*)dlsym_code, (void*)&__patched_dlsym);
 	
 	//Check if bytes overlap page border.	
-	unsigned long start_of_page = PAGE_ALIGN((long)dlsym_original) - PAGE_SIZE;
+	unsigned long start_of_page = PAGE_ALIGN((long)dlsym_code) - PAGE_SIZE;
 	unsigned long size_of_pages = 0;
 	
-	if((unsigned long)dlsym_original + BYTES_SIZE > PAGE_ALIGN((unsigned long)dlsym_original))
+	if((unsigned long)dlsym_code + BYTES_SIZE > PAGE_ALIGN((unsigned long)dlsym_code))
 	{
 		//bytes are located on two pages
 		size_of_pages = PAGE_SIZE*2;
@@ -232,3 +522,38 @@ int DLLINTERNAL init_linkent_replacement(DLHANDLE MetamodHandle, DLHANDLE GameDl
 	//done
 	return(1);
 }
+
+//
+// Initialize
+//
+int DLLINTERNAL init_linkent_replacement(DLHANDLE MetamodHandle, DLHANDLE GameDllHandle)
+{
+	metamod_module_handle = MetamodHandle;
+	gamedll_module_handle = GameDllHandle;
+	
+	// Our own reference to dlsym is bound to the real function, even if
+	// the engine's is lazily bound.
+	dlsym_original = &dlsym;
+	
+	// Without an index, lookups just go through dlsym as before.
+	free_linkent_index();
+	build_linkent_index();
+	
+	if(hook_engine_dlsym())
+		return(1);
+	
+	META_DEBUG(2, ("linkent: No dlsym relocation in engine module; patching dlsym code"));
+	return(patch_dlsym_code());
+}
+
+//
+// Game entity lookup for plugins
+//
+void * DLLINTERNAL lookup_game_entity(const char *entStr)
+{
+	void * func;
+	
+	if((func = linkent_find(entStr)) != 0)
+		return(func);
+	return(dlsym_original ? dlsym_original(gamedll_module_handle, entStr) : 0);
+}
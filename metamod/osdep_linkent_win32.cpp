@@ -239,7 +239,18 @@ static int DLLINTERNAL_NOVIS combine_module_export_tables(HMODULE moduleMM, HMOD
 //
 // ...
 //
+static HMODULE game_module = 0;
+
 int DLLINTERNAL init_linkent_replacement(DLHANDLE moduleMetamod, DLHANDLE moduleGame)
 {
+	game_module = moduleGame;
 	return(combine_module_export_tables(moduleMetamod, moduleGame));
 }
+
+//
+// GetProcAddress already binary searches the export name table.
+//
+void * DLLINTERNAL lookup_game_entity(const char *entStr)
+{
+	return(game_module ? (void*)GetProcAddress(game_module, entStr) : 0);
+}
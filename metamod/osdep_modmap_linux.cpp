@@ -0,0 +1,229 @@
+/*
+ * Copyright (c) 2004-2006 Jussi Kivilinna
+ *
+ *    This file is part of "Metamod All-Mod-Support"-patch for Metamod.
+ *
+ *    Metamod is free software; you can redistribute it and/or modify it
+ *    under the terms of the GNU General Public License as published by the
+ *    Free Software Foundation; either version 2 of the License, or (at
+ *    your option) any later version.
+ *
+ *    Metamod is distributed in the hope that it will be useful, but
+ *    WITHOUT ANY WARRANTY; without even the implied warranty of
+ *    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ *    General Public License for more details.
+ *
+ *    You should have received a copy of the GNU General Public License
+ *    along with Metamod; if not, write to the Free Software Foundation,
+ *    Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+ *
+ *    In addition, as a special exception, the author gives permission to
+ *    link the code of this program with the Half-Life Game Engine ("HL
+ *    Engine") and Modified Game Libraries ("MODs") developed by Valve,
+ *    L.L.C ("Valve").  You must obey the GNU General Public License in all
+ *    respects for all of the code used other than the HL Engine and MODs
+ *    from Valve.  If you modify this file, you may extend this exception
+ *    to your version of the file, but you are not obligated to do so.  If
+ *    you do not wish to do so, delete this exception statement from your
+ *    version.
+ *
+ */
+
+#include <dlfcn.h>			// dlinfo
+#include <link.h>			// dl_iterate_phdr, link_map
+#include <stddef.h>			// offsetof
+#include <stdlib.h>			// qsort, malloc
+
+#include <extdll.h>			// always
+
+#include "osdep_modmap_linux.h"	// me
+#include "metamod.h"			// Plugins
+#include "mplugin.h"			// class MPlugin
+#include "log_meta.h"			// META_DEBUG, etc
+
+typedef struct modmap_s {
+	int count;
+	int size;
+	modmap_range_t *ranges;
+	unsigned long long adds;		// dl_iterate_phdr load/unload counts
+	unsigned long long subs;		// when taken
+} modmap_t;
+
+typedef struct modmap_owner_s {
+	ElfW(Addr) l_addr;
+	const char *l_name;
+	MPlugin *plugin;
+} modmap_owner_t;
+
+typedef struct modmap_build_s {
+	modmap_t *map;
+	modmap_owner_t owners[MAX_PLUGINS];
+	int num_owners;
+	mBOOL failed;
+} modmap_build_t;
+
+// Current snapshot, and the one it replaced.  The previous one is kept
+// until the next update, so that a lookup running at the time of the
+// swap doesn't read freed memory.
+static modmap_t *cur_modmap = NULL;
+static modmap_t *retired_modmap = NULL;
+
+static void DLLINTERNAL modmap_free(modmap_t *map) {
+	if(!map)
+		return;
+	free(map->ranges);
+	free(map);
+}
+
+static int DLLINTERNAL modmap_compare(const void *a, const void *b) {
+	const modmap_range_t *ra = (const modmap_range_t *)a;
+	const modmap_range_t *rb = (const modmap_range_t *)b;
+
+	if(ra->start < rb->start)
+		return(-1);
+	return(ra->start > rb->start ? 1 : 0);
+}
+
+// Get the loader's counts of modules loaded and unloaded; false if this
+// glibc doesn't have them.
+static int DLLINTERNAL modmap_get_counts(struct dl_phdr_info *info, size_t size, void *data) {
+	unsigned long long *counts = (unsigned long long *)data;
+
+	if(size < offsetof(struct dl_phdr_info, dlpi_subs) + sizeof(info->dlpi_subs))
+		return(0);
+	counts[0] = info->dlpi_adds;
+	counts[1] = info->dlpi_subs;
+	// same for every module
+	return(1);
+}
+
+static mBOOL DLLINTERNAL modmap_counts(unsigned long long *adds, unsigned long long *subs) {
+	unsigned long long counts[2] = { 0, 0 };
+
+	if(!dl_iterate_phdr(modmap_get_counts, counts))
+		return(mFALSE);
+	*adds = counts[0];
+	*subs = counts[1];
+	return(mTRUE);
+}
+
+static int DLLINTERNAL modmap_add_module(struct dl_phdr_info *info, size_t, void *data) {
+	modmap_build_t *build = (modmap_build_t *)data;
+	modmap_t *map = build->map;
+	modmap_range_t *range;
+	MPlugin *plugin = NULL;
+	const char *name = info->dlpi_name ? info->dlpi_name : "";
+	int i;
+
+	for(i=0; i < build->num_owners; i++) {
+		if(build->owners[i].l_addr == info->dlpi_addr 
+				&& strcmp(build->owners[i].l_name, name) == 0) {
+			plugin = build->owners[i].plugin;
+			break;
+		}
+	}
+
+	for(i=0; i < info->dlpi_phnum; i++) {
+		const ElfW(Phdr) *phdr = &info->dlpi_phdr[i];
+
+		if(phdr->p_type != PT_LOAD || phdr->p_memsz == 0)
+			continue;
+		if(map->count == map->size) {
+			int nsize = map->size ? map->size * 2 : 64;
+			modmap_range_t *nranges = (modmap_range_t *)realloc(map->ranges, nsize * sizeof(modmap_range_t));
+			if(!nranges) {
+				build->failed = mTRUE;
+				return(1);
+			}
+			map->ranges = nranges;
+			map->size = nsize;
+		}
+		range = &map->ranges[map->count++];
+		range->start = info->dlpi_addr + phdr->p_vaddr;
+		range->end = range->start + phdr->p_memsz;
+		range->plugin = plugin;
+	}
+	return(0);
+}
+
+void DLLINTERNAL modmap_update(void) {
+	modmap_build_t build;
+	struct link_map *lmap;
+	MPlugin *iplug;
+	int i;
+
+	memset(&build, 0, sizeof(build));
+	for(i=0; Plugins && i < Plugins->endlist; i++) {
+		iplug = &Plugins->plist[i];
+		if(!iplug->handle)
+			continue;
+		lmap = NULL;
+		if(dlinfo(iplug->handle, RTLD_DI_LINKMAP, &lmap) != 0 || !lmap)
+			continue;
+		build.owners[build.num_owners].l_addr = lmap->l_addr;
+		build.owners[build.num_owners].l_name = lmap->l_name ? lmap->l_name : "";
+		build.owners[build.num_owners].plugin = iplug;
+		build.num_owners++;
+	}
+
+	build.map = (modmap_t *)calloc(1, sizeof(modmap_t));
+	if(build.map) {
+		modmap_counts(&build.map->adds, &build.map->subs);
+		dl_iterate_phdr(modmap_add_module, &build);
+	}
+	if(!build.map || build.failed) {
+		// An outdated map could still claim memory of a closed plugin,
+		// so go without one; lookups fall back to dladdr().
+		META_ERROR("Failed malloc() for module address map");
+		modmap_free(build.map);
+		build.map = NULL;
+	}
+	else
+		qsort(build.map->ranges, build.map->count, sizeof(modmap_range_t), modmap_compare);
+
+	modmap_free(retired_modmap);
+	retired_modmap = cur_modmap;
+	cur_modmap = build.map;
+
+	META_DEBUG(7, ("Updated module address map; %d ranges, %d plugins", 
+				cur_modmap ? cur_modmap->count : 0, build.num_owners));
+}
+
+mBOOL DLLINTERNAL modmap_refresh(void) {
+	unsigned long long adds, subs;
+
+	if(!modmap_counts(&adds, &subs))
+		return(mFALSE);
+	if(!cur_modmap || cur_modmap->adds != adds || cur_modmap->subs != subs) {
+		META_DEBUG(7, ("Modules loaded or unloaded since module address map was taken"));
+		modmap_update();
+	}
+	return(cur_modmap ? mTRUE : mFALSE);
+}
+
+const modmap_range_t * DLLINTERNAL modmap_find(const void *memptr) {
+	const modmap_t *map = cur_modmap;
+	unsigned long addr = (unsigned long)memptr;
+	int lo, hi, mid;
+
+	if(!map)
+		return(NULL);
+	// last range starting at or below addr
+	lo = 0;
+	hi = map->count;
+	while(lo < hi) {
+		mid = lo + (hi - lo) / 2;
+		if(map->ranges[mid].start <= addr)
+			lo = mid + 1;
+		else
+			hi = mid;
+	}
+	if(lo == 0 || addr >= map->ranges[lo - 1].end)
+		return(NULL);
+	return(&map->ranges[lo - 1]);
+}
+
+MPlugin * DLLINTERNAL modmap_find_plugin(const void *memptr) {
+	const modmap_range_t *range = modmap_find(memptr);
+	return(range ? range->plugin : NULL);
+}
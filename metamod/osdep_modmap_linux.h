@@ -0,0 +1,69 @@
+/*
+ * Copyright (c) 2004-2006 Jussi Kivilinna
+ *
+ *    This file is part of "Metamod All-Mod-Support"-patch for Metamod.
+ *
+ *    Metamod is free software; you can redistribute it and/or modify it
+ *    under the terms of the GNU General Public License as published by the
+ *    Free Software Foundation; either version 2 of the License, or (at
+ *    your option) any later version.
+ *
+ *    Metamod is distributed in the hope that it will be useful, but
+ *    WITHOUT ANY WARRANTY; without even the implied warranty of
+ *    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ *    General Public License for more details.
+ *
+ *    You should have received a copy of the GNU General Public License
+ *    along with Metamod; if not, write to the Free Software Foundation,
+ *    Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+ *
+ *    In addition, as a special exception, the author gives permission to
+ *    link the code of this program with the Half-Life Game Engine ("HL
+ *    Engine") and Modified Game Libraries ("MODs") developed by Valve,
+ *    L.L.C ("Valve").  You must obey the GNU General Public License in all
+ *    respects for all of the code used other than the HL Engine and MODs
+ *    from Valve.  If you modify this file, you may extend this exception
+ *    to your version of the file, but you are not obligated to do so.  If
+ *    you do not wish to do so, delete this exception statement from your
+ *    version.
+ *
+ */
+
+#ifndef OSDEP_MODMAP_LINUX_H
+#define OSDEP_MODMAP_LINUX_H
+
+#include "types_meta.h"		// mBOOL
+#include "osdep.h"			// DLLINTERNAL
+
+class MPlugin;
+
+// Sorted map of the address ranges (PT_LOAD segments) of every module in
+// the process, each tagged with the plugin it belongs to, if any.  Lookups
+// are a binary search, instead of a dladdr() and a pathname compare
+// against every plugin.
+//
+// The map is a snapshot; it is refreshed whenever metamod opens or closes
+// a plugin or the game dll.  Libraries loaded by someone else since then
+// are not in it, so a miss only means "don't know" and callers fall back
+// to dladdr().
+typedef struct modmap_range_s {
+	unsigned long start;			// [start, end)
+	unsigned long end;
+	MPlugin *plugin;				// owning plugin, or NULL
+} modmap_range_t;
+
+// Re-read loaded modules and plugin handles.
+void DLLINTERNAL modmap_update(void);
+
+// Re-read them if any library was loaded or unloaded since, by anyone.
+// Returns whether the snapshot is now complete; false if it can't tell.
+mBOOL DLLINTERNAL modmap_refresh(void);
+
+// Range containing memptr, or NULL if not in the snapshot.  Usable for
+// attributing arbitrary code addresses, eg. profiler samples, to plugins.
+const modmap_range_t * DLLINTERNAL modmap_find(const void *memptr);
+
+// Plugin whose module contains memptr, or NULL.
+MPlugin * DLLINTERNAL modmap_find_plugin(const void *memptr);
+
+#endif /* OSDEP_MODMAP_LINUX_H */
@@ -40,6 +40,10 @@
 //  --Jussi Kivilinna
 mBOOL DLLINTERNAL is_gamedll(const char *filename);
 
+// Gets the build-id of a dll as a hex string, where the file format has
+// one (ELF NT_GNU_BUILD_ID note); used to key the autodetect cache.
+mBOOL DLLINTERNAL get_dll_build_id(const char *filename, char *hexbuf, int buflen);
+
 // MSVC doesn't provide opendir/readdir/closedir, so we write our own.
 //  --Jussi Kivilinna
 #ifdef _WIN32
@@ -0,0 +1,209 @@
+/*
+ * Copyright (c) 2004-2006 Jussi Kivilinna
+ *
+ *    This file is part of "Metamod All-Mod-Support"-patch for Metamod.
+ *
+ *    Metamod is free software; you can redistribute it and/or modify it
+ *    under the terms of the GNU General Public License as published by the
+ *    Free Software Foundation; either version 2 of the License, or (at
+ *    your option) any later version.
+ *
+ *    Metamod is distributed in the hope that it will be useful, but
+ *    WITHOUT ANY WARRANTY; without even the implied warranty of
+ *    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ *    General Public License for more details.
+ *
+ *    You should have received a copy of the GNU General Public License
+ *    along with Metamod; if not, write to the Free Software Foundation,
+ *    Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+ *
+ *    In addition, as a special exception, the author gives permission to
+ *    link the code of this program with the Half-Life Game Engine ("HL
+ *    Engine") and Modified Game Libraries ("MODs") developed by Valve,
+ *    L.L.C ("Valve").  You must obey the GNU General Public License in all
+ *    respects for all of the code used other than the HL Engine and MODs
+ *    from Valve.  If you modify this file, you may extend this exception
+ *    to your version of the file, but you are not obligated to do so.  If
+ *    you do not wish to do so, delete this exception statement from your
+ *    version.
+ *
+ */
+
+#include <string.h>			// strcmp, strrchr
+#include <atomic>			// std::atomic
+#include <thread>			// std::thread
+#ifdef linux
+#include <fcntl.h>			// open
+#include <unistd.h>			// read, write, close, unlink
+#endif
+
+#include <extdll.h>			// always
+
+#include "plugin_preload.h"	// me
+#include "metamod.h"		// Plugins, GameDLL
+#include "log_meta.h"		// META_LOG, etc
+#include "support_meta.h"	// STRNCPY
+#ifdef linux
+	#include "osdep_modmap_linux.h"	// modmap_update
+#endif
+
+typedef enum {
+	PRELOAD_NONE = 0,
+	PRELOAD_RUNNING,		// worker thread is loading
+	PRELOAD_DONE,			// worker finished; handle or error is set
+} preload_state_t;
+
+typedef struct preload_s {
+	std::atomic<int> state;
+	char pathname[PATH_MAX];	// file being loaded, to check slot wasn't reused
+	DLHANDLE handle;
+	char error[256];
+} preload_t;
+
+// By plugin index; worker threads only touch their own entry, and only
+// until they set PRELOAD_DONE.
+static preload_t preloads[MAX_PLUGINS + 1];
+
+#ifdef linux
+// Numbers copies; the loader would also match the name of a copy loaded
+// earlier.
+static std::atomic<unsigned int> preload_copies(0);
+
+// Copy the plugin's file to a hidden file next to it, for loading as a
+// module of its own.  The loader matches modules by name and by inode, so
+// neither the same path nor a hard link would do.
+static mBOOL DLLINTERNAL preload_copy(preload_t *pre, char *copypath, size_t size) {
+	char buf[65536];
+	const char *file;
+	ssize_t len;
+	int in, out;
+	mBOOL ok;
+
+	if((file=strrchr(pre->pathname, '/')) == nullptr)
+		return(mFALSE);
+	file++;
+	safevoid_snprintf(copypath, size, "%.*s.%s.bgload.%d.%u", (int)(file - pre->pathname), 
+			pre->pathname, file, (int)getpid(), preload_copies.fetch_add(1));
+	if((in=open(pre->pathname, O_RDONLY)) < 0)
+		return(mFALSE);
+	if((out=open(copypath, O_WRONLY | O_CREAT | O_TRUNC, 0700)) < 0) {
+		close(in);
+		return(mFALSE);
+	}
+	ok = mTRUE;
+	while(ok && (len=read(in, buf, sizeof(buf))) != 0) {
+		if(len < 0 || write(out, buf, len) != len)
+			ok = mFALSE;
+	}
+	close(in);
+	if(close(out) != 0)
+		ok = mFALSE;
+	if(!ok)
+		unlink(copypath);
+	return(ok);
+}
+#endif
+
+static void DLLINTERNAL preload_worker(preload_t *pre) {
+#ifdef linux
+	char copypath[PATH_MAX];
+
+	// Load a copy; the file is only needed until it's mapped.  If there's
+	// no copy (eg. directory not writable), the loader hands back the
+	// running module, and the plugin is reloaded the usual way.
+	if(preload_copy(pre, copypath, sizeof(copypath))) {
+		pre->handle = DLOPEN(copypath);
+		if(!pre->handle)
+			STRNCPY(pre->error, dlerror(), sizeof(pre->error));
+		unlink(copypath);
+	}
+	else {
+		pre->handle = DLOPEN(pre->pathname);
+		if(!pre->handle)
+			STRNCPY(pre->error, dlerror(), sizeof(pre->error));
+	}
+#else
+	pre->handle = DLOPEN(pre->pathname);
+	if(!pre->handle)
+		safevoid_snprintf(pre->error, sizeof(pre->error), "error %d", GetLastError());
+#endif
+	pre->state.store(PRELOAD_DONE, std::memory_order_release);
+}
+
+mBOOL DLLINTERNAL preload_start(MPlugin *plug) {
+	preload_t *pre = &preloads[plug->index];
+
+	if(plug->status < PL_RUNNING)
+		RETURN_ERRNO(mFALSE, ME_BADREQ);
+	if(pre->state.load(std::memory_order_acquire) != PRELOAD_NONE)
+		RETURN_ERRNO(mFALSE, ME_ALREADY);
+
+	STRNCPY(pre->pathname, plug->pathname, sizeof(pre->pathname));
+	pre->handle = NULL;
+	pre->error[0] = '\0';
+	pre->state.store(PRELOAD_RUNNING, std::memory_order_release);
+	std::thread(preload_worker, pre).detach();
+	META_DEBUG(3, ("dll: Loading plugin '%s' in the background from '%s'", plug->desc, pre->pathname));
+	return(mTRUE);
+}
+
+// Whether the loader gave us a module we already have, rather than a new
+// copy of the file.
+static mBOOL DLLINTERNAL is_known_handle(DLHANDLE handle) {
+	int i;
+
+	if(handle == GameDLL.handle)
+		return(mTRUE);
+	for(i=0; i < Plugins->endlist; i++) {
+		if(Plugins->plist[i].handle == handle)
+			return(mTRUE);
+	}
+	return(mFALSE);
+}
+
+void DLLINTERNAL preload_frame(void) {
+	preload_t *pre;
+	MPlugin *plug;
+	DLHANDLE handle;
+	int i;
+
+	if(!Plugins)
+		return;
+	for(i=1; i <= MAX_PLUGINS; i++) {
+		pre = &preloads[i];
+		if(likely(pre->state.load(std::memory_order_acquire) != PRELOAD_DONE))
+			continue;
+		handle = pre->handle;
+		pre->handle = NULL;
+		pre->state.store(PRELOAD_NONE, std::memory_order_release);
+
+		plug = i <= Plugins->endlist ? &Plugins->plist[i - 1] : NULL;
+		if(!plug || plug->status < PL_RUNNING || strcmp(plug->pathname, pre->pathname)) {
+			META_DEBUG(3, ("dll: Dropping background load of '%s'; plugin was unloaded", pre->pathname));
+			if(handle) {
+				DLCLOSE(handle);
+#ifdef linux
+				modmap_update();
+#endif
+			}
+			continue;
+		}
+		if(!handle) {
+			META_WARNING("dll: Failed background load of plugin '%s'; couldn't open file '%s': %s", 
+					plug->desc, pre->pathname, pre->error);
+			continue;
+		}
+		if(is_known_handle(handle)) {
+			// just another reference; reload from disk the usual way
+			META_DEBUG(3, ("dll: Background load of plugin '%s' gave an already loaded module", plug->desc));
+			DLCLOSE(handle);
+			handle = NULL;
+		}
+
+		plug->action = PA_RELOAD;
+		if(plug->reload_preloaded(PT_ANYTIME, PNL_COMMAND, handle))
+			META_LOG("dll: Reloaded plugin '%s'%s", plug->desc, handle ? " from background load" : "");
+		else
+			META_WARNING("dll: Failed background reload of plugin '%s'", plug->desc);
+	}
+}
@@ -0,0 +1,62 @@
+/*
+ * Copyright (c) 2004-2006 Jussi Kivilinna
+ *
+ *    This file is part of "Metamod All-Mod-Support"-patch for Metamod.
+ *
+ *    Metamod is free software; you can redistribute it and/or modify it
+ *    under the terms of the GNU General Public License as published by the
+ *    Free Software Foundation; either version 2 of the License, or (at
+ *    your option) any later version.
+ *
+ *    Metamod is distributed in the hope that it will be useful, but
+ *    WITHOUT ANY WARRANTY; without even the implied warranty of
+ *    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ *    General Public License for more details.
+ *
+ *    You should have received a copy of the GNU General Public License
+ *    along with Metamod; if not, write to the Free Software Foundation,
+ *    Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+ *
+ *    In addition, as a special exception, the author gives permission to
+ *    link the code of this program with the Half-Life Game Engine ("HL
+ *    Engine") and Modified Game Libraries ("MODs") developed by Valve,
+ *    L.L.C ("Valve").  You must obey the GNU General Public License in all
+ *    respects for all of the code used other than the HL Engine and MODs
+ *    from Valve.  If you modify this file, you may extend this exception
+ *    to your version of the file, but you are not obligated to do so.  If
+ *    you do not wish to do so, delete this exception statement from your
+ *    version.
+ *
+ */
+
+#ifndef PLUGIN_PRELOAD_H
+#define PLUGIN_PRELOAD_H
+
+#include "types_meta.h"		// mBOOL
+#include "mplugin.h"		// MPlugin
+#include "osdep.h"			// DLLINTERNAL
+
+// Background reload of a plugin, for "meta bgreload".
+//
+// The plugin's file is dlopen()ed again on a worker thread, so reading
+// it, relocating it and running its static constructors doesn't hold up
+// a frame.  At the next StartFrame the running copy is unloaded, and the
+// new one queried and attached from the handle already open.  Meta_Query
+// and Meta_Attach still run on the main thread, as plugins call engine
+// functions from them.
+//
+// The loader hands back the running module for the same pathname, so
+// under linux the worker loads a copy of the file, made next to it and
+// removed once loaded.  Where it can't (no copy, or win32), the plugin is
+// reloaded the usual way.
+
+// Start loading the plugin's file in the background.
+// meta_errno values:
+//  - ME_ALREADY	background load already in progress for this plugin
+//  - ME_BADREQ		plugin not running
+mBOOL DLLINTERNAL preload_start(MPlugin *plug);
+
+// Swap in plugins that finished loading; called at StartFrame.
+void DLLINTERNAL preload_frame(void);
+
+#endif /* PLUGIN_PRELOAD_H */
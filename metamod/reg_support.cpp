@@ -43,6 +43,7 @@
 #endif /* linux */
 
 #include <string.h>			// strsignal, etc
+#include <utility>			// std::index_sequence
 
 #include <extdll.h>			// always
 #include "sdk_util.h"		// REG_SVR_COMMAND, etc
@@ -50,6 +51,7 @@
 #include "reg_support.h"	// me
 #include "metamod.h"            // RegCmds, g_Players, etc
 #include "log_meta.h"		// META_ERROR, etc
+#include "api_hook.h"		// rebuild_api_hook_lists
 
 // "Register" support.
 //
@@ -159,6 +161,102 @@ void DLLHIDDEN meta_AddServerCommand(const char *cmd_name, void (*function) (voi
 }
 
 
+// Register a client command for a plugin, for REG_CLIENT_COMMAND.  Unlike
+// server commands, nothing is registered with the engine; the gamedll's
+// ClientCommand is where client commands show up, and that's where
+// metamod looks them up (below).  A NULL function removes the plugin's
+// command.  Commands are disabled along with the plugin's server commands
+// when it's unloaded.
+// meta_errno values:
+//  - ME_ARGUMENT	missing command name
+//  - ME_ALREADY	another running plugin has the command
+//  - ME_NOTFOUND	removing a command the plugin doesn't have
+//  - ME_NOMEM		couldn't add to the list
+mBOOL DLLINTERNAL meta_RegClientCommand(MPlugin *plug, const char *cmd_name, REG_CLIENT_CMD_FN function) {
+	MPlugin *owner;
+	MRegCmd *icmd;
+
+	META_DEBUG(4, ("called: meta_RegClientCommand; plugin=%s, cmd_name=%s, function=%p", plug->desc, cmd_name, function));
+	if(!cmd_name || !cmd_name[0])
+		RETURN_ERRNO(mFALSE, ME_ARGUMENT);
+
+	icmd=RegClientCmds->find(cmd_name);
+	if(!function) {
+		if(!icmd || icmd->status != RG_VALID || icmd->plugid != plug->index)
+			RETURN_ERRNO(mFALSE, ME_NOTFOUND);
+		icmd->status=RG_INVALID;
+		icmd->pfnClientCmd=NULL;
+		// plugin may not need its ClientCommand dispatch hook anymore
+		rebuild_api_hook_lists();
+		return(mTRUE);
+	}
+
+	if(icmd && icmd->status==RG_VALID && icmd->plugid != plug->index) {
+		owner=Plugins->find(icmd->plugid);
+		META_WARNING("Plugin '%s' can't register client command '%s'; plugin '%s' has it", 
+				plug->desc, cmd_name, owner ? owner->desc : "(unknown)");
+		RETURN_ERRNO(mFALSE, ME_ALREADY);
+	}
+	// Reuse a command from an unloaded plugin, ie a "reloaded" plugin.
+	if(!icmd) {
+		icmd=RegClientCmds->add(cmd_name);
+		if(!icmd) {
+			// error details logged in add()
+			return(mFALSE);
+		}
+	}
+
+	icmd->pfnClientCmd=function;
+	icmd->plugid=plug->index;
+	icmd->status=RG_VALID;
+	// plugin gets a ClientCommand dispatch hook, if it has none yet
+	rebuild_api_hook_lists();
+	return(mTRUE);
+}
+
+// ClientCommand pre hook for a plugin's registered client commands.  The
+// hook lists call it in the plugin's place among the other plugins'
+// ClientCommand pre hooks (see meta_client_command_hook), so priorities,
+// MRES_SUPERCEDE and post hooks work as if the plugin hooked
+// ClientCommand itself.  Looks up the engine's tokenized command, and
+// calls the plugin's function if the command is the plugin's; a handled
+// command supercedes the gamedll's ClientCommand.
+static void DLLINTERNAL client_command_dispatch(int plugin_index, edict_t *pEntity) {
+	MRegCmd *icmd;
+	const char *cmd;
+	qboolean handled;
+
+	PublicMetaGlobals.mres=MRES_IGNORED;
+	cmd=CMD_ARGV(0);
+	if(!cmd || !(icmd=RegClientCmds->find(cmd)) || icmd->status != RG_VALID || icmd->plugid != plugin_index)
+		return;
+
+	META_DEBUG(5, ("Calling plugin %d: client command '%s'", plugin_index, cmd));
+	handled=FALSE;
+	if(icmd->call(pEntity, &handled) == mTRUE && handled)
+		PublicMetaGlobals.mres=MRES_SUPERCEDE;
+}
+
+// One hook function per plugin index, as hook lists tell plugins apart
+// by their functions.
+template<int plugin_index>
+static void client_command_hook(edict_t *pEntity) {
+	client_command_dispatch(plugin_index, pEntity);
+}
+
+template<size_t... I>
+static void * DLLINTERNAL client_command_hook_at(int plugin_index, std::index_sequence<I...>) {
+	static void (* const hooks[])(edict_t *) = { &client_command_hook<I>... };
+	return((void *)hooks[plugin_index]);
+}
+
+void * DLLINTERNAL meta_client_command_hook(int plugin_index) {
+	if(!RegClientCmds || plugin_index < 1 || plugin_index > MAX_PLUGINS || !RegClientCmds->any_valid(plugin_index))
+		return(NULL);
+	return(client_command_hook_at(plugin_index, std::make_index_sequence<MAX_PLUGINS + 1>()));
+}
+
+
 // Replacement for engine routine CVarRegister; called by plugins.  Rather
 // then handing the engine the plugin's cvar structure (which is allocated
 // in the plugin DLL), this hands the engine a cvar structure allocated
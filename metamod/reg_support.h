@@ -38,10 +38,15 @@
 #define REG_SUPPORT_H
 
 #include "mreg.h"			// REG_CMD_FN, etc
+#include "mplugin.h"		// MPlugin
 
 // these are only 'hidden' because called from outside (plugins and engine)
 void DLLHIDDEN meta_command_handler(void);
 void DLLHIDDEN meta_AddServerCommand(const char *cmd_name, REG_CMD_FN function);
+mBOOL DLLINTERNAL meta_RegClientCommand(MPlugin *plug, const char *cmd_name, REG_CLIENT_CMD_FN function);
+// ClientCommand pre hook dispatching plugin's registered client commands;
+// NULL if it has none.
+void * DLLINTERNAL meta_client_command_hook(int plugin_index);
 void DLLHIDDEN meta_CVarRegister(cvar_t *pCvar);
 int DLLHIDDEN meta_RegUserMsg(const char *pszName, int iSize);
 void DLLHIDDEN meta_QueryClientCvarValue(const edict_t *player, const char *cvarName);
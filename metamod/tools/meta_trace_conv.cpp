@@ -0,0 +1,293 @@
+/*
+ * Copyright (c) 2004-2006 Jussi Kivilinna
+ *
+ *    This file is part of "Metamod All-Mod-Support"-patch for Metamod.
+ *
+ *    Metamod is free software; you can redistribute it and/or modify it
+ *    under the terms of the GNU General Public License as published by the
+ *    Free Software Foundation; either version 2 of the License, or (at
+ *    your option) any later version.
+ *
+ *    Metamod is distributed in the hope that it will be useful, but
+ *    WITHOUT ANY WARRANTY; without even the implied warranty of
+ *    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ *    General Public License for more details.
+ *
+ *    You should have received a copy of the GNU General Public License
+ *    along with Metamod; if not, write to the Free Software Foundation,
+ *    Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+ *
+ *    In addition, as a special exception, the author gives permission to
+ *    link the code of this program with the Half-Life Game Engine ("HL
+ *    Engine") and Modified Game Libraries ("MODs") developed by Valve,
+ *    L.L.C ("Valve").  You must obey the GNU General Public License in all
+ *    respects for all of the code used other than the HL Engine and MODs
+ *    from Valve.  If you modify this file, you may extend this exception
+ *    to your version of the file, but you are not obligated to do so.  If
+ *    you do not wish to do so, delete this exception statement from your
+ *    version.
+ *
+ */
+
+// meta_trace_conv - convert "meta trace dump" files for analysis.
+//
+//	meta_trace_conv folded <dump> [<output>]
+//		Folded stacks ("thread 0;plugin:dllapi.StartFrame;engine:... 1234"),
+//		for flamegraph.pl and similar.  Counts are self time in
+//		nanoseconds, or in TSC ticks if the dump wasn't calibrated.
+//
+//	meta_trace_conv chrome <dump> [<output>]
+//		Chrome trace event JSON, for chrome://tracing or Perfetto.
+//
+// Output goes to stdout unless a file is given.
+
+#include <errno.h>
+#include <stdio.h>
+#include <string.h>
+
+#include <algorithm>
+#include <map>
+#include <string>
+#include <vector>
+
+#include "api_trace_format.h"
+
+static const char *mres_names[] = {
+	"MRES_UNSET",
+	"MRES_IGNORED",
+	"MRES_HANDLED",
+	"MRES_OVERRIDE",
+	"MRES_SUPERCEDE",
+};
+
+typedef struct trace_s {
+	api_trace_header_t header;
+	std::vector<std::string> funcs;
+	std::vector<std::string> slots;
+	std::vector<api_trace_rec_t> recs;
+} trace_t;
+
+static bool read_trace(const char *filename, trace_t *trace) {
+	std::vector<char> buf;
+	size_t pos, len;
+	unsigned int i;
+	FILE *fp;
+	char chunk[65536];
+
+	fp = fopen(filename, "rb");
+	if(!fp) {
+		fprintf(stderr, "Couldn't open '%s': %s\n", filename, strerror(errno));
+		return(false);
+	}
+	while((len = fread(chunk, 1, sizeof(chunk), fp)) > 0)
+		buf.insert(buf.end(), chunk, chunk + len);
+	fclose(fp);
+
+	if(buf.size() < sizeof(api_trace_header_t)) {
+		fprintf(stderr, "'%s' is too short for a trace dump\n", filename);
+		return(false);
+	}
+	memcpy(&trace->header, &buf[0], sizeof(api_trace_header_t));
+	if(memcmp(trace->header.magic, API_TRACE_MAGIC, sizeof(trace->header.magic))) {
+		fprintf(stderr, "'%s' isn't a trace dump\n", filename);
+		return(false);
+	}
+	if(trace->header.version != API_TRACE_VERSION) {
+		fprintf(stderr, "'%s' is trace dump version %u; expected %u\n", filename,
+				trace->header.version, API_TRACE_VERSION);
+		return(false);
+	}
+
+	pos = sizeof(api_trace_header_t);
+	for(i=0; i < trace->header.num_funcs + trace->header.num_slots; i++) {
+		len = strnlen(&buf[pos], buf.size() - pos);
+		if(pos + len >= buf.size()) {
+			fprintf(stderr, "'%s' is truncated\n", filename);
+			return(false);
+		}
+		if(i < trace->header.num_funcs)
+			trace->funcs.push_back(std::string(&buf[pos], len));
+		else
+			trace->slots.push_back(std::string(&buf[pos], len));
+		pos += len + 1;
+	}
+
+	if((buf.size() - pos) / sizeof(api_trace_rec_t) < trace->header.num_recs) {
+		fprintf(stderr, "'%s' is truncated\n", filename);
+		return(false);
+	}
+	trace->recs.resize(trace->header.num_recs);
+	if(trace->header.num_recs)
+		memcpy(&trace->recs[0], &buf[pos], trace->header.num_recs * sizeof(api_trace_rec_t));
+	return(true);
+}
+
+// "plugin:api.Function", with "_Post" for post hooks.  Real routines are
+// shown as owned by the gamedll, or just "engine.Function".
+static std::string frame_name(const trace_t *trace, const api_trace_rec_t *rec) {
+	std::string name;
+	const std::string *func;
+	static const std::string unknown = "?";
+
+	func = rec->func < trace->funcs.size() ? &trace->funcs[rec->func] : &unknown;
+	if(rec->slot == 0 && !func->compare(0, 7, "engine."))
+		return(*func);
+	if(rec->slot < trace->slots.size() && !trace->slots[rec->slot].empty())
+		name = trace->slots[rec->slot];
+	else {
+		char buf[32];
+		snprintf(buf, sizeof(buf), "plugin#%u", rec->slot);
+		name = buf;
+	}
+	name += ':';
+	name += *func;
+	if(rec->post)
+		name += "_Post";
+	return(name);
+}
+
+// Order records as calls were made: by thread, then start time, with
+// outer calls before the calls nested in them.
+static bool rec_order(const api_trace_rec_t &a, const api_trace_rec_t &b) {
+	if(a.thread != b.thread)
+		return(a.thread < b.thread);
+	if(a.tsc != b.tsc)
+		return(a.tsc < b.tsc);
+	return(a.duration > b.duration);
+}
+
+static void write_folded(trace_t *trace, FILE *out) {
+	std::map<std::string, unsigned long long> stacks;
+	std::map<std::string, unsigned long long>::iterator it;
+	std::vector<const api_trace_rec_t *> stack;
+	std::vector<unsigned long long> self;
+	std::vector<std::string> paths;
+	const api_trace_rec_t *rec;
+	double scale;
+	size_t i;
+	char buf[32];
+
+	// nanoseconds per tick
+	scale = trace->header.tsc_per_usec > 0 ? 1000.0 / trace->header.tsc_per_usec : 1.0;
+
+	std::sort(trace->recs.begin(), trace->recs.end(), rec_order);
+	for(i=0; i <= trace->recs.size(); i++) {
+		rec = i < trace->recs.size() ? &trace->recs[i] : NULL;
+		// close calls that ended before this one started
+		while(!stack.empty() && (!rec || rec->thread != stack.back()->thread
+					|| stack.back()->tsc + stack.back()->duration <= rec->tsc)) {
+			stacks[paths.back()] += (unsigned long long)(self.back() * scale + 0.5);
+			stack.pop_back();
+			self.pop_back();
+			paths.pop_back();
+		}
+		if(!rec)
+			break;
+		if(!stack.empty())
+			self.back() -= std::min<unsigned long long>(self.back(), rec->duration);
+		if(stack.empty()) {
+			snprintf(buf, sizeof(buf), "thread %u", rec->thread);
+			paths.push_back(std::string(buf) + ";" + frame_name(trace, rec));
+		}
+		else
+			paths.push_back(paths.back() + ";" + frame_name(trace, rec));
+		stack.push_back(rec);
+		self.push_back(rec->duration);
+	}
+
+	for(it = stacks.begin(); it != stacks.end(); ++it) {
+		if(it->second)
+			fprintf(out, "%s %llu\n", it->first.c_str(), it->second);
+	}
+}
+
+static void write_json_string(const std::string &s, FILE *out) {
+	size_t i;
+	unsigned char c;
+
+	fputc('"', out);
+	for(i=0; i < s.size(); i++) {
+		c = (unsigned char)s[i];
+		if(c == '"' || c == '\\')
+			fprintf(out, "\\%c", c);
+		else if(c < 0x20)
+			fprintf(out, "\\u%04x", c);
+		else
+			fputc(c, out);
+	}
+	fputc('"', out);
+}
+
+static void write_chrome(trace_t *trace, FILE *out) {
+	const api_trace_rec_t *rec;
+	unsigned long long base;
+	double tpu;
+	size_t i;
+
+	// without calibration, show ticks as if they were microseconds
+	tpu = trace->header.tsc_per_usec > 0 ? trace->header.tsc_per_usec : 1.0;
+
+	std::sort(trace->recs.begin(), trace->recs.end(), rec_order);
+	base = ~0ULL;
+	for(i=0; i < trace->recs.size(); i++)
+		base = std::min<unsigned long long>(base, trace->recs[i].tsc);
+
+	fprintf(out, "{\"displayTimeUnit\":\"ns\",\"traceEvents\":[\n");
+	for(i=0; i < trace->recs.size(); i++) {
+		rec = &trace->recs[i];
+		fprintf(out, "%s{\"name\":", i ? ",\n" : "");
+		write_json_string(frame_name(trace, rec), out);
+		fprintf(out, ",\"cat\":\"%s\",\"ph\":\"X\",\"ts\":%.3f,\"dur\":%.3f,\"pid\":1,\"tid\":%u",
+				rec->slot == 0 ? "real" : (rec->post ? "post" : "pre"),
+				(rec->tsc - base) / tpu, rec->duration / tpu, rec->thread);
+		if(rec->slot != 0)
+			fprintf(out, ",\"args\":{\"mres\":\"%s\"}",
+					rec->mres < sizeof(mres_names) / sizeof(mres_names[0]) ? mres_names[rec->mres] : "?");
+		fputc('}', out);
+	}
+	fprintf(out, "\n]}\n");
+}
+
+static void usage(void) {
+	fprintf(stderr, "usage: meta_trace_conv folded|chrome <dump> [<output>]\n");
+}
+
+int main(int argc, char **argv) {
+	trace_t trace;
+	FILE *out;
+	bool folded;
+
+	if(argc < 3 || argc > 4) {
+		usage();
+		return(2);
+	}
+	if(!strcmp(argv[1], "folded"))
+		folded = true;
+	else if(!strcmp(argv[1], "chrome"))
+		folded = false;
+	else {
+		usage();
+		return(2);
+	}
+
+	if(!read_trace(argv[2], &trace))
+		return(1);
+
+	out = stdout;
+	if(argc == 4) {
+		out = fopen(argv[3], "w");
+		if(!out) {
+			fprintf(stderr, "Couldn't open '%s': %s\n", argv[3], strerror(errno));
+			return(1);
+		}
+	}
+	if(folded)
+		write_folded(&trace, out);
+	else
+		write_chrome(&trace, out);
+	if(out != stdout && fclose(out) != 0) {
+		fprintf(stderr, "Couldn't write '%s': %s\n", argv[3], strerror(errno));
+		return(1);
+	}
+	return(0);
+}